@@ -0,0 +1,110 @@
+#include "agendador.h"
+
+#include "hal.h"
+
+#define AGENDADOR_MODOS_MAX 8
+
+static const Modo *tabela = nullptr;
+static uint8_t nModos = 0;
+static uint8_t atual = 0;
+static int16_t pedido = -1; // -1 = nenhum
+static bool interromper = false;
+static void (*observador)(const AcqSample &a) = nullptr;
+
+static LatenciaModo latencia[AGENDADOR_MODOS_MAX];
+static bool primeiraVolta = true;
+static uint32_t inicioUs = 0;
+static uint8_t modoMedido = 0; // o modo que corre entre duas voltas
+
+static void terminar(bool interrompido) {
+  if (atual != 0 && tabela[atual].sair)
+    tabela[atual].sair(interrompido);
+  atual = 0;
+  latencia[0] = LatenciaModo();
+}
+
+static void arrancarPedido() {
+  while (atual == 0 && pedido >= 0) {
+    uint8_t m = (uint8_t)pedido;
+    pedido = -1;
+    latencia[m] = LatenciaModo();
+    if (tabela[m].entrar && !tabela[m].entrar())
+      continue; // não arrancou: fica em idle
+    atual = m;
+  }
+}
+
+void agendadorBegin(const Modo *modos, uint8_t n) {
+  tabela = modos;
+  nModos = n < AGENDADOR_MODOS_MAX ? n : AGENDADOR_MODOS_MAX;
+  atual = 0;
+  pedido = -1;
+  interromper = false;
+  primeiraVolta = true;
+  for (uint8_t i = 0; i < nModos; i++)
+    latencia[i] = LatenciaModo();
+}
+
+void agendadorPedir(uint8_t modo) {
+  if (modo > 0 && modo < nModos)
+    pedido = modo;
+}
+
+void agendadorInterromper() { interromper = true; }
+
+uint8_t agendadorModo() { return atual; }
+
+void agendadorObservar(void (*f)(const AcqSample &a)) { observador = f; }
+
+uint16_t agendadorVolta(AcqSample &ultima) {
+  uint32_t agora = halMicros();
+  if (!primeiraVolta) {
+    LatenciaModo &l = latencia[modoMedido];
+    uint32_t intervalo = agora - inicioUs;
+    l.voltas++;
+    l.somaIntervaloUs += intervalo;
+    if (intervalo > l.maxIntervaloUs)
+      l.maxIntervaloUs = intervalo;
+  }
+  primeiraVolta = false;
+  inicioUs = agora;
+
+  if (interromper) {
+    interromper = false;
+    if (atual != 0)
+      terminar(true);
+  }
+  arrancarPedido();
+
+  // o modo que acaba a meio passa as amostras seguintes ao que está à
+  // espera (ou ao idle, que as descarta)
+  uint16_t n = 0;
+  AcqSample a;
+  while (acqRead(a)) {
+    n++;
+    ultima = a;
+    if (observador)
+      observador(a);
+    if (!tabela[atual].amostra(a)) {
+      terminar(false);
+      arrancarPedido();
+    }
+  }
+  if (tabela[atual].volta && !tabela[atual].volta(halMillis())) {
+    terminar(false);
+    arrancarPedido();
+  }
+  return n;
+}
+
+void agendadorFimVolta() {
+  LatenciaModo &l = latencia[atual];
+  uint32_t trabalho = halMicros() - inicioUs;
+  if (trabalho > l.maxTrabalhoUs)
+    l.maxTrabalhoUs = trabalho;
+  modoMedido = atual;
+}
+
+const LatenciaModo &agendadorLatencia(uint8_t modo) {
+  return latencia[modo < nModos ? modo : 0];
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <stdint.h>
+
+#include "eog_acq.h"
+
+// =================== AGENDADOR COOPERATIVO ===================
+// Os modos (idle, C, P, S, DL) são máquinas de estados: nenhum tem o seu
+// próprio while nem delays. Cada volta do loop() chama agendadorVolta(),
+// que trata as transições, passa ao modo atual as amostras que estão no anel
+// e chama a sua volta(); o resto do loop (comandos, RT, log, BLE) corre
+// sempre, seja qual for o modo.
+//
+// Um modo pedido com outro a correr fica à espera que este acabe (ou seja
+// interrompido com X) e arranca na mesma volta, a partir da amostra
+// seguinte do anel: P -> S não perde amostras.
+
+struct Modo {
+  const char *nome;
+  // false: não arrancou (ex.: DL sem ligação); volta logo ao idle
+  bool (*entrar)();
+  // cada amostra do anel, por ordem; false = o modo acabou
+  bool (*amostra)(const AcqSample &a);
+  // uma vez por volta, depois das amostras; false = o modo acabou
+  bool (*volta)(uint32_t agoraMs);
+  // interrompido: saiu por X, não por ter chegado ao fim
+  void (*sair)(bool interrompido);
+};
+
+// modos[0] é o idle (nunca acaba); a tabela tem de durar para sempre
+void agendadorBegin(const Modo *modos, uint8_t n);
+// em idle arranca na próxima volta; senão fica à espera (só um pedido)
+void agendadorPedir(uint8_t modo);
+// X: termina o modo atual; o pedido à espera, se houver, arranca a seguir
+void agendadorInterromper();
+uint8_t agendadorModo();
+// vê cada amostra do anel antes do modo, seja ele qual for (ex.: RAW);
+// nullptr = nenhum
+void agendadorObservar(void (*observador)(const AcqSample &a));
+// uma volta; devolve quantas amostras consumiu e a última em ultima
+uint16_t agendadorVolta(AcqSample &ultima);
+// fim do trabalho da volta (antes do delay que cede o CPU)
+void agendadorFimVolta();
+
+// latência do loop por modo, desde a última vez que o modo arrancou:
+// intervalo = início de uma volta ao início da seguinte (o que uma amostra
+// pode esperar no anel); trabalho = o que a volta gastou antes do delay
+struct LatenciaModo {
+  uint32_t voltas;
+  uint32_t maxIntervaloUs;
+  uint32_t maxTrabalhoUs;
+  uint64_t somaIntervaloUs;
+};
+const LatenciaModo &agendadorLatencia(uint8_t modo);
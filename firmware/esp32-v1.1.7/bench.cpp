@@ -0,0 +1,407 @@
+#include "bench.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "calibracao.h"
+#include "classificador.h"
+#include "hal.h"
+#include "raw_codec.h"
+#include "rt_frame.h"
+
+// amostras geradas de uma vez; cada etapa é medida sobre o bloco inteiro
+// para o custo de ler o contador não pesar
+#define BENCH_BLOCO 64
+#define BENCH_EVENTOS_BLOCO 8
+#define BENCH_PENDENTES 8
+// uma piscadela gerada que o detetor não fechou até aqui depois do fim
+#define BENCH_ESPERA_MS 300
+
+// grandes para a pilha do loop
+static RtFrameBuilder rtBench;
+static RawCodificador rawBench;
+
+// como C (main.cpp, calibracao.h) faria sobre este sinal, com as mesmas
+// paragens antecipadas
+static void calibrar(const SintParams &sint, const BlinkParams &forma,
+                     BenchResultado &r) {
+  BlinkParams &out = r.params;
+  SintParams s = sint;
+  s.bpm = 0;
+  GeradorEog g;
+  g.begin(s);
+  CalBaseline base;
+  base.begin(s.fsHz);
+  uint32_t nMin = (uint32_t)CAL_BASE_MIN_S * s.fsHz;
+  uint32_t n = (uint32_t)CAL_BASE_MAX_S * s.fsHz;
+  for (uint32_t i = 0; i < n; i++) {
+    uint32_t t;
+    base.add(g.proxima(t));
+    if ((i + 1) % (s.fsHz / 10) == 0 && base.pronta(nMin))
+      break;
+  }
+  out = forma;
+  out.limiarInferior = base.limiarInferior();
+
+  // 2/2: a piscar normalmente (qualquer evento conta)
+  s = sint;
+  s.fracLentas = 0;
+  s.semente = sint.semente ^ 0x9E3779B9UL;
+  g.begin(s);
+  BlinkDetector det;
+  det.setParams(out);
+  CalPiscadelas pisc;
+  pisc.begin();
+  n = (uint32_t)CAL_PISCAR_MAX_S * s.fsHz;
+  uint32_t i = 0;
+  while (i < n) {
+    uint32_t t;
+    uint16_t v = g.proxima(t);
+    i++;
+    BlinkEvent ev;
+    if (det.update(v, t, ev)) {
+      pisc.add((uint16_t)ev.amplitude);
+      if (pisc.pronta())
+        break;
+    }
+  }
+  r.calPiscadelas = (uint16_t)pisc.n();
+  r.calPiscarS = (uint16_t)(i / s.fsHz);
+  calAmplitudes(pisc.amplitudeRef(), out.amplitudeMin, out.amplitudeMinLenta);
+}
+
+// ---- piscadelas geradas à espera de um evento ----
+static SintPiscadela pendentes[BENCH_PENDENTES];
+static uint8_t nPendentes = 0;
+static void (*rotulos)(const BlinkEvent &ev, BlinkClass verdade) = nullptr;
+
+void benchRotulos(void (*rotulo)(const BlinkEvent &ev, BlinkClass verdade)) {
+  rotulos = rotulo;
+}
+
+static void falhou(BenchResultado &r, const SintPiscadela &p) {
+  r.eventos.fn++;
+  for (uint8_t m = 0; m < r.modelos; m++)
+    r.classe[m][p.cls].fn++;
+}
+static void retirar(uint8_t i) {
+  memmove(&pendentes[i], &pendentes[i + 1],
+          (nPendentes - i - 1) * sizeof(pendentes[0]));
+  nPendentes--;
+}
+static void emparelhar(BenchResultado &r, const BlinkEvent &ev,
+                       const BlinkClass *cls) {
+  int melhor = -1;
+  uint32_t melhorDt = BENCH_TOLERANCIA_MS * 1000UL + 1;
+  for (uint8_t i = 0; i < nPendentes; i++) {
+    int32_t d = (int32_t)(ev.tPicoUs - pendentes[i].tPicoUs);
+    uint32_t dt = (uint32_t)(d < 0 ? -d : d);
+    if (dt < melhorDt) {
+      melhorDt = dt;
+      melhor = i;
+    }
+  }
+  bool piscadela = ev.cls != BLINK_OTHER; // como o detetor a classifica
+  if (!piscadela)
+    r.outros++;
+  if (melhor < 0) {
+    if (rotulos)
+      rotulos(ev, BLINK_OTHER);
+    if (piscadela)
+      r.eventos.fp++;
+    for (uint8_t m = 0; m < r.modelos; m++)
+      if (cls[m] != BLINK_OTHER)
+        r.classe[m][cls[m]].fp++;
+    return;
+  }
+  BlinkClass verdade = pendentes[melhor].cls;
+  retirar((uint8_t)melhor);
+  if (rotulos)
+    rotulos(ev, verdade);
+  if (piscadela)
+    r.eventos.vp++;
+  else
+    r.eventos.fn++;
+  for (uint8_t m = 0; m < r.modelos; m++) {
+    if (cls[m] == verdade) {
+      r.classe[m][verdade].vp++;
+      continue;
+    }
+    r.classe[m][verdade].fn++;
+    if (cls[m] != BLINK_OTHER)
+      r.classe[m][cls[m]].fp++;
+  }
+}
+
+// o que passa de uma fatia para a seguinte (grande demais para a pilha)
+static struct {
+  BlinkDetector det;
+  OrientacaoFiltro orient;
+  GeradorEog g;
+  AccCalib acc;
+  uint32_t accPeriodoUs;
+  uint8_t dtMs;
+  uint32_t total; // amostras
+  uint32_t k;     // já passadas
+  uint32_t proxAccUs, proxJsonUs, proxMinutoUs;
+  int16_t roll, pitch;
+} corrida;
+
+void benchComecar(const SintParams &sint, uint32_t segundos,
+                  const BlinkParams &forma, const AccCalib &acc,
+                  BenchResultado &r) {
+  memset(&r, 0, sizeof(r));
+  r.segundos = segundos;
+  r.fsHz = sint.fsHz;
+  r.modelos = classificadorN() < BENCH_MODELOS ? classificadorN()
+                                               : BENCH_MODELOS;
+  calibrar(sint, forma, r);
+  corrida.det = BlinkDetector();
+  corrida.det.setParams(r.params);
+  corrida.acc = acc;
+  corrida.accPeriodoUs = 1000000UL / ACC_RATE_HZ;
+  corrida.orient.begin(acc, corrida.accPeriodoUs);
+  corrida.dtMs = (uint8_t)(1000 / sint.fsHz);
+  rtBench.reset(corrida.dtMs, 1);
+  rawBench.reset(sint.fsHz, 1);
+  nPendentes = 0;
+  corrida.g.begin(sint);
+  corrida.total = segundos * sint.fsHz;
+  corrida.k = 0;
+  corrida.proxAccUs = corrida.proxJsonUs = corrida.proxMinutoUs = 0;
+  corrida.roll = corrida.pitch = 0;
+}
+
+bool benchPasso(BenchResultado &r, uint32_t blocos) {
+  const AccCalib &acc = corrida.acc;
+  uint8_t dtMs = corrida.dtMs;
+  uint32_t total = corrida.total;
+  BlinkDetector &det = corrida.det;
+  int16_t &roll = corrida.roll, &pitch = corrida.pitch;
+  uint16_t v[BENCH_BLOCO];
+  uint32_t t[BENCH_BLOCO];
+  BlinkEvent evs[BENCH_EVENTOS_BLOCO];
+  AccSample accs[BENCH_BLOCO];
+  uint8_t trama[RT_FRAME_MAX_LEN];
+  char texto[RT_JSON_MAX > RT_MINUTO_MAX ? RT_JSON_MAX : RT_MINUTO_MAX];
+  for (; corrida.k < total && blocos > 0; corrida.k += BENCH_BLOCO, blocos--) {
+    uint32_t resta = total - corrida.k;
+    uint32_t m = resta < BENCH_BLOCO ? resta : BENCH_BLOCO;
+    // sinal e verdade (fora das medições)
+    uint8_t nAcc = 0;
+    for (uint32_t i = 0; i < m; i++) {
+      v[i] = corrida.g.proxima(t[i]);
+      SintPiscadela p;
+      if (corrida.g.novaPiscadela(p)) {
+        r.piscadelas[p.cls]++;
+        if (nPendentes == BENCH_PENDENTES) {
+          falhou(r, pendentes[0]);
+          retirar(0);
+        }
+        pendentes[nPendentes++] = p;
+      }
+      if (t[i] >= corrida.proxAccUs) {
+        // cabeça a oscilar +-20 graus em roll, a 0.2 Hz
+        float a = 0.35f * sinf(6.2831853f * 0.2f * (t[i] / 1e6f));
+        AccSample &s = accs[nAcc++];
+        s.tUs = t[i];
+        s.q4[0] = (uint16_t)(acc.offsetQ4[0] + acc.escalaQ4[0] * a);
+        s.q4[1] = (uint16_t)acc.offsetQ4[1];
+        float z = sqrtf(1 - a * a);
+        s.q4[2] = (uint16_t)(acc.offsetQ4[2] + acc.escalaQ4[2] * z);
+        corrida.proxAccUs += corrida.accPeriodoUs;
+      }
+    }
+    r.amostras += m;
+
+    // deteção
+    uint8_t nEv = 0;
+    uint32_t c0 = halCiclos();
+    for (uint32_t i = 0; i < m; i++)
+      if (det.update(v[i], t[i], evs[nEv]) && nEv < BENCH_EVENTOS_BLOCO - 1)
+        nEv++;
+    r.detecao.ciclos += halCiclos() - c0;
+    r.detecao.n += m;
+
+    // classificação (cada modelo), trama EVT e comparação com a verdade
+    for (uint8_t e = 0; e < nEv; e++) {
+      BlinkClass cls[BENCH_MODELOS];
+      for (uint8_t md = 0; md < r.modelos; md++) {
+        c0 = halCiclos();
+        cls[md] = classificadorPiscadela(md, evs[e], r.params);
+        r.classif[md].ciclos += halCiclos() - c0;
+        r.classif[md].n++;
+      }
+      c0 = halCiclos();
+      size_t len = rtMontarPiscadela(trama, (uint16_t)r.evento.n, 0, evs[e],
+                                     0);
+      r.evento.ciclos += halCiclos() - c0;
+      r.evento.n++;
+      r.evento.bytes += len;
+      emparelhar(r, evs[e], cls);
+    }
+    while (nPendentes && pendentes[0].tFimUs + BENCH_ESPERA_MS * 1000UL <
+                             t[m - 1]) {
+      falhou(r, pendentes[0]);
+      retirar(0);
+    }
+
+    // orientação
+    c0 = halCiclos();
+    for (uint8_t i = 0; i < nAcc; i++)
+      corrida.orient.update(accs[i]);
+    r.acel.ciclos += halCiclos() - c0;
+    r.acel.n += nAcc;
+    roll = corrida.orient.rollDg();
+    pitch = corrida.orient.pitchDg();
+
+    // RT binário: todas as amostras, tramas do MTU máximo
+    c0 = halCiclos();
+    for (uint32_t i = 0; i < m; i++) {
+      uint32_t ms = t[i] / 1000;
+      if (!rtBench.add(ms, &v[i], roll, pitch, RT_FRAME_MAX_LEN)) {
+        const uint8_t *f;
+        r.rtBin.bytes += rtBench.finish(f);
+        r.rtBinTramas++;
+        rtBench.reset(dtMs, 1);
+        rtBench.add(ms, &v[i], roll, pitch, RT_FRAME_MAX_LEN);
+      }
+    }
+    r.rtBin.ciclos += halCiclos() - c0;
+    r.rtBin.n += m;
+
+    // RAW: blocos a cada meio buffer, como servirRaw
+    c0 = halCiclos();
+    for (uint32_t i = 0; i < m; i++) {
+      rawBench.add(t[i], &v[i]);
+      if (rawBench.pendentes() < RAW_BUF_AMOSTRAS / 2)
+        continue;
+      while (rawBench.pendentes()) {
+        size_t len = rawBench.montar(trama, RT_FRAME_MAX_LEN);
+        if (len == 0)
+          break;
+        r.raw.bytes += len;
+        r.rawBlocos++;
+      }
+    }
+    r.raw.ciclos += halCiclos() - c0;
+    r.raw.n += m;
+
+    // texto: RT a cada 100 ms e o array do minuto a cada segundo
+    for (uint32_t i = 0; i < m; i++) {
+      if (t[i] >= corrida.proxJsonUs) {
+        c0 = halCiclos();
+        size_t len = rtFormatarJson(texto, sizeof(texto), t[i] / 1000, &v[i],
+                                    1, roll, pitch);
+        r.rtJson.ciclos += halCiclos() - c0;
+        r.rtJson.n++;
+        r.rtJson.bytes += len;
+        corrida.proxJsonUs += 100000UL;
+      }
+      if (t[i] >= corrida.proxMinutoUs) {
+        uint16_t normais = (uint16_t)r.classe[0][BLINK_NORMAL].vp;
+        uint16_t lentas = (uint16_t)r.classe[0][BLINK_SLOW].vp;
+        c0 = halCiclos();
+        size_t len = rtFormatarMinuto(texto, sizeof(texto), t[i] / 60000000UL,
+                                      &normais, &lentas, 1, lentas >= 2);
+        r.minuto.ciclos += halCiclos() - c0;
+        r.minuto.n++;
+        r.minuto.bytes += len;
+        corrida.proxMinutoUs += 1000000UL;
+      }
+    }
+  }
+  if (corrida.k < total)
+    return true;
+  while (nPendentes) {
+    falhou(r, pendentes[0]);
+    retirar(0);
+  }
+  return false;
+}
+
+void benchCorrer(const SintParams &sint, uint32_t segundos,
+                 const BlinkParams &forma, const AccCalib &acc,
+                 BenchResultado &r) {
+  benchComecar(sint, segundos, forma, acc, r);
+  while (benchPasso(r, UINT32_MAX))
+    ;
+}
+
+// ---- relatório ----
+static float nsPor(const BenchCusto &k) {
+  return k.n ? (float)k.ciclos * 1000.0f / halCiclosPorUs() / k.n : 0;
+}
+static float bytesPor(const BenchCusto &k) {
+  return k.n ? (float)k.bytes / k.n : 0;
+}
+// "P 0.97 R 1.00" ("-" sem casos)
+static void pr(char *out, size_t max, const BenchContagem &c) {
+  char p[8] = "-", rr[8] = "-";
+  if (c.vp + c.fp)
+    snprintf(p, sizeof(p), "%.2f", (float)c.vp / (c.vp + c.fp));
+  if (c.vp + c.fn)
+    snprintf(rr, sizeof(rr), "%.2f", (float)c.vp / (c.vp + c.fn));
+  snprintf(out, max, "P %s R %s", p, rr);
+}
+
+void benchRelatorio(const BenchResultado &r, void (*linha)(const char *)) {
+  char l[160], a[24], b[24];
+  snprintf(l, sizeof(l),
+           "BENCH: %lu s a %u Hz (%lu amostras), %lu piscadelas geradas "
+           "(%lu lentas), %lu ciclos/us",
+           (unsigned long)r.segundos, (unsigned)r.fsHz,
+           (unsigned long)r.amostras,
+           (unsigned long)(r.piscadelas[BLINK_NORMAL] +
+                           r.piscadelas[BLINK_SLOW]),
+           (unsigned long)r.piscadelas[BLINK_SLOW],
+           (unsigned long)halCiclosPorUs());
+  linha(l);
+  snprintf(l, sizeof(l),
+           "limiares calibrados: limiarInferior %d, AMPLITUDE_MIN %d/%d",
+           r.params.limiarInferior, r.params.amplitudeMin,
+           r.params.amplitudeMinLenta);
+  linha(l);
+  snprintf(l, sizeof(l), "calibração: %u piscadelas em %u s%s",
+           r.calPiscadelas, r.calPiscarS,
+           r.calPiscadelas < CAL_PISCADELAS_MIN ? " (pouco fiável)" : "");
+  linha(l);
+  pr(a, sizeof(a), r.eventos);
+  snprintf(l, sizeof(l),
+           "deteção: %.1f ns/amostra; piscadelas %s (vp %lu, fp %lu, fn %lu), "
+           "%lu eventos OTHER",
+           nsPor(r.detecao), a, (unsigned long)r.eventos.vp,
+           (unsigned long)r.eventos.fp, (unsigned long)r.eventos.fn,
+           (unsigned long)r.outros);
+  linha(l);
+  for (uint8_t m = 0; m < r.modelos; m++) {
+    pr(a, sizeof(a), r.classe[m][BLINK_NORMAL]);
+    pr(b, sizeof(b), r.classe[m][BLINK_SLOW]);
+    snprintf(l, sizeof(l), "modelo %u %s: %.0f ns/evento; normais %s, "
+             "lentas %s",
+             (unsigned)m, classificadorNome(m), nsPor(r.classif[m]), a, b);
+    linha(l);
+  }
+  snprintf(l, sizeof(l), "orientação: %.0f ns/atualização",
+           nsPor(r.acel));
+  linha(l);
+  snprintf(l, sizeof(l),
+           "RT JSON: %.0f ns, %.1f B/linha; array do minuto: %.0f ns, %.1f B",
+           nsPor(r.rtJson), bytesPor(r.rtJson), nsPor(r.minuto),
+           bytesPor(r.minuto));
+  linha(l);
+  snprintf(l, sizeof(l),
+           "RT binário: %.1f ns/amostra, %lu tramas de %.0f B (%.2f "
+           "B/amostra)",
+           nsPor(r.rtBin), (unsigned long)r.rtBinTramas,
+           r.rtBinTramas ? (float)r.rtBin.bytes / r.rtBinTramas : 0,
+           r.rtBin.n ? (float)r.rtBin.bytes / r.rtBin.n : 0);
+  linha(l);
+  snprintf(l, sizeof(l),
+           "EVT: %.0f ns, %.0f B/evento; RAW: %.1f ns/amostra, %.2f "
+           "bits/amostra",
+           nsPor(r.evento), bytesPor(r.evento), nsPor(r.raw),
+           r.raw.n ? (float)r.raw.bytes * 8 / r.raw.n : 0);
+  linha(l);
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <stdint.h>
+
+#include "blink_detector.h"
+#include "orientacao.h"
+#include "sintetico.h"
+
+// =================== BENCH (caminhos quentes de S) ===================
+// Passa um sinal sintético (sintetico.h) pelo trabalho que S faz por
+// amostra e mede cada etapa à parte com halCiclos(): deteção, classificação
+// (cada modelo), orientação, RT em JSON e em binário, array do minuto,
+// trama de evento e RAW. As piscadelas detetadas são comparadas com as
+// geradas (precisão e recall por classe). O mesmo código corre no host
+// (host/eog_bench) e no ESP32 (comando BENCH, um modo do agendador), onde
+// os ciclos são os do CPU.
+//
+// Os limiares saem do próprio sinal como C os calibraria (até 10 s sem
+// piscar, até 40 s a piscar ao ritmo do sinal); de `forma` só contam as
+// derivadas e as durações.
+
+#define BENCH_MODELOS 2
+#define BENCH_TOLERANCIA_MS 150 // pico detetado vs pico gerado
+
+struct BenchContagem {
+  uint32_t vp;
+  uint32_t fp;
+  uint32_t fn;
+};
+struct BenchCusto {
+  uint32_t n;
+  uint64_t ciclos;
+  uint64_t bytes;
+};
+
+struct BenchResultado {
+  uint32_t segundos;
+  uint16_t fsHz;
+  uint32_t amostras;
+  uint32_t piscadelas[3]; // geradas, por BlinkClass
+  BlinkParams params;     // calibrados sobre o sinal
+  uint16_t calPiscadelas; // vistas na fase 2/2 da calibração
+  uint16_t calPiscarS;    // quanto durou essa fase
+  BenchCusto detecao;     // n = amostras
+  BenchContagem eventos;  // NORMAL/SLOW do detetor vs qualquer piscadela
+  uint32_t outros;        // eventos que o detetor deixou em OTHER
+  uint8_t modelos;
+  BenchCusto classif[BENCH_MODELOS]; // n = eventos
+  BenchContagem classe[BENCH_MODELOS][3];
+  BenchCusto acel;   // n = atualizações (ACC_RATE_HZ)
+  BenchCusto rtJson; // uma linha a cada 100 ms
+  BenchCusto rtBin;  // n = amostras; bytes das tramas
+  uint32_t rtBinTramas;
+  BenchCusto minuto; // um array por segundo (no firmware, por minuto)
+  BenchCusto evento; // trama EVT por evento
+  BenchCusto raw;    // n = amostras; bytes dos blocos
+  uint32_t rawBlocos;
+};
+
+void benchCorrer(const SintParams &sint, uint32_t segundos,
+                 const BlinkParams &forma, const AccCalib &acc,
+                 BenchResultado &r);
+// o mesmo em fatias (o firmware passa uma por volta do loop): benchComecar
+// calibra e prepara; cada benchPasso passa até `blocos` blocos de amostras
+// e devolve false quando o sinal acabou (r fica completo)
+void benchComecar(const SintParams &sint, uint32_t segundos,
+                  const BlinkParams &forma, const AccCalib &acc,
+                  BenchResultado &r);
+bool benchPasso(BenchResultado &r, uint32_t blocos);
+// cada evento do detetor com a classe verdadeira (BLINK_OTHER sem piscadela
+// gerada a menos de BENCH_TOLERANCIA_MS): dados rotulados para o
+// gerar_modelo (eog_bench -E); nullptr = nenhum
+void benchRotulos(void (*rotulo)(const BlinkEvent &ev, BlinkClass verdade));
+// o relatório, uma linha de cada vez (USB no firmware, stdout no host)
+void benchRelatorio(const BenchResultado &r, void (*linha)(const char *));
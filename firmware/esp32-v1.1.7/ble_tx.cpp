@@ -0,0 +1,462 @@
+#include "ble_tx.h"
+
+#include <string.h>
+
+#include "hal.h"
+#include "perfil.h"
+#include "rt_frame.h"
+#include "spsc_ring.h"
+
+// uma mensagem na fila de uma ligação: o lugar no conjunto, o seq dela e a
+// central a que se destina (a geração do lugar quando entrou)
+struct BleTxRef {
+  uint8_t msg;
+  uint8_t geracao;
+  uint32_t seq;
+};
+
+// Uma ligação. O loop mexe na parte do produtor, a task de envio na do
+// consumidor; a HAL (ao ligar) só mexe nos atómicos.
+struct Ligacao {
+  SpscRing<BleTxRef, BLE_TX_QUEUE_LEN> fila[BLE_TX_PRIORIDADES];
+  std::atomic<bool> nova{false}; // o produtor ainda não viu a central nova
+  // sobe a cada central nova neste lugar: o que ficou na fila para a
+  // anterior (ACK, SYNC, seq antigos) é libertado sem sair
+  std::atomic<uint8_t> geracao{0};
+  std::atomic<uint8_t> fluxos{BLE_FLUXOS_TODOS};
+  std::atomic<bool> subscreveu{false};
+  std::atomic<bool> envelope{false};
+  // lugares do conjunto que esta ligação ainda prende (sobe no produtor,
+  // desce na task de envio)
+  std::atomic<uint8_t> presos{0};
+  // produtor
+  uint32_t seq = 0;
+  uint32_t queued = 0;
+  uint32_t dropped = 0;
+  uint16_t highWater = 0;
+  uint32_t descartadasPor[BLE_TX_PRIORIDADES] = {};
+  // consumidor
+  std::atomic<uint32_t> notificacoes{0};
+  std::atomic<uint32_t> bytes{0};
+  std::atomic<uint32_t> falhadas{0};
+  std::atomic<uint32_t> falhadasPor[BLE_TX_PRIORIDADES] = {};
+  std::atomic<uint32_t> semEspaco{0};
+
+  uint16_t ocupacao() const {
+    size_t n = 0;
+    for (uint8_t p = 0; p < BLE_TX_PRIORIDADES; p++)
+      n += fila[p].size();
+    return (uint16_t)n;
+  }
+};
+static Ligacao lig[HAL_BLE_LIGACOES_MAX];
+
+// cada mensagem é guardada uma vez; refs = filas que ainda a têm (0 = livre)
+static BleTxMsg pool[BLE_TX_POOL_LEN];
+static std::atomic<uint8_t> poolRefs[BLE_TX_POOL_LEN];
+static uint8_t poolProx = 0;
+// lugares com refs > 0 (sobe no produtor, desce na task de envio)
+static std::atomic<uint8_t> poolOcupados{0};
+
+// totais (produtor)
+static uint32_t txQueued = 0;
+static uint32_t txDropped = 0;
+static uint32_t txTruncated = 0;
+static uint16_t txHighWater = 0;
+static uint32_t txSeq = 0;
+static uint32_t txDescartadas = 0;
+static uint32_t txDescartadasPor[BLE_TX_PRIORIDADES] = {};
+// totais (task de envio; o loop só lê)
+static std::atomic<uint32_t> txNotificacoes{0};
+static std::atomic<uint32_t> txBytes{0};
+static std::atomic<uint32_t> txFalhadas{0};
+static std::atomic<uint32_t> txFalhadasPor[BLE_TX_PRIORIDADES] = {};
+static std::atomic<uint32_t> txSemEspaco{0};
+
+BlePrioridade bleTxPrioridade(uint8_t fluxos) {
+  if (fluxos & (BLE_FLUXO_TEXTO | BLE_FLUXO_MINUTO))
+    return BLE_PRIO_ALERTA;
+  if (fluxos & BLE_FLUXO_EVT)
+    return BLE_PRIO_EVENTO;
+  if (fluxos & (BLE_FLUXO_RT | BLE_FLUXO_RAW))
+    return BLE_PRIO_RT;
+  return BLE_PRIO_DEBUG;
+}
+
+// uma tentativa; cada recusa conta em falhadas
+static bool notificar(uint8_t i, uint8_t prio, const uint8_t *data,
+                      size_t len) {
+  if (halBleNotify(i, data, len)) {
+    lig[i].notificacoes.fetch_add(1, std::memory_order_relaxed);
+    lig[i].bytes.fetch_add((uint32_t)len, std::memory_order_relaxed);
+    txNotificacoes.fetch_add(1, std::memory_order_relaxed);
+    txBytes.fetch_add((uint32_t)len, std::memory_order_relaxed);
+    return true;
+  }
+  lig[i].falhadas.fetch_add(1, std::memory_order_relaxed);
+  lig[i].falhadasPor[prio].fetch_add(1, std::memory_order_relaxed);
+  txFalhadas.fetch_add(1, std::memory_order_relaxed);
+  txFalhadasPor[prio].fetch_add(1, std::memory_order_relaxed);
+  return false;
+}
+
+// =================== PRODUTOR (loop) ===================
+// a parte do produtor de uma ligação, zerada se entretanto ligou outra
+// central nesse lugar
+static Ligacao &produtor(uint8_t i) {
+  Ligacao &l = lig[i];
+  if (l.nova.exchange(false, std::memory_order_acquire)) {
+    l.seq = 0;
+    l.queued = 0;
+    l.dropped = 0;
+    l.highWater = 0;
+    memset(l.descartadasPor, 0, sizeof(l.descartadasPor));
+  }
+  return l;
+}
+
+static int reservar(BlePrioridade prio) {
+  uint8_t livres = prio < BLE_PRIO_RT ? 0 : BLE_TX_POOL_RESERVA;
+  if (poolOcupados.load(std::memory_order_acquire) + livres >=
+      BLE_TX_POOL_LEN)
+    return -1;
+  for (uint8_t k = 0; k < BLE_TX_POOL_LEN; k++) {
+    uint8_t m = (uint8_t)((poolProx + k) % BLE_TX_POOL_LEN);
+    if (poolRefs[m].load(std::memory_order_acquire) == 0) {
+      poolProx = (uint8_t)((m + 1) % BLE_TX_POOL_LEN);
+      poolOcupados.fetch_add(1, std::memory_order_acq_rel);
+      return m;
+    }
+  }
+  return -1;
+}
+
+// destino: um bit por ligação
+static bool enfileirar(uint8_t destino, BlePrioridade prio, BleTxKind kind,
+                       const uint8_t *data, size_t len) {
+  size_t max = kind == BLE_TX_TEXT ? BLE_TX_MSG_MAX - 1 : BLE_TX_MSG_MAX;
+  bool grande = len > max;
+  if (grande && kind == BLE_TX_TEXT) {
+    len = max;
+    txTruncated++;
+  }
+  // quem a recebe: com lugar no seu anel (e uma trama que caiba)
+  uint8_t alvo = 0, n = 0;
+  for (uint8_t i = 0; i < HAL_BLE_LIGACOES_MAX; i++) {
+    if (!(destino & (1u << i)))
+      continue;
+    Ligacao &l = produtor(i);
+    if (l.fila[prio].size() < BLE_TX_QUEUE_LEN &&
+        l.presos.load(std::memory_order_acquire) < BLE_TX_POOL_POR_LIGACAO &&
+        !(grande && kind != BLE_TX_TEXT)) {
+      alvo |= (uint8_t)(1u << i);
+      n++;
+    }
+  }
+  int m = n ? reservar(prio) : -1;
+  if (m >= 0) {
+    BleTxMsg &msg = pool[m];
+    msg.kind = kind;
+    msg.tUs = halMicros64();
+    memcpy(msg.data, data, len);
+    if (kind == BLE_TX_TEXT)
+      msg.data[len++] = '\n';
+    msg.len = (uint8_t)len;
+    // antes do 1º push: a task de envio pode libertá-la logo a seguir
+    poolRefs[m].store(n, std::memory_order_release);
+  }
+  for (uint8_t i = 0; i < HAL_BLE_LIGACOES_MAX; i++) {
+    if (!(destino & (1u << i)))
+      continue;
+    Ligacao &l = lig[i];
+    // um descarte também gasta um seq: a app vê o buraco
+    BleTxRef r = {(uint8_t)m, l.geracao.load(std::memory_order_acquire),
+                  l.seq++};
+    txSeq++;
+    if (m < 0 || !(alvo & (1u << i))) {
+      l.dropped++;
+      l.descartadasPor[prio]++;
+      txDropped++;
+      txDescartadas++;
+      txDescartadasPor[prio]++;
+      continue;
+    }
+    l.presos.fetch_add(1, std::memory_order_acq_rel);
+    l.fila[prio].push(r);
+    l.queued++;
+    txQueued++;
+    uint16_t depth = l.ocupacao();
+    if (depth > l.highWater)
+      l.highWater = depth;
+    if (depth > txHighWater)
+      txHighWater = depth;
+  }
+  return m >= 0;
+}
+
+bool bleTxPush(BleTxKind kind, uint8_t fluxos, const uint8_t *data,
+               size_t len) {
+  uint8_t destino = 0;
+  for (uint8_t i = 0; i < HAL_BLE_LIGACOES_MAX; i++)
+    if (halBleLigada(i) && (lig[i].fluxos.load() & fluxos))
+      destino |= (uint8_t)(1u << i);
+  return destino &&
+         enfileirar(destino, bleTxPrioridade(fluxos), kind, data, len);
+}
+
+bool bleTxPushPara(uint8_t ligacao, BleTxKind kind, const uint8_t *data,
+                   size_t len) {
+  if (ligacao >= HAL_BLE_LIGACOES_MAX || !halBleLigada(ligacao))
+    return false;
+  return enfileirar((uint8_t)(1u << ligacao), BLE_PRIO_ALERTA, kind, data,
+                    len);
+}
+
+// =================== CONSUMIDOR (task de envio) ===================
+static size_t payloadMax(uint8_t i) {
+  uint16_t mtu = halBleMtuLigacao(i);
+  return mtu > 23 ? (size_t)(mtu - 3) : 20;
+}
+
+// A mensagem que está a sair numa ligação. Sai um notify de cada vez (um
+// fragmento da linha): as ligações alternam mesmo a meio de uma linha e um
+// notify recusado fica para a chamada seguinte sem parar as outras.
+struct EmCurso {
+  bool ativa;
+  uint8_t prio;
+  uint8_t offset; // bytes já enviados
+  uint8_t chunk;  // os do fragmento que está a sair
+  uint8_t frag;
+  uint8_t recusas; // deste fragmento
+  BleTxRef r;
+};
+static EmCurso emCurso[HAL_BLE_LIGACOES_MAX];
+
+static void libertar(uint8_t i) {
+  EmCurso &e = emCurso[i];
+  e.ativa = false;
+  lig[i].presos.fetch_sub(1, std::memory_order_acq_rel);
+  if (poolRefs[e.r.msg].fetch_sub(1, std::memory_order_acq_rel) == 1)
+    poolOcupados.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+// o próximo notify da mensagem em curso: o fragmento em offset (chunk
+// bytes), com o envelope à frente se SEQ=1 (a linha já vem com '\n' da
+// fila); false se foi recusado
+static bool passo(uint8_t i) {
+  EmCurso &e = emCurso[i];
+  BleTxMsg &m = pool[e.r.msg];
+  uint8_t buf[BLE_TX_MSG_MAX];
+  size_t max = payloadMax(i);
+  if (max > sizeof(buf))
+    max = sizeof(buf);
+  bool envelope = lig[i].envelope.load(std::memory_order_relaxed);
+  size_t util = envelope ? max - RT_FRAME_LIGACAO_LEN : max; // max >= 20
+  size_t chunk = m.len - e.offset;
+  if (m.kind != BLE_TX_TEXT && envelope && chunk > util) {
+    lig[i].semEspaco.fetch_add(1, std::memory_order_relaxed);
+    txSemEspaco.fetch_add(1, std::memory_order_relaxed);
+    e.chunk = (uint8_t)chunk;
+    return true;
+  }
+  uint8_t flags = 0;
+  if (m.kind == BLE_TX_TEXT) {
+    if (chunk > util) {
+      chunk = util;
+      flags = RT_LIGACAO_CONTINUA;
+    }
+    flags |= RT_LIGACAO_TEXTO;
+  }
+  e.chunk = (uint8_t)chunk;
+  if (m.kind == BLE_TX_SYNC) // só tem um destino: pode mexer-lhe
+    rtSyncCarimbar(m.data, halMicros64());
+  const uint8_t *data = m.data + e.offset;
+  size_t len = chunk;
+  if (envelope) {
+    rtMontarLigacao(buf, e.r.seq, m.tUs, flags, e.frag);
+    memcpy(buf + RT_FRAME_LIGACAO_LEN, data, chunk);
+    data = buf;
+    len += RT_FRAME_LIGACAO_LEN;
+  }
+  return notificar(i, e.prio, data, len);
+}
+
+// um notify de cada ligação à vez (da mensagem em curso ou da mais
+// prioritária na fila) até não haver mais nada; uma recusa tira a ligação
+// desta chamada e só as prioridades altas voltam a tentar, até
+// BLE_TX_TENTATIVAS vezes. Depois o fragmento perde-se, mas a linha segue
+// (a central ainda recebe o '\n')
+bool bleTxDrain() {
+  uint8_t adiadas = 0;
+  for (bool alguma = true; alguma;) {
+    alguma = false;
+    for (uint8_t i = 0; i < HAL_BLE_LIGACOES_MAX; i++) {
+      EmCurso &e = emCurso[i];
+      if (adiadas & (1u << i))
+        continue;
+      if (!e.ativa) {
+        uint8_t prio = 0;
+        while (prio < BLE_TX_PRIORIDADES && !lig[i].fila[prio].pop(e.r))
+          prio++;
+        if (prio == BLE_TX_PRIORIDADES)
+          continue;
+        e.ativa = true;
+        e.prio = prio;
+        e.offset = e.frag = e.recusas = 0;
+      }
+      alguma = true;
+      // ligação caiu ou é de outra central: descarta o que estava na fila
+      if (!halBleLigada(i) ||
+          e.r.geracao != lig[i].geracao.load(std::memory_order_acquire)) {
+        libertar(i);
+        continue;
+      }
+      bool aceite;
+      {
+        PERF_MEDIR(PERF_BLE_TX);
+        aceite = passo(i);
+      }
+      if (!aceite && e.prio < BLE_PRIO_RT &&
+          ++e.recusas < BLE_TX_TENTATIVAS) {
+        adiadas |= (uint8_t)(1u << i);
+        continue;
+      }
+      e.offset = (uint8_t)(e.offset + e.chunk);
+      e.frag++;
+      e.recusas = 0;
+      if (e.offset >= pool[e.r.msg].len)
+        libertar(i);
+    }
+  }
+  return adiadas != 0;
+}
+
+// =================== ESTADO ===================
+void bleTxGetStats(BleTxStats &out) {
+  out.queued = txQueued;
+  out.dropped = txDropped;
+  out.truncated = txTruncated;
+  out.depth = 0;
+  for (uint8_t i = 0; i < HAL_BLE_LIGACOES_MAX; i++)
+    if (lig[i].ocupacao() > out.depth)
+      out.depth = lig[i].ocupacao();
+  out.highWater = txHighWater;
+  out.notificacoes = txNotificacoes.load(std::memory_order_relaxed);
+  out.bytes = txBytes.load(std::memory_order_relaxed);
+  out.falhadas = txFalhadas.load(std::memory_order_relaxed);
+  out.seq = txSeq;
+  out.descartadas = txDescartadas;
+  out.semEspaco = txSemEspaco.load(std::memory_order_relaxed);
+  memcpy(out.descartadasPor, txDescartadasPor, sizeof(out.descartadasPor));
+  for (uint8_t p = 0; p < BLE_TX_PRIORIDADES; p++)
+    out.falhadasPor[p] = txFalhadasPor[p].load(std::memory_order_relaxed);
+}
+
+void bleTxResetStats() {
+  txQueued = 0;
+  txDropped = 0;
+  txTruncated = 0;
+  txHighWater = 0;
+}
+
+bool bleTxGetStatsLigacao(uint8_t ligacao, BleTxStats &out) {
+  if (ligacao >= HAL_BLE_LIGACOES_MAX || !halBleLigada(ligacao))
+    return false;
+  Ligacao &l = produtor(ligacao);
+  out.queued = l.queued;
+  out.dropped = l.dropped;
+  out.truncated = 0;
+  out.depth = l.ocupacao();
+  out.highWater = l.highWater;
+  out.notificacoes = l.notificacoes.load(std::memory_order_relaxed);
+  out.bytes = l.bytes.load(std::memory_order_relaxed);
+  out.falhadas = l.falhadas.load(std::memory_order_relaxed);
+  out.seq = l.seq;
+  out.descartadas = l.dropped;
+  out.semEspaco = l.semEspaco.load(std::memory_order_relaxed);
+  memcpy(out.descartadasPor, l.descartadasPor, sizeof(out.descartadasPor));
+  for (uint8_t p = 0; p < BLE_TX_PRIORIDADES; p++)
+    out.falhadasPor[p] = l.falhadasPor[p].load(std::memory_order_relaxed);
+  return true;
+}
+
+uint16_t bleTxOcupacao(uint8_t fluxos) {
+  uint8_t prio = bleTxPrioridade(fluxos);
+  uint16_t max = 0;
+  for (uint8_t i = 0; i < HAL_BLE_LIGACOES_MAX; i++)
+    if (halBleLigada(i) && (lig[i].fluxos.load() & fluxos) &&
+        lig[i].fila[prio].size() > max)
+      max = (uint16_t)lig[i].fila[prio].size();
+  return max;
+}
+
+uint16_t bleTxOcupacaoLigacao(uint8_t ligacao, uint8_t fluxos) {
+  if (ligacao >= HAL_BLE_LIGACOES_MAX || !halBleLigada(ligacao) ||
+      !(lig[ligacao].fluxos.load() & fluxos))
+    return 0;
+  return (uint16_t)lig[ligacao].fila[bleTxPrioridade(fluxos)].size();
+}
+
+size_t bleTxPayloadMaxLigacao(uint8_t ligacao) {
+  if (ligacao >= HAL_BLE_LIGACOES_MAX || !halBleLigada(ligacao))
+    return 20;
+  size_t max = payloadMax(ligacao);
+  if (lig[ligacao].envelope.load(std::memory_order_relaxed))
+    max -= RT_FRAME_LIGACAO_LEN;
+  return max;
+}
+
+// uma central com MTU 23 que só quer texto não encolhe as tramas das outras
+size_t bleTxPayloadMax(uint8_t fluxos) {
+  size_t min = 0;
+  for (uint8_t i = 0; i < HAL_BLE_LIGACOES_MAX; i++) {
+    if (!halBleLigada(i) || !(lig[i].fluxos.load() & fluxos))
+      continue;
+    size_t max = bleTxPayloadMaxLigacao(i);
+    if (min == 0 || max < min)
+      min = max;
+  }
+  return min ? min : 20;
+}
+
+void bleTxLigacaoNova(uint8_t ligacao) {
+  if (ligacao >= HAL_BLE_LIGACOES_MAX)
+    return;
+  Ligacao &l = lig[ligacao];
+  l.fluxos.store(BLE_FLUXOS_TODOS);
+  l.subscreveu.store(false);
+  l.envelope.store(false);
+  l.notificacoes.store(0);
+  l.bytes.store(0);
+  l.falhadas.store(0);
+  for (std::atomic<uint32_t> &f : l.falhadasPor)
+    f.store(0);
+  l.semEspaco.store(0);
+  l.geracao.fetch_add(1, std::memory_order_acq_rel);
+  l.nova.store(true, std::memory_order_release);
+}
+
+void bleTxSubscrever(uint8_t ligacao, uint8_t fluxos) {
+  if (ligacao >= HAL_BLE_LIGACOES_MAX)
+    return;
+  lig[ligacao].fluxos.store(fluxos & BLE_FLUXOS_TODOS);
+  lig[ligacao].subscreveu.store(true);
+}
+
+bool bleTxSubscreveu(uint8_t ligacao) {
+  return ligacao < HAL_BLE_LIGACOES_MAX && lig[ligacao].subscreveu.load();
+}
+
+uint8_t bleTxFluxos(uint8_t ligacao) {
+  return ligacao < HAL_BLE_LIGACOES_MAX ? lig[ligacao].fluxos.load() : 0;
+}
+
+void bleTxSetEnvelope(uint8_t ligacao, bool on) {
+  if (ligacao < HAL_BLE_LIGACOES_MAX)
+    lig[ligacao].envelope.store(on, std::memory_order_relaxed);
+}
+
+bool bleTxEnvelopeAtivo(uint8_t ligacao) {
+  return ligacao < HAL_BLE_LIGACOES_MAX &&
+         lig[ligacao].envelope.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,135 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hal.h"
+
+// =================== FILA DE ENVIO BLE ===================
+// O loop() (único produtor) mete mensagens de tamanho fixo na fila e uma
+// task dedicada, no outro core, esvazia-a para txChar->notify(). Assim o
+// ciclo de amostragem nunca fica à espera do rádio: se a fila encher, a
+// mensagem é descartada e contada.
+//
+// Com várias centrais ligadas (hal.h) cada mensagem é copiada uma vez para
+// um conjunto partilhado e cada ligação tem o seu anel SPSC de índices: a
+// mensagem vai só para as ligações que subscreveram o fluxo dela (SUB=) e
+// uma central lenta enche o seu anel sem atrasar as outras: prende no
+// máximo BLE_TX_POOL_POR_LIGACAO lugares do conjunto. A task de envio serve
+// as ligações à vez, um notify de cada, e nunca dorme à espera de uma.
+//
+// Cada ligação tem um anel por prioridade (BlePrioridade, tirada do fluxo)
+// e sai sempre primeiro o mais importante: com o rádio congestionado são os
+// pontos RT e a telemetria que ficam na fila e se perdem, não os alertas.
+// As prioridades baixas também não podem gastar os últimos
+// BLE_TX_POOL_RESERVA lugares do conjunto, e um notify recusado só é
+// repetido nas altas (os pontos RT são descartáveis).
+//
+// Cada mensagem leva, por ligação, um seq (que avança mesmo quando é
+// descartada) e os µs em que entrou na fila. Com o envelope ligado (SEQ=1)
+// a task de envio põe os dois à frente de cada notificação
+// (RT_FRAME_TYPE_LIGACAO, rt_frame.h) e a app vê as perdas e a latência de
+// fila; desligado, sai tudo como antes.
+
+#define BLE_TX_MSG_MAX 244 // = maior notificação (MTU 247 - 3)
+#define BLE_TX_QUEUE_LEN 32 // por ligação e prioridade; potência de 2
+// mensagens guardadas; as de prioridade RT e debug deixam sempre a reserva
+#define BLE_TX_POOL_LEN 48
+#define BLE_TX_POOL_RESERVA 12
+#define BLE_TX_POOL_POR_LIGACAO 24 // refs de uma ligação ainda por enviar
+// notify recusado (sem buffers no controlador): nas prioridades alerta e
+// evento fica para a chamada seguinte da task, BLE_TX_REPETIR_MS depois,
+// até BLE_TX_TENTATIVAS vezes
+#define BLE_TX_TENTATIVAS 3
+#define BLE_TX_REPETIR_MS 8
+
+enum BleTxKind : uint8_t {
+  BLE_TX_TEXT = 0,  // linha; o '\n' é acrescentado na fila; fragmentada
+  BLE_TX_FRAME = 1, // trama binária; uma notificação
+  BLE_TX_SYNC = 2,  // resposta a SYNC=: o t2 é carimbado mesmo antes de sair
+};
+
+// o que cada ligação quer receber (máscara de SUB=; ao ligar, todos)
+enum BleFluxo : uint8_t {
+  BLE_FLUXO_TEXTO = 0x01,  // mensagens de estado (calibração, perfis, ...)
+  BLE_FLUXO_RT = 0x02,     // pontos RT (JSON ou RTB=)
+  BLE_FLUXO_MINUTO = 0x04, // arrays por minuto, janelas e alertas
+  BLE_FLUXO_EVT = 0x08,    // uma trama por piscadela (EVT=1)
+  BLE_FLUXO_RAW = 0x10,    // RAW=1
+  BLE_FLUXO_DADOS = 0x20,  // DL, TPUT e telemetria (TLM=)
+};
+#define BLE_FLUXOS_TODOS 0x3F
+
+// ordem de saída (0 primeiro): texto, minuto e as respostas diretas (ACK,
+// SYNC) são alertas; EVT é evento; RT e RAW são RT; DL/TPUT/TLM são debug
+enum BlePrioridade : uint8_t {
+  BLE_PRIO_ALERTA = 0,
+  BLE_PRIO_EVENTO = 1,
+  BLE_PRIO_RT = 2,
+  BLE_PRIO_DEBUG = 3,
+};
+#define BLE_TX_PRIORIDADES 4
+BlePrioridade bleTxPrioridade(uint8_t fluxos);
+
+struct BleTxMsg {
+  uint8_t kind;
+  uint8_t len;
+  uint64_t tUs; // halMicros64() no push
+  uint8_t data[BLE_TX_MSG_MAX];
+};
+
+struct BleTxStats {
+  uint32_t queued;    // mensagens aceites
+  uint32_t dropped;   // fila cheia
+  uint32_t truncated; // linhas maiores que BLE_TX_MSG_MAX
+  uint16_t depth;     // ocupação atual, todas as prioridades (a da
+                      // ligação mais atrasada)
+  uint16_t highWater; // ocupação máxima desde o último reset
+  // contados pela task de envio e nunca zerados (quem mede faz diferenças)
+  uint32_t notificacoes; // notify aceites pelo NimBLE
+  uint32_t bytes;
+  uint32_t falhadas; // notify recusados (sem buffers / ligação a cair)
+  uint32_t seq;         // próximo seq = mensagens postas na fila
+  uint32_t descartadas; // como dropped, mas nunca zerado
+  uint32_t semEspaco;   // tramas que não cabem no MTU com o envelope
+  uint32_t descartadasPor[BLE_TX_PRIORIDADES]; // nunca zerado
+  uint32_t falhadasPor[BLE_TX_PRIORIDADES];    // nunca zerado
+};
+
+// produtor (loop): para todas as ligações que subscreveram algum dos fluxos
+// (a prioridade é a do mais importante); false se nenhuma a aceitou
+bool bleTxPush(BleTxKind kind, uint8_t fluxos, const uint8_t *data,
+               size_t len);
+// produtor: só para uma ligação (ACK, SYNC), seja qual for a máscara
+bool bleTxPushPara(uint8_t ligacao, BleTxKind kind, const uint8_t *data,
+                   size_t len);
+// consumidor (task de envio): esvazia as filas para halBleNotify(); as
+// linhas de texto vão em fragmentos de MTU - 3 bytes. true se ficou algum
+// notify recusado para repetir (chamar outra vez daqui a BLE_TX_REPETIR_MS)
+bool bleTxDrain();
+// totais de todas as ligações desde o arranque (seq: soma dos de cada uma)
+void bleTxGetStats(BleTxStats &out);
+void bleTxResetStats();
+// só uma ligação, desde que ligou; false se o lugar está livre
+bool bleTxGetStatsLigacao(uint8_t ligacao, BleTxStats &out);
+// ocupação do anel destes fluxos (o da prioridade deles) na ligação mais
+// atrasada entre as que os querem
+uint16_t bleTxOcupacao(uint8_t fluxos);
+// o mesmo só numa ligação (0 se não quer os fluxos)
+uint16_t bleTxOcupacaoLigacao(uint8_t ligacao, uint8_t fluxos);
+// payload útil comum às ligações que querem algum destes fluxos (menor
+// MTU entre elas, menos o envelope); 20 se nenhuma os quer
+size_t bleTxPayloadMax(uint8_t fluxos);
+// o de uma ligação só (respostas diretas: ACK, SYNC)
+size_t bleTxPayloadMaxLigacao(uint8_t ligacao);
+
+// HAL (task do NimBLE): lugar ocupado por uma central nova; tudo volta ao
+// início (todos os fluxos, sem envelope, seq 0) e o que ficou na fila
+// para a central anterior já não sai
+void bleTxLigacaoNova(uint8_t ligacao);
+void bleTxSubscrever(uint8_t ligacao, uint8_t fluxos);
+uint8_t bleTxFluxos(uint8_t ligacao);
+// a central escolheu os fluxos com SUB= (a máscara por omissão não conta)
+bool bleTxSubscreveu(uint8_t ligacao);
+// envelope de ligação (SEQ=): vale a partir da mensagem seguinte a sair
+void bleTxSetEnvelope(uint8_t ligacao, bool on);
+bool bleTxEnvelopeAtivo(uint8_t ligacao);
@@ -0,0 +1,61 @@
+#include "blink_detector.h"
+
+bool BlinkDetector::update(int v, uint32_t tUs, BlinkEvent &ev) {
+  if (!emEvento_) {
+    if (v >= p_.limiarInferior)
+      return false;
+    emEvento_ = true;
+    inicio_ = pico_ = anterior_ = v;
+    tInicio_ = tPico_ = tAnterior_ = tUs;
+    velMax_ = 0;
+    velMaxSubida_ = 0;
+    return false;
+  }
+  uint32_t dt = tUs - tAnterior_;
+  if (dt > 0 && v < anterior_) {
+    float vel = (float)(anterior_ - v) * 1000.0f / (float)dt;
+    if (vel > velMax_)
+      velMax_ = vel;
+  } else if (dt > 0 && v > anterior_) {
+    float vel = (float)(v - anterior_) * 1000.0f / (float)dt;
+    if (vel > velMaxSubida_)
+      velMaxSubida_ = vel;
+  }
+  anterior_ = v;
+  tAnterior_ = tUs;
+  if (v < pico_) {
+    pico_ = v;
+    tPico_ = tUs;
+    velMaxSubida_ = 0; // a reabertura conta a partir do pico mais fundo
+  }
+  if (v < p_.limiarInferior)
+    return false;
+
+  emEvento_ = false;
+  ev.tInicioUs = tInicio_;
+  ev.tPicoUs = tPico_;
+  ev.tFimUs = tUs;
+  ev.valorInicio = inicio_;
+  ev.pico = pico_;
+  ev.valorFim = v;
+  ev.amplitude = (float)(inicio_ - pico_);
+  ev.duracaoMs = (float)(tPico_ - tInicio_) / 1000.0f;
+  ev.derivada = ev.duracaoMs > 0 ? ev.amplitude / ev.duracaoMs : 0;
+  ev.velMaxDesc = velMax_;
+  ev.duracaoAberturaMs = (float)(tUs - tPico_) / 1000.0f;
+  ev.velMaxSubida = velMaxSubida_;
+  ev.cls = classify(ev, p_);
+  return true;
+}
+
+BlinkClass BlinkDetector::classify(const BlinkEvent &ev, const BlinkParams &p) {
+  if (ev.derivada >= p.limiarDerivada && ev.duracaoMs >= p.duracaoMinMs &&
+      ev.duracaoMs <= p.duracaoMaxMs && ev.amplitude >= p.amplitudeMin)
+    return BLINK_NORMAL;
+  if (ev.derivada < p.derivadaLentaMax &&
+      ev.duracaoMs >= p.duracaoLentaMinMs &&
+      ev.duracaoMs <= p.duracaoLentaMaxMs &&
+      ev.amplitude >= p.amplitudeMinLenta)
+    return BLINK_SLOW;
+  return BLINK_OTHER;
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <stdint.h>
+
+// =================== DETETOR DE PISCADELAS (streaming) ===================
+// Usado por C, P e S. Um evento começa na 1ª amostra abaixo de limiarInferior
+// e fecha na 1ª amostra >= limiarInferior. Início, pico (mínimo) e derivada
+// são seguidos amostra a amostra: memória e trabalho constantes, sem buffer
+// de evento, por isso nada é truncado seja qual for a taxa de amostragem.
+
+enum BlinkClass : uint8_t {
+  BLINK_OTHER = 0,
+  BLINK_NORMAL = 1,
+  BLINK_SLOW = 2, // sonolência
+};
+
+struct BlinkParams {
+  int limiarInferior;
+  // normal: derivada >= limiarDerivada, duração em [duracaoMin, duracaoMax]
+  float limiarDerivada;
+  float duracaoMinMs;
+  float duracaoMaxMs;
+  int amplitudeMin;
+  // lenta: derivada < derivadaLentaMax, duração em [duracaoLentaMin, ...Max]
+  float derivadaLentaMax;
+  float duracaoLentaMinMs;
+  float duracaoLentaMaxMs;
+  int amplitudeMinLenta;
+};
+
+struct BlinkEvent {
+  BlinkClass cls;
+  uint32_t tInicioUs; // 1ª amostra abaixo do limiar
+  uint32_t tPicoUs;   // mínimo do evento
+  uint32_t tFimUs;    // amostra que fechou o evento
+  int valorInicio;
+  int pico;
+  int valorFim;     // 1ª amostra de volta acima do limiar
+  float amplitude;  // |pico - valorInicio| (contagens ADC)
+  float duracaoMs;  // início -> pico (fecho)
+  float derivada;   // amplitude / duracaoMs (contagens/ms)
+  float velMaxDesc; // maior descida entre amostras seguidas (contagens/ms)
+  float duracaoAberturaMs; // pico -> fim (reabertura, até ao limiar)
+  float velMaxSubida; // maior subida depois do pico (contagens/ms)
+};
+
+class BlinkDetector {
+public:
+  void setParams(const BlinkParams &p) { p_ = p; }
+  const BlinkParams &params() const { return p_; }
+  void reset() { emEvento_ = false; }
+  bool inEvent() const { return emEvento_; }
+  // true quando esta amostra fecha um evento (ev vem preenchido e classificado)
+  bool update(int v, uint32_t tUs, BlinkEvent &ev);
+  static BlinkClass classify(const BlinkEvent &ev, const BlinkParams &p);
+
+private:
+  BlinkParams p_ = {};
+  bool emEvento_ = false;
+  int inicio_ = 0;
+  int pico_ = 0;
+  int anterior_ = 0;
+  uint32_t tInicio_ = 0;
+  uint32_t tPico_ = 0;
+  uint32_t tAnterior_ = 0;
+  float velMax_ = 0;
+  float velMaxSubida_ = 0; // desde o pico atual
+};
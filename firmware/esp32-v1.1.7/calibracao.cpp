@@ -0,0 +1,79 @@
+#include "calibracao.h"
+
+#include <math.h>
+
+int calOffset(float sigma) {
+  int offset = (int)(5.0f * sigma);
+  if (offset < CAL_OFFSET_MIN)
+    offset = CAL_OFFSET_MIN;
+  if (offset > CAL_OFFSET_MAX)
+    offset = CAL_OFFSET_MAX;
+  return offset;
+}
+
+void calAmplitudes(int ampRef, int &amplitudeMin, int &amplitudeMinLenta) {
+  amplitudeMin = (int)(0.60 * ampRef);
+  if (amplitudeMin < 10)
+    amplitudeMin = 10;
+  amplitudeMinLenta = (int)(0.5 * ampRef);
+  if (amplitudeMinLenta < 10)
+    amplitudeMinLenta = 10;
+}
+
+// =================== 1/2: BASELINE ===================
+void CalBaseline::begin(uint16_t fsHz) {
+  rob_.begin();
+  classico_.begin();
+  bloco_ = (uint32_t)fsHz * CAL_BLOCO_MS / 1000;
+  if (bloco_ == 0)
+    bloco_ = 1;
+}
+
+void CalBaseline::add(uint16_t v) {
+  rob_.add(v);
+  classico_.add(v);
+}
+
+// Erros assintóticos com ruído normal: mediana 1.2533 sigma / sqrt(n), sigma
+// pelo MAD 1.166 sigma / sqrt(n), com n o efetivo. O do sigma só pesa (x5)
+// se o offset não está preso a um dos extremos.
+float CalBaseline::erroLimiar() const {
+  if (nEfetivo() == 0)
+    return INFINITY;
+  float s = sigma();
+  float raiz = sqrtf((float)nEfetivo());
+  float e = 1.2533f * s / raiz;
+  float o = 5.0f * s;
+  if (o > CAL_OFFSET_MIN && o < CAL_OFFSET_MAX)
+    e += 5.0f * 1.166f * s / raiz;
+  return 1.96f * e;
+}
+
+// =================== 2/2: PISCADELAS ===================
+void CalPiscadelas::begin() { amp_.begin(); }
+
+// com poucas piscadelas quase iguais o MAD sai baixo e uma um pouco maior
+// passava a outlier: nunca abaixo da variação natural entre elas
+float CalPiscadelas::sigma() const {
+  float med = mediana();
+  float s = 1.4826f * amp_.desvioMediano(med);
+  float min = CAL_PISCAR_CV_MIN * med;
+  return s > min ? s : min;
+}
+
+// com menos de CAL_PISCADELAS_MIN o MAD não vale nada, mas a partir de 3 a
+// mediana já não é puxada por uma piscadela forçada: um múltiplo dela
+float CalPiscadelas::cerca() const {
+  if (n() < 3)
+    return INFINITY;
+  if (n() < CAL_PISCADELAS_MIN)
+    return CAL_OUTLIER_MED_K * mediana();
+  return mediana() + CAL_OUTLIER_K * sigma();
+}
+
+float CalPiscadelas::erroRelativo() const {
+  float med = mediana();
+  if (n() == 0 || med <= 0)
+    return INFINITY;
+  return 1.2533f * sigma() / (med * sqrtf((float)n()));
+}
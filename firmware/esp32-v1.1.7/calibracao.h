@@ -0,0 +1,94 @@
+#pragma once
+#include <stdint.h>
+
+#include "estatistica.h"
+
+// =================== CALIBRAÇÃO (C) ===================
+// As contas de C, por canal, sem saber de onde vêm as amostras (main.cpp e
+// o bench usam as mesmas):
+//
+// 1/2 olhos abertos: baseline = mediana e ruído = 1.4826 MAD, ambos em
+// contínuo (estatistica.h), por isso um movimento ou uma piscadela no meio
+// não os puxam. A fase acaba assim que o limiarInferior que daí sai tem um
+// erro (95%) de no máximo CAL_BASE_ERRO_LSB, entre CAL_BASE_MIN_S e
+// CAL_BASE_MAX_S. As amostras seguidas não são independentes (o filtro do
+// DSP junta várias): o erro conta uma por bloco de CAL_BLOCO_MS.
+//
+// 2/2 a piscar: as amplitudes vão para um esboço de quantis. A partir de
+// CAL_PISCADELAS_MIN, acima de mediana + CAL_OUTLIER_K sigmas (robustos) é
+// outlier (piscadela forçada, artefacto) e não conta; com menos (mas pelo
+// menos 3), acima de CAL_OUTLIER_MED_K x mediana. A referência dos limiares
+// é a maior das outras, como antes era a maior de todas. O sigma é pelo
+// menos CAL_PISCAR_CV_MIN da mediana (a variação natural entre piscadelas).
+// Acaba com CAL_PISCADELAS_MIN piscadelas e a mediana com um erro relativo
+// até CAL_PISCAR_ERRO_REL: a 15 bpm são uns 20 s, por isso o limite
+// CAL_PISCAR_MAX_S é largo. Ao fim dele, com menos de CAL_PISCADELAS_MIN, a
+// calibração é pouco fiável (confiavel() = false).
+//
+// Welford (média e sigma clássicos) fica só para comparar no log: muito
+// acima do robusto = houve artefactos na baseline.
+
+#define CAL_BASE_MIN_S 2
+#define CAL_BASE_MAX_S 10
+#define CAL_BASE_ERRO_LSB 4.0f
+#define CAL_BLOCO_MS 100
+#define CAL_PISCAR_MAX_S 40
+#define CAL_PISCADELAS_MIN 5
+#define CAL_PISCAR_ERRO_REL 0.10f
+#define CAL_OUTLIER_K 3.0f
+#define CAL_PISCAR_CV_MIN 0.15f
+#define CAL_OUTLIER_MED_K 1.6f // 3 a CAL_PISCADELAS_MIN - 1 piscadelas
+// limiarInferior = baseline - 5 sigma, entre estes offsets
+#define CAL_OFFSET_MIN 20
+#define CAL_OFFSET_MAX 150
+
+int calOffset(float sigma);
+// AMPLITUDE_MIN (60%) e a das lentas (50%) da amplitude de referência
+void calAmplitudes(int ampRef, int &amplitudeMin, int &amplitudeMinLenta);
+
+class CalBaseline {
+public:
+  void begin(uint16_t fsHz);
+  void add(uint16_t v);
+  uint32_t n() const { return rob_.n(); }
+  // amostras independentes: uma por bloco de CAL_BLOCO_MS
+  uint32_t nEfetivo() const { return n() / bloco_; }
+  float mediana() const { return rob_.mediana(); }
+  float sigma() const { return rob_.sigma(); }
+  float media() const { return classico_.media(); }
+  float sigmaWelford() const { return classico_.sigma(); }
+  int offset() const { return calOffset(sigma()); }
+  int limiarInferior() const { return (int)mediana() - offset(); }
+  // meia largura do intervalo de 95% do limiarInferior, em LSB
+  float erroLimiar() const;
+  bool pronta(uint32_t nMin) const {
+    return n() >= nMin && erroLimiar() <= CAL_BASE_ERRO_LSB;
+  }
+
+private:
+  MedianaMad rob_;
+  Welford classico_;
+  uint32_t bloco_ = 1; // amostras por CAL_BLOCO_MS
+};
+
+class CalPiscadelas {
+public:
+  void begin();
+  void add(uint16_t amplitude) { amp_.add(amplitude); }
+  uint32_t n() const { return amp_.n(); }
+  float mediana() const { return amp_.mediana(); }
+  float sigma() const; // 1.4826 MAD das amplitudes (com um mínimo)
+  float cerca() const; // sem limite com menos de 3
+  int amplitudeRef() const { return amp_.maiorAte(cerca()); }
+  int amplitudeMax() const { return amp_.maximo(); }
+  uint32_t outliers() const { return amp_.acima(cerca()); }
+  // erro padrão relativo da mediana
+  float erroRelativo() const;
+  bool pronta() const {
+    return confiavel() && erroRelativo() <= CAL_PISCAR_ERRO_REL;
+  }
+  bool confiavel() const { return n() >= CAL_PISCADELAS_MIN; }
+
+private:
+  EsbocoQuantis amp_;
+};
@@ -0,0 +1,171 @@
+#include "captura_usb.h"
+
+#include <string.h>
+
+#include "hal.h"
+
+static uint8_t capAnel[CAP_ANEL_BYTES];
+static size_t capHead = 0; // total escrito
+static size_t capTail = 0; // total já enviado para a USB
+static bool ativa = false;
+static uint16_t seq = 0;
+static uint8_t nCanais = 1;
+static uint32_t capBaud = 0;
+static CapStats stats = {};
+
+static void putU16(uint8_t *p, uint16_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+}
+static void putU32(uint8_t *p, uint32_t v) {
+  putU16(p, (uint16_t)v);
+  putU16(p + 2, (uint16_t)(v >> 16));
+}
+
+uint16_t crc16Ccitt(const uint8_t *d, size_t n) {
+  uint16_t crc = 0xFFFF;
+  for (size_t i = 0; i < n; i++) {
+    crc ^= (uint16_t)d[i] << 8;
+    for (int b = 0; b < 8; b++)
+      crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021)
+                           : (uint16_t)(crc << 1);
+  }
+  return crc;
+}
+
+size_t cobsCodificar(const uint8_t *in, size_t n, uint8_t *out) {
+  size_t codigo = 0; // onde vai o byte de contagem do bloco atual
+  size_t k = 1;
+  uint8_t c = 1;
+  for (size_t i = 0; i < n; i++) {
+    if (in[i] != 0) {
+      out[k++] = in[i];
+      c++;
+    }
+    if (in[i] == 0 || c == 0xFF) {
+      out[codigo] = c;
+      codigo = k++;
+      c = 1;
+    }
+  }
+  out[codigo] = c;
+  return k;
+}
+
+size_t cobsDescodificar(const uint8_t *in, size_t n, uint8_t *out) {
+  size_t k = 0;
+  for (size_t i = 0; i < n;) {
+    uint8_t c = in[i++];
+    if (c == 0 || i + c - 1 > n)
+      return 0;
+    for (uint8_t j = 1; j < c; j++) {
+      if (in[i] == 0)
+        return 0;
+      out[k++] = in[i++];
+    }
+    if (c != 0xFF && i < n)
+      out[k++] = 0;
+  }
+  return k;
+}
+
+// codifica e mete no anel inteiro ou nada
+static void registar(CapTipo tipo, const uint8_t *dados, size_t n) {
+  if (!ativa)
+    return;
+  if (n > CAP_DADOS_MAX)
+    n = CAP_DADOS_MAX;
+  uint8_t reg[CAP_REGISTO_MAX];
+  reg[0] = tipo;
+  putU16(reg + 1, seq++);
+  memcpy(reg + CAP_CABECALHO_LEN, dados, n);
+  size_t len = CAP_CABECALHO_LEN + n;
+  putU16(reg + len, crc16Ccitt(reg, len));
+  len += CAP_CRC_LEN;
+  uint8_t cobs[CAP_COBS_MAX(CAP_REGISTO_MAX)];
+  size_t m = cobsCodificar(reg, len, cobs);
+  cobs[m++] = 0;
+  if (CAP_ANEL_BYTES - (capHead - capTail) < m) {
+    stats.perdidos++;
+    return;
+  }
+  for (size_t i = 0; i < m; i++)
+    capAnel[(capHead + i) % CAP_ANEL_BYTES] = cobs[i];
+  capHead += m;
+  stats.registos++;
+  stats.bytes += (uint32_t)m;
+}
+
+void capBegin(uint16_t fsHz, uint8_t canais, uint32_t baud) {
+  capHead = capTail = 0;
+  seq = 0;
+  nCanais = canais;
+  capBaud = baud;
+  memset(&stats, 0, sizeof(stats));
+  ativa = true;
+  capAnel[capHead++] = 0; // fecha o texto que o recetor tenha a meio
+  capMudarFs(fsHz);
+}
+
+void capMudarFs(uint16_t fsHz) {
+  uint8_t d[12];
+  d[0] = CAP_VERSAO;
+  putU16(d + 1, fsHz);
+  d[3] = nCanais;
+  putU32(d + 4, capBaud);
+  putU32(d + 8, halMicros());
+  registar(CAP_INICIO, d, sizeof(d));
+}
+
+bool capAtiva() { return ativa; }
+
+void capParar() {
+  ativa = false;
+  capHead = capTail = 0;
+}
+
+void capAmostra(const AcqSample &a) {
+  uint8_t d[4 + 2 * ACQ_CANAIS_MAX];
+  putU32(d, a.tUs);
+  for (uint8_t c = 0; c < nCanais; c++)
+    putU16(d + 4 + 2 * c, a.eog[c]);
+  registar(CAP_AMOSTRA, d, 4 + 2 * nCanais);
+}
+
+void capAcel(const AccSample &a) {
+  uint8_t d[10];
+  putU32(d, a.tUs);
+  for (uint8_t i = 0; i < 3; i++)
+    putU16(d + 4 + 2 * i, a.q4[i]);
+  registar(CAP_ACEL, d, sizeof(d));
+}
+
+void capEvento(const uint8_t *trama, size_t len) {
+  registar(CAP_EVENTO, trama, len);
+}
+
+void capTexto(const char *linha, size_t n) {
+  registar(CAP_TEXTO, (const uint8_t *)linha, n);
+}
+
+void capDrain() {
+  while (capHead != capTail) {
+    size_t inicio = capTail % CAP_ANEL_BYTES;
+    size_t n = CAP_ANEL_BYTES - inicio; // até ao fim do anel
+    if (n > capHead - capTail)
+      n = capHead - capTail;
+    size_t livre = halConsoleWritable();
+    if (n > livre)
+      n = livre;
+    if (n == 0)
+      return; // USB cheia: fica para a próxima volta
+    size_t escritos = halConsoleWrite(capAnel + inicio, n);
+    capTail += escritos;
+    if (escritos < n)
+      return;
+  }
+}
+
+size_t capPendentes() { return capHead - capTail; }
+
+void capStats(CapStats &out) { out = stats; }
@@ -0,0 +1,83 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include "eog_acq.h"
+
+// =================== CAPTURA USB (CAP=) ===================
+// Modo de laboratório: a USB deixa de levar texto e passa a levar registos
+// binários com todas as amostras EOG, o acelerómetro e as piscadelas de S,
+// para montar conjuntos de treino (host/cap_dump passa-os a CSV). O log
+// continua a sair, como registos CAP_TEXTO.
+//
+// Cada registo (little-endian), antes de codificado:
+//   0  u8  tipo (CapTipo)
+//   1  u16 seq (todos os tipos; um buraco = registos perdidos)
+//   3  ..  dados
+//   .. u16 CRC-16/CCITT-FALSE de tudo o que está antes
+// e vai na linha em COBS seguido de 0x00, por isso um byte perdido só
+// estraga um registo e o recetor volta a sincronizar no 0x00 seguinte. A
+// captura começa com um 0x00 solto, que separa o texto de antes.
+//
+// Dados:
+//   CAP_INICIO  u8 CAP_VERSAO, u16 fs (Hz), u8 canais, u32 baud, u32 tUs
+//   CAP_AMOSTRA u32 tUs, canais x u16 eog (ADC, a saída do DSP)
+//   CAP_ACEL    u32 tUs, 3 x u16 média x, y, z (LSB x16, AccSample)
+//   CAP_EVENTO  a trama EVT de rt_frame.h (RT_FRAME_PISCADELA_LEN bytes)
+//   CAP_TEXTO   uma linha do log, sem o fim de linha
+//
+// Os registos vão para um anel em RAM e capDrain() passa à USB só o que
+// cabe no buffer de TX (como o log): a amostragem nunca espera pela USB.
+// Com o anel cheio o registo é descartado e contado (o seq avança na
+// mesma). A 250 Hz x 1 canal são ~3.7 kB/s, já perto dos 11.5 kB/s de
+// 115200 baud; a 1 kHz ou com mais canais é preciso subir a velocidade.
+
+#define CAP_VERSAO 1
+#define CAP_ANEL_BYTES 8192 // ~90 ms a 921600 baud; potência de 2
+#define CAP_BAUD_TEXTO 115200
+#define CAP_BAUD_OMISSAO 921600
+#define CAP_BAUD_MAX 3000000
+#define CAP_CABECALHO_LEN 3
+#define CAP_CRC_LEN 2
+// o maior registo é uma linha do log inteira
+#define CAP_DADOS_MAX 160
+#define CAP_REGISTO_MAX (CAP_CABECALHO_LEN + CAP_DADOS_MAX + CAP_CRC_LEN)
+// COBS: +1 byte a cada 254, mais o 0x00 no fim
+#define CAP_COBS_MAX(n) ((n) + (n) / 254 + 2)
+
+enum CapTipo : uint8_t {
+  CAP_INICIO = 0x01,
+  CAP_AMOSTRA = 0x02,
+  CAP_ACEL = 0x03,
+  CAP_EVENTO = 0x04,
+  CAP_TEXTO = 0x05,
+};
+
+// esvazia o anel, recomeça o seq e põe o CAP_INICIO
+void capBegin(uint16_t fsHz, uint8_t canais, uint32_t baud);
+// FS= a meio: um CAP_INICIO novo (o seq continua)
+void capMudarFs(uint16_t fsHz);
+bool capAtiva();
+void capParar(); // o que está no anel perde-se (quem chama drena antes)
+
+// produtores: só o loop (nada aqui é thread-safe)
+void capAmostra(const AcqSample &a);
+void capAcel(const AccSample &a);
+void capEvento(const uint8_t *trama, size_t len);
+void capTexto(const char *linha, size_t n);
+// consumidor (loop): passa o que couber para a USB, sem bloquear
+void capDrain();
+size_t capPendentes();
+
+struct CapStats {
+  uint32_t registos; // metidos no anel
+  uint32_t bytes;    // já codificados
+  uint32_t perdidos; // anel cheio
+};
+void capStats(CapStats &out);
+
+// COBS: out com CAP_COBS_MAX(n) bytes; devolve o comprimento sem o 0x00
+size_t cobsCodificar(const uint8_t *in, size_t n, uint8_t *out);
+// 0 se não é COBS válido (out com n bytes chega)
+size_t cobsDescodificar(const uint8_t *in, size_t n, uint8_t *out);
+uint16_t crc16Ccitt(const uint8_t *d, size_t n);
@@ -0,0 +1,179 @@
+#include "classificador.h"
+
+#include <string.h>
+
+#include "hal.h"
+#include "modelo_tabelas.h"
+#include "perfil.h"
+
+const char *const featPiscadelaNomes[FP_N] = {
+    "fecho_ms",   "amplitude", "vel_fecho",     "vel_max_fecho",
+    "reab_ms",    "vel_reab",  "vel_max_reab",
+};
+const char *const featJanelaNomes[FJ_N] = {
+    "normais_min_x10", "lentas_min_x10",   "rel_baseline_x100", "lentas",
+    "dur_normais_ms",  "dur_lentas_ms",    "ibi_ms",
+};
+
+static inline int32_t arredondar(float v) {
+  return (int32_t)(v < 0 ? v - 0.5f : v + 0.5f);
+}
+
+void featuresPiscadela(const BlinkEvent &ev, int32_t *f) {
+  f[FP_FECHO_MS] = arredondar(ev.duracaoMs);
+  f[FP_AMPLITUDE] = arredondar(ev.amplitude);
+  f[FP_VEL_FECHO] = arredondar(ev.derivada * 1000.0f);
+  f[FP_VEL_MAX_FECHO] = arredondar(ev.velMaxDesc * 1000.0f);
+  f[FP_REAB_MS] = arredondar(ev.duracaoAberturaMs);
+  f[FP_VEL_REAB] =
+      ev.duracaoAberturaMs > 0
+          ? arredondar((float)(ev.valorFim - ev.pico) * 1000.0f /
+                       ev.duracaoAberturaMs)
+          : 0;
+  f[FP_VEL_MAX_REAB] = arredondar(ev.velMaxSubida * 1000.0f);
+}
+
+void normalizarPiscadela(int32_t *f, int amplitudeMin) {
+  static const uint8_t escala[] = {FP_AMPLITUDE, FP_VEL_FECHO,
+                                   FP_VEL_MAX_FECHO, FP_VEL_REAB,
+                                   FP_VEL_MAX_REAB};
+  int64_t ref = amplitudeMin > CLASSIF_AMP_REF_MIN ? amplitudeMin
+                                                   : CLASSIF_AMP_REF_MIN;
+  for (uint8_t i = 0; i < sizeof(escala); i++)
+    f[escala[i]] = (int32_t)((int64_t)f[escala[i]] * 1000 / ref);
+}
+
+void featuresJanela(const JanelaResumo &r, float baselineBpm, int32_t *f) {
+  f[FJ_NORMAIS_MIN_X10] = arredondar(r.normaisMin * 10.0f);
+  f[FJ_LENTAS_MIN_X10] = arredondar(r.lentasMin * 10.0f);
+  f[FJ_REL_BASELINE_X100] =
+      baselineBpm > 0.01f ? arredondar(r.normaisMin * 100.0f / baselineBpm)
+                          : 0;
+  f[FJ_LENTAS] = (int32_t)r.lentas;
+  f[FJ_DUR_NORMAIS_MS] = arredondar(r.durNormaisMs);
+  f[FJ_DUR_LENTAS_MS] = arredondar(r.durLentasMs);
+  f[FJ_IBI_MS] = arredondar(r.ibiMs);
+}
+
+BlinkClass florestaClasse(const ModeloNo *nos, const uint16_t *raizes,
+                          uint8_t nArvores, const int32_t *f) {
+  uint8_t votos[3] = {0, 0, 0};
+  for (uint8_t a = 0; a < nArvores; a++) {
+    const ModeloNo *n = &nos[raizes[a]];
+    while (n->feat >= 0)
+      n = &nos[f[n->feat] <= n->limiar ? n->esq : n->dir];
+    if (n->classe < 3)
+      votos[n->classe]++;
+  }
+  uint8_t melhor = 0;
+  for (uint8_t c = 1; c < 3; c++)
+    if (votos[c] > votos[melhor])
+      melhor = c;
+  return (BlinkClass)melhor;
+}
+
+int64_t logisticaLogito(const int32_t *pesos, int32_t vies,
+                        const int32_t *f) {
+  int64_t z = vies;
+  for (uint8_t i = 0; i < FJ_N; i++)
+    z += (int64_t)pesos[i] * f[i];
+  return z;
+}
+
+// ---- modelo 0: os limiares de sempre ----
+static BlinkClass limiaresPiscadela(const BlinkEvent &ev,
+                                    const BlinkParams &p) {
+  return BlinkDetector::classify(ev, p);
+}
+static bool limiaresSono(const JanelaResumo &r, const SonoParams &p) {
+  return p.baselineBpm > 0.01f && r.normaisMin >= p.baselineBpm * p.fatorBpm &&
+         r.lentasMin >= p.lentasMin && r.lentas >= p.lentasMin;
+}
+
+// ---- modelo 1: tabelas geradas ----
+static BlinkClass tabelasPiscadela(const BlinkEvent &ev,
+                                   const BlinkParams &p) {
+  int32_t f[FP_N];
+  featuresPiscadela(ev, f);
+  normalizarPiscadela(f, p.amplitudeMin);
+  return florestaClasse(modeloNos, modeloRaizes, MODELO_ARVORES, f);
+}
+static bool tabelasSono(const JanelaResumo &r, const SonoParams &p) {
+  int32_t f[FJ_N];
+  featuresJanela(r, p.baselineBpm, f);
+  return logisticaLogito(modeloPesos, modeloVies, f) >= 0;
+}
+
+struct Modelo {
+  const char *nome;
+  BlinkClass (*piscadela)(const BlinkEvent &ev, const BlinkParams &p);
+  bool (*sono)(const JanelaResumo &r, const SonoParams &p);
+};
+static const Modelo modelos[] = {
+    {"limiares", limiaresPiscadela, limiaresSono},
+    {MODELO_NOME, tabelasPiscadela, tabelasSono},
+};
+#define N_MODELOS (sizeof(modelos) / sizeof(modelos[0]))
+
+static uint8_t atual = 0;
+static CustoInferencia custos[2];
+
+static void medir(uint8_t etapa, uint32_t t0) {
+  uint32_t ciclos = halCiclos() - t0;
+  CustoInferencia &k = custos[etapa];
+  k.n++;
+  k.somaCiclos += ciclos;
+  if (ciclos > k.maxCiclos)
+    k.maxCiclos = ciclos;
+  if (ciclos > classificadorOrcamentoCiclos())
+    k.acima++;
+#if PERF_ATIVO
+  if (perfLigado)
+    perfRegistar(etapa ? PERF_SONO : PERF_CLASSIF, ciclos);
+#endif
+}
+
+uint8_t classificadorN() { return (uint8_t)N_MODELOS; }
+
+const char *classificadorNome(uint8_t m) {
+  return m < N_MODELOS ? modelos[m].nome : "?";
+}
+
+bool classificadorSelecionar(uint8_t m) {
+  if (m >= N_MODELOS)
+    return false;
+  atual = m;
+  memset(custos, 0, sizeof(custos));
+  return true;
+}
+
+uint8_t classificadorAtual() { return atual; }
+
+BlinkClass classificarPiscadela(const BlinkEvent &ev, const BlinkParams &p) {
+  uint32_t t0 = halCiclos();
+  BlinkClass c = modelos[atual].piscadela(ev, p);
+  medir(0, t0);
+  return c;
+}
+
+BlinkClass classificadorPiscadela(uint8_t m, const BlinkEvent &ev,
+                                  const BlinkParams &p) {
+  return m < N_MODELOS ? modelos[m].piscadela(ev, p) : BLINK_OTHER;
+}
+
+bool avaliarSono(const JanelaResumo &r, const SonoParams &p) {
+  if (!r.cheia)
+    return false;
+  uint32_t t0 = halCiclos();
+  bool sono = modelos[atual].sono(r, p);
+  medir(1, t0);
+  return sono;
+}
+
+void classificadorCusto(uint8_t etapa, CustoInferencia &out) {
+  out = custos[etapa ? 1 : 0];
+}
+
+uint32_t classificadorOrcamentoCiclos() {
+  return CLASSIF_ORCAMENTO_US * halCiclosPorUs();
+}
@@ -0,0 +1,97 @@
+#pragma once
+#include <stdint.h>
+
+#include "blink_detector.h"
+#include "janelas.h"
+
+// =================== CLASSIFICADOR ===================
+// Um modelo decide duas coisas: a classe de cada piscadela do canal 0 que o
+// detetor fecha e se uma janela (janelas.h, e o minuto do array M#) indica
+// sonolência. O modelo 0 são os limiares de sempre (BlinkDetector::classify
+// e baseline x fator + lentas por minuto); os outros correm só em inteiros
+// sobre tabelas constexpr (flash) geradas por gerar_modelo (host) a partir
+// de dados rotulados: modelo_tabelas.h. MDL=n troca de modelo.
+//
+// Cada inferência é medida com o contador de ciclos e comparada com o
+// orçamento (MDL mostra; STATS tem as etapas classif e sono).
+
+#define CLASSIF_ORCAMENTO_US 10 // 2400 ciclos a 240 MHz
+
+// features em inteiros, nas unidades da trama de evento (rt_frame.h)
+enum FeatPiscadela : uint8_t {
+  FP_FECHO_MS = 0,
+  FP_AMPLITUDE,
+  FP_VEL_FECHO, // contagens/s
+  FP_VEL_MAX_FECHO,
+  FP_REAB_MS,
+  FP_VEL_REAB,
+  FP_VEL_MAX_REAB,
+  FP_N
+};
+enum FeatJanela : uint8_t {
+  FJ_NORMAIS_MIN_X10 = 0,
+  FJ_LENTAS_MIN_X10,
+  FJ_REL_BASELINE_X100, // normais/min em % da baseline (0 sem baseline)
+  FJ_LENTAS,
+  FJ_DUR_NORMAIS_MS,
+  FJ_DUR_LENTAS_MS,
+  FJ_IBI_MS,
+  FJ_N
+};
+extern const char *const featPiscadelaNomes[FP_N];
+extern const char *const featJanelaNomes[FJ_N];
+void featuresPiscadela(const BlinkEvent &ev, int32_t *f);
+// o modelo 1 vê a amplitude e as velocidades em ‰ do AMPLITUDE_MIN
+// calibrado: os cortes da floresta seguem o ganho de cada pessoa e elétrodo
+#define CLASSIF_AMP_REF_MIN 10 // abaixo (sem calibração) fica em 10
+void normalizarPiscadela(int32_t *f, int amplitudeMin);
+void featuresJanela(const JanelaResumo &r, float baselineBpm, int32_t *f);
+
+// regra de sonolência dos limiares (e baseline para as features)
+struct SonoParams {
+  float baselineBpm;
+  float fatorBpm;     // normais/min >= baseline x fator
+  uint16_t lentasMin; // lentas/min e lentas na janela >= lentasMin
+};
+
+// ---- tabelas (modelo_tabelas.h) ----
+// nó de árvore: folha se feat < 0 (classe em classe); senão
+// f[feat] <= limiar -> esq, > limiar -> dir (índices na tabela toda)
+struct ModeloNo {
+  int8_t feat;
+  uint8_t classe;
+  uint16_t esq;
+  uint16_t dir;
+  int32_t limiar;
+};
+#define MODELO_PESO_Q 20 // pesos e viés da regressão logística em Q20
+
+// floresta: voto da maioria (empate: a classe mais baixa)
+BlinkClass florestaClasse(const ModeloNo *nos, const uint16_t *raizes,
+                          uint8_t nArvores, const int32_t *f);
+// regressão logística: logit em Q20 (>= 0: sono)
+int64_t logisticaLogito(const int32_t *pesos, int32_t vies,
+                        const int32_t *f);
+
+// ---- modelos ----
+uint8_t classificadorN();
+const char *classificadorNome(uint8_t m);
+bool classificadorSelecionar(uint8_t m); // false se m não existe
+uint8_t classificadorAtual();
+// p: limiares atuais (calibração / TH=), para o modelo 0
+BlinkClass classificarPiscadela(const BlinkEvent &ev, const BlinkParams &p);
+// janelas que ainda não cobrem o horizonte nunca dão sono
+bool avaliarSono(const JanelaResumo &r, const SonoParams &p);
+// inferência com o modelo m, sem medir nem mudar o atual (bench.h)
+BlinkClass classificadorPiscadela(uint8_t m, const BlinkEvent &ev,
+                                  const BlinkParams &p);
+
+struct CustoInferencia {
+  uint32_t n;
+  uint32_t maxCiclos;
+  uint32_t acima; // acima de classificadorOrcamentoCiclos()
+  uint64_t somaCiclos;
+};
+// 0 = piscadelas, 1 = janelas; zerado ao trocar de modelo
+void classificadorCusto(uint8_t etapa, CustoInferencia &out);
+uint32_t classificadorOrcamentoCiclos(); // CLASSIF_ORCAMENTO_US em ciclos
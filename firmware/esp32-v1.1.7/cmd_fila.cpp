@@ -0,0 +1,179 @@
+#include "cmd_fila.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "hal.h"
+#include "rt_frame.h"
+#include "spsc_ring.h"
+
+static SpscRing<CmdMsg, CMD_FILA_LEN> filaConsola;
+static SpscRing<CmdMsg, CMD_FILA_LEN> filaBle;
+static std::atomic<uint32_t> descartados{0};
+static uint16_t seqTexto = 0; // só o consumidor mexe
+
+bool cmdPush(CmdOrigem origem, uint8_t ligacao, const uint8_t *data,
+             size_t len, bool binario) {
+  CmdMsg m;
+  m.rxUs = halMicros();
+  m.seq = 0;
+  m.origem = origem;
+  m.ligacao = ligacao;
+  m.binario = binario ? 1 : 0;
+  if (binario) {
+    if (len < CMD_BIN_CABECALHO_LEN || len > CMD_MSG_MAX) {
+      descartados.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+  } else if (len > CMD_MSG_MAX - 1) {
+    len = CMD_MSG_MAX - 1; // como o buffer de linha antigo
+  }
+  memcpy(m.data, data, len);
+  if (!binario)
+    m.data[len] = 0;
+  m.len = (uint8_t)len;
+  SpscRing<CmdMsg, CMD_FILA_LEN> &fila =
+      origem == CMD_BLE ? filaBle : filaConsola;
+  if (fila.push(m))
+    return true;
+  descartados.fetch_add(1, std::memory_order_relaxed);
+  return false;
+}
+
+bool cmdPop(CmdMsg &out) {
+  if (!filaConsola.pop(out) && !filaBle.pop(out))
+    return false;
+  if (out.binario)
+    out.seq = (uint16_t)(out.data[3] | (out.data[4] << 8));
+  else
+    out.seq = seqTexto++;
+  return true;
+}
+
+uint32_t cmdDescartados() {
+  return descartados.load(std::memory_order_relaxed);
+}
+
+// ---- opcodes <-> texto ----
+struct OpTexto {
+  uint8_t op;
+  const char *texto; // com '=' quando leva argumento
+  uint8_t argBytes;
+  bool opcional; // argumento 0 = sem "=..." (DL, TPUT, PF, BENCH, SYNC)
+};
+static const OpTexto opTabela[] = {
+    {CMD_OP_C, "C", 0, false},
+    {CMD_OP_P, "P", 0, false},
+    {CMD_OP_S, "S", 0, false},
+    {CMD_OP_X, "X", 0, false},
+    {CMD_OP_TH, "TH=", 2, false},
+    {CMD_OP_FS, "FS=", 2, false},
+    {CMD_OP_RTB, "RTB=", 1, false},
+    {CMD_OP_LOG, "LOG=", 1, false},
+    {CMD_OP_OS, "OS=", 1, false},
+    {CMD_OP_FLT, "FLT=", 1, false},
+    {CMD_OP_DL, "DL=", 2, true},
+    {CMD_OP_REC, "REC", 0, false},
+    {CMD_OP_DSP, "DSP", 0, false},
+    {CMD_OP_LAT, "LAT", 0, false},
+    {CMD_OP_PING, "PING", 0, false},
+    {CMD_OP_SYNC, "SYNC=", 2, true},
+    {CMD_OP_SEQ, "SEQ=", 1, false},
+    {CMD_OP_SUB, "SUB=", 1, false},
+    {CMD_OP_RTA, "RTA=", 1, false},
+    {CMD_OP_CH, "CH=", 1, false},
+    {CMD_OP_STATS, "STATS", 0, false},
+    {CMD_OP_PERF, "STATS=", 1, false},
+    {CMD_OP_TLM, "TLM=", 1, false},
+    {CMD_OP_TPUT, "TPUT=", 1, true},
+    {CMD_OP_RAW, "RAW=", 1, false},
+    {CMD_OP_EVT, "EVT=", 1, false},
+    {CMD_OP_CAP, "CAP=", 1, false},
+    {CMD_OP_MDL, "MDL=", 1, false},
+    {CMD_OP_PF, "PF=", 1, true},
+    {CMD_OP_BENCH, "BENCH=", 2, true},
+    {CMD_OP_BLE, "BLE", 0, false},
+    {CMD_OP_JAN, "JAN", 0, false},
+    {CMD_OP_MODELO, "MDL", 0, false},
+    {CMD_OP_SUBS, "SUB", 0, false},
+};
+
+// "DL=" -> "DL"
+static bool ehSemArgumento(const OpTexto &e, const char *texto) {
+  size_t n = strlen(e.texto) - 1;
+  return e.opcional && strncasecmp(texto, e.texto, n) == 0 && texto[n] == 0;
+}
+
+bool cmdBinarioParaTexto(const uint8_t *trama, size_t len, char *out,
+                         size_t max) {
+  if (len < CMD_BIN_CABECALHO_LEN || trama[0] != RT_FRAME_MAGIC ||
+      trama[2] != RT_FRAME_TYPE_CMD)
+    return false;
+  uint8_t op = trama[5];
+  for (const OpTexto &e : opTabela) {
+    if (e.op != op)
+      continue;
+    if (len < (size_t)CMD_BIN_CABECALHO_LEN + e.argBytes)
+      return false;
+    const uint8_t *a = trama + CMD_BIN_CABECALHO_LEN;
+    unsigned arg = e.argBytes == 2 ? (unsigned)(a[0] | (a[1] << 8))
+                   : e.argBytes  ? a[0]
+                                 : 0;
+    if (e.argBytes == 0)
+      snprintf(out, max, "%s", e.texto);
+    else if (e.opcional && arg == 0)
+      snprintf(out, max, "%.*s", (int)strlen(e.texto) - 1, e.texto);
+    else
+      snprintf(out, max, "%s%u", e.texto, arg);
+    return true;
+  }
+  return false;
+}
+
+size_t cmdTextoParaBinario(const char *texto, uint16_t seq, uint8_t *out,
+                           size_t max) {
+  for (const OpTexto &e : opTabela) {
+    size_t n = strlen(e.texto);
+    unsigned arg = 0;
+    if (e.argBytes == 0 && strcasecmp(texto, e.texto) == 0) {
+      // sem argumento
+    } else if (ehSemArgumento(e, texto)) {
+      arg = 0;
+    } else if (e.argBytes && strncasecmp(texto, e.texto, n) == 0 &&
+               texto[n] >= '0' && texto[n] <= '9') {
+      arg = (unsigned)atoi(texto + n);
+    } else {
+      continue;
+    }
+    if (max < (size_t)CMD_BIN_CABECALHO_LEN + e.argBytes)
+      return 0;
+    out[0] = RT_FRAME_MAGIC;
+    out[1] = RT_FRAME_VERSION;
+    out[2] = RT_FRAME_TYPE_CMD;
+    out[3] = (uint8_t)seq;
+    out[4] = (uint8_t)(seq >> 8);
+    out[5] = e.op;
+    if (e.argBytes >= 1)
+      out[6] = (uint8_t)arg;
+    if (e.argBytes == 2)
+      out[7] = (uint8_t)(arg >> 8);
+    return CMD_BIN_CABECALHO_LEN + e.argBytes;
+  }
+  return 0;
+}
+
+size_t cmdMontarAck(uint8_t *out, uint16_t seq, uint8_t opcode,
+                    CmdEstado estado, uint32_t latenciaUs) {
+  out[0] = RT_FRAME_MAGIC;
+  out[1] = RT_FRAME_VERSION;
+  out[2] = RT_FRAME_TYPE_ACK;
+  out[3] = (uint8_t)seq;
+  out[4] = (uint8_t)(seq >> 8);
+  out[5] = opcode;
+  out[6] = estado;
+  for (int i = 0; i < 4; i++)
+    out[7 + i] = (uint8_t)(latenciaUs >> (8 * i));
+  return CMD_ACK_LEN;
+}
@@ -0,0 +1,102 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// =================== FILA DE COMANDOS ===================
+// Os recetores só metem mensagens num anel SPSC por origem (BLE: task do
+// NimBLE; consola: o próprio loop) e o loop() tira-as e executa-as. Assim o
+// estado do firmware só é mexido pelo loop. A única exceção é o atalho do
+// X, que o recetor continua a sinalizar logo (abortRequested).
+//
+// Ao lado do texto (C, P, S, X, TH=...) há comandos binários, escritos na
+// característica RX (little-endian):
+//   0 u8  RT_FRAME_MAGIC (0xA5; nunca é o 1º byte de um comando de texto)
+//   1 u8  RT_FRAME_VERSION
+//   2 u8  RT_FRAME_TYPE_CMD
+//   3 u16 seq (escolhido pela app; volta no ACK)
+//   5 u8  opcode (CMD_OP_*)
+//   6 u8/u16 argumento, se o opcode tiver
+// Cada comando binário recebe uma trama RT_FRAME_TYPE_ACK (rt_frame.h); os
+// de texto também, depois de ACK=1 (as apps antigas não as esperam).
+
+#define CMD_MSG_MAX 64
+#define CMD_FILA_LEN 8 // por origem; potência de 2
+#define CMD_BIN_CABECALHO_LEN 6
+
+#define CMD_OP_C 0x01
+#define CMD_OP_P 0x02
+#define CMD_OP_S 0x03
+#define CMD_OP_X 0x04
+#define CMD_OP_TH 0x10  // u16
+#define CMD_OP_FS 0x11  // u16
+#define CMD_OP_RTB 0x12 // u8
+#define CMD_OP_LOG 0x13 // u8
+#define CMD_OP_OS 0x14  // u8
+#define CMD_OP_FLT 0x15 // u8
+#define CMD_OP_DL 0x16  // u16 (0 = última sessão)
+#define CMD_OP_PERF 0x17 // u8: STATS=0/1
+#define CMD_OP_TLM 0x18  // u8: segundos
+#define CMD_OP_TPUT 0x19 // u8: segundos (0 = por omissão)
+#define CMD_OP_RAW 0x1A  // u8: 0/1
+#define CMD_OP_EVT 0x1B  // u8: 0/1
+#define CMD_OP_MDL 0x1C  // u8: modelo
+#define CMD_OP_PF 0x1D   // u8: utilizador (0 = mostrar os perfis)
+#define CMD_OP_BENCH 0x1E // u16: segundos (0 = por omissão)
+#define CMD_OP_CAP 0x1F   // u8: 0/1 (captura USB à velocidade por omissão)
+#define CMD_OP_REC 0x20
+#define CMD_OP_DSP 0x21
+#define CMD_OP_LAT 0x22
+#define CMD_OP_STATS 0x23
+#define CMD_OP_BLE 0x24
+#define CMD_OP_JAN 0x25
+#define CMD_OP_MODELO 0x26
+#define CMD_OP_SUBS 0x27
+#define CMD_OP_PING 0x30 // não faz nada: só o ACK (mede o tempo de ida e volta)
+#define CMD_OP_SYNC 0x31 // u16: id (a resposta é uma trama SYNC, rt_frame.h)
+#define CMD_OP_SEQ 0x32  // u8: 0/1 (envelope de ligação)
+#define CMD_OP_SUB 0x33  // u8: máscara de fluxos (BleFluxo, ble_tx.h)
+#define CMD_OP_RTA 0x34  // u8: 0/1 (RT adaptativo)
+#define CMD_OP_CH 0x35   // u8: canais EOG (1..)
+
+enum CmdOrigem : uint8_t { CMD_CONSOLA = 0, CMD_BLE = 1 };
+
+// resultado no ACK
+enum CmdEstado : uint8_t {
+  CMD_OK = 0,
+  CMD_EM_ESPERA = 1, // modo aceite, arranca quando o atual acabar
+  CMD_INVALIDO = 2,  // argumento fora dos limites
+  CMD_DESCONHECIDO = 3,
+  CMD_VAZIO = 4, // linha em branco: sem ACK
+};
+
+struct CmdMsg {
+  uint32_t rxUs;   // halMicros() na receção
+  uint16_t seq;    // binário: o da app; texto: atribuído por cmdPop
+  uint8_t origem;  // CmdOrigem
+  uint8_t ligacao; // BLE: a central que o escreveu (o ACK só vai para ela)
+  uint8_t binario; // 1 = trama CMD, 0 = linha de texto (terminada em 0)
+  uint8_t len;
+  uint8_t data[CMD_MSG_MAX];
+};
+
+// produtor (um por origem; as centrais BLE partilham a task do NimBLE);
+// false se a fila dessa origem está cheia
+bool cmdPush(CmdOrigem origem, uint8_t ligacao, const uint8_t *data,
+             size_t len, bool binario);
+// consumidor (loop): próxima mensagem, a consola primeiro
+bool cmdPop(CmdMsg &out);
+uint32_t cmdDescartados();
+
+// trama CMD -> comando de texto equivalente (ex.: TH=90); false se o
+// opcode não existe ou falta o argumento
+bool cmdBinarioParaTexto(const uint8_t *trama, size_t len, char *out,
+                         size_t max);
+// o inverso, para ferramentas e testes: texto -> trama CMD; 0 se o texto
+// não tem opcode
+size_t cmdTextoParaBinario(const char *texto, uint16_t seq, uint8_t *out,
+                           size_t max);
+
+// trama ACK: seq e opcode do comando (0 = texto), estado e latência
+#define CMD_ACK_LEN 11
+size_t cmdMontarAck(uint8_t *out, uint16_t seq, uint8_t opcode,
+                    CmdEstado estado, uint32_t latenciaUs);
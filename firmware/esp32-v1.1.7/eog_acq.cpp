@@ -0,0 +1,186 @@
+#include "eog_acq.h"
+
+#include "hal.h"
+#include "perfil.h"
+#include "spsc_ring.h"
+
+// anel SoA: a posição i de cada vetor é a mesma amostra
+static SpscIndices<ACQ_RING_SIZE> acqIdx;
+static uint32_t anelT[ACQ_RING_SIZE];
+static uint16_t anelEog[ACQ_CANAIS_MAX][ACQ_RING_SIZE];
+static int acqPins[ACQ_CANAIS_MAX] = {-1, -1, -1, -1};
+static uint8_t acqN = 0;
+static uint16_t acqRate = 0;
+static std::atomic<uint32_t> acqLost{0};
+
+static EogDsp acqDsp[ACQ_CANAIS_MAX];
+static uint8_t acqOsPedido = ACQ_OS_DEFAULT;
+static DspModo acqModoPedido = ACQ_FLT_DEFAULT;
+// custo do tick (só estatística: o loop lê e zera em acqCusto)
+static uint32_t custoSomaUs = 0;
+static uint32_t custoTicks = 0;
+static uint32_t custoMaxUs = 0;
+// ritmo real: amostras que saíram do DSP e ticks que chegaram tarde
+static std::atomic<uint32_t> acqTotal{0};
+static std::atomic<uint32_t> acqTarde{0};
+static uint32_t periodoUs = 0;
+static uint32_t ultimoTickUs = 0;
+
+static SpscRing<AccSample, ACC_RING_SIZE> accRing;
+static int accPin[3] = {-1, -1, -1};
+static uint32_t accSoma[3];
+static uint16_t accN[3];
+static uint8_t accEixo = 0;
+static uint16_t accTicks = 0;
+static uint16_t accJanela = 0; // ticks por AccSample (>= 3)
+
+static void accTick(uint32_t tUs) {
+  accSoma[accEixo] += (uint32_t)halAdcRead(accPin[accEixo]);
+  accN[accEixo]++;
+  accEixo = accEixo == 2 ? 0 : accEixo + 1;
+  if (++accTicks < accJanela)
+    return;
+  AccSample a;
+  a.tUs = tUs;
+  for (int i = 0; i < 3; i++) {
+    a.q4[i] = (uint16_t)((accSoma[i] * 16 + accN[i] / 2) / accN[i]);
+    accSoma[i] = 0;
+    accN[i] = 0;
+  }
+  accTicks = 0;
+  accRing.push(a); // cheio = ninguém está a ler (idle, C, P): descarta
+}
+
+// chamado pelo timer da HAL (task do esp_timer no ESP32), a fs x os
+static void acqTick() {
+  PERF_MEDIR(PERF_TICK_ACQ);
+  uint32_t t = halMicros();
+  // tarde: mais de 1,5 períodos desde o tick anterior
+  if (ultimoTickUs != 0 && t - ultimoTickUs > periodoUs + periodoUs / 2)
+    acqTarde.fetch_add(1, std::memory_order_relaxed);
+  ultimoTickUs = t;
+  uint16_t raw[ACQ_CANAIS_MAX];
+  {
+    PERF_MEDIR(PERF_ADC);
+    for (uint8_t c = 0; c < acqN; c++)
+      raw[c] = (uint16_t)halAdcRead(acqPins[c]);
+  }
+  // os DSP dos canais decimam em fase: ou saem todos ou nenhum
+  uint16_t eog[ACQ_CANAIS_MAX];
+  bool saiu = false;
+  for (uint8_t c = 0; c < acqN; c++)
+    saiu = acqDsp[c].push(raw[c], eog[c]);
+  if (saiu) {
+    acqTotal.fetch_add(1, std::memory_order_relaxed);
+    size_t i;
+    if (acqIdx.livre(i)) {
+      anelT[i] = t;
+      for (uint8_t c = 0; c < acqN; c++)
+        anelEog[c][i] = eog[c];
+      acqIdx.publicar();
+    } else {
+      acqLost.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (accPin[0] >= 0)
+      accTick(t);
+  }
+  uint32_t dt = halMicros() - t;
+  custoSomaUs += dt;
+  custoTicks++;
+  if (dt > custoMaxUs)
+    custoMaxUs = dt;
+}
+
+void acqSetAccelPins(int pinX, int pinY, int pinZ) {
+  accPin[0] = pinX;
+  accPin[1] = pinY;
+  accPin[2] = pinZ;
+}
+
+bool acqReadAccel(AccSample &out) { return accRing.pop(out); }
+
+void acqSetDsp(uint8_t os, DspModo modo) {
+  acqOsPedido = os < 1 ? 1 : (os > DSP_OS_MAX ? DSP_OS_MAX : os);
+  acqModoPedido = modo > DSP_MODO_MAX ? DSP_BRUTO : modo;
+}
+
+uint8_t acqOs() { return acqDsp[0].os(); }
+DspModo acqDspModo() { return acqDsp[0].modo(); }
+uint8_t acqDspTaps() { return acqDsp[0].taps(); }
+
+void acqSetCanais(const int *pins, uint8_t n) {
+  acqN = n < ACQ_CANAIS_MAX ? n : ACQ_CANAIS_MAX;
+  for (uint8_t c = 0; c < ACQ_CANAIS_MAX; c++)
+    acqPins[c] = c < acqN ? pins[c] : -1;
+}
+
+uint8_t acqCanais() { return acqN; }
+
+void acqCusto(uint32_t &mediaCentUs, uint32_t &maxUs) {
+  halCriticalEnter();
+  uint32_t soma = custoSomaUs, ticks = custoTicks;
+  maxUs = custoMaxUs;
+  custoSomaUs = custoTicks = custoMaxUs = 0;
+  halCriticalExit();
+  mediaCentUs = ticks ? (uint32_t)((uint64_t)soma * 100 / ticks) : 0;
+}
+
+uint32_t acqAccelPeriodUs() {
+  return acqRate ? 1000000UL * accJanela / acqRate : 0;
+}
+
+bool acqBegin(uint16_t rateHz) {
+  if (rateHz < ACQ_MIN_RATE_HZ || rateHz > ACQ_MAX_RATE_HZ || acqN == 0)
+    return false;
+  acqStop();
+  acqRate = rateHz;
+  acqIdx.clear();
+  uint8_t os = acqOsPedido;
+  if ((uint32_t)rateHz * os > DSP_MAX_RAW_HZ)
+    os = (uint8_t)(DSP_MAX_RAW_HZ / rateHz);
+  for (uint8_t c = 0; c < acqN; c++)
+    acqDsp[c].configurar(os, acqModoPedido, rateHz);
+  custoSomaUs = custoTicks = custoMaxUs = 0;
+  accJanela = (uint16_t)((rateHz + ACC_RATE_HZ / 2) / ACC_RATE_HZ);
+  if (accJanela < 3)
+    accJanela = 3;
+  for (int i = 0; i < 3; i++) {
+    accSoma[i] = 0;
+    accN[i] = 0;
+  }
+  accEixo = 0;
+  accTicks = 0;
+  accRing.clear();
+  periodoUs = 1000000UL / ((uint32_t)rateHz * os);
+  ultimoTickUs = 0;
+  acqTarde.store(0, std::memory_order_relaxed);
+  return halTimerStart(&acqTick, periodoUs);
+}
+
+void acqStop() { halTimerStop(); }
+
+bool acqRead(AcqSample &out) {
+  size_t i;
+  if (!acqIdx.proxima(i))
+    return false;
+  out.tUs = anelT[i];
+  for (uint8_t c = 0; c < acqN; c++)
+    out.eog[c] = anelEog[c][i];
+  acqIdx.consumir();
+  return true;
+}
+
+void acqFlush() {
+  acqIdx.clear();
+  accRing.clear();
+}
+
+uint16_t acqRateHz() { return acqRate; }
+
+uint32_t acqOverruns() { return acqLost.load(std::memory_order_relaxed); }
+
+uint32_t acqAmostrasTotal() {
+  return acqTotal.load(std::memory_order_relaxed);
+}
+
+uint32_t acqAtrasos() { return acqTarde.load(std::memory_order_relaxed); }
@@ -0,0 +1,83 @@
+#pragma once
+#include <stdint.h>
+
+#include "eog_dsp.h"
+
+// =================== MOTOR DE AQUISIÇÃO EOG ===================
+// Um timer periódico (halTimerStart) lê o ADC a taxa fixa e mete cada
+// amostra, com o seu instante exato, num anel SPSC. C, P e S consomem do
+// anel, por isso o ritmo de amostragem já não depende do resto do loop (BLE,
+// Serial, acelerómetro...).
+//
+// Com sobre-amostragem (OS=n) o timer lê o ADC a fs x n e o EogDsp (FLT=m)
+// filtra e decima para fs dentro do próprio tick: o anel e o detetor veem
+// sempre amostras a fs. tUs é o instante da última leitura usada.
+//
+// Vários canais EOG (ex.: 0 vertical, 1 horizontal) são lidos seguidos no
+// mesmo tick, cada um com o seu EogDsp, e partilham o instante. O anel é
+// structure-of-arrays (um vetor de instantes e um por canal): um canal a
+// mais custa uma leitura do ADC e um push no DSP por tick, nada mais.
+
+// taxa por omissão (amostras/s); alterável em runtime com FS=valor
+#ifndef EOG_SAMPLE_RATE_HZ
+#define EOG_SAMPLE_RATE_HZ 250
+#endif
+#define ACQ_MIN_RATE_HZ 50
+#define ACQ_MAX_RATE_HZ 1000
+// potência de 2: ~4 s a 250 Hz, ~1 s a 1 kHz
+#define ACQ_RING_SIZE 1024
+#define ACQ_CANAIS_MAX 4
+#ifndef ACQ_OS_DEFAULT
+#define ACQ_OS_DEFAULT 8 // 2 kHz de leituras a 250 Hz
+#endif
+#ifndef ACQ_FLT_DEFAULT
+#define ACQ_FLT_DEFAULT DSP_FIR_IIR
+#endif
+
+struct AcqSample {
+  uint32_t tUs;                 // instante da leitura (µs, volta em ~71 min)
+  uint16_t eog[ACQ_CANAIS_MAX]; // ADC 12 bits; só os acqCanais() primeiros
+};
+
+// ---- acelerómetro (ADXL335) na mesma varredura ----
+// Com pinos definidos, cada tick lê também UM eixo (x, y, z à vez) e soma-o em
+// inteiros; ao fim de cada janela (~1/ACC_RATE_HZ s) sai a média dos 3
+// eixos para um anel próprio. Nada de analogRead nem de esperas no loop.
+#define ACC_RATE_HZ 25
+#define ACC_RING_SIZE 16
+
+struct AccSample {
+  uint32_t tUs;   // fim da janela
+  uint16_t q4[3]; // média x, y, z em LSB do ADC x16
+};
+
+// chamar antes de acqBegin (-1 desliga)
+void acqSetAccelPins(int pinX, int pinY, int pinZ);
+bool acqReadAccel(AccSample &out);
+uint32_t acqAccelPeriodUs(); // intervalo entre AccSample
+
+// chamar antes de acqBegin; os é reduzido para fs x os <= DSP_MAX_RAW_HZ
+void acqSetDsp(uint8_t os, DspModo modo);
+uint8_t acqOs(); // o efetivo, depois de acqBegin
+DspModo acqDspModo();
+uint8_t acqDspTaps();
+
+// custo do tick do timer desde a última chamada (e zera): média em
+// centésimos de µs por tick (uma leitura por canal) e pior tick em µs
+void acqCusto(uint32_t &mediaCentUs, uint32_t &maxUs);
+
+// chamar antes de acqBegin; n é limitado a ACQ_CANAIS_MAX
+void acqSetCanais(const int *pins, uint8_t n);
+uint8_t acqCanais();
+
+bool acqBegin(uint16_t rateHz);
+void acqStop();
+// consumidor (loop): tira a amostra mais antiga; false se o anel está vazio
+bool acqRead(AcqSample &out);
+void acqFlush();
+uint16_t acqRateHz();
+uint32_t acqOverruns();
+// amostras a fs que o DSP já entregou (nunca zera: STATS faz diferenças)
+uint32_t acqAmostrasTotal();
+// ticks do timer com mais de 1,5 períodos de atraso, desde acqBegin
+uint32_t acqAtrasos();
@@ -0,0 +1,116 @@
+#include "eog_dsp.h"
+
+#include <math.h>
+#include <string.h>
+
+static const float DSP_PI = 3.14159265f;
+
+void EogDsp::configurar(uint8_t os, DspModo modo, uint16_t fsSaidaHz) {
+  if (os < 1)
+    os = 1;
+  if (os > DSP_OS_MAX)
+    os = DSP_OS_MAX;
+  os_ = os;
+  modo_ = modo;
+  fase_ = 0;
+  pos_ = 0;
+  primeira_ = true;
+
+  if (modo == DSP_BRUTO) {
+    // média simples das os leituras
+    n_ = os;
+    for (int k = 0; k < n_; k++)
+      taps_[k] = 32768 / os;
+    taps_[0] += 32768 - (32768 / os) * os;
+  } else {
+    // sinc com janela de Hamming, corte a 0.8 x Nyquist da saída
+    n_ = (uint8_t)(os * DSP_TAPS_POR_OS);
+    float fc = 0.4f / os; // ciclos por leitura
+    float h[DSP_FIR_MAX_TAPS];
+    float soma = 0;
+    for (int k = 0; k < n_; k++) {
+      float m = k - (n_ - 1) / 2.0f;
+      float s = m == 0 ? 2 * fc : sinf(2 * DSP_PI * fc * m) / (DSP_PI * m);
+      h[k] = s * (0.54f - 0.46f * cosf(2 * DSP_PI * k / (n_ - 1)));
+      soma += h[k];
+    }
+    int32_t total = 0;
+    for (int k = 0; k < n_; k++) {
+      taps_[k] = lroundf(h[k] / soma * 32768);
+      total += taps_[k];
+    }
+    taps_[n_ / 2] += 32768 - total; // ganho DC exatamente 1
+  }
+
+  // biquad passa-baixo (Butterworth, RBJ) à taxa de saída
+  float f0 = DSP_IIR_CORTE_HZ;
+  if (f0 > 0.4f * fsSaidaHz)
+    f0 = 0.4f * fsSaidaHz;
+  float w0 = 2 * DSP_PI * f0 / fsSaidaHz;
+  float alpha = sinf(w0) / (2 * 0.70710678f);
+  float a0 = 1 + alpha;
+  float c = cosf(w0);
+  const float q28 = 268435456.0f;
+  b0_ = (int32_t)lroundf((1 - c) / 2 / a0 * q28);
+  b1_ = 2 * b0_;
+  b2_ = b0_;
+  a1_ = (int32_t)lroundf(-2 * c / a0 * q28);
+  a2_ = (int32_t)lroundf((1 - alpha) / a0 * q28);
+  // ganho DC exatamente 1 apesar dos arredondamentos
+  b1_ = (int32_t)268435456 + a1_ + a2_ - 2 * b0_;
+  x1_ = x2_ = y1_ = y2_ = 0;
+
+  // linha de base: 1ª ordem com passo 2^-k, k ~ log2(tau x fs)
+  uint32_t amostrasTau = (uint32_t)DSP_BASE_TAU_MS * fsSaidaHz / 1000;
+  baseK_ = 0;
+  while ((1UL << (baseK_ + 1)) <= amostrasTau && baseK_ < 20)
+    baseK_++;
+  base_ = 0;
+}
+
+int32_t EogDsp::biquad(int32_t xQ4) {
+  int64_t acc = (int64_t)b0_ * xQ4 + (int64_t)b1_ * x1_ +
+                (int64_t)b2_ * x2_ - (int64_t)a1_ * y1_ -
+                (int64_t)a2_ * y2_;
+  int32_t y = (int32_t)((acc + (1 << 27)) >> 28);
+  x2_ = x1_;
+  x1_ = xQ4;
+  y2_ = y1_;
+  y1_ = y;
+  return y;
+}
+
+bool EogDsp::push(uint16_t raw, uint16_t &out) {
+  if (primeira_) {
+    // arranque sem transitório: histórico e filtros já no 1º valor
+    for (int k = 0; k < 2 * n_; k++)
+      hist_[k] = raw;
+    x1_ = x2_ = y1_ = y2_ = (int32_t)raw << 4;
+    base_ = ((int32_t)raw << 4) << 8;
+    primeira_ = false;
+  }
+  hist_[pos_] = raw;
+  hist_[pos_ + n_] = raw;
+  if (++pos_ == n_)
+    pos_ = 0;
+  if (++fase_ < os_)
+    return false;
+  fase_ = 0;
+
+  // FIR sobre as últimas n_ leituras (da mais antiga para a mais recente)
+  const uint16_t *janela = hist_ + pos_;
+  int32_t acc = 0;
+  for (int k = 0; k < n_; k++)
+    acc += taps_[k] * janela[k];
+  int32_t y = (acc + (1 << 10)) >> 11; // Q15 -> Q4
+
+  if (modo_ >= DSP_FIR_IIR)
+    y = biquad(y);
+  if (modo_ == DSP_FIR_IIR_BASE) {
+    base_ += ((y << 8) - base_) >> baseK_;
+    y = y - (base_ >> 8) + (DSP_BASE_CENTRO << 4);
+  }
+  y = (y + 8) >> 4;
+  out = (uint16_t)(y < 0 ? 0 : (y > 4095 ? 4095 : y));
+  return true;
+}
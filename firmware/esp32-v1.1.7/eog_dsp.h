@@ -0,0 +1,59 @@
+#pragma once
+#include <stdint.h>
+
+// =================== DSP DA AQUISIÇÃO (vírgula fixa) ===================
+// Entre o ADC e o anel de amostras: o timer lê o ADC a fs x os (sobre-
+// amostragem), um FIR passa-baixo anti-aliasing decima por os e, à taxa de
+// saída, um biquad passa-baixo e (opcional) a remoção da linha de base.
+// Tudo em inteiros; os coeficientes são calculados em float só ao
+// configurar (FLT= / OS=), nunca por amostra. O FIR só é avaliado uma vez
+// por amostra de saída (decimação polifásica): ~8 MAC por leitura do ADC.
+//
+// O atraso do FIR é (taps-1)/2 leituras (~4 amostras de saída); todas as
+// amostras atrasam o mesmo, por isso durações e derivadas não mudam.
+
+#define DSP_OS_MAX 16
+#define DSP_TAPS_POR_OS 8
+#define DSP_FIR_MAX_TAPS (DSP_OS_MAX * DSP_TAPS_POR_OS)
+// leituras do ADC por segundo (fs x os) que o timer aguenta com folga
+#define DSP_MAX_RAW_HZ 4000
+#define DSP_IIR_CORTE_HZ 35
+#define DSP_BASE_TAU_MS 4000
+#define DSP_BASE_CENTRO 2048
+
+enum DspModo : uint8_t {
+  DSP_BRUTO = 0,        // média das os leituras (como antes, se os = 1)
+  DSP_FIR = 1,          // FIR anti-aliasing + decimação
+  DSP_FIR_IIR = 2,      // + biquad passa-baixo DSP_IIR_CORTE_HZ
+  DSP_FIR_IIR_BASE = 3, // + linha de base removida (saída à volta de 2048)
+};
+#define DSP_MODO_MAX DSP_FIR_IIR_BASE
+
+class EogDsp {
+public:
+  // fsSaidaHz: taxa das amostras que saem (a do detetor)
+  void configurar(uint8_t os, DspModo modo, uint16_t fsSaidaHz);
+  // uma leitura do ADC; true quando sai uma amostra (a cada os leituras)
+  bool push(uint16_t raw, uint16_t &out);
+  uint8_t os() const { return os_; }
+  DspModo modo() const { return modo_; }
+  uint8_t taps() const { return n_; }
+
+private:
+  int32_t biquad(int32_t xQ4);
+
+  uint8_t os_ = 1;
+  DspModo modo_ = DSP_BRUTO;
+  uint8_t n_ = 1;
+  uint8_t fase_ = 0;
+  uint8_t pos_ = 0;
+  bool primeira_ = true;
+  int32_t taps_[DSP_FIR_MAX_TAPS];      // Q15, somam 32768
+  uint16_t hist_[2 * DSP_FIR_MAX_TAPS]; // duplicado: janela sempre contígua
+  // biquad (forma direta I), coeficientes Q28, estado em Q4
+  int32_t b0_ = 0, b1_ = 0, b2_ = 0, a1_ = 0, a2_ = 0;
+  int32_t x1_ = 0, x2_ = 0, y1_ = 0, y2_ = 0;
+  // linha de base em Q4 << 8; segue com passo 2^-baseK_
+  int32_t base_ = 0;
+  uint8_t baseK_ = 10;
+};
@@ -0,0 +1,111 @@
+#include "eog_log.h"
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "hal.h"
+
+volatile uint8_t logNivel = LOG_NIVEL_MAX;
+
+// Vários produtores (loop, callbacks do NimBLE): head/tail e a cópia para o
+// anel ficam numa secção crítica curta. O consumidor é só o loop.
+static char logAnel[LOG_ANEL_BYTES];
+static size_t logHead = 0; // total escrito
+static size_t logTail = 0; // total já enviado para a USB
+static uint32_t logPerdidas = 0;
+static void (*desvio)(const char *linha, size_t n) = nullptr;
+
+void logWrite(uint8_t nivel, const char *texto) {
+  if (nivel > LOG_NIVEL_MAX || nivel > logNivel)
+    return;
+  size_t n = strlen(texto);
+  if (n > LOG_LINHA_MAX)
+    n = LOG_LINHA_MAX;
+  halCriticalEnter();
+  if (LOG_ANEL_BYTES - (logHead - logTail) < n + 2) {
+    logPerdidas++;
+    halCriticalExit();
+    return;
+  }
+  for (size_t i = 0; i < n; i++)
+    logAnel[(logHead + i) % LOG_ANEL_BYTES] = texto[i];
+  logAnel[(logHead + n) % LOG_ANEL_BYTES] = '\r';
+  logAnel[(logHead + n + 1) % LOG_ANEL_BYTES] = '\n';
+  logHead += n + 2;
+  halCriticalExit();
+}
+
+void logPrintf(uint8_t nivel, const char *fmt, ...) {
+  if (nivel > LOG_NIVEL_MAX || nivel > logNivel)
+    return;
+  char linha[LOG_LINHA_MAX + 1];
+  va_list ap;
+  va_start(ap, fmt);
+  vsnprintf(linha, sizeof(linha), fmt, ap);
+  va_end(ap);
+  logWrite(nivel, linha);
+}
+
+// uma linha de cada vez, inteira (logWrite só escreve linhas inteiras)
+static void drenarDesvio() {
+  char linha[LOG_LINHA_MAX + 2];
+  for (;;) {
+    halCriticalEnter();
+    size_t pendente = logHead - logTail;
+    halCriticalExit();
+    if (pendente == 0)
+      return;
+    size_t n = 0;
+    while (n < pendente && n < sizeof(linha) &&
+           (linha[n] = logAnel[(logTail + n) % LOG_ANEL_BYTES]) != '\n')
+      n++;
+    size_t texto = n >= 1 && linha[n - 1] == '\r' ? n - 1 : n;
+    desvio(linha, texto);
+    halCriticalEnter();
+    logTail += n < pendente ? n + 1 : n;
+    halCriticalExit();
+  }
+}
+
+void logDesviar(void (*destino)(const char *linha, size_t n)) {
+  desvio = destino;
+}
+
+void logDrain() {
+  if (desvio) {
+    drenarDesvio();
+    return;
+  }
+  for (;;) {
+    halCriticalEnter();
+    size_t pendente = logHead - logTail;
+    halCriticalExit();
+    if (pendente == 0)
+      return;
+    size_t inicio = logTail % LOG_ANEL_BYTES;
+    size_t n = LOG_ANEL_BYTES - inicio; // até ao fim do anel
+    if (n > pendente)
+      n = pendente;
+    size_t livre = halConsoleWritable();
+    if (n > livre)
+      n = livre;
+    if (n == 0)
+      return; // USB cheia: fica para a próxima volta
+    size_t escritos = halConsoleWrite((const uint8_t *)logAnel + inicio, n);
+    halCriticalEnter();
+    logTail += escritos;
+    halCriticalExit();
+    if (escritos < n)
+      return;
+  }
+}
+
+size_t logPendentes() {
+  halCriticalEnter();
+  size_t n = logHead - logTail;
+  halCriticalExit();
+  return n;
+}
+
+uint32_t logDescartadas() { return logPerdidas; }
@@ -0,0 +1,48 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// =================== LOG (USB) ===================
+// As linhas são formatadas em buffers de tamanho fixo (sem heap) e vão para
+// um anel em RAM; logDrain() passa para a USB só o que cabe no buffer de TX,
+// por isso escrever no log nunca bloqueia a amostragem. Se o anel encher, a
+// linha é descartada e contada.
+//
+// Nível em runtime com LOG=n. LOG_NIVEL_MAX corta em compilação tudo o que
+// está acima (ex.: -DLOG_NIVEL_MAX=1 num build de produção tira o texto por
+// piscadela e por segundo da imagem).
+
+#define LOG_ERRO 0
+#define LOG_INFO 1
+#define LOG_DEBUG 2   // progresso por segundo, uma linha por piscadela
+#define LOG_VERBOSE 3 // por amostra
+
+#ifndef LOG_NIVEL_MAX
+#define LOG_NIVEL_MAX LOG_DEBUG
+#endif
+
+#define LOG_LINHA_MAX 160
+#define LOG_ANEL_BYTES 2048
+
+extern volatile uint8_t logNivel;
+
+void logWrite(uint8_t nivel, const char *texto);
+void logPrintf(uint8_t nivel, const char *fmt, ...)
+    __attribute__((format(printf, 2, 3)));
+// consumidor (loop): passa o que couber para a USB, sem bloquear
+void logDrain();
+size_t logPendentes(); // bytes no anel por enviar
+// com destino (captura USB), logDrain entrega-lhe as linhas inteiras, sem o
+// fim de linha, em vez de as escrever na USB; nullptr volta ao normal
+void logDesviar(void (*destino)(const char *linha, size_t n));
+uint32_t logDescartadas();
+
+#define LOG_AT(nivel, ...)                                                     \
+  do {                                                                         \
+    if ((nivel) <= LOG_NIVEL_MAX && (nivel) <= logNivel)                       \
+      logPrintf((nivel), __VA_ARGS__);                                         \
+  } while (0)
+#define LOGE(...) LOG_AT(LOG_ERRO, __VA_ARGS__)
+#define LOGI(...) LOG_AT(LOG_INFO, __VA_ARGS__)
+#define LOGD(...) LOG_AT(LOG_DEBUG, __VA_ARGS__)
+#define LOGV(...) LOG_AT(LOG_VERBOSE, __VA_ARGS__)
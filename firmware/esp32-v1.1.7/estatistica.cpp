@@ -0,0 +1,220 @@
+#include "estatistica.h"
+
+#include <math.h>
+
+// =================== WELFORD ===================
+void Welford::begin() {
+  n_ = 0;
+  media_ = 0;
+  m2_ = 0;
+}
+
+void Welford::add(float x) {
+  n_++;
+  float d = x - media_;
+  media_ += d / (float)n_;
+  m2_ += d * (x - media_);
+}
+
+float Welford::variancia() const { return n_ ? m2_ / (float)n_ : 0; }
+
+float Welford::sigma() const {
+  float v = variancia();
+  return v > 0 ? sqrtf(v) : 0;
+}
+
+// =================== P² ===================
+void QuantilP2::begin(float p) {
+  p_ = p;
+  n_ = 0;
+  passo_[0] = 0;
+  passo_[1] = p / 2;
+  passo_[2] = p;
+  passo_[3] = (1 + p) / 2;
+  passo_[4] = 1;
+}
+
+void QuantilP2::add(float x) {
+  if (n_ < 5) {
+    // as primeiras 5 ficam ordenadas nos marcadores
+    int i = (int)n_++;
+    for (; i > 0 && q_[i - 1] > x; i--)
+      q_[i] = q_[i - 1];
+    q_[i] = x;
+    if (n_ == 5)
+      for (int k = 0; k < 5; k++) {
+        pos_[k] = k + 1;
+        desejada_[k] = 1 + 4 * passo_[k];
+      }
+    return;
+  }
+  n_++;
+  int k;
+  if (x < q_[0]) {
+    q_[0] = x;
+    k = 0;
+  } else if (x >= q_[4]) {
+    q_[4] = x;
+    k = 3;
+  } else {
+    for (k = 0; k < 3 && x >= q_[k + 1]; k++)
+      ;
+  }
+  for (int i = k + 1; i < 5; i++)
+    pos_[i]++;
+  for (int i = 0; i < 5; i++)
+    desejada_[i] += passo_[i];
+  // os marcadores do meio voltam para a posição desejada, um passo de cada
+  for (int i = 1; i < 4; i++) {
+    float d = desejada_[i] - (float)pos_[i];
+    if (!((d >= 1 && pos_[i + 1] - pos_[i] > 1) ||
+          (d <= -1 && pos_[i - 1] - pos_[i] < -1)))
+      continue;
+    int s = d > 0 ? 1 : -1;
+    float nm = (float)pos_[i - 1], ni = (float)pos_[i],
+          np = (float)pos_[i + 1];
+    float parab = q_[i] + s / (np - nm) *
+                              ((ni - nm + s) * (q_[i + 1] - q_[i]) / (np - ni) +
+                               (np - ni - s) * (q_[i] - q_[i - 1]) / (ni - nm));
+    if (q_[i - 1] < parab && parab < q_[i + 1])
+      q_[i] = parab;
+    else // linear, para o vizinho do lado do passo
+      q_[i] += s * (q_[i + s] - q_[i]) / (float)(pos_[i + s] - pos_[i]);
+    pos_[i] += s;
+  }
+}
+
+float QuantilP2::valor() const {
+  if (n_ == 0)
+    return 0;
+  if (n_ < 5) // exato: as amostras estão ordenadas em q_
+    return q_[(int)lroundf(p_ * (float)(n_ - 1))];
+  return q_[2];
+}
+
+// =================== MEDIANA E MAD ===================
+void MedianaMad::begin() {
+  med_.begin(0.5f);
+  mad_.begin(0.5f);
+}
+
+void MedianaMad::add(float x) {
+  med_.add(x);
+  mad_.add(fabsf(x - med_.valor()));
+}
+
+// =================== ESBOÇO DE QUANTIS ===================
+void EsbocoQuantis::begin() {
+  len_ = 0;
+  total_ = 0;
+  max_ = 0;
+}
+
+void EsbocoQuantis::add(uint16_t v) {
+  if (len_ == ESBOCO_LUGARES)
+    compactar();
+  // inserção ordenada: os quantis leem-se diretamente
+  int i = len_++;
+  for (; i > 0 && v_[i - 1] > v; i--) {
+    v_[i] = v_[i - 1];
+    peso_[i] = peso_[i - 1];
+  }
+  v_[i] = v;
+  peso_[i] = 1;
+  total_++;
+  if (v > max_)
+    max_ = v;
+}
+
+// um lugar livre: os vizinhos mais próximos (no empate, os mais leves)
+void EsbocoQuantis::compactar() {
+  uint8_t m = 0;
+  for (uint8_t i = 1; i + 1 < len_; i++) {
+    uint16_t d = (uint16_t)(v_[i + 1] - v_[i]);
+    uint16_t dm = (uint16_t)(v_[m + 1] - v_[m]);
+    if (d < dm || (d == dm && peso_[i] + peso_[i + 1] <
+                                  peso_[m] + peso_[m + 1]))
+      m = i;
+  }
+  uint32_t w = (uint32_t)peso_[m] + peso_[m + 1];
+  uint32_t soma =
+      (uint32_t)v_[m] * peso_[m] + (uint32_t)v_[m + 1] * peso_[m + 1];
+  v_[m] = (uint16_t)((soma + w / 2) / w);
+  peso_[m] = (uint16_t)(w > UINT16_MAX ? UINT16_MAX : w);
+  for (uint8_t i = m + 1; i + 1 < len_; i++) {
+    v_[i] = v_[i + 1];
+    peso_[i] = peso_[i + 1];
+  }
+  len_--;
+}
+
+uint16_t EsbocoQuantis::quantil(float q) const {
+  if (len_ == 0)
+    return 0;
+  float alvo = q * (float)total_;
+  uint32_t acum = 0;
+  for (uint8_t i = 0; i < len_; i++) {
+    acum += peso_[i];
+    if ((float)acum >= alvo)
+      return v_[i];
+  }
+  return v_[len_ - 1];
+}
+
+float EsbocoQuantis::mediana() const {
+  if (len_ == 0)
+    return 0;
+  uint32_t meio = (total_ + 1) / 2; // posição (1..n) da de baixo
+  uint32_t acum = 0;
+  for (uint8_t i = 0; i < len_; i++) {
+    acum += peso_[i];
+    if (acum < meio)
+      continue;
+    // n par e a de cima já está no lugar seguinte
+    if (total_ % 2 == 0 && acum == meio && i + 1 < len_)
+      return 0.5f * ((float)v_[i] + (float)v_[i + 1]);
+    return v_[i];
+  }
+  return v_[len_ - 1];
+}
+
+float EsbocoQuantis::desvioMediano(float centro) const {
+  if (len_ == 0)
+    return 0;
+  // |v - centro| por ordem: duas frentes a partir do centro, como um merge
+  int dir = 0;
+  while (dir < len_ && (float)v_[dir] < centro)
+    dir++;
+  int esq = dir - 1;
+  float alvo = 0.5f * (float)total_;
+  uint32_t acum = 0;
+  float d = 0;
+  while (esq >= 0 || dir < len_) {
+    float de = esq >= 0 ? centro - (float)v_[esq] : INFINITY;
+    float dd = dir < len_ ? (float)v_[dir] - centro : INFINITY;
+    if (de <= dd) {
+      d = de;
+      acum += peso_[esq--];
+    } else {
+      d = dd;
+      acum += peso_[dir++];
+    }
+    if ((float)acum >= alvo)
+      break;
+  }
+  return d;
+}
+
+uint16_t EsbocoQuantis::maiorAte(float limite) const {
+  for (int i = len_ - 1; i >= 0; i--)
+    if ((float)v_[i] <= limite)
+      return v_[i];
+  return 0;
+}
+
+uint32_t EsbocoQuantis::acima(float limite) const {
+  uint32_t n = 0;
+  for (int i = len_ - 1; i >= 0 && (float)v_[i] > limite; i--)
+    n += peso_[i];
+  return n;
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// =================== ESTATÍSTICA EM CONTÍNUO ===================
+// Estimadores de uma passagem, memória fixa e sem heap, para a calibração
+// (calibracao.h): média/variância de Welford, quantis P² (mediana e MAD em
+// contínuo) e um esboço pequeno de quantis para poucas dezenas de valores.
+
+// Welford: sem somas de quadrados que percam precisão em float
+class Welford {
+public:
+  void begin();
+  void add(float x);
+  uint32_t n() const { return n_; }
+  float media() const { return media_; }
+  float variancia() const; // da população (÷ n)
+  float sigma() const;
+
+private:
+  uint32_t n_ = 0;
+  float media_ = 0;
+  float m2_ = 0;
+};
+
+// P² (Jain & Chlamtac, 1985): um quantil p com 5 marcadores que se ajustam
+// a cada amostra por interpolação parabólica; exato até 5 amostras
+class QuantilP2 {
+public:
+  void begin(float p);
+  void add(float x);
+  uint32_t n() const { return n_; }
+  float valor() const; // 0 sem amostras
+
+private:
+  float p_ = 0.5f;
+  uint32_t n_ = 0;
+  float q_[5];       // alturas dos marcadores
+  int32_t pos_[5];   // posições atuais (1..n)
+  float desejada_[5];
+  float passo_[5];
+};
+
+// Mediana e MAD em contínuo: o MAD é a mediana P² de |x - mediana atual|,
+// uma aproximação que converge com a mediana. sigma() = 1.4826 MAD, o
+// desvio padrão de um ruído normal sem se deixar levar por artefactos.
+class MedianaMad {
+public:
+  void begin();
+  void add(float x);
+  uint32_t n() const { return med_.n(); }
+  float mediana() const { return med_.valor(); }
+  float mad() const { return mad_.valor(); }
+  float sigma() const { return 1.4826f * mad_.valor(); }
+
+private:
+  QuantilP2 med_;
+  QuantilP2 mad_;
+};
+
+// Esboço de quantis para poucos valores (amplitudes de piscadelas): guarda
+// até ESBOCO_LUGARES valores exatos, por ordem; cheio, junta os dois
+// vizinhos mais próximos na média pesada deles (histograma em contínuo de
+// Ben-Haim & Tom-Tov). Um valor afastado dos outros, como um outlier, fica
+// sozinho. Com menos valores do que lugares todos os quantis são exatos.
+#define ESBOCO_LUGARES 32
+
+class EsbocoQuantis {
+public:
+  void begin();
+  void add(uint16_t v);
+  uint32_t n() const { return total_; } // valores vistos (soma dos pesos)
+  uint16_t maximo() const { return max_; }
+  // quantil q em [0, 1] (o menor valor com peso acumulado >= q * n)
+  uint16_t quantil(float q) const;
+  // com n par, a média dos dois do meio (quantil(0.5) dá o de baixo)
+  float mediana() const;
+  // mediana de |v - centro| (com centro = mediana: o MAD)
+  float desvioMediano(float centro) const;
+  // o maior valor guardado <= limite (0 se nenhum)
+  uint16_t maiorAte(float limite) const;
+  // valores guardados acima do limite, com os pesos
+  uint32_t acima(float limite) const;
+
+private:
+  void compactar();
+  uint16_t v_[ESBOCO_LUGARES];
+  uint16_t peso_[ESBOCO_LUGARES];
+  uint8_t len_ = 0;
+  uint32_t total_ = 0;
+  uint16_t max_ = 0;
+};
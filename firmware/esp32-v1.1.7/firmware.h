@@ -0,0 +1,13 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// Funções do firmware (main.cpp) chamadas pelas implementações da HAL.
+
+void setup();
+void loop();
+// USB apenas
+void imprimir(const char *texto);
+// bytes escritos na característica RX por uma central (task do NimBLE /
+// loopback no host)
+void bleRxBytes(uint8_t ligacao, const uint8_t *data, size_t len);
@@ -0,0 +1,103 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// =================== HAL ===================
+// Tudo o que toca em hardware passa por aqui. hal_esp32.cpp implementa-o com
+// Arduino/NimBLE/esp_timer; firmware/host/hal_host.cpp implementa-o em Linux
+// (relógio virtual, ADC a partir de traços CSV, BLE em loopback), o que deixa
+// compilar e correr no PC a mesma deteção, comandos e tramas.
+
+// ---- tempo ----
+uint32_t halMillis();
+uint32_t halMicros(); // 32 bits, dá a volta ao fim de ~71 min
+uint64_t halMicros64(); // o mesmo relógio, sem voltas (tramas, SYNC)
+void halDelayMs(uint32_t ms);
+void halDelayUs(uint32_t us);
+// contador de ciclos do CPU (perfil.h): barato, dá a volta em segundos
+uint32_t halCiclos();
+uint32_t halCiclosPorUs();
+
+// relógio de parede em s desde 1970 (UTC); 0 = desconhecido até alguém o
+// acertar (HORA=)
+uint32_t halEpoch();
+void halSetEpoch(uint32_t s);
+
+// ---- memória (0 = desconhecido) ----
+uint32_t halHeapLivre();
+uint32_t halHeapMaiorBloco();
+
+// ---- secção crítica curta (dados partilhados com as tasks do BLE) ----
+void halCriticalEnter();
+void halCriticalExit();
+
+// ---- ADC ----
+enum HalAdcRange : uint8_t {
+  HAL_ADC_RANGE_3V3, // 11 dB: EOG
+  HAL_ADC_RANGE_1V1, // 0 dB: acelerómetro
+};
+void halAdcBegin(); // 12 bits
+void halAdcConfigPin(int pin, HalAdcRange range);
+int halAdcRead(int pin);
+
+// ---- timer periódico (um só, usado pela aquisição) ----
+// cb corre em contexto de task (não ISR), pode ler o ADC
+bool halTimerStart(void (*cb)(), uint32_t periodUs);
+void halTimerStop();
+
+// ---- consola (USB; + SPP se ativo) ----
+void halConsoleBegin(uint32_t baud);
+// muda a velocidade (espera que o buffer de TX saia à antiga); false se a
+// porta não tem baud (USB CDC nativo: vai sempre à velocidade do USB)
+bool halConsoleSetBaud(uint32_t baud);
+// escrita sem bloquear: quanto cabe agora no buffer de TX da USB
+size_t halConsoleWritable();
+size_t halConsoleWrite(const uint8_t *data, size_t len);
+int halConsoleAvailable();
+int halConsolePeek();
+int halConsoleRead();
+void halSppWriteLine(const char *s); // nada se o SPP estiver desligado
+
+// ---- armazenamento: partição de flash em bruto (gravador de sessão) ----
+// offsets e apagamentos em múltiplos de HAL_STORAGE_SETOR
+#define HAL_STORAGE_SETOR 4096
+bool halStorageBegin();
+uint32_t halStorageSize(); // 0 se não há partição
+bool halStorageErase(uint32_t offset, uint32_t len);
+bool halStorageWrite(uint32_t offset, const void *data, size_t len);
+bool halStorageRead(uint32_t offset, void *data, size_t len);
+
+// ---- preferências: blobs pequenos por chave na NVS (perfis_cal.h) ----
+// chaves até 15 caracteres; cada escrita fica logo persistente
+bool halPrefsBegin();
+// tamanho guardado (0 = não existe); só copia para data se couber em max
+size_t halPrefsRead(const char *chave, void *data, size_t max);
+bool halPrefsWrite(const char *chave, const void *data, size_t len);
+
+// ---- BLE (serviço UART: TX notify, RX write) ----
+// Até HAL_BLE_LIGACOES_MAX centrais ao mesmo tempo (telemóvel + registador);
+// cada uma ocupa um lugar 0..MAX-1 enquanto está ligada e a HAL continua a
+// anunciar enquanto houver lugares livres.
+#define HAL_BLE_LIGACOES_MAX 3
+void halBleBegin(const char *name);
+bool halBleConnected(); // alguma central ligada
+bool halBleLigada(uint8_t ligacao);
+// o menor MTU das centrais ligadas: uma trama montada uma vez cabe em todas
+uint16_t halBleMtu();
+uint16_t halBleMtuLigacao(uint8_t ligacao);
+// ligação atual, lida ao controlador (0 = desconhecido). Depois de ligar, a
+// HAL pede DLE, PHY 2M (se o chip tiver) e um intervalo curto; a central
+// decide, por isso aqui vem o que ficou.
+struct HalBleLigacao {
+  uint16_t mtu;
+  uint8_t phyTx; // 1 = 1M, 2 = 2M, 3 = coded
+  uint8_t phyRx;
+  uint32_t intervaloUs;
+  uint16_t latencia; // eventos de ligação que o periférico pode saltar
+  uint16_t supervisaoMs;
+  uint16_t dleOctetos; // payload do link layer pedido (27 = sem DLE)
+};
+bool halBleLigacao(uint8_t ligacao, HalBleLigacao &out); // false se livre
+bool halBleNotify(uint8_t ligacao, const uint8_t *data, size_t len);
+// há mensagens novas na fila de envio (ble_tx.h)
+void halBleTxKick();
@@ -0,0 +1,427 @@
+// Implementação ESP32 (Arduino + NimBLE) da HAL.
+#include <Arduino.h>
+// ================== CONFIG ==================
+#define ENABLE_SPP 0
+#if ENABLE_SPP
+#include "BluetoothSerial.h"
+BluetoothSerial SerialBT;
+#else
+#include "esp_bt.h"
+#endif
+#include <NimBLEDevice.h>
+#include <Preferences.h>
+#include <sys/time.h>
+#include <time.h>
+
+#include "ble_tx.h"
+#include "esp_partition.h"
+#include "esp_timer.h"
+#include "soc/soc_caps.h"
+#include "firmware.h"
+#include "hal.h"
+
+static const char *SERVICE_UUID = "6E400001-B5A3-F393-E0A9-E50E24DCCA9E";
+static const char *RX_UUID = "6E400002-B5A3-F393-E0A9-E50E24DCCA9E";
+static const char *TX_UUID = "6E400003-B5A3-F393-E0A9-E50E24DCCA9E";
+static NimBLECharacteristic *txChar = nullptr;
+static NimBLEAdvertising *adv = nullptr;
+// um lugar por central ligada (handle BLE_HS_CONN_HANDLE_NONE = livre); o
+// NimBLE tem de aceitar HAL_BLE_LIGACOES_MAX ligações
+// (CONFIG_BT_NIMBLE_MAX_CONNECTIONS, 3 por omissão no Arduino)
+struct LugarBle {
+  volatile uint16_t handle;
+  // MTU negociado com a central (23 = mínimo BLE até haver troca de MTU)
+  volatile uint16_t mtu;
+  volatile uint16_t dlePedido;
+};
+static LugarBle lugares[HAL_BLE_LIGACOES_MAX];
+// task que esvazia a fila de envio BLE (outro core que não o do loop)
+static TaskHandle_t bleTxTask = nullptr;
+
+// =================== TEMPO ===================
+uint32_t halMillis() { return millis(); }
+uint32_t halMicros() { return (uint32_t)esp_timer_get_time(); }
+uint64_t halMicros64() { return (uint64_t)esp_timer_get_time(); }
+void halDelayMs(uint32_t ms) { delay(ms); }
+void halDelayUs(uint32_t us) { delayMicroseconds(us); }
+// CCOUNT do core onde corre (cada core tem o seu; só se subtraem leituras
+// da mesma task)
+uint32_t halCiclos() { return ESP.getCycleCount(); }
+uint32_t halCiclosPorUs() { return getCpuFrequencyMhz(); }
+// o RTC conta desde o arranque até alguém acertar a hora: abaixo de 2020
+// ainda não foi acertado
+#define EPOCH_MINIMO 1577836800UL
+uint32_t halEpoch() {
+  time_t t = time(nullptr);
+  return t >= (time_t)EPOCH_MINIMO ? (uint32_t)t : 0;
+}
+void halSetEpoch(uint32_t s) {
+  struct timeval tv = {(time_t)s, 0};
+  settimeofday(&tv, nullptr);
+}
+
+// =================== MEMÓRIA ===================
+uint32_t halHeapLivre() { return ESP.getFreeHeap(); }
+uint32_t halHeapMaiorBloco() { return ESP.getMaxAllocHeap(); }
+
+static portMUX_TYPE halMux = portMUX_INITIALIZER_UNLOCKED;
+void halCriticalEnter() { portENTER_CRITICAL(&halMux); }
+void halCriticalExit() { portEXIT_CRITICAL(&halMux); }
+
+// =================== ADC ===================
+void halAdcBegin() { analogReadResolution(12); }
+void halAdcConfigPin(int pin, HalAdcRange range) {
+  analogSetPinAttenuation(pin, range == HAL_ADC_RANGE_1V1 ? ADC_0db : ADC_11db);
+}
+int halAdcRead(int pin) { return analogRead(pin); }
+
+// =================== TIMER (esp_timer) ===================
+static esp_timer_handle_t halTimer = nullptr;
+static void (*halTimerCb)() = nullptr;
+static bool halTimerRunning = false;
+// corre na task do esp_timer (não é ISR), por isso analogRead é permitido
+static void halTimerTrampoline(void * /*arg*/) {
+  if (halTimerCb)
+    halTimerCb();
+}
+bool halTimerStart(void (*cb)(), uint32_t periodUs) {
+  halTimerStop();
+  halTimerCb = cb;
+  if (!halTimer) {
+    esp_timer_create_args_t args = {};
+    args.callback = &halTimerTrampoline;
+    args.dispatch_method = ESP_TIMER_TASK;
+    args.name = "eog_acq";
+    if (esp_timer_create(&args, &halTimer) != ESP_OK) {
+      halTimer = nullptr;
+      return false;
+    }
+  }
+  halTimerRunning = esp_timer_start_periodic(halTimer, periodUs) == ESP_OK;
+  return halTimerRunning;
+}
+void halTimerStop() {
+  if (halTimer && halTimerRunning)
+    esp_timer_stop(halTimer);
+  halTimerRunning = false;
+}
+
+// =================== CONSOLA ===================
+void halConsoleBegin(uint32_t baud) {
+  // buffer de TX no driver: o log escreve só o que lá cabe (logDrain)
+  Serial.setTxBufferSize(1024);
+  Serial.begin(baud);
+#if ENABLE_SPP
+  SerialBT.begin("EOG-Calibracao");
+#endif
+}
+bool halConsoleSetBaud(uint32_t baud) {
+#if ARDUINO_USB_CDC_ON_BOOT
+  (void)baud;
+  return false;
+#else
+  Serial.flush();
+  Serial.updateBaudRate(baud);
+  return true;
+#endif
+}
+size_t halConsoleWritable() { return (size_t)Serial.availableForWrite(); }
+size_t halConsoleWrite(const uint8_t *data, size_t len) {
+  return Serial.write(data, len);
+}
+// USB primeiro; o SPP só é lido quando o USB não tem nada
+static Stream &consoleAtiva() {
+#if ENABLE_SPP
+  if (!Serial.available() && SerialBT.available())
+    return SerialBT;
+#endif
+  return Serial;
+}
+int halConsoleAvailable() { return consoleAtiva().available(); }
+int halConsolePeek() { return consoleAtiva().peek(); }
+int halConsoleRead() { return consoleAtiva().read(); }
+void halSppWriteLine(const char *s) {
+#if ENABLE_SPP
+  SerialBT.println(s);
+#else
+  (void)s;
+#endif
+}
+
+// =================== ARMAZENAMENTO ===================
+// Partição "eogrec" se existir num partitions.csv próprio; senão usa a
+// partição SPIFFS dos esquemas por omissão do Arduino (o firmware não usa
+// sistema de ficheiros).
+static const esp_partition_t *recPart = nullptr;
+bool halStorageBegin() {
+  recPart = esp_partition_find_first(ESP_PARTITION_TYPE_DATA,
+                                     ESP_PARTITION_SUBTYPE_ANY, "eogrec");
+  if (!recPart)
+    recPart = esp_partition_find_first(
+        ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_SPIFFS, nullptr);
+  return recPart != nullptr;
+}
+uint32_t halStorageSize() { return recPart ? recPart->size : 0; }
+bool halStorageErase(uint32_t offset, uint32_t len) {
+  return recPart && esp_partition_erase_range(recPart, offset, len) == ESP_OK;
+}
+bool halStorageWrite(uint32_t offset, const void *data, size_t len) {
+  return recPart && esp_partition_write(recPart, offset, data, len) == ESP_OK;
+}
+bool halStorageRead(uint32_t offset, void *data, size_t len) {
+  return recPart && esp_partition_read(recPart, offset, data, len) == ESP_OK;
+}
+
+// =================== PREFERÊNCIAS (NVS) ===================
+static Preferences prefs;
+static bool prefsAberto = false;
+bool halPrefsBegin() {
+  if (!prefsAberto)
+    prefsAberto = prefs.begin("eog", false);
+  return prefsAberto;
+}
+size_t halPrefsRead(const char *chave, void *data, size_t max) {
+  if (!prefsAberto || !prefs.isKey(chave))
+    return 0;
+  size_t n = prefs.getBytesLength(chave);
+  if (n && n <= max)
+    prefs.getBytes(chave, data, n);
+  return n;
+}
+bool halPrefsWrite(const char *chave, const void *data, size_t len) {
+  return prefsAberto && prefs.putBytes(chave, data, len) == len;
+}
+
+// =================== BLE ===================
+// pedidos feitos à central logo a seguir a ligar (ela pode recusar ou
+// ficar-se por menos: halBleLigacao() lê o que ficou)
+#define BLE_MTU_PEDIDO 247 // notificações de 244 B (BLE_TX_MSG_MAX)
+#define BLE_DLE_OCTETOS 251 // um PDU do link layer leva uma trama inteira
+// intervalo 7.5-15 ms, latência 0, supervisão 4 s (1.25 ms e 10 ms)
+#define BLE_INTERVALO_MIN 6
+#define BLE_INTERVALO_MAX 12
+#define BLE_SUPERVISAO 400
+
+static int lugarDe(uint16_t handle) {
+  for (uint8_t i = 0; i < HAL_BLE_LIGACOES_MAX; i++)
+    if (lugares[i].handle == handle)
+      return i;
+  return -1;
+}
+
+static void pedirLigacaoRapida(NimBLEServer *server, uint16_t handle,
+                               uint8_t i) {
+  server->setDataLen(handle, BLE_DLE_OCTETOS);
+  lugares[i].dlePedido = BLE_DLE_OCTETOS;
+#ifdef SOC_BLE_50_SUPPORTED
+  ble_gap_set_prefered_le_phy(handle, BLE_GAP_LE_PHY_2M_MASK,
+                              BLE_GAP_LE_PHY_2M_MASK,
+                              BLE_GAP_LE_PHY_CODED_ANY);
+#endif
+  server->updateConnParams(handle, BLE_INTERVALO_MIN, BLE_INTERVALO_MAX, 0,
+                           BLE_SUPERVISAO);
+}
+
+// O NimBLE 1.x chama as duas formas de onConnect/onDisconnect (com e sem
+// desc): só as que trazem o handle contam.
+class ServerCB : public NimBLEServerCallbacks {
+public:
+  void onConnect(NimBLEServer *pServer, ble_gap_conn_desc *desc) {
+    ligou(pServer, desc->conn_handle);
+  }
+  void onDisconnect(NimBLEServer *pServer, ble_gap_conn_desc *desc) {
+    (void)pServer;
+    desligou(desc->conn_handle);
+  }
+  void onConnect(NimBLEServer *pServer, NimBLEConnInfo &connInfo) {
+    ligou(pServer, connInfo.getConnHandle());
+  }
+  void onDisconnect(NimBLEServer *pServer, NimBLEConnInfo &connInfo,
+                    int reason) {
+    (void)pServer;
+    (void)reason;
+    desligou(connInfo.getConnHandle());
+  }
+  // MTU negociado: dimensiona as tramas binárias (NimBLE 1.x e 2.x)
+  void onMTUChange(uint16_t MTU, ble_gap_conn_desc *desc) {
+    setMtu(desc->conn_handle, MTU);
+  }
+  void onMTUChange(uint16_t MTU, NimBLEConnInfo &connInfo) {
+    setMtu(connInfo.getConnHandle(), MTU);
+  }
+
+private:
+  static void ligou(NimBLEServer *server, uint16_t handle) {
+    int i = lugarDe(BLE_HS_CONN_HANDLE_NONE);
+    if (i < 0) { // o NimBLE aceitou mais do que HAL_BLE_LIGACOES_MAX
+      server->disconnect(handle);
+      return;
+    }
+    lugares[i].mtu = 23;
+    lugares[i].dlePedido = 27;
+    bleTxLigacaoNova((uint8_t)i);
+    lugares[i].handle = handle; // a partir daqui halBleLigada(i)
+    char linha[40];
+    snprintf(linha, sizeof(linha), "[BLE] Conectado (central %d).", i);
+    imprimir(linha);
+    pedirLigacaoRapida(server, handle, (uint8_t)i);
+    // continua visível enquanto houver lugares livres
+    if (lugarDe(BLE_HS_CONN_HANDLE_NONE) >= 0 && adv)
+      adv->start();
+  }
+  static void desligou(uint16_t handle) {
+    int i = lugarDe(handle);
+    if (i < 0)
+      return;
+    lugares[i].handle = BLE_HS_CONN_HANDLE_NONE;
+    lugares[i].mtu = 23;
+    lugares[i].dlePedido = 27;
+    char linha[64];
+    snprintf(linha, sizeof(linha),
+             "[BLE] Desconectado (central %d). A anunciar de novo...", i);
+    imprimir(linha);
+    if (adv)
+      adv->start();
+  }
+  static void setMtu(uint16_t handle, uint16_t mtu) {
+    int i = lugarDe(handle);
+    if (i < 0)
+      return;
+    lugares[i].mtu = mtu;
+    char linha[48];
+    snprintf(linha, sizeof(linha), "[BLE] MTU negociado: %u (central %d)",
+             (unsigned)mtu, i);
+    imprimir(linha);
+  }
+};
+class RxCB : public NimBLECharacteristicCallbacks {
+public:
+  // NimBLE antigo: sem a ligação, conta como a primeira
+  void onWrite(NimBLECharacteristic *c) { handleWrite(c, 0); }
+  void onWrite(NimBLECharacteristic *c, ble_gap_conn_desc *desc) {
+    handleWrite(c, lugarDe(desc->conn_handle));
+  }
+  void onWrite(NimBLECharacteristic *c, NimBLEConnInfo &connInfo) {
+    handleWrite(c, lugarDe(connInfo.getConnHandle()));
+  }
+
+private:
+  void handleWrite(NimBLECharacteristic *c, int lugar) {
+    std::string v = c->getValue();
+    if (!v.empty() && lugar >= 0)
+      bleRxBytes((uint8_t)lugar, (const uint8_t *)v.data(), v.size());
+  }
+};
+static void bleTxTaskFn(void * /*arg*/) {
+  bool repetir = false;
+  for (;;) {
+    ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(repetir ? BLE_TX_REPETIR_MS : 50));
+    repetir = bleTxDrain();
+  }
+}
+void halBleBegin(const char *name) {
+#if !ENABLE_SPP
+  esp_bt_controller_mem_release(ESP_BT_MODE_CLASSIC_BT);
+#endif
+  for (LugarBle &l : lugares) {
+    l.handle = BLE_HS_CONN_HANDLE_NONE;
+    l.mtu = 23;
+    l.dlePedido = 27;
+  }
+  NimBLEDevice::init(name);
+  NimBLEDevice::setMTU(BLE_MTU_PEDIDO);
+  NimBLEDevice::setPower(ESP_PWR_LVL_P9);
+  NimBLEServer *server = NimBLEDevice::createServer();
+  server->setCallbacks(new ServerCB());
+  NimBLEService *svc = server->createService(SERVICE_UUID);
+  txChar = svc->createCharacteristic(TX_UUID, NIMBLE_PROPERTY::NOTIFY);
+  NimBLECharacteristic *rxChar = svc->createCharacteristic(
+      RX_UUID, NIMBLE_PROPERTY::WRITE | NIMBLE_PROPERTY::WRITE_NR);
+  rxChar->setCallbacks(new RxCB());
+  svc->start();
+  adv = NimBLEDevice::getAdvertising();
+  adv->reset();
+  NimBLEAdvertisementData advData;
+  advData.setFlags(0x06);
+  advData.setCompleteServices(NimBLEUUID(SERVICE_UUID));
+  adv->setAdvertisementData(advData);
+  NimBLEAdvertisementData scanData;
+  scanData.setName(name);
+  adv->setScanResponseData(scanData);
+  adv->start();
+#if CONFIG_FREERTOS_UNICORE
+  const BaseType_t txCore = tskNO_AFFINITY;
+#else
+  const BaseType_t txCore = 1 - xPortGetCoreID(); // o loop fica sozinho
+#endif
+  xTaskCreatePinnedToCore(bleTxTaskFn, "ble_tx", 4096, nullptr, 3, &bleTxTask,
+                          txCore);
+  imprimir("[BLE] A anunciar (Nome + UART UUID)...");
+}
+bool halBleConnected() {
+  for (const LugarBle &l : lugares)
+    if (l.handle != BLE_HS_CONN_HANDLE_NONE)
+      return true;
+  return false;
+}
+bool halBleLigada(uint8_t ligacao) {
+  return ligacao < HAL_BLE_LIGACOES_MAX &&
+         lugares[ligacao].handle != BLE_HS_CONN_HANDLE_NONE;
+}
+uint16_t halBleMtu() {
+  uint16_t min = 0;
+  for (const LugarBle &l : lugares)
+    if (l.handle != BLE_HS_CONN_HANDLE_NONE && (min == 0 || l.mtu < min))
+      min = l.mtu;
+  return min ? min : 23;
+}
+uint16_t halBleMtuLigacao(uint8_t ligacao) {
+  return halBleLigada(ligacao) ? lugares[ligacao].mtu : 23;
+}
+bool halBleLigacao(uint8_t ligacao, HalBleLigacao &out) {
+  out = HalBleLigacao();
+  if (!halBleLigada(ligacao))
+    return false;
+  uint16_t h = lugares[ligacao].handle;
+  out.mtu = lugares[ligacao].mtu;
+  out.dleOctetos = lugares[ligacao].dlePedido;
+  ble_gap_conn_desc desc;
+  if (ble_gap_conn_find(h, &desc) == 0) {
+    out.intervaloUs = desc.conn_itvl * 1250UL;
+    out.latencia = desc.conn_latency;
+    out.supervisaoMs = (uint16_t)(desc.supervision_timeout * 10);
+  }
+#ifdef SOC_BLE_50_SUPPORTED
+  uint8_t tx = 0, rx = 0;
+  if (ble_gap_read_le_phy(h, &tx, &rx) == 0) {
+    out.phyTx = tx;
+    out.phyRx = rx;
+  }
+#else
+  out.phyTx = out.phyRx = 1; // ESP32 clássico (BLE 4.2): só 1M
+#endif
+  return true;
+}
+// notify para uma só central: o NimBLE 2.x tem notify(valor, len, handle)
+// (devolve bool); no 1.x o notify() vai para todas, por isso usa-se a API
+// do host (o mbuf é sempre consumido)
+template <typename C>
+static auto notificar(C *c, const uint8_t *data, size_t len, uint16_t h,
+                      int) -> decltype(bool(c->notify(data, len, h))) {
+  return c->notify(data, len, h);
+}
+template <typename C>
+static bool notificar(C *c, const uint8_t *data, size_t len, uint16_t h,
+                      long) {
+  os_mbuf *om = ble_hs_mbuf_from_flat(data, (uint16_t)len);
+  return om && ble_gattc_notify_custom(h, c->getHandle(), om) == 0;
+}
+bool halBleNotify(uint8_t ligacao, const uint8_t *data, size_t len) {
+  if (!txChar || !halBleLigada(ligacao))
+    return false;
+  return notificar(txChar, data, len, lugares[ligacao].handle, 0);
+}
+void halBleTxKick() {
+  if (bleTxTask)
+    xTaskNotifyGive(bleTxTask);
+}
@@ -0,0 +1,119 @@
+#include "janelas.h"
+
+#include <string.h>
+
+static void somar(JanelaSomas &a, const JanelaSomas &b) {
+  a.normais += b.normais;
+  a.lentas += b.lentas;
+  a.durNormaisMs += b.durNormaisMs;
+  a.ampNormais += b.ampNormais;
+  a.durLentasMs += b.durLentasMs;
+  a.ampLentas += b.ampLentas;
+  a.ibiMs += b.ibiMs;
+  a.nIbi += b.nIbi;
+}
+static void subtrair(JanelaSomas &a, const JanelaSomas &b) {
+  a.normais -= b.normais;
+  a.lentas -= b.lentas;
+  a.durNormaisMs -= b.durNormaisMs;
+  a.ampNormais -= b.ampNormais;
+  a.durLentasMs -= b.durLentasMs;
+  a.ampLentas -= b.ampLentas;
+  a.ibiMs -= b.ibiMs;
+  a.nIbi -= b.nIbi;
+}
+static float media(uint32_t soma, uint32_t n) {
+  return n ? (float)soma / (float)n : 0.0f;
+}
+
+bool JanelasSono::configurar(const uint16_t *horizontesS, uint8_t n) {
+  if (n == 0 || n > JANELAS_MAX)
+    return false;
+  for (uint8_t h = 0; h < n; h++)
+    if (horizontesS[h] < JANELA_MIN_S || horizontesS[h] > JANELA_MAX_S)
+      return false;
+  for (uint8_t h = 0; h < n; h++) {
+    hor_[h].horizonteS = horizontesS[h];
+    hor_[h].larguraMs = horizontesS[h] * 1000UL / JANELA_BALDES;
+  }
+  n_ = n;
+  return true;
+}
+
+void JanelasSono::begin(uint32_t agoraMs) {
+  for (uint8_t h = 0; h < n_; h++) {
+    Horizonte &k = hor_[h];
+    k.inicioMs = agoraMs;
+    k.proximo = 0;
+    k.fechados = 0;
+    memset(&k.corrente, 0, sizeof(k.corrente));
+    memset(&k.soma, 0, sizeof(k.soma));
+    memset(k.baldes, 0, sizeof(k.baldes));
+  }
+  temPico_ = false;
+}
+
+void JanelasSono::piscadela(const BlinkEvent &ev) {
+  if (ev.cls != BLINK_NORMAL && ev.cls != BLINK_SLOW)
+    return;
+  JanelaSomas s = {};
+  if (ev.cls == BLINK_NORMAL) {
+    s.normais = 1;
+    s.durNormaisMs = (uint32_t)(ev.duracaoMs + 0.5f);
+    s.ampNormais = (uint32_t)(ev.amplitude + 0.5f);
+  } else {
+    s.lentas = 1;
+    s.durLentasMs = (uint32_t)(ev.duracaoMs + 0.5f);
+    s.ampLentas = (uint32_t)(ev.amplitude + 0.5f);
+  }
+  if (temPico_) {
+    s.ibiMs = (ev.tPicoUs - ultimoPicoUs_) / 1000;
+    s.nIbi = 1;
+  }
+  temPico_ = true;
+  ultimoPicoUs_ = ev.tPicoUs;
+  for (uint8_t h = 0; h < n_; h++)
+    somar(hor_[h].corrente, s);
+}
+
+uint8_t JanelasSono::avancar(uint32_t agoraMs) {
+  uint8_t fechou = 0;
+  for (uint8_t h = 0; h < n_; h++) {
+    Horizonte &k = hor_[h];
+    while (agoraMs - k.inicioMs >= k.larguraMs) {
+      JanelaSomas &sai = k.baldes[k.proximo];
+      subtrair(k.soma, sai);
+      sai = k.corrente;
+      somar(k.soma, sai);
+      memset(&k.corrente, 0, sizeof(k.corrente));
+      k.proximo = (uint8_t)((k.proximo + 1) % JANELA_BALDES);
+      if (k.fechados < JANELA_BALDES)
+        k.fechados++;
+      k.inicioMs += k.larguraMs;
+      fechou |= (uint8_t)(1u << h);
+    }
+  }
+  return fechou;
+}
+
+void JanelasSono::resumo(uint8_t h, JanelaResumo &out) const {
+  memset(&out, 0, sizeof(out));
+  if (h >= n_)
+    return;
+  const Horizonte &k = hor_[h];
+  const JanelaSomas &s = k.soma;
+  out.horizonteS = k.horizonteS;
+  out.cheia = k.fechados >= JANELA_BALDES;
+  out.cobertoMs = k.fechados * k.larguraMs;
+  out.normais = s.normais;
+  out.lentas = s.lentas;
+  if (out.cobertoMs) {
+    out.normaisMin = s.normais * 60000.0f / (float)out.cobertoMs;
+    out.lentasMin = s.lentas * 60000.0f / (float)out.cobertoMs;
+  }
+  out.durNormaisMs = media(s.durNormaisMs, s.normais);
+  out.ampNormais = media(s.ampNormais, s.normais);
+  out.durLentasMs = media(s.durLentasMs, s.lentas);
+  out.ampLentas = media(s.ampLentas, s.lentas);
+  out.ibiMs = media(s.ibiMs, s.nIbi);
+}
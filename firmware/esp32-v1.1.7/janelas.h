@@ -0,0 +1,79 @@
+#pragma once
+#include <stdint.h>
+
+#include "blink_detector.h"
+
+// =================== JANELAS DESLIZANTES (sessão S) ===================
+// Estatísticas das piscadelas do canal 0 em vários horizontes (ex.: 10 s,
+// 1 min, 5 min) ao mesmo tempo. Cada horizonte é um anel de JANELA_BALDES
+// baldes de horizonte/JANELA_BALDES: a piscadela soma-se ao balde corrente
+// e, quando este fecha, entra na soma da janela e sai o balde mais antigo.
+// Tudo O(1) por piscadela e por balde, sem guardar eventos.
+//
+// A janela é sempre a dos últimos JANELA_BALDES baldes fechados, por isso
+// um resumo lido logo a seguir a fechar um balde cobre exatamente o
+// horizonte. Os tempos são os de halMillis() (baldes) e do detetor (IBI).
+
+#define JANELA_BALDES 10
+#define JANELAS_MAX 3
+#define JANELA_MIN_S 5
+#define JANELA_MAX_S 1800
+
+// somas de um balde (e da janela)
+struct JanelaSomas {
+  uint32_t normais;
+  uint32_t lentas;
+  uint32_t durNormaisMs;
+  uint32_t ampNormais;
+  uint32_t durLentasMs;
+  uint32_t ampLentas;
+  uint32_t ibiMs; // intervalos entre picos de piscadelas seguidas
+  uint32_t nIbi;
+};
+
+struct JanelaResumo {
+  uint16_t horizonteS;
+  bool cheia;         // já fecharam JANELA_BALDES baldes desde begin()
+  uint32_t cobertoMs; // o que a janela cobre (= horizonte se cheia)
+  uint32_t normais;
+  uint32_t lentas;
+  float normaisMin; // por minuto, sobre cobertoMs
+  float lentasMin;
+  float durNormaisMs; // médias (0 sem piscadelas)
+  float ampNormais;
+  float durLentasMs;
+  float ampLentas;
+  float ibiMs;
+};
+
+class JanelasSono {
+public:
+  // horizontes em segundos (JANELA_MIN_S..JANELA_MAX_S); false se algum
+  // está fora ou n > JANELAS_MAX. Não mexe nas janelas atuais se falhar.
+  bool configurar(const uint16_t *horizontesS, uint8_t n);
+  uint8_t n() const { return n_; }
+  uint16_t horizonteS(uint8_t h) const { return hor_[h].horizonteS; }
+  // esvazia tudo; o 1º balde de cada horizonte começa em agoraMs
+  void begin(uint32_t agoraMs);
+  // normais e lentas; as outras não contam
+  void piscadela(const BlinkEvent &ev);
+  // fecha os baldes vencidos; bit h = o horizonte h fechou pelo menos um
+  uint8_t avancar(uint32_t agoraMs);
+  void resumo(uint8_t h, JanelaResumo &out) const;
+
+private:
+  struct Horizonte {
+    uint16_t horizonteS;
+    uint32_t larguraMs;
+    uint32_t inicioMs; // do balde corrente
+    uint8_t proximo;   // balde do anel que sai quando o corrente fechar
+    uint8_t fechados;  // satura em JANELA_BALDES
+    JanelaSomas corrente;
+    JanelaSomas soma; // dos baldes do anel
+    JanelaSomas baldes[JANELA_BALDES];
+  };
+  Horizonte hor_[JANELAS_MAX];
+  uint8_t n_ = 0;
+  bool temPico_ = false;
+  uint32_t ultimoPicoUs_ = 0;
+};
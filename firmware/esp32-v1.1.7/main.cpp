@@ -1,31 +1,42 @@
-#include <Arduino.h>
-#include <math.h> // ADICIONADO: necessário para atan2
-// ================== CONFIG ==================
-#define ENABLE_SPP 0
-#if ENABLE_SPP
-#include "BluetoothSerial.h"
-BluetoothSerial SerialBT;
-#else
-#include "esp_bt.h"
-#endif
-#include <NimBLEDevice.h>
-static const char *SERVICE_UUID = "6E400001-B5A3-F393-E0A9-E50E24DCCA9E";
-static const char *RX_UUID = "6E400002-B5A3-F393-E0A9-E50E24DCCA9E";
-static const char *TX_UUID = "6E400003-B5A3-F393-E0A9-E50E24DCCA9E";
-static NimBLECharacteristic *txChar = nullptr;
-static NimBLEAdvertising *adv = nullptr;
-static volatile bool bleConnected = false;
-static String bleCmdBuf;
-// !!! NOVO: Variável de agendamento (o segredo para não bloquear) !!!
-String commandToRun = "";
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "agendador.h"
+#include "bench.h"
+#include "ble_tx.h"
+#include "blink_detector.h"
+#include "calibracao.h"
+#include "captura_usb.h"
+#include "classificador.h"
+#include "cmd_fila.h"
+#include "eog_acq.h"
+#include "eog_log.h"
+#include "firmware.h"
+#include "hal.h"
+#include "janelas.h"
+#include "orientacao.h"
+#include "perfil.h"
+#include "perfis_cal.h"
+#include "raw_codec.h"
+#include "rec_sessao.h"
+#include "rt_frame.h"
+// RX BLE: linha em construção de cada central (escrita só pela task do
+// NimBLE)
+static char bleCmdBuf[HAL_BLE_LIGACOES_MAX][CMD_MSG_MAX];
+static size_t bleCmdLen[HAL_BLE_LIGACOES_MAX];
+static uint16_t dlSessaoPedida = 0; // DL=id (0 = última)
+// ACK=1: tramas ACK também para os comandos de texto (binários têm sempre)
+static bool acksTexto = false;
 // ===== forward declaration =====
-void imprimir(const String &texto);
-void imprimirImportante(const String &texto);
-void enviarBluetooth(const String &texto);
-void handleCommand(const String &cmdRaw);
+void imprimirImportante(const char *texto);
+void enviarBluetooth(const char *texto);
+CmdEstado handleCommand(const char *cmdRaw);
 // =================== TEU CÓDIGO ORIGINAL (IGUAL) ===================
 const int sensorPin = 36;
-#define MAX_EVENTO 50
+const int sensorPinH = 34; // par horizontal (ADC1_CH6, só entrada)
 // ----------------------------cenas a ser mudadas---------------------
 const float LIMIAR_DERIVADA = 1.40;
 const int DURACAO_MIN = 5;
@@ -34,637 +45,2276 @@ const int DURACAO_MAX = 70;
 const float DERIVADA_LENTA_MAX = 1.0;
 const int DURACAO_LENTA_MIN = 145;
 const int DURACAO_LENTA_MAX = 350;
-int limiarInferior = 471;
-int AMPLITUDE_MIN_LENTA = 60;
-int AMPLITUDE_MIN = 90;
 int contagemBlinksNormais = 0;
 int contagemBlinksLentos = 0;
 unsigned long somaDuracoesNormais = 0;
 unsigned long somaAmplitudesNormais = 0;
 unsigned long somaDuracoesLentas = 0;
 unsigned long somaAmplitudesLentas = 0;
-bool emEvento = false;
-int valoresEvento[MAX_EVENTO];
-unsigned long temposEvento[MAX_EVENTO];
-int eventoIndex = 0;
+// =================== CANAIS EOG ===================
+// Um por par de elétrodos, lidos na mesma varredura (eog_acq.h). O canal 0
+// é o vertical de sempre: piscadelas, P, alertas e gravador. Os outros
+// (1 = horizontal, movimentos do olhar) têm calibração e detetor próprios e
+// seguem no RT e no array do minuto. Um canal novo é mais um pino aqui.
+// Só o canal 0 lê por omissão: sem elétrodos, o pino 34 fica no ar e
+// mudava o RT, o M# e a calibração. Os outros ligam-se com CH=n (em idle).
+static const int eogPins[] = {sensorPin, sensorPinH};
+#define CANAIS_MAX ((uint8_t)(sizeof(eogPins) / sizeof(eogPins[0])))
+static_assert(CANAIS_MAX <= ACQ_CANAIS_MAX, "canais EOG a mais");
+static uint8_t nCanais = 1; // CH=
+static volatile uint8_t canaisPendente = 0; // CH= à espera do idle
+struct CanalEog {
+  // valores de origem até à calibração (C)
+  int limiarInferior = 471;
+  int amplitudeMin = 90; // TH= (canal 0) / THc=
+  int amplitudeMinLenta = 60;
+  BlinkDetector detetor; // partilhado por C, P e S
+  uint16_t minutoNormais = 0; // minuto corrente em S
+  uint16_t minutoLentos = 0;
+  bool temPico = false; // IBI das tramas de evento (S)
+  uint32_t ultimoPicoUs = 0;
+};
+static CanalEog canais[CANAIS_MAX];
 // =================== BASELINE + ALERTA POR MINUTO ===================
 static float baselineBpm = 0.0f;
-// contadores do minuto corrente durante S
+// início do minuto corrente durante S (contadores em canais[])
 static unsigned long minuteStartMs = 0;
-static uint16_t currentMinuteNormal = 0;
-static uint16_t currentMinuteSlow = 0;
 // critérios de aviso
 static const float BPM_INCREASE_FACTOR = 1.30f; // +30% vs baseline
 static const uint16_t SLOW_BPM_ALERT = 2;       // bpm lentas >= 2
 static const unsigned long ONE_MIN_MS = 60000UL;
+// janelas deslizantes (janelas.h): a mesma regra avaliada a cada balde que
+// fecha em cada horizonte, não só ao minuto; JAN=s1[,s2[,s3]] muda-os
+static const uint16_t JANELAS_OMISSAO[] = {10, 60, 300};
+static JanelasSono janelas;
+// o minuto do array M# como uma janela de 60 s alinhada com a sessão, para
+// o modelo ver as mesmas features que nas outras janelas
+static const uint16_t MINUTO_S = 60;
+static JanelasSono minutoJanela;
+static bool alertaJanela[JANELAS_MAX];
+static uint8_t baldesSemSono[JANELAS_MAX];
+// =================== PERFIL (perfis_cal.h) ===================
+// perfil de calibração do utilizador ativo: gravado no fim de C (se ficou
+// boa) e de P, posto à prova no arranque e em PF=n (modo V)
+static PerfilCal perfil;
+static bool temPerfil = false;
+static VerificacaoPerfil verif;
+static long verifAlvo = 0;
+// C pedido porque o perfil não conferiu: P arranca logo a seguir
+static bool calEmCadeia = false;
 // =================== ABORT (X) ===================
 static volatile bool abortRequested = false;
+// FS=valor: aplicado no loop() quando está idle (o anel é do loop)
+static volatile uint16_t taxaPendente = 0;
+// OS=n / FLT=m: sobre-amostragem e filtros da aquisição (eog_dsp.h),
+// aplicados no loop() como o FS=
+static volatile bool dspPendente = false;
+static uint8_t dspOs = ACQ_OS_DEFAULT;
+static DspModo dspModo = ACQ_FLT_DEFAULT;
+// RTB=hz: 0 = RT em JSON a cada 100 ms (apps antigas); >0 = tramas binárias
+// com amostras a hz, agrupadas até encher o MTU ou RT_BIN_MAX_LATENCY_MS
+static volatile uint8_t rtBinHz = 0;
+#define RT_BIN_MIN_HZ 10
+#define RT_BIN_MAX_HZ 100
+#define RT_BIN_MAX_LATENCY_MS 200
+static RtFrameBuilder rtFrame;
+// RT adaptativo (RTA=1, por omissão): com a ligação congestionada (notify
+// RT recusados, pontos RT descartados ou o anel RT a meio) o ritmo RT desce
+// para metade por nível e cada ponto passa a ser a média das amostras desde
+// o anterior; sobe um nível de cada vez depois de RT_ADAPT_RECUPERA_MS sem
+// problemas. Cada central que quer o RT tem o seu nível e vale o da melhor:
+// uma lenta perde pontos no seu anel sem abrandar as outras
+#define RT_ADAPT_JANELA_MS 500
+#define RT_ADAPT_RECUPERA_MS 3000
+#define RT_ADAPT_ESTADO_MS 5000 // trama de estado enquanto o nível não é 0
+#define RT_ADAPT_NIVEL_MAX 3
+#define RT_BIN_DT_MAX_MS 250 // dt da trama binária é u8
+static bool rtAdaptLigado = true;
+static uint8_t rtNivel = 0; // o aplicado: o menor de rtNivelLig
+static uint8_t rtNivelLig[HAL_BLE_LIGACOES_MAX];
+static uint32_t rtAdaptLimpoMs[HAL_BLE_LIGACOES_MAX];
+static uint32_t rtAdaptPerdas[HAL_BLE_LIGACOES_MAX];
+static uint32_t rtAdaptJanelaMs = 0, rtEstadoMs = 0;
+static uint16_t rtEstadoSeq = 0;
+// soma das amostras desde o último ponto RT (pontos de resumo)
+static uint32_t rtSoma[ACQ_CANAIS_MAX];
+static uint16_t rtSomaN = 0;
+// RAW=1: além do RT, todas as amostras de todos os canais em blocos
+// comprimidos (raw_codec.h), em C, P e S; os blocos saem a cada
+// RAW_MAX_LATENCY_MS ou quando o buffer vai a meio
+static bool rawLigado = false;
+#define RAW_MAX_LATENCY_MS 250
+static RawCodificador rawCod;
+static uint32_t rawBlocos = 0, rawAmostras = 0, rawBytes = 0;
+// EVT=1: em S, uma trama RT_FRAME_TYPE_PISCADELA por evento fechado, em
+// todos os canais (as features já calculadas pelo detetor)
+static bool evtLigado = false;
+static uint16_t evtSeq = 0;
+static uint32_t evtEnviados = 0, evtSemEspaco = 0;
 
 // =================== ADICIONADO: ACELERÓMETRO ADXL335 ===================
 #define PIN_X 32
 #define PIN_Y 33
 #define PIN_Z 39
-const float offset_x = 704.3;
-const float offset_y = 700.8;
-const float offset_z = 740.0;
-const float scale_x = 207.7;
-const float scale_y = 203.2;
-const float scale_z = 206.6;
-float filtered_roll = 0;
-float filtered_pitch = 0;
-const float alpha = 0.15;
-float readAvg(int pin) {
-  long soma = 0;
-  for (int i = 0; i < 5; i++) { // 5 amostras rápidas para não bloquear EOG
-    soma += analogRead(pin);
-    delayMicroseconds(100);
-  }
-  return soma / 5.0;
-}
-void updateAccelerometer() {
-  float raw_x = readAvg(PIN_X);
-  float raw_y = readAvg(PIN_Y);
-  float raw_z = readAvg(PIN_Z);
-  float gx = (raw_x - offset_x) / scale_x;
-  float gy = (raw_y - offset_y) / scale_y;
-  float gz = -(raw_z - offset_z) / scale_z;
-  gx = constrain(gx, -1.0, 1.0);
-  gy = constrain(gy, -1.0, 1.0);
-  gz = constrain(gz, -1.0, 1.0);
-  float current_pitch = atan2(gx, sqrt(gz * gz + gy * gy)) * 180.0 / PI;
-  float current_roll = atan2(gz, sqrt(gx * gx + gy * gy)) * 180.0 / PI;
-  filtered_roll = alpha * current_roll + (1.0 - alpha) * filtered_roll;
-  filtered_pitch = alpha * current_pitch + (1.0 - alpha) * filtered_pitch;
-  if (abs(filtered_roll) < 2)
-    filtered_roll = 0;
-  if (abs(filtered_pitch) < 2)
-    filtered_pitch = 0;
-}
+// lido em segundo plano pela aquisição (acqSetAccelPins); offsets e escalas
+// em LSB x16 (offset_x = 704.3, scale_x = 207.7, ...)
+static const AccCalib accCalib = {{11269, 11213, 11840}, {3323, 3251, 3306}};
+static OrientacaoFiltro orientacao;
 // =================== FIM ADICIONADO ===================
 
 // =================== UTILITÁRIOS ===================
-void bleSendLine(const String &s) {
-  if (!txChar)
-    return;
-  String line = s + "\n";
-  const uint16_t mtu = 20; // safe BLE payload size
-  size_t offset = 0;
-  while (offset < line.length()) {
-    size_t chunk = line.length() - offset;
-    if (chunk > mtu)
-      chunk = mtu;
-    txChar->setValue((uint8_t *)(line.c_str() + offset), chunk);
-    txChar->notify();
-    offset += chunk;
-    if (offset < line.length())
-      delay(8); // espera entre fragmentos
-  }
-}
-// USB apenas
-void imprimir(const String &texto) { Serial.println(texto); }
+// alguma central ligada quer este fluxo (SUB=)
+static bool bleAlguemQuer(uint8_t fluxo) {
+  for (uint8_t i = 0; i < HAL_BLE_LIGACOES_MAX; i++)
+    if (halBleLigada(i) && (bleTxFluxos(i) & fluxo))
+      return true;
+  return false;
+}
+// só vai para as centrais que subscreveram o fluxo (SUB=)
+static bool bleEnqueue(BleTxKind kind, uint8_t fluxos, const uint8_t *data,
+                       size_t len) {
+  if (!bleTxPush(kind, fluxos, data, len))
+    return false;
+  halBleTxKick();
+  return true;
+}
+// payload útil de uma notificação com o MTU negociado (o menor das
+// centrais que querem o fluxo, menos o envelope de ligação com SEQ=1)
+static inline size_t blePayloadMax(uint8_t fluxo) {
+  return bleTxPayloadMax(fluxo);
+}
+// uma trama binária = uma notificação (sem fragmentar nem delay); false se
+// nenhuma fila a aceitou
+bool bleSendFrame(uint8_t fluxos, const uint8_t *data, size_t len) {
+  if (!halBleConnected())
+    return false;
+  return bleEnqueue(BLE_TX_FRAME, fluxos, data, len);
+}
+// USB apenas (via anel do log; sai no próximo logDrain)
+void imprimir(const char *texto) { logWrite(LOG_INFO, texto); }
+static void enviarFluxo(BleFluxo fluxo, const char *texto) {
+  halSppWriteLine(texto);
+  if (halBleConnected())
+    bleEnqueue(BLE_TX_TEXT, fluxo, (const uint8_t *)texto, strlen(texto));
+}
 // Bluetooth apenas
-void enviarBluetooth(const String &texto) {
-#if ENABLE_SPP
-  SerialBT.println(texto);
-#endif
-  if (bleConnected)
-    bleSendLine(texto);
+void enviarBluetooth(const char *texto) {
+  enviarFluxo(BLE_FLUXO_TEXTO, texto);
 }
 // USB + Bluetooth (só para mensagens "importantes": calibração, etc.)
-void imprimirImportante(const String &texto) {
+void imprimirImportante(const char *texto) {
   imprimir(texto);
   enviarBluetooth(texto);
 }
-bool lerLinhaStream(Stream &st, String &out) {
-  if (!st.available())
+// Linha da consola montada sem bloquear. Sem '\n', a linha conta ao fim de
+// 1 s sem bytes novos (o timeout que o readStringUntil tinha).
+static char consolaBuf[64];
+static size_t consolaLen = 0;
+static uint32_t consolaUltimoMs = 0;
+bool lerLinhaComando(char *out, size_t max) {
+  bool completa = false;
+  while (!completa && halConsoleAvailable() > 0) {
+    char c = (char)halConsoleRead();
+    consolaUltimoMs = halMillis();
+    if (c == '\n' || c == '\r')
+      completa = consolaLen > 0;
+    else if (consolaLen < sizeof(consolaBuf) - 1)
+      consolaBuf[consolaLen++] = c;
+  }
+  if (!completa &&
+      !(consolaLen > 0 && halMillis() - consolaUltimoMs >= 1000))
     return false;
-  out = st.readStringUntil('\n');
-  out.trim();
-  return out.length() > 0;
+  size_t n = consolaLen < max - 1 ? consolaLen : max - 1;
+  memcpy(out, consolaBuf, n);
+  out[n] = 0;
+  consolaLen = 0;
+  return true;
 }
-bool lerLinhaComando(String &out) {
-  if (lerLinhaStream(Serial, out))
-    return true;
-#if ENABLE_SPP
-  if (lerLinhaStream(SerialBT, out))
+// prefixo sem distinguir maiúsculas (TH=, th=, ...)
+static bool comecaPor(const char *s, const char *prefixo) {
+  for (; *prefixo; s++, prefixo++) {
+    char c = *s;
+    if (c >= 'a' && c <= 'z')
+      c -= 'a' - 'A';
+    if (c != *prefixo)
+      return false;
+  }
+  return true;
+}
+// TH=v: canal 0, como sempre; THc=v: canal c
+static bool ehThreshold(const char *cmd) {
+  return comecaPor(cmd, "TH=") ||
+         (comecaPor(cmd, "TH") && cmd[2] >= '0' && cmd[2] <= '9' &&
+          cmd[3] == '=');
+}
+bool aplicarThresholdManual(const char *cmd) {
+  uint8_t c = cmd[2] == '=' ? 0 : (uint8_t)(cmd[2] - '0');
+  int v = atoi(cmd + (cmd[2] == '=' ? 3 : 4));
+  if (c < nCanais && v > 0) {
+    canais[c].amplitudeMin = v;
+    if (c == 0)
+      LOGI(">> Threshold manual aplicado: AMPLITUDE_MIN = %d", v);
+    else
+      LOGI(">> Threshold manual aplicado: canal %u AMPLITUDE_MIN = %d",
+           (unsigned)c, v);
     return true;
-#endif
+  }
+  LOGI(">> TH inválido. Use TH=numero (ex: TH=90) ou THc=numero (canal "
+       "0-%u)",
+       (unsigned)(nCanais - 1));
   return false;
 }
-void aplicarThresholdManual(const String &cmd) {
-  int v = cmd.substring(3).toInt();
-  if (v > 0) {
-    AMPLITUDE_MIN = v;
-    imprimir(">> Threshold manual aplicado: AMPLITUDE_MIN = " +
-             String(AMPLITUDE_MIN));
+bool aplicarRTBinario(const char *cmd) {
+  int v = atoi(cmd + 4);
+  if (v == 0) {
+    rtBinHz = 0;
+    imprimir(">> RT em JSON (a cada 100 ms).");
+  } else if (v >= RT_BIN_MIN_HZ && v <= RT_BIN_MAX_HZ) {
+    rtBinHz = (uint8_t)v;
+    LOGI(">> RT binário a %d Hz.", v);
   } else {
-    imprimir(">> TH inválido. Use TH=numero (ex: TH=90)");
+    LOGI(">> RTB inválido. Use RTB=0 (JSON) ou RTB=%d..%d (Hz)",
+         RT_BIN_MIN_HZ, RT_BIN_MAX_HZ);
+    return false;
   }
+  return true;
 }
-// apanha X imediato sem engolir outros comandos
-static inline void pollAbortImmediate() {
-  while (Serial.available()) {
-    char c = (char)Serial.peek();
-    if (c == 'x' || c == 'X') {
-      Serial.read();
-      abortRequested = true;
-    } else {
-      break;
-    }
+bool aplicarTaxaAmostragem(const char *cmd) {
+  int v = atoi(cmd + 3);
+  if (v >= ACQ_MIN_RATE_HZ && v <= ACQ_MAX_RATE_HZ) {
+    taxaPendente = (uint16_t)v;
+    return true;
+  }
+  LOGI(">> FS inválido. Use FS=numero entre %d e %d (Hz)", ACQ_MIN_RATE_HZ,
+       ACQ_MAX_RATE_HZ);
+  return false;
+}
+bool aplicarSobreAmostragem(const char *cmd) {
+  int v = atoi(cmd + 3);
+  if (v >= 1 && v <= DSP_OS_MAX) {
+    dspOs = (uint8_t)v;
+    dspPendente = true;
+    return true;
+  }
+  LOGI(">> OS inválido. Use OS=1..%d (leituras do ADC por amostra)",
+       DSP_OS_MAX);
+  return false;
+}
+bool aplicarFiltro(const char *cmd) {
+  int v = atoi(cmd + 4);
+  if (cmd[4] >= '0' && cmd[4] <= '9' && v <= DSP_MODO_MAX) {
+    dspModo = (DspModo)v;
+    dspPendente = true;
+    return true;
+  }
+  LOGI(">> FLT inválido. Use FLT=0 (média) .. FLT=%d", DSP_MODO_MAX);
+  return false;
+}
+// CH=n: canais EOG lidos (os n primeiros de eogPins); como FS=, espera
+// pelo idle. A captura USB leva o número de canais no cabeçalho.
+bool aplicarCanais(const char *cmd) {
+  int v = atoi(cmd + 3);
+  if (cmd[3] < '1' || cmd[3] > '9' || v > CANAIS_MAX) {
+    LOGI(">> CH inválido. Use CH=1..%u (canais EOG)", (unsigned)CANAIS_MAX);
+    return false;
+  }
+  if (capAtiva()) {
+    imprimir(">> CH: pare primeiro a captura (CAP=0).");
+    return false;
+  }
+  canaisPendente = (uint8_t)v;
+  return true;
+}
+bool aplicarNivelLog(const char *cmd) {
+  int v = atoi(cmd + 4);
+  if (cmd[4] >= '0' && cmd[4] <= '9' && v <= LOG_VERBOSE) {
+    logNivel = (uint8_t)v;
+    LOGI(">> Nível de log: %d", v);
+    if (v > LOG_NIVEL_MAX)
+      LOGI(">> (compilado só até %d)", LOG_NIVEL_MAX);
+    return true;
   }
-#if ENABLE_SPP
-  while (SerialBT.available()) {
-    char c = (char)SerialBT.peek();
+  LOGI(">> LOG inválido. Use LOG=0 (erros) .. LOG=%d", LOG_VERBOSE);
+  return false;
+}
+static void reportarCustoAcq() {
+  uint32_t mediaCentUs, maxUs;
+  acqCusto(mediaCentUs, maxUs);
+  // % de um core = µs por tick x ticks por segundo / 10^4
+  uint32_t cargaMil =
+      (uint32_t)((uint64_t)mediaCentUs * acqRateHz() * acqOs() / 100000UL);
+  LOGI("Aquisição: tick %lu.%02lu us com %u canais (pior %lu us), %lu.%lu%% "
+       "de um core",
+       (unsigned long)(mediaCentUs / 100), (unsigned long)(mediaCentUs % 100),
+       (unsigned)acqCanais(), (unsigned long)maxUs,
+       (unsigned long)(cargaMil / 10), (unsigned long)(cargaMil % 10));
+}
+static void reportarPerdas() {
+  uint32_t perdidas = acqOverruns();
+  if (perdidas > 0)
+    LOGI("Aquisição: %lu amostras perdidas (anel cheio)",
+         (unsigned long)perdidas);
+  BleTxStats st;
+  bleTxGetStats(st);
+  LOGI("BLE TX: %lu em fila, %lu descartadas (fila cheia), "
+       "fila máx %u/%u",
+       (unsigned long)st.queued, (unsigned long)st.dropped,
+       (unsigned)st.highWater, (unsigned)BLE_TX_POOL_LEN);
+  if (st.dropped > 0)
+    LOGI("BLE TX: descartadas desde o arranque: alerta %lu, evento %lu, RT "
+         "%lu, debug %lu",
+         (unsigned long)st.descartadasPor[BLE_PRIO_ALERTA],
+         (unsigned long)st.descartadasPor[BLE_PRIO_EVENTO],
+         (unsigned long)st.descartadasPor[BLE_PRIO_RT],
+         (unsigned long)st.descartadasPor[BLE_PRIO_DEBUG]);
+  if (st.semEspaco > 0 || st.falhadas > 0)
+    LOGI("BLE TX: %lu sem espaço no MTU (SEQ=1), %lu notify recusados",
+         (unsigned long)st.semEspaco, (unsigned long)st.falhadas);
+  uint32_t logPerdidas = logDescartadas();
+  if (logPerdidas > 0)
+    LOGI("Log: %lu linhas descartadas (anel cheio)",
+         (unsigned long)logPerdidas);
+  reportarCustoAcq();
+}
+// linha da consola que é só um X (com espaços): atalho como o do BLE
+static bool linhaEhX(const char *l) {
+  while (*l == ' ' || *l == '\t')
+    l++;
+  if (*l != 'x' && *l != 'X')
+    return false;
+  for (l++; *l == ' ' || *l == '\t'; l++)
+    ;
+  return *l == 0;
+}
+static inline void pollAbortImmediate() {
+  while (halConsoleAvailable() > 0) {
+    char c = (char)halConsolePeek();
     if (c == 'x' || c == 'X') {
-      SerialBT.read();
+      halConsoleRead();
       abortRequested = true;
     } else {
       break;
     }
   }
-#endif
-}
-static inline bool shouldAbortNow() {
-  pollAbortImmediate();
-  return abortRequested;
 }
 // =================== MINUTO: fechar e devolver contagens ===================
-bool tickMinute(unsigned long now, uint16_t &endedNormal, uint16_t &endedSlow) {
+// endedNormal/endedSlow: um por canal
+bool tickMinute(unsigned long now, uint16_t *endedNormal, uint16_t *endedSlow) {
   bool closedAny = false;
   while (now - minuteStartMs >= ONE_MIN_MS) {
-    endedNormal = currentMinuteNormal;
-    endedSlow = currentMinuteSlow;
-    currentMinuteNormal = 0;
-    currentMinuteSlow = 0;
+    for (uint8_t c = 0; c < nCanais; c++) {
+      endedNormal[c] = canais[c].minutoNormais;
+      endedSlow[c] = canais[c].minutoLentos;
+      canais[c].minutoNormais = 0;
+      canais[c].minutoLentos = 0;
+    }
     minuteStartMs += ONE_MIN_MS;
     closedAny = true;
   }
   return closedAny;
 }
 // === NOVO: envia o array por Bluetooth no formato pedido ===
+// ["M#",normais,lentas,"S-/NS-"] do canal 0 e, no fim, normais,lentas de
+// cada outro canal (as apps antigas só leem as 4 primeiras posições)
 static inline void enviarArrayMinutoBluetooth(uint32_t minutoN,
-                                              uint16_t normais, uint16_t lentas,
+                                              const uint16_t *normais,
+                                              const uint16_t *lentas,
                                               bool sonoDetectado) {
-  String m = "M" + String(minutoN);
-  String flag = sonoDetectado ? "S-" : "NS-";
   // array em string (tipo JSON)
-  String payload = "[\"" + m + "\"," + String(normais) + "," + String(lentas) +
-                   ",\"" + flag + "\"]";
-  enviarBluetooth(payload);
+  char payload[RT_MINUTO_MAX];
+  rtFormatarMinuto(payload, sizeof(payload), minutoN, normais, lentas,
+                   nCanais, sonoDetectado);
+  enviarFluxo(BLE_FLUXO_MINUTO, payload);
+}
+// ADICIONADO: envia array RT com EOG + acelerómetro (rt_frame.h)
+static inline void enviarRT(unsigned long ts, const uint16_t *eog,
+                            int16_t rollDg, int16_t pitchDg) {
+  char payload[RT_JSON_MAX];
+  rtFormatarJson(payload, sizeof(payload), (uint32_t)ts, eog, nCanais,
+                 rollDg, pitchDg);
+  enviarFluxo(BLE_FLUXO_RT, payload);
+}
+// limiares atuais (calibração / TH=) no formato do detetor
+static BlinkParams parametrosDetecao(uint8_t c) {
+  BlinkParams p;
+  p.limiarInferior = canais[c].limiarInferior;
+  p.limiarDerivada = LIMIAR_DERIVADA;
+  p.duracaoMinMs = DURACAO_MIN;
+  p.duracaoMaxMs = DURACAO_MAX;
+  p.amplitudeMin = canais[c].amplitudeMin;
+  p.derivadaLentaMax = DERIVADA_LENTA_MAX;
+  p.duracaoLentaMinMs = DURACAO_LENTA_MIN;
+  p.duracaoLentaMaxMs = DURACAO_LENTA_MAX;
+  p.amplitudeMinLenta = canais[c].amplitudeMinLenta;
+  return p;
+}
+static void enviarRTBinarioPendente() {
+  if (rtFrame.count() == 0)
+    return;
+  const uint8_t *frame;
+  size_t len = rtFrame.finish(frame);
+  bleSendFrame(BLE_FLUXO_RT, frame, len);
+}
+// ADICIONADO: RT binário; acumula amostras e envia uma trama por notificação
+static void enviarRTBinario(unsigned long ts, const uint16_t *eog,
+                            int16_t rollDg, int16_t pitchDg, uint8_t dtMs) {
+  size_t maxLen = blePayloadMax(BLE_FLUXO_RT);
+  if (rtFrame.count() > 0 && rtFrame.dtMs() != dtMs)
+    enviarRTBinarioPendente();
+  if (rtFrame.count() == 0)
+    rtFrame.reset(dtMs, nCanais);
+  if (!rtFrame.add(ts, eog, rollDg, pitchDg, maxLen)) {
+    enviarRTBinarioPendente();
+    rtFrame.reset(dtMs, nCanais);
+    rtFrame.add(ts, eog, rollDg, pitchDg, maxLen);
+  }
+  if (!rtFrame.hasRoom(maxLen) ||
+      ts - rtFrame.firstMs() >= RT_BIN_MAX_LATENCY_MS)
+    enviarRTBinarioPendente();
+}
+// =================== RT ADAPTATIVO ===================
+// período dos pontos RT no nível atual (o binário fica pelo dt máximo)
+static uint16_t periodoRT() {
+  uint8_t rtHz = rtBinHz;
+  uint16_t base = rtHz == 0 ? 100 : (uint16_t)(1000U / rtHz);
+  uint16_t p = (uint16_t)(base << rtNivel);
+  if (rtHz != 0 && p > RT_BIN_DT_MAX_MS)
+    p = base > RT_BIN_DT_MAX_MS ? base : RT_BIN_DT_MAX_MS;
+  return p;
+}
+// trama de estado, com prioridade de alerta, para quem quer o RT e já lê
+// tramas binárias (RTB=, SEQ=1 ou SUB= explícito); nunca no fluxo de texto
+static bool querEstadoRT(uint8_t i) {
+  return halBleLigada(i) && (bleTxFluxos(i) & BLE_FLUXO_RT) &&
+         (rtBinHz != 0 || bleTxEnvelopeAtivo(i) || bleTxSubscreveu(i));
+}
+// cada central recebe os contadores RT dela
+static void enviarEstadoRT() {
+  bool algum = false;
+  for (uint8_t i = 0; i < HAL_BLE_LIGACOES_MAX; i++) {
+    BleTxStats st;
+    if (!querEstadoRT(i) || !bleTxGetStatsLigacao(i, st))
+      continue;
+    uint16_t ocup = bleTxOcupacaoLigacao(i, BLE_FLUXO_RT);
+    uint8_t trama[RT_FRAME_ESTADO_LEN];
+    size_t len = rtMontarEstado(trama, rtEstadoSeq, rtNivel, periodoRT(),
+                                st.descartadasPor[BLE_PRIO_RT],
+                                st.falhadasPor[BLE_PRIO_RT],
+                                (uint8_t)(ocup > 255 ? 255 : ocup));
+    algum |= bleTxPushPara(i, BLE_TX_FRAME, trama, len);
+  }
+  if (algum) {
+    rtEstadoSeq++;
+    halBleTxKick();
+  }
+  rtEstadoMs = halMillis();
 }
-// ADICIONADO: envia array RT com EOG + acelerómetro
-static inline void enviarRT(unsigned long ts, int eog, float roll,
-                            float pitch) {
-  String payload = "[\"RT\"," + String(ts) + "," + String(eog) + "," +
-                   String(roll, 1) + "," + String(pitch, 1) + "]";
-  enviarBluetooth(payload);
+static void mudarNivelRT(uint8_t nivel) {
+  rtNivel = nivel;
+  BleTxStats st;
+  bleTxGetStats(st);
+  LOGI(">> RT adaptativo: nível %u, um ponto a cada %u ms (%lu descartadas, "
+       "%lu recusadas)",
+       (unsigned)nivel, (unsigned)periodoRT(),
+       (unsigned long)st.descartadasPor[BLE_PRIO_RT],
+       (unsigned long)st.falhadasPor[BLE_PRIO_RT]);
+  enviarEstadoRT();
 }
+// perdas de prioridade RT de uma ligação (notify recusados + descartes),
+// desde que ligou: as de texto, alertas ou DL não contam
+static uint32_t perdasRT(uint8_t i) {
+  BleTxStats st;
+  if (!bleTxGetStatsLigacao(i, st))
+    return 0;
+  return st.falhadasPor[BLE_PRIO_RT] + st.descartadasPor[BLE_PRIO_RT];
+}
+// o nível de uma central, uma vez por janela: sobe logo um se a janela teve
+// perdas ou o anel RT dela vai a meio; desce um com RT_ADAPT_RECUPERA_MS
+// limpos
+static void adaptarRTLigacao(uint8_t i, uint32_t agora) {
+  uint32_t perdas = perdasRT(i);
+  // menos que antes: ligou outra central neste lugar (contadores a 0)
+  if (perdas < rtAdaptPerdas[i]) {
+    rtNivelLig[i] = 0;
+    rtAdaptLimpoMs[i] = agora;
+  }
+  bool perdeu = perdas > rtAdaptPerdas[i];
+  rtAdaptPerdas[i] = perdas;
+  uint16_t ocup = bleTxOcupacaoLigacao(i, BLE_FLUXO_RT);
+  if (perdeu || ocup >= BLE_TX_QUEUE_LEN / 2) {
+    rtAdaptLimpoMs[i] = agora;
+    if (rtNivelLig[i] < RT_ADAPT_NIVEL_MAX)
+      rtNivelLig[i]++;
+  } else if (ocup > 2) {
+    rtAdaptLimpoMs[i] = agora;
+  } else if (rtNivelLig[i] > 0 &&
+             agora - rtAdaptLimpoMs[i] >= RT_ADAPT_RECUPERA_MS) {
+    rtAdaptLimpoMs[i] = agora;
+    rtNivelLig[i]--;
+  }
+}
+static void adaptarRT(uint32_t agora) {
+  if (agora - rtAdaptJanelaMs < RT_ADAPT_JANELA_MS)
+    return;
+  rtAdaptJanelaMs = agora;
+  uint8_t nivel = RT_ADAPT_NIVEL_MAX + 1;
+  for (uint8_t i = 0; i < HAL_BLE_LIGACOES_MAX; i++) {
+    if (!rtAdaptLigado || !halBleLigada(i) ||
+        !(bleTxFluxos(i) & BLE_FLUXO_RT)) {
+      rtNivelLig[i] = 0;
+      rtAdaptPerdas[i] = perdasRT(i);
+      continue;
+    }
+    adaptarRTLigacao(i, agora);
+    if (rtNivelLig[i] < nivel)
+      nivel = rtNivelLig[i];
+  }
+  if (nivel > RT_ADAPT_NIVEL_MAX) // ninguém quer o RT, ou RTA=0
+    return;
+  if (nivel != rtNivel)
+    mudarNivelRT(nivel);
+  if (rtNivel > 0 && agora - rtEstadoMs >= RT_ADAPT_ESTADO_MS)
+    enviarEstadoRT();
+}
+bool aplicarRTAdaptativo(const char *cmd) {
+  if (cmd[4] != '0' && cmd[4] != '1') {
+    imprimir(">> RTA inválido. Use RTA=0 (ritmo fixo) ou RTA=1 (adaptativo)");
+    return false;
+  }
+  rtAdaptLigado = cmd[4] == '1';
+  if (!rtAdaptLigado && rtNivel > 0)
+    mudarNivelRT(0);
+  LOGI(">> RT adaptativo: %s", rtAdaptLigado ? "sim" : "não");
+  return true;
+}
+// modos do agendador (a tabela modos[] vem depois das funções de cada um)
+enum : uint8_t {
+  MODO_IDLE,
+  MODO_C,
+  MODO_P,
+  MODO_S,
+  MODO_D,
+  MODO_T,
+  MODO_V,
+  MODO_B,
+  NUM_MODOS
+};
 // =================== CALIBRAR ===================
-void calibrar() {
-  abortRequested = false;
+// 1/2: baseline -> limiarInferior; pausa de 0.5 s; 2/2: a piscar ->
+// AMPLITUDE_MIN, com estimadores robustos em contínuo (calibracao.h). Cada
+// fase acaba quando as estimativas do canal 0, o das piscadelas, chegam ao
+// alvo de confiança ou ao limite de tempo (10 s na baseline, 40 s a piscar).
+// Contado em amostras, não em ms. Todos os canais calibram ao mesmo tempo.
+enum FaseCal : uint8_t { CAL_BASELINE, CAL_PAUSA, CAL_PISCAR };
+static struct {
+  FaseCal fase;
+  long n;
+  long nMin;
+  long nAlvo; // o máximo da fase
+  CalBaseline base[CANAIS_MAX];
+  CalPiscadelas pisc[CANAIS_MAX];
+} cal;
+// =================== PERFIL: GRAVAR E APLICAR ===================
+static void lerPerfil() {
+  temPerfil = perfilLer(perfilAtivo(), perfil, nCanais);
+}
+static void gravarPerfil() {
+  perfil.nCanais = nCanais;
+  perfil.epoch = halEpoch();
+  if (perfilGravar(perfilAtivo(), perfil)) {
+    temPerfil = true;
+    LOGI(">> Perfil %u gravado na NVS", (unsigned)perfilAtivo());
+  } else {
+    LOGE("[NVS] Falha a gravar o perfil %u", (unsigned)perfilAtivo());
+  }
+}
+// fim de C: limiares e qualidade do sinal; o BPM de um P anterior fica
+static void gravarPerfilCalibracao() {
+  if (!temPerfil)
+    memset(&perfil, 0, sizeof(perfil));
+  perfil.fsHz = (uint16_t)acqRateHz();
+  perfil.calibracoes++;
+  for (uint8_t c = 0; c < nCanais; c++) {
+    PerfilCanal &pc = perfil.canal[c];
+    pc.baseline = cal.base[c].mediana();
+    pc.sigma = cal.base[c].sigma();
+    pc.limiarInferior = (int16_t)canais[c].limiarInferior;
+    pc.amplitudeMin = (int16_t)canais[c].amplitudeMin;
+    pc.amplitudeMinLenta = (int16_t)canais[c].amplitudeMinLenta;
+    pc.ampMax = (int16_t)cal.pisc[c].amplitudeRef();
+  }
+  gravarPerfil();
+}
+// fim de P: só há perfil depois de uma C
+static void gravarPerfilBpm() {
+  if (!temPerfil) {
+    imprimir(">> Sem calibração (C) neste perfil: BPM não gravado.");
+    return;
+  }
+  perfil.baselineBpm = baselineBpm;
+  perfil.temBpm = 1;
+  gravarPerfil();
+}
+static void aplicarPerfil() {
+  for (uint8_t c = 0; c < nCanais; c++) {
+    canais[c].limiarInferior = perfil.canal[c].limiarInferior;
+    canais[c].amplitudeMin = perfil.canal[c].amplitudeMin;
+    canais[c].amplitudeMinLenta = perfil.canal[c].amplitudeMinLenta;
+  }
+  baselineBpm = perfil.temBpm ? perfil.baselineBpm : 0.0f;
+}
+static bool calEntrar() {
   imprimir("=== Calibração 1/2 ===");
-  imprimir("10s olhos abertos, sem mexer e sem piscar. (X para sair)");
-  long soma = 0;
-  long soma2 = 0;
-  int n = 0;
-  for (int s = 1; s <= 10; s++) {
-    if (shouldAbortNow()) {
-      imprimir(">> Saí da calibração (X).");
-      return;
+  LOGI("Olhos abertos, sem mexer e sem piscar (%d a %d s). (X para sair)",
+       CAL_BASE_MIN_S, CAL_BASE_MAX_S);
+  cal.fase = CAL_BASELINE;
+  cal.n = 0;
+  cal.nMin = (long)CAL_BASE_MIN_S * acqRateHz();
+  cal.nAlvo = (long)CAL_BASE_MAX_S * acqRateHz();
+  for (uint8_t c = 0; c < nCanais; c++) {
+    cal.base[c].begin(acqRateHz());
+    cal.pisc[c].begin();
+  }
+  return true;
+}
+// só o canal 0: um canal extra sem elétrodos nunca chega ao alvo
+static bool calBaselinePronta() {
+  return cal.base[0].pronta((uint32_t)cal.nMin);
+}
+static void calFimBaseline() {
+  LOGI("Baseline em %.1f s", cal.n / (float)acqRateHz());
+  for (uint8_t c = 0; c < nCanais; c++) {
+    const CalBaseline &b = cal.base[c];
+    canais[c].limiarInferior = b.limiarInferior();
+    if (c > 0) {
+      LOGI("Canal %u: baseline %.1f, sigma %.2f, limiarInferior %d",
+           (unsigned)c, b.mediana(), b.sigma(), canais[c].limiarInferior);
+      continue;
     }
-    imprimir("Baseline: " + String(s) + "/10 s");
-    for (int i = 0; i < 50; i++) {
-      if (shouldAbortNow()) {
-        imprimir(">> Saí da calibração (X).");
-        return;
-      }
-      int v = analogRead(sensorPin);
-      soma += v;
-      soma2 += (long)v * (long)v;
-      n++;
-      delay(20);
+    LOGI("Baseline ADC: %.1f (mediana; média %.1f)", b.mediana(), b.media());
+    LOGI("Sigma (ruído): %.2f (MAD; Welford %.2f)", b.sigma(),
+         b.sigmaWelford());
+    LOGI("Offset escolhido: %d (erro do limiar ±%.1f)", b.offset(),
+         b.erroLimiar());
+    LOGI(">> limiarInferior calibrado: %d", canais[c].limiarInferior);
+  }
+}
+static void calFimPiscar() {
+  LOGI("Piscar em %.1f s", cal.n / (float)acqRateHz());
+  for (uint8_t c = 0; c < nCanais; c++) {
+    CanalEog &k = canais[c];
+    const CalPiscadelas &p = cal.pisc[c];
+    int ampRef = p.amplitudeRef();
+    calAmplitudes(ampRef, k.amplitudeMin, k.amplitudeMinLenta);
+    if (c > 0) {
+      LOGI("Canal %u: amplitude de referência %d, AMPLITUDE_MIN %d",
+           (unsigned)c, ampRef, k.amplitudeMin);
+      continue;
     }
+    LOGI("Piscadelas: %lu, mediana %.0f, %lu outliers (acima de %.0f)",
+         (unsigned long)p.n(), p.mediana(), (unsigned long)p.outliers(),
+         p.cerca());
+    LOGI("Amplitude de referência: %d (máxima observada %d)", ampRef,
+         p.amplitudeMax());
+    LOGI(">> AMPLITUDE_MIN (60%% da referência): %d", k.amplitudeMin);
   }
-  float baseline = soma / (float)n;
-  float variancia = (soma2 / (float)n) - (baseline * baseline);
-  float sigma = variancia > 0 ? sqrt(variancia) : 0;
-  int offset = (int)(5.0 * sigma);
-  if (offset < 20)
-    offset = 20;
-  if (offset > 150)
-    offset = 150;
-  limiarInferior = (int)baseline - offset;
-  imprimir("Baseline ADC: " + String(baseline, 1));
-  imprimir("Sigma (ruído): " + String(sigma, 2));
-  imprimir("Offset escolhido: " + String(offset));
-  imprimir(">> limiarInferior calibrado: " + String(limiarInferior));
-  delay(500);
-  imprimir("=== Calibração 2/2 ===");
-  imprimir("10s a piscar normalmente (sem forçar). (X para sair)");
-  int ampMax = 0;
-  bool emEv = false;
-  int inicioV = 0;
-  int picoV = 4095;
-  unsigned long t0 = millis();
-  unsigned long tLast = millis();
-  while (millis() - t0 < 10000) {
-    if (shouldAbortNow()) {
-      imprimir(">> Saí da calibração (X).");
-      return;
+  // Só o resultado final vai por Bluetooth (texto) como antes; a qualidade
+  // é a do canal das piscadelas
+  bool emCadeia = calEmCadeia;
+  calEmCadeia = false;
+  if (cal.pisc[0].amplitudeRef() < 15 || cal.base[0].sigma() > 110) {
+    imprimirImportante("Calibração mal efetuada");
+    return;
+  }
+  // poucas piscadelas: os limiares ficam (melhores do que os de origem),
+  // mas não vão para o perfil nem seguem para P
+  if (!cal.pisc[0].confiavel()) {
+    char linha[64];
+    snprintf(linha, sizeof(linha),
+             "Calibração pouco fiável (%lu piscadelas): repita C",
+             (unsigned long)cal.pisc[0].n());
+    imprimirImportante(linha);
+    return;
+  }
+  imprimirImportante("Calibração concluída");
+  gravarPerfilCalibracao();
+  if (emCadeia)
+    agendadorPedir(MODO_P);
+}
+static bool calAmostra(const AcqSample &a) {
+  cal.n++;
+  switch (cal.fase) {
+  case CAL_BASELINE:
+    for (uint8_t c = 0; c < nCanais; c++)
+      cal.base[c].add(a.eog[c]);
+    if (cal.n % acqRateHz() == 0)
+      LOGD("Baseline: %ld s", cal.n / acqRateHz());
+    // o alvo de confiança só é visto a cada 100 ms
+    if (cal.n == cal.nAlvo ||
+        (cal.n % (acqRateHz() / 10) == 0 && calBaselinePronta())) {
+      calFimBaseline();
+      cal.fase = CAL_PAUSA;
+      cal.n = 0;
+      cal.nAlvo = acqRateHz() / 2;
     }
-    int v = analogRead(sensorPin);
-    if (!emEv && v < limiarInferior) {
-      emEv = true;
-      inicioV = v;
-      picoV = v;
+    break;
+  case CAL_PAUSA: // amostras descartadas (o antigo delay(500))
+    if (cal.n == cal.nAlvo) {
+      imprimir("=== Calibração 2/2 ===");
+      LOGI("A piscar normalmente, sem forçar, até acabar (%d piscadelas, "
+           "até %d s). (X para sair)",
+           CAL_PISCADELAS_MIN, CAL_PISCAR_MAX_S);
+      for (uint8_t c = 0; c < nCanais; c++) {
+        canais[c].detetor.setParams(parametrosDetecao(c));
+        canais[c].detetor.reset();
+      }
+      cal.fase = CAL_PISCAR;
+      cal.n = 0;
+      cal.nAlvo = (long)CAL_PISCAR_MAX_S * acqRateHz();
     }
-    if (emEv) {
-      if (v < picoV)
-        picoV = v;
-      if (v >= limiarInferior) {
-        emEv = false;
-        int amp = abs(picoV - inicioV);
-        if (amp > ampMax)
-          ampMax = amp;
+    break;
+  case CAL_PISCAR: {
+    // aqui conta qualquer evento, seja qual for a classe
+    bool nova = false;
+    for (uint8_t c = 0; c < nCanais; c++) {
+      BlinkEvent ev;
+      if (canais[c].detetor.update(a.eog[c], a.tUs, ev)) {
+        cal.pisc[c].add((uint16_t)ev.amplitude);
+        nova |= c == 0;
       }
     }
-    if (millis() - tLast >= 1000) {
-      int sec = (millis() - t0) / 1000;
-      imprimir("Piscar: " + String(sec) + "/10 s");
-      tLast = millis();
+    if (cal.n % acqRateHz() == 0)
+      LOGD("Piscar: %ld s, %lu piscadelas", cal.n / acqRateHz(),
+           (unsigned long)cal.pisc[0].n());
+    if (cal.n == cal.nAlvo || (nova && cal.pisc[0].pronta())) {
+      calFimPiscar();
+      return false;
     }
-    delay(10);
-  }
-  AMPLITUDE_MIN = (int)((0.60) * ampMax);
-  if (AMPLITUDE_MIN < 10)
-    AMPLITUDE_MIN = 10;
-  AMPLITUDE_MIN_LENTA = (int)((1.0 / 2.0) * ampMax);
-  if (AMPLITUDE_MIN_LENTA < 10)
-    AMPLITUDE_MIN_LENTA = 10;
-  imprimir("Amplitude máxima observada: " + String(ampMax));
-  imprimir(">> AMPLITUDE_MIN (1/2 do max): " + String(AMPLITUDE_MIN));
-  // Só o resultado final vai por Bluetooth (texto) como antes
-  if (ampMax < 15 || sigma > 110) {
-    imprimirImportante("Calibração mal efetuada");
-  } else {
-    imprimirImportante("Calibração concluída");
+    break;
+  }
+  }
+  return true;
+}
+static void calSair(bool interrompido) {
+  if (interrompido) {
+    calEmCadeia = false;
+    imprimir(">> Saí da calibração (X).");
   }
 }
 // =================== comando P (baseline BPM normal em 30s)
 // ===================
+// só o canal 0: o BPM de referência é o das piscadelas
 static const unsigned long BASELINE_P_MS = 30000UL;
-void medirBaselinePiscadelas_30s() {
-  abortRequested = false;
+static long pN = 0;
+static long pAlvo = 0;
+static int pBlinksNormais = 0;
+static bool baselinePEntrar() {
   imprimir("=== Baseline Piscadelas (P) ===");
   imprimir("30s a piscar normalmente. A medir BPM baseline... (X para sair)");
-  int blinksNormaisLocal = 0;
-  unsigned long t0 = millis();
-  unsigned long tLast = millis();
-  emEvento = false;
-  eventoIndex = 0;
-  while (millis() - t0 < BASELINE_P_MS) {
-    if (shouldAbortNow()) {
-      imprimir(">> Saí do baseline P (X).");
-      return;
-    }
-    int leitura = analogRead(sensorPin);
-    unsigned long agora = millis();
-    if (agora - tLast >= 1000) {
-      int sec = (agora - t0) / 1000;
-      imprimir("Tempo P: " + String(sec) + "/30 s");
-      tLast = agora;
-    }
-    if (!emEvento && leitura < limiarInferior) {
-      emEvento = true;
-      eventoIndex = 0;
-    }
-    if (emEvento) {
-      if (eventoIndex < MAX_EVENTO) {
-        valoresEvento[eventoIndex] = leitura;
-        temposEvento[eventoIndex] = agora;
-        eventoIndex++;
-      }
-      if (leitura >= limiarInferior || eventoIndex >= MAX_EVENTO) {
-        emEvento = false;
-        int valorInicio = valoresEvento[0];
-        unsigned long tempoInicioEvento = temposEvento[0];
-        int pico = valorInicio;
-        unsigned long tempoPico = tempoInicioEvento;
-        for (int i = 1; i < eventoIndex; i++) {
-          if (valoresEvento[i] < pico) {
-            pico = valoresEvento[i];
-            tempoPico = temposEvento[i];
-          }
-        }
-        float deltaValor = abs(pico - valorInicio);
-        float deltaTempo = (float)(tempoPico - tempoInicioEvento);
-        float derivada = deltaTempo > 0 ? deltaValor / deltaTempo : 0;
-        if (derivada >= LIMIAR_DERIVADA && deltaTempo >= DURACAO_MIN &&
-            deltaTempo <= DURACAO_MAX) {
-          blinksNormaisLocal++;
-          imprimir("✓ Piscadela NORMAL detetada (P)");
-        }
-      }
-    }
-    delay(10);
+  pBlinksNormais = 0;
+  pAlvo = (long)(BASELINE_P_MS / 1000UL) * acqRateHz();
+  pN = 0;
+  // P não exigia amplitude mínima às normais (ainda não há TH confiável)
+  BlinkParams pp = parametrosDetecao(0);
+  pp.amplitudeMin = 0;
+  canais[0].detetor.setParams(pp);
+  canais[0].detetor.reset();
+  return true;
+}
+static bool baselinePAmostra(const AcqSample &a) {
+  pN++;
+  BlinkEvent ev;
+  if (canais[0].detetor.update(a.eog[0], a.tUs, ev) &&
+      classificarPiscadela(ev, canais[0].detetor.params()) == BLINK_NORMAL) {
+    pBlinksNormais++;
+    LOGD("✓ Piscadela NORMAL detetada (P)");
   }
-  baselineBpm = (float)blinksNormaisLocal * (60000.0f / (float)BASELINE_P_MS);
+  if (pN % acqRateHz() == 0)
+    LOGD("Tempo P: %ld/30 s", pN / acqRateHz());
+  if (pN < pAlvo)
+    return true;
+  baselineBpm = (float)pBlinksNormais * (60000.0f / (float)BASELINE_P_MS);
   imprimir("=== Baseline P concluído ===");
-  imprimir("Piscadelas normais em 30s: " + String(blinksNormaisLocal));
-  imprimir("BASELINE_BPM: " + String(baselineBpm, 2));
+  LOGI("Piscadelas normais em 30s: %d", pBlinksNormais);
+  LOGI("BASELINE_BPM: %.2f", baselineBpm);
+  gravarPerfilBpm();
+  return false;
+}
+static void baselinePSair(bool interrompido) {
+  if (interrompido)
+    imprimir(">> Saí do baseline P (X).");
+}
+// =================== V (verificar o perfil) ===================
+// no arranque e em PF=n: se o sinal bate com o perfil, aplica-o; senão
+// segue para a calibração completa (C e depois P)
+static bool verifEntrar() {
+  lerPerfil();
+  if (!temPerfil) {
+    LOGI(">> Sem perfil %u na NVS: C e P para calibrar.",
+         (unsigned)perfilAtivo());
+    return false;
+  }
+  LOGI("=== Verificação do perfil %u ===", (unsigned)perfilAtivo());
+  LOGI("%ds olhos abertos, sem mexer. (X para sair)", PERFIL_VERIF_S);
+  verif.begin(perfil);
+  verifAlvo = (long)PERFIL_VERIF_S * acqRateHz();
+  return true;
+}
+static bool verifAmostra(const AcqSample &a) {
+  verif.amostra(a.eog);
+  if ((long)verif.n() < verifAlvo)
+    return true;
+  VerificacaoPerfil::Canal r[CANAIS_MAX];
+  bool confere = verif.resultado(r);
+  for (uint8_t c = 0; c < nCanais; c++)
+    LOGI("Canal %u: %.0f%% acima do limiar, mediana %.1f (perfil %.1f), "
+         "sigma %.2f (perfil %.2f)%s",
+         (unsigned)c, r[c].fracAbertos * 100, r[c].mediana,
+         perfil.canal[c].baseline, r[c].sigma, perfil.canal[c].sigma,
+         r[c].confere ? "" : " -> não confere");
+  char linha[80];
+  if (confere) {
+    aplicarPerfil();
+    snprintf(linha, sizeof(linha), "Perfil %u aplicado (%s)",
+             (unsigned)perfilAtivo(),
+             perfil.temBpm ? "S pronto" : "falta P");
+    imprimirImportante(linha);
+    if (perfil.temBpm)
+      LOGI("BASELINE_BPM: %.2f", baselineBpm);
+    return false;
+  }
+  snprintf(linha, sizeof(linha), "Perfil %u não confere: calibração",
+           (unsigned)perfilAtivo());
+  imprimirImportante(linha);
+  calEmCadeia = true;
+  agendadorPedir(MODO_C);
+  return false;
+}
+static void verifSair(bool interrompido) {
+  if (interrompido)
+    imprimir(">> Saí da verificação (X): perfil não aplicado.");
 }
 // -------------------- S: INFINITO, USB com texto, Bluetooth com array
 // --------------------
-void correrSessao() {
-  abortRequested = false;
+static uint32_t sessaoInicioMs = 0;
+static uint32_t sessaoSegMs = 0;
+static uint32_t sessaoMinutoN = 0;
+static bool sessaoEntrar() {
   contagemBlinksNormais = 0;
   contagemBlinksLentos = 0;
   somaDuracoesNormais = 0;
   somaAmplitudesNormais = 0;
   somaDuracoesLentas = 0;
   somaAmplitudesLentas = 0;
+  bleTxResetStats();
   imprimir("=== Sessão iniciada ===");
   imprimir("Fase: pisque normalmente (INFINITO). (X para sair)");
   imprimir("BLE envia RT a cada 100ms + array de minuto "
            "[M#,normais,lentas,S-/NS-].");
-  minuteStartMs = millis();
-  currentMinuteNormal = 0;
-  currentMinuteSlow = 0;
-  unsigned long tempoInicio = millis();
-  unsigned long tempoAnteriorSeg = millis();
-  uint32_t minutoN = 0;
-  unsigned long ultimoAcc =
-      millis(); // ADICIONADO: controla update do acelerómetro
-  unsigned long ultimoRT = millis(); // ADICIONADO: controla envio do array RT
-  while (true) {
-    if (shouldAbortNow()) {
-      imprimir(">> Saí da sessão S (X).");
-      return;
+  sessaoInicioMs = halMillis();
+  minuteStartMs = sessaoInicioMs;
+  janelas.begin(sessaoInicioMs);
+  minutoJanela.begin(sessaoInicioMs);
+  memset(alertaJanela, 0, sizeof(alertaJanela));
+  memset(baldesSemSono, 0, sizeof(baldesSemSono));
+  sessaoSegMs = sessaoInicioMs;
+  sessaoMinutoN = 0;
+  for (uint8_t c = 0; c < nCanais; c++) {
+    canais[c].minutoNormais = 0;
+    canais[c].minutoLentos = 0;
+    canais[c].temPico = false;
+    canais[c].detetor.setParams(parametrosDetecao(c));
+    canais[c].detetor.reset();
+  }
+  uint16_t sessaoRec = recIniciarSessao(
+      acqRateHz(), canais[0].limiarInferior, canais[0].amplitudeMin);
+  if (sessaoRec)
+    LOGI("A gravar na flash: sessão %u (DL para descarregar)",
+         (unsigned)sessaoRec);
+  return true;
+}
+// piscadela do canal 0: totais da sessão e gravador
+static void piscadelaSessao(const BlinkEvent &ev) {
+  recPiscadela(ev);
+  janelas.piscadela(ev);
+  minutoJanela.piscadela(ev);
+  if (ev.cls == BLINK_NORMAL) {
+    contagemBlinksNormais++;
+    somaDuracoesNormais += (unsigned long)ev.duracaoMs;
+    somaAmplitudesNormais += (unsigned long)ev.amplitude;
+    LOGD("✓ Piscadela NORMAL detetada");
+  } else if (ev.cls == BLINK_SLOW) {
+    contagemBlinksLentos++;
+    somaDuracoesLentas += (unsigned long)ev.duracaoMs;
+    somaAmplitudesLentas += (unsigned long)ev.amplitude;
+    LOGD("⚠ Piscadela LENTA (SONOLÊNCIA) detetada");
+  }
+}
+// EVT=1: o IBI conta só entre normais e lentas, como nas janelas
+static void eventoSessao(uint8_t c, const BlinkEvent &ev) {
+  CanalEog &k = canais[c];
+  uint32_t ibiMs = k.temPico ? (ev.tPicoUs - k.ultimoPicoUs) / 1000 : 0;
+  if (ev.cls != BLINK_OTHER) {
+    k.temPico = true;
+    k.ultimoPicoUs = ev.tPicoUs;
+  }
+  bool ble = evtLigado && halBleConnected();
+  if (!ble && !capAtiva())
+    return;
+  uint8_t trama[RT_FRAME_PISCADELA_LEN];
+  size_t len = rtMontarPiscadela(trama, evtSeq++, c, ev, ibiMs);
+  capEvento(trama, len);
+  if (!ble)
+    return;
+  if (blePayloadMax(BLE_FLUXO_EVT) < RT_FRAME_PISCADELA_LEN) {
+    evtSemEspaco++;
+    return;
+  }
+  bleSendFrame(BLE_FLUXO_EVT, trama, len);
+  evtEnviados++;
+}
+// deteção da sessão S, uma amostra do anel de cada vez, em todos os canais
+static bool sessaoAmostra(const AcqSample &a) {
+  {
+    PERF_MEDIR(PERF_GRAVADOR);
+    recAmostra(a);
+  }
+  PERF_MEDIR(PERF_DETECAO);
+  for (uint8_t c = 0; c < nCanais; c++) {
+    CanalEog &k = canais[c];
+    BlinkEvent ev;
+    if (!k.detetor.update(a.eog[c], a.tUs, ev))
+      continue;
+    if (c == 0) // piscadelas: o modelo escolhido (MDL=)
+      ev.cls = classificarPiscadela(ev, k.detetor.params());
+    eventoSessao(c, ev);
+    if (ev.cls == BLINK_NORMAL)
+      k.minutoNormais++;
+    else if (ev.cls == BLINK_SLOW)
+      k.minutoLentos++;
+    if (c == 0)
+      piscadelaSessao(ev);
+    else if (ev.cls != BLINK_OTHER)
+      LOGD("↔ Evento no canal %u (%s)", (unsigned)c,
+           ev.cls == BLINK_NORMAL ? "rápido" : "lento");
+  }
+  return true;
+}
+// a regra do minuto em taxas por minuto sobre a janela (modelo 0); as
+// lentas têm de ser também pelo menos SLOW_BPM_ALERT em número (numa janela
+// de 10 s uma só lenta já daria 6/min)
+static SonoParams sonoParams() {
+  SonoParams p;
+  p.baselineBpm = baselineBpm;
+  p.fatorBpm = BPM_INCREASE_FACTOR;
+  p.lentasMin = SLOW_BPM_ALERT;
+  return p;
+}
+// só nas mudanças: ["J<s>",normais,lentas,"S-/NS-"] na janela de s segundos.
+// O alerta só cai depois de um horizonte inteiro sem a condição, senão a
+// janela de 10 s piscava entre S- e NS- a cada lenta que entra e sai.
+static void avaliarJanela(uint8_t h) {
+  JanelaResumo r;
+  janelas.resumo(h, r);
+  bool sono = avaliarSono(r, sonoParams());
+  if (sono)
+    baldesSemSono[h] = 0;
+  else if (alertaJanela[h] && ++baldesSemSono[h] < JANELA_BALDES)
+    return;
+  if (sono == alertaJanela[h])
+    return;
+  alertaJanela[h] = sono;
+  if (sono) {
+    imprimir("CANSAÇO!!!!!!!!");
+    LOGI("ALERTA_JANELA %us normal_bpm=%.1f slow_bpm=%.1f baseline_bpm=%.2f",
+         (unsigned)r.horizonteS, r.normaisMin, r.lentasMin, baselineBpm);
+  } else {
+    LOGI(">> Janela de %u s: sem sinais de cansaço.", (unsigned)r.horizonteS);
+  }
+  char payload[48];
+  snprintf(payload, sizeof(payload), "[\"J%u\",%lu,%lu,\"%s\"]",
+           (unsigned)r.horizonteS, (unsigned long)r.normais,
+           (unsigned long)r.lentas, sono ? "S-" : "NS-");
+  enviarFluxo(BLE_FLUXO_MINUTO, payload);
+}
+static bool sessaoVolta(uint32_t agora) {
+  for (uint8_t c = 0; c < nCanais; c++) // TH= aplica-se de imediato
+    canais[c].detetor.setParams(parametrosDetecao(c));
+  uint8_t fechou = janelas.avancar(agora);
+  for (uint8_t h = 0; h < janelas.n(); h++)
+    if (fechou & (1u << h))
+      avaliarJanela(h);
+  minutoJanela.avancar(agora);
+  // fecha minuto(s)
+  uint16_t endedNormal[CANAIS_MAX] = {}, endedSlow[CANAIS_MAX] = {};
+  if (tickMinute(agora, endedNormal, endedSlow)) {
+    sessaoMinutoN++;
+    // condição de sono/cansaço no canal 0: o modelo sobre o minuto que
+    // fechou (com os limiares, a mesma lógica do teu alerta)
+    JanelaResumo minuto;
+    minutoJanela.resumo(0, minuto);
+    bool sonoDetectado = avaliarSono(minuto, sonoParams());
+    // USB mantém texto como estava
+    if (sonoDetectado) {
+      imprimir("CANSAÇO!!!!!!!!");
+      LOGI("RELATORIO_MINUTO normal_bpm=%u slow_bpm=%u baseline_bpm=%.2f",
+           (unsigned)endedNormal[0], (unsigned)endedSlow[0], baselineBpm);
     }
-    int leitura = analogRead(sensorPin);
-    unsigned long agora = millis();
-
-    // ADICIONADO: atualiza acelerómetro a cada 100ms (não bloqueia EOG)
-    if (agora - ultimoAcc >= 100) {
-      ultimoAcc = agora;
-      updateAccelerometer();
+    LOGI("=== Resultados (minuto %lu) ===", (unsigned long)sessaoMinutoN);
+    LOGI("Piscadelas normais: %u", (unsigned)endedNormal[0]);
+    LOGI("Piscadelas lentas (sonolência): %u", (unsigned)endedSlow[0]);
+    for (uint8_t c = 1; c < nCanais; c++)
+      LOGI("Canal %u: eventos rápidos %u, lentos %u", (unsigned)c,
+           (unsigned)endedNormal[c], (unsigned)endedSlow[c]);
+    // Bluetooth: SÓ o array pedido
+    enviarArrayMinutoBluetooth(sessaoMinutoN, endedNormal, endedSlow,
+                               sonoDetectado);
+    recMinuto(sessaoMinutoN, endedNormal[0], endedSlow[0], sonoDetectado);
+  }
+  if (agora - sessaoSegMs >= 1000) {
+    int segundos = (agora - sessaoInicioMs) / 1000;
+    LOGD("Tempo: %ds", segundos);
+    sessaoSegMs = agora;
+  }
+  return true;
+}
+static void sessaoSair(bool interrompido) {
+  (void)interrompido; // S só acaba com X
+  imprimir(">> Saí da sessão S (X).");
+  recTerminarSessao();
+  reportarPerdas();
+}
+// -------------------- D: descarga da sessão gravada (DL) --------------------
+// Tramas REC_BLOCO do tamanho do MTU, tão depressa quanto a fila de envio
+// aceita; deixa sempre algum lugar na fila para texto. O leitor já avançou
+// quando a fila recusa: a trama fica guardada e vai primeiro na volta
+// seguinte.
+static uint32_t dlT0 = 0;
+static uint32_t dlTramas = 0;
+static uint32_t dlBytes = 0;
+static uint32_t dlRecusas = 0;
+static uint8_t dlTrama[BLE_TX_MSG_MAX];
+static size_t dlTramaLen = 0; // > 0: trama lida e ainda por enviar
+static bool descargaEntrar() {
+  if (!halBleConnected()) {
+    imprimir(">> DL: sem ligação BLE.");
+    return false;
+  }
+  // sem ninguém no fluxo a fila nunca enche: lia tudo para o vazio
+  if (!bleAlguemQuer(BLE_FLUXO_DADOS)) {
+    imprimir(">> DL: nenhuma central subscreveu os dados (SUB=, bit 32).");
+    return false;
+  }
+  if (!recDescargaBegin(dlSessaoPedida)) {
+    imprimir(">> DL: gravador indisponível.");
+    return false;
+  }
+  imprimir("=== Descarga iniciada === (X para parar)");
+  dlT0 = halMillis();
+  dlTramas = 0;
+  dlBytes = 0;
+  dlRecusas = 0;
+  dlTramaLen = 0;
+  return true;
+}
+static bool descargaVolta(uint32_t agora) {
+  if (!halBleConnected()) {
+    imprimir(">> DL: ligação perdida.");
+    return false;
+  }
+  if (!bleAlguemQuer(BLE_FLUXO_DADOS)) {
+    imprimir(">> DL: nenhuma central quer os dados: descarga parada.");
+    return false;
+  }
+  while (bleTxOcupacao(BLE_FLUXO_DADOS) < BLE_TX_QUEUE_LEN - 4) {
+    if (dlTramaLen == 0)
+      dlTramaLen = recDescargaNext(dlTrama, blePayloadMax(BLE_FLUXO_DADOS));
+    if (dlTramaLen == 0) {
+      LOGI("=== Descarga concluída: %lu tramas, %lu bytes, %lu recusas, "
+           "%lu ms ===",
+           (unsigned long)dlTramas, (unsigned long)dlBytes,
+           (unsigned long)dlRecusas, (unsigned long)(agora - dlT0));
+      return false;
     }
-    // ADICIONADO: envia array RT a cada 100ms
-    if (agora - ultimoRT >= 100) {
-      ultimoRT = agora;
-      enviarRT(agora, leitura, filtered_roll, filtered_pitch);
+    if (!bleSendFrame(BLE_FLUXO_DADOS, dlTrama, dlTramaLen)) {
+      dlRecusas++; // a mesma trama outra vez na próxima volta
+      break;
     }
-
-    // fecha minuto(s)
-    uint16_t endedNormal = 0, endedSlow = 0;
-    if (tickMinute(agora, endedNormal, endedSlow)) {
-      minutoN++;
-      // condição de sono/cansaço (mesma lógica do teu alerta)
-      bool hasBaseline = baselineBpm > 0.01f;
-      bool bpmUp30 = hasBaseline &&
-                     ((float)endedNormal >= baselineBpm * BPM_INCREASE_FACTOR);
-      bool slowOk = (endedSlow >= SLOW_BPM_ALERT);
-      bool sonoDetectado = (bpmUp30 && slowOk);
-      // USB mantém texto como estava
-      if (sonoDetectado) {
-        imprimir("CANSAÇO!!!!!!!!");
-        imprimir(String("RELATORIO_MINUTO ") + "normal_bpm=" +
-                 String(endedNormal) + " slow_bpm=" + String(endedSlow) +
-                 " baseline_bpm=" + String(baselineBpm, 2));
-      }
-      imprimir("=== Resultados (minuto " + String(minutoN) + ") ===");
-      imprimir("Piscadelas normais: " + String(endedNormal));
-      imprimir("Piscadelas lentas (sonolência): " + String(endedSlow));
-      // Bluetooth: SÓ o array pedido
-      enviarArrayMinutoBluetooth(minutoN, endedNormal, endedSlow,
-                                 sonoDetectado);
+    dlTramas++;
+    dlBytes += dlTramaLen;
+    dlTramaLen = 0;
+  }
+  return true;
+}
+static void descargaSair(bool interrompido) {
+  if (interrompido)
+    imprimir(">> Descarga interrompida (X).");
+}
+// -------------------- T: teste de débito BLE (TPUT) --------------------
+// Tramas sintéticas do tamanho do MTU, tão depressa quanto a fila de envio
+// aceita, durante tputSeg segundos. No fim: o que a task de envio passou ao
+// NimBLE por segundo e quantos notify falharam (telemóvel que não aguenta).
+#define TPUT_SEG_OMISSAO 10
+#define TPUT_SEG_MAX 60
+static uint8_t tputSeg = TPUT_SEG_OMISSAO;
+static uint32_t tputT0 = 0;
+static uint16_t tputSeq = 0;
+static BleTxStats tputInicio;
+static const char *nomePhy(uint8_t phy) {
+  static const char *nomes[] = {"n/d", "1M", "2M", "coded"};
+  return phy < 4 ? nomes[phy] : "?";
+}
+static void mostrarLigacaoBle(uint8_t i) {
+  HalBleLigacao l;
+  if (!halBleLigacao(i, l))
+    return;
+  // só o que a HAL conseguiu ler (o loopback do host só tem o MTU)
+  char linha[128];
+  int n = snprintf(linha, sizeof(linha), ">> BLE %u: MTU %u", (unsigned)i,
+                   (unsigned)l.mtu);
+  if (l.phyTx)
+    n += snprintf(linha + n, sizeof(linha) - n, ", PHY %s/%s",
+                  nomePhy(l.phyTx), nomePhy(l.phyRx));
+  if (l.intervaloUs)
+    n += snprintf(linha + n, sizeof(linha) - n,
+                  ", intervalo %lu.%02lu ms, latência %u, supervisão %u ms",
+                  (unsigned long)(l.intervaloUs / 1000),
+                  (unsigned long)(l.intervaloUs % 1000 / 10),
+                  (unsigned)l.latencia, (unsigned)l.supervisaoMs);
+  if (l.dleOctetos)
+    snprintf(linha + n, sizeof(linha) - n, ", DLE %u B",
+             (unsigned)l.dleOctetos);
+  imprimir(linha);
+  // desde que ligou (os mesmos contadores vão na resposta ao SYNC=)
+  BleTxStats st;
+  if (!bleTxGetStatsLigacao(i, st))
+    return;
+  LOGI(">> BLE %u TX: %lu mensagens, %lu descartadas, %lu notificações (%lu "
+       "B), %lu recusadas, fila máx %u/%u; SUB=%u SEQ=%d",
+       (unsigned)i, (unsigned long)st.seq,
+       (unsigned long)(st.descartadas + st.semEspaco),
+       (unsigned long)st.notificacoes, (unsigned long)st.bytes,
+       (unsigned long)st.falhadas, (unsigned)st.highWater,
+       (unsigned)BLE_TX_POOL_LEN, (unsigned)bleTxFluxos(i),
+       bleTxEnvelopeAtivo(i) ? 1 : 0);
+}
+static void mostrarLigacaoBle() {
+  if (!halBleConnected()) {
+    imprimir(">> BLE: sem ligação.");
+    return;
+  }
+  for (uint8_t i = 0; i < HAL_BLE_LIGACOES_MAX; i++)
+    mostrarLigacaoBle(i);
+  LOGI(">> RT adaptativo: %s, nível %u, um ponto a cada %u ms",
+       rtAdaptLigado ? "sim" : "não", (unsigned)rtNivel,
+       (unsigned)periodoRT());
+}
+static bool tputEntrar() {
+  if (!halBleConnected()) {
+    imprimir(">> TPUT: sem ligação BLE.");
+    return false;
+  }
+  if (!bleAlguemQuer(BLE_FLUXO_DADOS)) {
+    imprimir(">> TPUT: nenhuma central subscreveu os dados (SUB=, bit 32).");
+    return false;
+  }
+  mostrarLigacaoBle();
+  LOGI("=== TPUT: %u s de tramas de %u B === (X para parar)",
+       (unsigned)tputSeg, (unsigned)blePayloadMax(BLE_FLUXO_DADOS));
+  bleTxGetStats(tputInicio);
+  tputT0 = halMillis();
+  tputSeq = 0;
+  return true;
+}
+static bool tputVolta(uint32_t agora) {
+  if (!halBleConnected()) {
+    imprimir(">> TPUT: ligação perdida.");
+    return false;
+  }
+  if (agora - tputT0 >= tputSeg * 1000UL)
+    return false;
+  uint8_t trama[RT_FRAME_MAX_LEN];
+  size_t len = blePayloadMax(BLE_FLUXO_DADOS);
+  if (len > sizeof(trama))
+    len = sizeof(trama);
+  // no máximo uma fila por volta (no host a fila esvazia-se logo)
+  for (int k = 0; k < BLE_TX_QUEUE_LEN &&
+                  bleTxOcupacao(BLE_FLUXO_DADOS) < BLE_TX_QUEUE_LEN - 4;
+       k++) {
+    trama[0] = RT_FRAME_MAGIC;
+    trama[1] = RT_FRAME_VERSION;
+    trama[2] = RT_FRAME_TYPE_TPUT;
+    trama[3] = (uint8_t)tputSeq;
+    trama[4] = (uint8_t)(tputSeq >> 8);
+    for (int i = 0; i < 4; i++)
+      trama[5 + i] = (uint8_t)(agora >> (8 * i));
+    for (size_t i = 9; i < len; i++)
+      trama[i] = (uint8_t)i;
+    tputSeq++;
+    bleSendFrame(BLE_FLUXO_DADOS, trama, len);
+  }
+  return true;
+}
+static void tputSair(bool interrompido) {
+  BleTxStats st;
+  bleTxGetStats(st);
+  uint32_t ms = halMillis() - tputT0;
+  if (ms == 0)
+    ms = 1;
+  uint32_t notif = st.notificacoes - tputInicio.notificacoes;
+  uint64_t bytes = st.bytes - tputInicio.bytes;
+  char linha[128];
+  snprintf(linha, sizeof(linha),
+           "TPUT%s: %lu B/s, %lu notif/s, %lu notify falhados, %lu "
+           "descartadas, %lu ms",
+           interrompido ? " (X)" : "", (unsigned long)(bytes * 1000 / ms),
+           (unsigned long)((uint64_t)notif * 1000 / ms),
+           (unsigned long)(st.falhadas - tputInicio.falhadas),
+           (unsigned long)(st.dropped - tputInicio.dropped),
+           (unsigned long)ms);
+  imprimirImportante(linha);
+}
+// -------------------- B: bench sobre EOG sintético --------------------
+// Gerar o sinal custa mais do que medi-lo: umas centenas de amostras por
+// volta, para o loop (comandos, X, log, RT) não parar durante minutos.
+#define BENCH_SEG_OMISSAO 60
+#define BENCH_SEG_MAX 600
+#define BENCH_BLOCOS_VOLTA 4 // de 64 amostras (bench.cpp)
+static uint16_t benchSeg = BENCH_SEG_OMISSAO;
+static BenchResultado benchRes; // ~300 B fora da pilha do loop
+static bool benchEntrar() {
+  LOGI("=== BENCH: %u s de EOG sintético === (X para parar)",
+       (unsigned)benchSeg);
+  SintParams sint;
+  sintOmissao(sint);
+  sint.fsHz = (uint16_t)acqRateHz();
+  benchComecar(sint, benchSeg, parametrosDetecao(0), accCalib, benchRes);
+  return true;
+}
+static bool benchVolta(uint32_t agora) {
+  (void)agora;
+  if (benchPasso(benchRes, BENCH_BLOCOS_VOLTA))
+    return true;
+  benchRelatorio(benchRes, imprimir);
+  return false;
+}
+static void benchSair(bool interrompido) {
+  if (interrompido)
+    imprimir(">> BENCH interrompido (X).");
+}
+// =================== MODOS (agendador.h) ===================
+// idle, DL e BENCH descartam as amostras (ninguém as quer; não contam como
+// perda)
+static bool descartarAmostra(const AcqSample &) { return true; }
+static const Modo modos[NUM_MODOS] = {
+    {"idle", nullptr, descartarAmostra, nullptr, nullptr},
+    {"C", calEntrar, calAmostra, nullptr, calSair},
+    {"P", baselinePEntrar, baselinePAmostra, nullptr, baselinePSair},
+    {"S", sessaoEntrar, sessaoAmostra, sessaoVolta, sessaoSair},
+    {"DL", descargaEntrar, descartarAmostra, descargaVolta, descargaSair},
+    {"TPUT", tputEntrar, descartarAmostra, tputVolta, tputSair},
+    {"V", verifEntrar, verifAmostra, nullptr, verifSair},
+    {"BENCH", benchEntrar, descartarAmostra, benchVolta, benchSair},
+};
+// RT (JSON ou binário) em C, P e S, com a última amostra e a orientação; com
+// a ligação congestionada, a média das amostras desde o ponto anterior
+static unsigned long ultimoRT = 0;
+static uint16_t leituraRT[ACQ_CANAIS_MAX];
+static void servirRT() {
+  uint8_t modo = agendadorModo();
+  if (modo != MODO_C && modo != MODO_P && modo != MODO_S)
+    return;
+  PERF_MEDIR(PERF_RT);
+  unsigned long agora = halMillis();
+  if (halBleConnected())
+    adaptarRT(agora);
+  else
+    rtNivel = 0; // sem ninguém a ouvir: recomeça ao ritmo pedido
+  uint16_t periodo = periodoRT();
+  if (agora - ultimoRT < periodo)
+    return;
+  ultimoRT = agora;
+  uint16_t ponto[ACQ_CANAIS_MAX];
+  const uint16_t *eog = leituraRT;
+  if (rtNivel > 0 && rtSomaN > 0) {
+    for (uint8_t c = 0; c < nCanais; c++)
+      ponto[c] = (uint16_t)((rtSoma[c] + rtSomaN / 2) / rtSomaN);
+    eog = ponto;
+  }
+  memset(rtSoma, 0, sizeof(rtSoma));
+  rtSomaN = 0;
+  if (rtBinHz == 0)
+    enviarRT(agora, eog, orientacao.rollDg(), orientacao.pitchDg());
+  else
+    enviarRTBinario(agora, eog, orientacao.rollDg(), orientacao.pitchDg(),
+                    (uint8_t)periodo);
+}
+// =================== RAW (raw_codec.h) ===================
+static void observarAmostra(const AcqSample &a) {
+  capAmostra(a); // em todos os modos, idle incluído
+  uint8_t modo = agendadorModo();
+  if (modo != MODO_C && modo != MODO_P && modo != MODO_S)
+    return;
+  if (rtNivel > 0 && rtSomaN < UINT16_MAX) {
+    for (uint8_t c = 0; c < nCanais; c++)
+      rtSoma[c] += a.eog[c];
+    rtSomaN++;
+  }
+  if (rawLigado && halBleConnected())
+    rawCod.add(a.tUs, a.eog);
+}
+// tudo: não espera pela latência (antes de mudar a taxa)
+static void servirRaw(bool tudo) {
+  size_t n = rawCod.pendentes();
+  if (n == 0 || (!tudo && n < RAW_BUF_AMOSTRAS / 2 &&
+                 halMicros() - rawCod.primeiroUs() <
+                     RAW_MAX_LATENCY_MS * 1000UL))
+    return;
+  PERF_MEDIR(PERF_RAW);
+  uint8_t trama[RT_FRAME_MAX_LEN];
+  // meio buffer cabe em poucas tramas; o limite só protege o loop
+  for (int i = 0; i < BLE_TX_QUEUE_LEN && rawCod.pendentes(); i++) {
+    size_t antes = rawCod.pendentes();
+    size_t len = rawCod.montar(trama, blePayloadMax(BLE_FLUXO_RAW));
+    if (len == 0)
+      break;
+    rawBlocos++;
+    rawAmostras += (uint32_t)(antes - rawCod.pendentes());
+    rawBytes += (uint32_t)len;
+    bleSendFrame(BLE_FLUXO_RAW, trama, len);
+  }
+}
+static void mostrarRaw() {
+  uint32_t valores = rawAmostras * nCanais;
+  uint32_t bitsX100 =
+      valores ? (uint32_t)((uint64_t)rawBytes * 800 / valores) : 0;
+  LOGI(">> RAW: %lu blocos, %lu amostras x %u canais, %lu bytes (%lu.%02lu "
+       "bits/amostra), %lu perdidas",
+       (unsigned long)rawBlocos, (unsigned long)rawAmostras,
+       (unsigned)nCanais, (unsigned long)rawBytes,
+       (unsigned long)(bitsX100 / 100), (unsigned long)(bitsX100 % 100),
+       (unsigned long)rawCod.perdidas());
+}
+bool aplicarRaw(const char *cmd) {
+  if ((cmd[4] != '0' && cmd[4] != '1') || cmd[5] != 0) {
+    imprimir(">> RAW inválido. Use RAW=0 ou RAW=1.");
+    return false;
+  }
+  bool ligar = cmd[4] == '1';
+  if (ligar && !rawLigado) {
+    rawCod.reset(acqRateHz(), nCanais);
+    rawBlocos = rawAmostras = rawBytes = 0;
+    LOGI(">> RAW: todas as amostras a %u Hz x %u canais (BLE, binário)",
+         (unsigned)acqRateHz(), (unsigned)nCanais);
+    if (halBleConnected() &&
+        blePayloadMax(BLE_FLUXO_RAW) < RAW_CABECALHO_LEN + 32)
+      LOGI(">> RAW: MTU %u é pouco para os blocos (peça 247)",
+           (unsigned)halBleMtu());
+  } else if (!ligar && rawLigado) {
+    servirRaw(true);
+    mostrarRaw();
+  }
+  rawLigado = ligar;
+  return true;
+}
+bool aplicarEventos(const char *cmd) {
+  if ((cmd[4] != '0' && cmd[4] != '1') || cmd[5] != 0) {
+    imprimir(">> EVT inválido. Use EVT=0 ou EVT=1.");
+    return false;
+  }
+  bool ligar = cmd[4] == '1';
+  if (ligar && !evtLigado) {
+    evtEnviados = evtSemEspaco = 0;
+    imprimir(">> EVT: uma trama por piscadela em S (BLE, binário)");
+    if (halBleConnected() &&
+        blePayloadMax(BLE_FLUXO_EVT) < RT_FRAME_PISCADELA_LEN)
+      LOGI(">> EVT: MTU %u é pouco para as tramas (mínimo %d)",
+           (unsigned)halBleMtu(), RT_FRAME_PISCADELA_LEN + 3);
+  } else if (!ligar && evtLigado) {
+    LOGI(">> EVT: %lu tramas enviadas, %lu sem espaço no MTU",
+         (unsigned long)evtEnviados, (unsigned long)evtSemEspaco);
+  }
+  evtLigado = ligar;
+  return true;
+}
+// =================== CAPTURA USB (captura_usb.h) ===================
+static uint32_t capBaud = 0; // 0 = texto
+static void capLinhaLog(const char *linha, size_t n) { capTexto(linha, n); }
+static void mostrarCaptura() {
+  CapStats k;
+  capStats(k);
+  LOGI(">> CAP: %s, %lu registos (%lu bytes), %lu perdidos com a USB cheia",
+       capAtiva() ? "a capturar" : "desligada", (unsigned long)k.registos,
+       (unsigned long)k.bytes, (unsigned long)k.perdidos);
+}
+// CAP= não troca logo de velocidade: o que está no anel da captura (ou a
+// linha de texto que a anuncia) sai primeiro à velocidade atual, e isso
+// leva várias voltas. servirCaptura() avança uma vez por volta, depois do
+// logDrain/capDrain; ao fim de CAP_ESPERA_MS o resto perde-se (9600 baud).
+#define CAP_ESPERA_MS 2000
+static long capPedido = -1; // baud pedido (0 = texto); -1 = nada pendente
+static bool capAnunciada = false;
+static uint32_t capEsperaMs = 0;
+bool aplicarCaptura(const char *cmd) {
+  long v = cmd[4] >= '0' && cmd[4] <= '9' ? atol(cmd + 4) : -1;
+  if (v == 1)
+    v = CAP_BAUD_OMISSAO;
+  if (v != 0 && (v < 9600 || v > CAP_BAUD_MAX)) {
+    LOGI(">> CAP inválido. Use CAP=0, CAP=1 (%d baud) ou CAP=baud (9600-%d)",
+         CAP_BAUD_OMISSAO, CAP_BAUD_MAX);
+    return false;
+  }
+  capPedido = v;
+  capAnunciada = false;
+  capEsperaMs = halMillis();
+  return true;
+}
+static void servirCaptura() {
+  if (capPedido < 0)
+    return;
+  bool esgotou = halMillis() - capEsperaMs >= CAP_ESPERA_MS;
+  if (capAtiva()) {
+    if (capPendentes() && !esgotou)
+      return;
+    capParar();
+    logDesviar(nullptr);
+    if (capBaud != CAP_BAUD_TEXTO)
+      halConsoleSetBaud(CAP_BAUD_TEXTO);
+    capBaud = 0;
+    mostrarCaptura();
+    capEsperaMs = halMillis();
+    esgotou = false;
+  }
+  if (capPedido == 0) {
+    capPedido = -1;
+    return;
+  }
+  if (!capAnunciada) {
+    LOGI(">> CAP: captura binária a %ld baud (COBS, ver captura_usb.h); "
+         "CAP=0 volta ao texto",
+         capPedido);
+    capAnunciada = true;
+    return;
+  }
+  // esta linha ainda sai em texto, à velocidade antiga
+  if (logPendentes() && !esgotou)
+    return;
+  long v = capPedido;
+  capPedido = -1;
+  if (!halConsoleSetBaud((uint32_t)v))
+    v = CAP_BAUD_TEXTO; // CDC nativo: a velocidade não se escolhe
+  capBaud = (uint32_t)v;
+  capBegin(acqRateHz(), nCanais, capBaud);
+  logDesviar(capLinhaLog);
+}
+// =================== MODELO (classificador.h) ===================
+static void mostrarModelo() {
+  for (uint8_t m = 0; m < classificadorN(); m++)
+    LOGI(">> MDL=%u %s%s", (unsigned)m, classificadorNome(m),
+         m == classificadorAtual() ? " (atual)" : "");
+  static const char *const etapas[2] = {"piscadela", "janela"};
+  uint32_t porUs = halCiclosPorUs();
+  for (uint8_t e = 0; e < 2; e++) {
+    CustoInferencia k;
+    classificadorCusto(e, k);
+    if (k.n == 0)
+      continue;
+    uint32_t media = (uint32_t)(k.somaCiclos / k.n);
+    LOGI(">> %s: %lu inferências, %lu ciclos médio (%lu us), máx %lu, "
+         "%lu acima de %lu",
+         etapas[e], (unsigned long)k.n, (unsigned long)media,
+         (unsigned long)(media / porUs), (unsigned long)k.maxCiclos,
+         (unsigned long)k.acima,
+         (unsigned long)classificadorOrcamentoCiclos());
+  }
+}
+bool aplicarModelo(const char *cmd) {
+  int v = atoi(cmd + 4);
+  if (cmd[4] < '0' || cmd[4] > '9' || !classificadorSelecionar((uint8_t)v)) {
+    LOGI(">> MDL inválido. Use MDL=0..%u", (unsigned)(classificadorN() - 1));
+    return false;
+  }
+  LOGI(">> Modelo: %s", classificadorNome((uint8_t)v));
+  return true;
+}
+// =================== JANELAS (janelas.h) ===================
+static void mostrarJanelas() {
+  for (uint8_t h = 0; h < janelas.n(); h++) {
+    JanelaResumo r;
+    janelas.resumo(h, r);
+    LOGI(">> Janela %u s (%s%lu s cobertos): normais %lu (%.1f/min, %.0f ms, "
+         "amp %.0f)",
+         (unsigned)r.horizonteS, r.cheia ? "" : "só ",
+         (unsigned long)(r.cobertoMs / 1000), (unsigned long)r.normais,
+         r.normaisMin, r.durNormaisMs, r.ampNormais);
+    LOGI("   lentas %lu (%.1f/min, %.0f ms, amp %.0f), IBI médio %.0f ms%s",
+         (unsigned long)r.lentas, r.lentasMin, r.durLentasMs, r.ampLentas,
+         r.ibiMs, alertaJanela[h] ? ", CANSAÇO" : "");
+  }
+}
+bool aplicarJanelas(const char *cmd) {
+  uint16_t hs[JANELAS_MAX];
+  uint8_t n = 0;
+  const char *p = cmd + 4;
+  while (n < JANELAS_MAX && *p >= '0' && *p <= '9') {
+    char *fim;
+    long v = strtol(p, &fim, 10);
+    hs[n++] = (uint16_t)(v > 0xFFFF ? 0xFFFF : v);
+    p = *fim == ',' ? fim + 1 : fim;
+  }
+  if (*p != 0 || !janelas.configurar(hs, n)) {
+    LOGI(">> JAN inválido. Use JAN=s1[,s2[,s3]] (%d-%d s cada)",
+         JANELA_MIN_S, JANELA_MAX_S);
+    return false;
+  }
+  // as somas antigas eram de outros horizontes: recomeçam vazias
+  janelas.begin(halMillis());
+  memset(alertaJanela, 0, sizeof(alertaJanela));
+  memset(baldesSemSono, 0, sizeof(baldesSemSono));
+  char linha[48];
+  int k = snprintf(linha, sizeof(linha), ">> Janelas:");
+  for (uint8_t h = 0; h < n; h++)
+    k += snprintf(linha + k, sizeof(linha) - k, " %u s", (unsigned)hs[h]);
+  imprimir(linha);
+  return true;
+}
+static void mostrarLatencia(uint8_t m) {
+  const LatenciaModo &l = agendadorLatencia(m);
+  if (l.voltas == 0)
+    return;
+  LOGI(">> Loop em %s: %lu voltas, intervalo médio %lu us, pior %lu us, "
+       "trabalho pior %lu us",
+       modos[m].nome, (unsigned long)l.voltas,
+       (unsigned long)(l.somaIntervaloUs / l.voltas),
+       (unsigned long)l.maxIntervaloUs, (unsigned long)l.maxTrabalhoUs);
+}
+// com um modo a correr, o pedido arranca quando ele acabar (ou com X)
+static CmdEstado pedirModo(uint8_t m) {
+  agendadorPedir(m);
+  if (agendadorModo() == MODO_IDLE)
+    return CMD_OK;
+  LOGI(">> %s começa quando %s acabar (ou com X).", modos[m].nome,
+       modos[agendadorModo()].nome);
+  return CMD_EM_ESPERA;
+}
+static CmdEstado pedirDescarga(const char *cmd) {
+  dlSessaoPedida = cmd[2] == '=' ? (uint16_t)atoi(cmd + 3) : 0;
+  return pedirModo(MODO_D);
+}
+static CmdEstado pedirTput(const char *cmd) {
+  int v = cmd[4] == '=' ? atoi(cmd + 5) : TPUT_SEG_OMISSAO;
+  if (v < 1 || v > TPUT_SEG_MAX) {
+    LOGI(">> TPUT inválido. Use TPUT ou TPUT=1..%d (s)", TPUT_SEG_MAX);
+    return CMD_INVALIDO;
+  }
+  tputSeg = (uint8_t)v;
+  return pedirModo(MODO_T);
+}
+static CmdEstado pedirBench(const char *cmd) {
+  int v = cmd[5] == '=' ? atoi(cmd + 6) : BENCH_SEG_OMISSAO;
+  if (v < 1 || v > BENCH_SEG_MAX) {
+    LOGI(">> BENCH inválido. Use BENCH ou BENCH=1..%d (s)", BENCH_SEG_MAX);
+    return CMD_INVALIDO;
+  }
+  benchSeg = (uint16_t)v;
+  return pedirModo(MODO_B);
+}
+// =================== PERFIS (PF, HORA=) ===================
+static void mostrarPerfis() {
+  LOGI(">> Utilizador ativo: %u (PF=1..%d muda)", (unsigned)perfilAtivo(),
+       PERFIS_MAX);
+  for (uint8_t u = 1; u <= PERFIS_MAX; u++) {
+    PerfilCal p;
+    if (!perfilLer(u, p, nCanais))
+      continue;
+    char quando[24] = "sem hora";
+    if (p.epoch) {
+      time_t t = (time_t)p.epoch;
+      struct tm tm;
+      gmtime_r(&t, &tm);
+      strftime(quando, sizeof(quando), "%Y-%m-%d %H:%M UTC", &tm);
     }
-    if (agora - tempoAnteriorSeg >= 1000) {
-      int segundos = (agora - tempoInicio) / 1000;
-      imprimir("Tempo: " + String(segundos) + "s");
-      tempoAnteriorSeg = agora;
+    char bpm[16] = "sem P";
+    if (p.temBpm)
+      snprintf(bpm, sizeof(bpm), "%.1f bpm", p.baselineBpm);
+    LOGI(">> PF=%u%s: %s, %u calibrações a %u Hz, %s", (unsigned)u,
+         u == perfilAtivo() ? " (ativo)" : "", quando,
+         (unsigned)p.calibracoes, (unsigned)p.fsHz, bpm);
+    for (uint8_t c = 0; c < p.nCanais; c++) {
+      const PerfilCanal &pc = p.canal[c];
+      LOGI("   canal %u: baseline %.1f, sigma %.2f, amp máx %d, "
+           "limiarInferior %d, AMPLITUDE_MIN %d/%d",
+           (unsigned)c, pc.baseline, pc.sigma, (int)pc.ampMax,
+           (int)pc.limiarInferior, (int)pc.amplitudeMin,
+           (int)pc.amplitudeMinLenta);
     }
-    if (!emEvento && leitura < limiarInferior) {
-      emEvento = true;
-      eventoIndex = 0;
+  }
+}
+// PF=n: muda de utilizador e põe o perfil dele à prova (sem perfil, fica
+// com os limiares atuais até C e P)
+static CmdEstado pedirPerfil(const char *cmd) {
+  int v = atoi(cmd + 3);
+  if (cmd[3] < '0' || cmd[3] > '9' || !perfilDefinirAtivo((uint8_t)v)) {
+    LOGI(">> PF inválido. Use PF=1..%d", PERFIS_MAX);
+    return CMD_INVALIDO;
+  }
+  lerPerfil();
+  if (!temPerfil) {
+    LOGI(">> Utilizador %d sem perfil: C e P para calibrar.", v);
+    return CMD_OK;
+  }
+  return pedirModo(MODO_V);
+}
+// HORA=epoch: hora UTC (s desde 1970) para a data dos perfis
+static bool aplicarHora(const char *cmd) {
+  if (cmd[5] < '0' || cmd[5] > '9') {
+    imprimir(">> HORA inválida. Use HORA=segundos desde 1970 (UTC)");
+    return false;
+  }
+  halSetEpoch((uint32_t)strtoul(cmd + 5, nullptr, 10));
+  LOGI(">> Hora acertada: %lu", (unsigned long)halEpoch());
+  return true;
+}
+// ligação nova: mostra o que a central aceitou, depois de lhe dar tempo
+// para responder aos pedidos da HAL (MTU, DLE, PHY, intervalo)
+#define BLE_RELATORIO_MS 2000
+static bool bleLigadoAntes[HAL_BLE_LIGACOES_MAX];
+static bool bleRelatado[HAL_BLE_LIGACOES_MAX];
+static uint32_t bleLigadoMs[HAL_BLE_LIGACOES_MAX];
+static void servirLigacaoBle() {
+  for (uint8_t i = 0; i < HAL_BLE_LIGACOES_MAX; i++) {
+    bool ligado = halBleLigada(i);
+    if (ligado && !bleLigadoAntes[i]) {
+      bleLigadoMs[i] = halMillis();
+      bleRelatado[i] = false;
     }
-    if (emEvento) {
-      if (eventoIndex < MAX_EVENTO) {
-        valoresEvento[eventoIndex] = leitura;
-        temposEvento[eventoIndex] = agora;
-        eventoIndex++;
-      }
-      if (leitura >= limiarInferior || eventoIndex >= MAX_EVENTO) {
-        emEvento = false;
-        int valorInicio = valoresEvento[0];
-        unsigned long tempoInicioEvento = temposEvento[0];
-        int pico = valorInicio;
-        unsigned long tempoPico = tempoInicioEvento;
-        for (int i = 1; i < eventoIndex; i++) {
-          if (valoresEvento[i] < pico) {
-            pico = valoresEvento[i];
-            tempoPico = temposEvento[i];
-          }
-        }
-        float deltaValor = abs(pico - valorInicio);
-        float deltaTempo = (float)(tempoPico - tempoInicioEvento);
-        float derivada = deltaTempo > 0 ? deltaValor / deltaTempo : 0;
-        if (derivada >= LIMIAR_DERIVADA && deltaTempo >= DURACAO_MIN &&
-            deltaTempo <= DURACAO_MAX && deltaValor >= AMPLITUDE_MIN) {
-          contagemBlinksNormais++;
-          somaDuracoesNormais += (unsigned long)deltaTempo;
-          somaAmplitudesNormais += (unsigned long)deltaValor;
-          currentMinuteNormal++;
-          imprimir("✓ Piscadela NORMAL detetada");
-        } else if (derivada < DERIVADA_LENTA_MAX &&
-                   deltaTempo >= DURACAO_LENTA_MIN &&
-                   deltaTempo <= DURACAO_LENTA_MAX &&
-                   deltaValor >= AMPLITUDE_MIN_LENTA) {
-          contagemBlinksLentos++;
-          somaDuracoesLentas += (unsigned long)deltaTempo;
-          somaAmplitudesLentas += (unsigned long)deltaValor;
-          currentMinuteSlow++;
-          imprimir("⚠ Piscadela LENTA (SONOLÊNCIA) detetada");
-        }
-      }
+    bleLigadoAntes[i] = ligado;
+    if (ligado && !bleRelatado[i] &&
+        halMillis() - bleLigadoMs[i] >= BLE_RELATORIO_MS) {
+      bleRelatado[i] = true;
+      mostrarLigacaoBle(i);
     }
-    delay(10);
   }
 }
-// =================== COMMAND HANDLER (CORRIGIDO) ===================
-void handleCommand(const String &cmdRaw) {
-  String cmd = cmdRaw;
-  cmd.trim();
-  if (cmd.length() == 0)
+static void mostrarDsp() {
+  static const char *nomes[] = {"média", "FIR", "FIR+IIR", "FIR+IIR+base"};
+  LOGI(">> DSP: %u canais, FS=%u Hz, OS=%u (ADC a %lu Hz por canal), "
+       "FLT=%u %s, FIR de %u taps",
+       (unsigned)acqCanais(), (unsigned)acqRateHz(), (unsigned)acqOs(),
+       (unsigned long)acqRateHz() * acqOs(), (unsigned)acqDspModo(),
+       nomes[acqDspModo()], (unsigned)acqDspTaps());
+  reportarCustoAcq();
+}
+static void mostrarGravador() {
+  RecInfo info;
+  recInfo(info);
+  if (info.blocos == 0) {
+    imprimir(">> Gravador: sem partição de flash.");
+    return;
+  }
+  LOGI(">> Gravador: %lu/%lu blocos de %u B, última sessão %u%s, "
+       "%lu blocos perdidos",
+       (unsigned long)info.usados, (unsigned long)info.blocos,
+       (unsigned)REC_BLOCO_BYTES, (unsigned)info.sessao,
+       info.aGravar ? " (a gravar)" : "", (unsigned long)info.falhas);
+}
+// latência dos comandos: da receção (cmdPush) ao fim da execução
+static uint32_t cmdExecutados = 0;
+static uint64_t cmdSomaLatUs = 0;
+static uint32_t cmdMaxLatUs = 0;
+static void mostrarLatenciaComandos() {
+  if (cmdExecutados == 0)
+    return;
+  LOGI(">> Comandos: %lu, receção -> execução média %lu us, pior %lu us, "
+       "%lu perdidos (fila cheia)",
+       (unsigned long)cmdExecutados,
+       (unsigned long)(cmdSomaLatUs / cmdExecutados),
+       (unsigned long)cmdMaxLatUs, (unsigned long)cmdDescartados());
+}
+// =================== SEQ, SYNC E SUB ===================
+// SEQ=1 põe o envelope de ligação (seq + µs) em todas as notificações;
+// SYNC=id responde com t1 (chegada do pedido) e t2 (saída da resposta) para
+// a app acertar o relógio dela com o do dispositivo; SUB=máscara escolhe os
+// fluxos. Valem só para a central que os mandou (da consola: para todas).
+static uint32_t cmdAtualRxUs = 0; // halMicros() na receção do comando atual
+static uint8_t cmdAtualOrigem = CMD_CONSOLA;
+static uint8_t cmdAtualLigacao = 0;
+// um bit por ligação
+static uint8_t ligacoesDoComando() {
+  if (cmdAtualOrigem == CMD_BLE)
+    return (uint8_t)(1u << cmdAtualLigacao);
+  return (uint8_t)((1u << HAL_BLE_LIGACOES_MAX) - 1);
+}
+static bool aplicarSeq(const char *cmd) {
+  if ((cmd[4] != '0' && cmd[4] != '1') || cmd[5] != 0) {
+    imprimir(">> SEQ inválido. Use SEQ=0 ou SEQ=1.");
+    return false;
+  }
+  bool ligar = cmd[4] == '1';
+  uint8_t alvo = ligacoesDoComando();
+  for (uint8_t i = 0; i < HAL_BLE_LIGACOES_MAX; i++)
+    if (alvo & (1u << i))
+      bleTxSetEnvelope(i, ligar);
+  LOGI(">> SEQ: envelope de ligação (seq + µs) %s",
+       ligar ? "em todas as notificações" : "desligado");
+  if (ligar && halBleConnected() && halBleMtu() < 23 + RT_FRAME_LIGACAO_LEN +
+                                                       RT_FRAME_PISCADELA_LEN)
+    LOGI(">> SEQ: com MTU %u as tramas maiores não cabem (peça 247)",
+         (unsigned)halBleMtu());
+  return true;
+}
+static bool responderSync(const char *cmd) {
+  long id = cmd[4] == '=' ? atol(cmd + 5) : 0;
+  if (id < 0 || id > 0xFFFF) {
+    imprimir(">> SYNC inválido. Use SYNC=id (0-65535).");
+    return false;
+  }
+  // t1 no relógio de 64 bits: agora menos o que o pedido esperou na fila
+  uint64_t t1 = halMicros64() - (uint32_t)(halMicros() - cmdAtualRxUs);
+  BleTxStats st;
+  bool ble = cmdAtualOrigem == CMD_BLE &&
+             bleTxGetStatsLigacao(cmdAtualLigacao, st);
+  if (!ble) {
+    bleTxGetStats(st);
+    LOGI(">> SYNC #%ld: t1 %llu us, %lu mensagens, %lu descartadas, %lu "
+         "recusadas",
+         id, (unsigned long long)t1, (unsigned long)st.seq,
+         (unsigned long)(st.descartadas + st.semEspaco),
+         (unsigned long)st.falhadas);
+    return true;
+  }
+  uint8_t trama[RT_FRAME_SYNC_CONTADORES_LEN];
+  size_t len = rtMontarSync(trama, bleTxPayloadMaxLigacao(cmdAtualLigacao),
+                            (uint16_t)id, t1, st.seq,
+                            st.descartadas + st.semEspaco, st.falhadas);
+  if (len == 0)
+    return false;
+  if (bleTxPushPara(cmdAtualLigacao, BLE_TX_SYNC, trama, len))
+    halBleTxKick();
+  return true;
+}
+static const char *const nomesFluxos[] = {"texto", "RT",  "minuto",
+                                          "EVT",   "RAW", "dados"};
+static void mostrarSubscricoes() {
+  if (!halBleConnected()) {
+    imprimir(">> SUB: sem ligação BLE.");
+    return;
+  }
+  for (uint8_t i = 0; i < HAL_BLE_LIGACOES_MAX; i++) {
+    if (!halBleLigada(i))
+      continue;
+    uint8_t f = bleTxFluxos(i);
+    char linha[80];
+    int n = snprintf(linha, sizeof(linha), ">> SUB %u = %u:", (unsigned)i,
+                     (unsigned)f);
+    for (uint8_t b = 0; b < 6; b++)
+      if (f & (1u << b))
+        n += snprintf(linha + n, sizeof(linha) - n, " %s", nomesFluxos[b]);
+    imprimir(linha);
+  }
+}
+static bool aplicarSubscricao(const char *cmd) {
+  int v = atoi(cmd + 4);
+  if (cmd[4] < '0' || cmd[4] > '9' || v > BLE_FLUXOS_TODOS) {
+    LOGI(">> SUB inválido. Use SUB=máscara (0-%d): 1 texto, 2 RT, 4 minuto, "
+         "8 EVT, 16 RAW, 32 dados",
+         BLE_FLUXOS_TODOS);
+    return false;
+  }
+  uint8_t alvo = ligacoesDoComando();
+  for (uint8_t i = 0; i < HAL_BLE_LIGACOES_MAX; i++)
+    if (alvo & (1u << i))
+      bleTxSubscrever(i, (uint8_t)v);
+  mostrarSubscricoes();
+  return true;
+}
+// =================== PERFIL (perfil.h) ===================
+// STATS mostra o que foi medido desde o último zerar (arranque, STATS=1,
+// FS= ou OS=/FLT=); o ritmo real conta as amostras que saíram do DSP
+static uint32_t statsT0Us = 0;
+static uint32_t statsAmostras0 = 0;
+static uint32_t statsAtrasos0 = 0;
+static uint32_t statsPerdidas0 = 0;
+// TLM=s: trama RT_FRAME_TYPE_STATS a cada s segundos (0 = desligado)
+#define TLM_MAX_S 60
+static uint8_t tlmSeg = 0;
+static uint32_t tlmUltimoMs = 0;
+static void statsZerar() {
+  perfZerar();
+  statsT0Us = halMicros();
+  statsAmostras0 = acqAmostrasTotal();
+  statsAtrasos0 = acqAtrasos();
+  statsPerdidas0 = acqOverruns();
+}
+static void statsResumo(PerfResumo &r) {
+  uint32_t dtUs = halMicros() - statsT0Us;
+  uint32_t n = acqAmostrasTotal() - statsAmostras0;
+  r.fsX10 = dtUs ? (uint32_t)((uint64_t)n * 10000000ULL / dtUs) : 0;
+  r.atrasos = acqAtrasos() - statsAtrasos0;
+  r.perdidas = acqOverruns() - statsPerdidas0;
+  r.heapLivre = halHeapLivre();
+  r.heapMaiorBloco = halHeapMaiorBloco();
+}
+static void mostrarStats() {
+  PerfResumo r;
+  statsResumo(r);
+  LOGI(">> STATS (%lu ms): fs real %lu.%lu Hz de %u, %lu ticks atrasados, "
+       "%lu amostras perdidas",
+       (unsigned long)((halMicros() - statsT0Us) / 1000),
+       (unsigned long)(r.fsX10 / 10), (unsigned long)(r.fsX10 % 10),
+       (unsigned)acqRateHz(), (unsigned long)r.atrasos,
+       (unsigned long)r.perdidas);
+  if (r.heapLivre)
+    LOGI(">> Heap: %lu B livres, maior bloco %lu B",
+         (unsigned long)r.heapLivre, (unsigned long)r.heapMaiorBloco);
+  else
+    imprimir(">> Heap: n/d");
+  if (!perfLigado) {
+    imprimir(">> Perfil desligado (STATS=1 liga).");
+    return;
+  }
+  imprimir(">> etapa           n     mín     méd     máx us | <1 <4 <16 "
+           "<64 <256 <1m <4m >4m");
+  for (uint8_t e = 0; e < PERF_N; e++) {
+    PerfEstat st;
+    perfLer((PerfEtapa)e, st);
+    if (st.n == 0)
+      continue;
+    uint32_t mn = perfCiclosParaDecUs(st.minCiclos);
+    uint32_t md = perfCiclosParaDecUs(st.somaCiclos / st.n);
+    uint32_t mx = perfCiclosParaDecUs(st.maxCiclos);
+    LOGI(">> %-8s %8lu %5lu.%lu %5lu.%lu %5lu.%lu    | %lu %lu %lu %lu %lu "
+         "%lu %lu %lu",
+         perfNome((PerfEtapa)e), (unsigned long)st.n,
+         (unsigned long)(mn / 10), (unsigned long)(mn % 10),
+         (unsigned long)(md / 10), (unsigned long)(md % 10),
+         (unsigned long)(mx / 10), (unsigned long)(mx % 10),
+         (unsigned long)st.hist[0], (unsigned long)st.hist[1],
+         (unsigned long)st.hist[2], (unsigned long)st.hist[3],
+         (unsigned long)st.hist[4], (unsigned long)st.hist[5],
+         (unsigned long)st.hist[6], (unsigned long)st.hist[7]);
+  }
+}
+bool aplicarStats(const char *cmd) {
+  if ((cmd[6] != '0' && cmd[6] != '1') || cmd[7] != 0) {
+    imprimir(">> STATS inválido. Use STATS, STATS=0 ou STATS=1.");
+    return false;
+  }
+  perfLigado = cmd[6] == '1';
+  statsZerar();
+  LOGI(">> Perfil: %s", perfLigado ? "ligado (zerado)" : "desligado");
+  return true;
+}
+bool aplicarTelemetria(const char *cmd) {
+  int v = atoi(cmd + 4);
+  if (cmd[4] >= '0' && cmd[4] <= '9' && v <= TLM_MAX_S) {
+    tlmSeg = (uint8_t)v;
+    tlmUltimoMs = halMillis();
+    if (v)
+      LOGI(">> Telemetria STATS a cada %d s (BLE, binário)", v);
+    else
+      imprimir(">> Telemetria STATS desligada.");
+    return true;
+  }
+  LOGI(">> TLM inválido. Use TLM=0 (desligado) .. TLM=%d s", TLM_MAX_S);
+  return false;
+}
+static void servirTelemetria() {
+  if (tlmSeg == 0 || !halBleConnected())
+    return;
+  uint32_t agora = halMillis();
+  if (agora - tlmUltimoMs < tlmSeg * 1000UL)
     return;
+  tlmUltimoMs = agora;
+  PerfResumo r;
+  statsResumo(r);
+  uint8_t trama[RT_FRAME_MAX_LEN];
+  size_t max = blePayloadMax(BLE_FLUXO_DADOS);
+  size_t len = perfMontarTrama(trama, max < sizeof(trama) ? max : sizeof(trama),
+                               r);
+  if (len)
+    bleSendFrame(BLE_FLUXO_DADOS, trama, len);
+}
+// =================== COMMAND HANDLER (CORRIGIDO) ===================
+// corre só no loop() (as mensagens chegam pela fila de comandos)
+CmdEstado handleCommand(const char *cmdRaw) {
+  // trim
+  while (*cmdRaw == ' ' || *cmdRaw == '\t')
+    cmdRaw++;
+  char cmd[CMD_MSG_MAX];
+  size_t n = strlen(cmdRaw);
+  if (n >= sizeof(cmd))
+    n = sizeof(cmd) - 1;
+  while (n > 0 && (cmdRaw[n - 1] == ' ' || cmdRaw[n - 1] == '\t' ||
+                   cmdRaw[n - 1] == '\r' || cmdRaw[n - 1] == '\n'))
+    n--;
+  memcpy(cmd, cmdRaw, n);
+  cmd[n] = 0;
+  if (n == 0)
+    return CMD_VAZIO;
+  bool uma = n == 1; // comandos de uma letra
   //!!! X : PRIORIDADE MÁXIMA E IMEDIATA !!!
-  if (cmd == "X" || cmd == "x") {
-    abortRequested = true;
+  // (o recetor já levantou abortRequested ao recebê-lo)
+  if (uma && (cmd[0] == 'X' || cmd[0] == 'x')) {
     imprimir(">> X recebido: a sair do ciclo atual e voltar ao idle.");
-    return;
+    return CMD_OK;
   }
   //!!! C, P, S : AGENDADOS PARA O LOOP (NÃO BLOQUEIAM O BLUETOOTH) !!!
-  if (cmd == "C" || cmd == "c") {
-    commandToRun = "C";
-  } else if (cmd == "P" || cmd == "p") {
-    commandToRun = "P";
-  } else if (cmd == "S" || cmd == "s") {
-    commandToRun = "S";
-  } else if (cmd.startsWith("TH=") || cmd.startsWith("th=")) {
-    aplicarThresholdManual(cmd);
+  bool ok = true;
+  if (uma && (cmd[0] == 'C' || cmd[0] == 'c')) {
+    return pedirModo(MODO_C);
+  } else if (uma && (cmd[0] == 'P' || cmd[0] == 'p')) {
+    return pedirModo(MODO_P);
+  } else if (uma && (cmd[0] == 'S' || cmd[0] == 's')) {
+    return pedirModo(MODO_S);
+  } else if (ehThreshold(cmd)) {
+    ok = aplicarThresholdManual(cmd);
+  } else if (comecaPor(cmd, "FS=")) {
+    ok = aplicarTaxaAmostragem(cmd);
+  } else if (comecaPor(cmd, "RTB=")) {
+    ok = aplicarRTBinario(cmd);
+  } else if (comecaPor(cmd, "RTA=")) {
+    ok = aplicarRTAdaptativo(cmd);
+  } else if (comecaPor(cmd, "LOG=")) {
+    ok = aplicarNivelLog(cmd);
+  } else if (comecaPor(cmd, "OS=")) {
+    ok = aplicarSobreAmostragem(cmd);
+  } else if (comecaPor(cmd, "FLT=")) {
+    ok = aplicarFiltro(cmd);
+  } else if (comecaPor(cmd, "CH=")) {
+    ok = aplicarCanais(cmd);
+  } else if (comecaPor(cmd, "ACK=") && (cmd[4] == '0' || cmd[4] == '1')) {
+    acksTexto = cmd[4] == '1';
+    LOGI(">> ACK dos comandos de texto: %s", acksTexto ? "sim" : "não");
+  } else if (n == 3 && comecaPor(cmd, "DSP")) {
+    mostrarDsp();
+  } else if (comecaPor(cmd, "DL") && (n == 2 || cmd[2] == '=')) {
+    return pedirDescarga(cmd);
+  } else if (comecaPor(cmd, "TPUT") && (n == 4 || cmd[4] == '=')) {
+    return pedirTput(cmd);
+  } else if (n == 3 && comecaPor(cmd, "BLE")) {
+    mostrarLigacaoBle();
+  } else if (n == 3 && comecaPor(cmd, "REC")) {
+    mostrarGravador();
+  } else if (n == 3 && comecaPor(cmd, "LAT")) {
+    for (uint8_t m = 0; m < NUM_MODOS; m++)
+      mostrarLatencia(m);
+    mostrarLatenciaComandos();
+  } else if (n == 5 && comecaPor(cmd, "STATS")) {
+    mostrarStats();
+  } else if (comecaPor(cmd, "STATS=")) {
+    ok = aplicarStats(cmd);
+  } else if (comecaPor(cmd, "TLM=")) {
+    ok = aplicarTelemetria(cmd);
+  } else if (comecaPor(cmd, "RAW=")) {
+    ok = aplicarRaw(cmd);
+  } else if (comecaPor(cmd, "EVT=")) {
+    ok = aplicarEventos(cmd);
+  } else if (n == 3 && comecaPor(cmd, "CAP")) {
+    mostrarCaptura();
+  } else if (comecaPor(cmd, "CAP=")) {
+    ok = aplicarCaptura(cmd);
+  } else if (n == 3 && comecaPor(cmd, "MDL")) {
+    mostrarModelo();
+  } else if (comecaPor(cmd, "MDL=")) {
+    ok = aplicarModelo(cmd);
+  } else if (n == 3 && comecaPor(cmd, "JAN")) {
+    mostrarJanelas();
+  } else if (comecaPor(cmd, "JAN=")) {
+    ok = aplicarJanelas(cmd);
+  } else if (n == 2 && comecaPor(cmd, "PF")) {
+    mostrarPerfis();
+  } else if (comecaPor(cmd, "PF=")) {
+    return pedirPerfil(cmd);
+  } else if (comecaPor(cmd, "HORA=")) {
+    ok = aplicarHora(cmd);
+  } else if (n == 3 && comecaPor(cmd, "SUB")) {
+    mostrarSubscricoes();
+  } else if (comecaPor(cmd, "SUB=")) {
+    ok = aplicarSubscricao(cmd);
+  } else if (comecaPor(cmd, "SEQ=")) {
+    ok = aplicarSeq(cmd);
+  } else if (comecaPor(cmd, "SYNC") && (n == 4 || cmd[4] == '=')) {
+    ok = responderSync(cmd);
+  } else if (comecaPor(cmd, "BENCH") && (n == 5 || cmd[5] == '=')) {
+    return pedirBench(cmd);
+  } else if (n == 4 && comecaPor(cmd, "PING")) {
+    // só o ACK
   } else {
-    imprimir("Comando desconhecido. Use C, P, S, X ou TH=valor.");
-  }
-}
-// =================== BLE CALLBACKS ===================
-class ServerCB : public NimBLEServerCallbacks {
-public:
-  void onConnect(NimBLEServer *pServer) {
-    (void)pServer;
-    bleConnected = true;
-    imprimir("[BLE] Conectado.");
-  }
-  void onDisconnect(NimBLEServer *pServer) {
-    (void)pServer;
-    bleConnected = false;
-    imprimir("[BLE] Desconectado. A anunciar de novo...");
-    if (adv)
-      adv->start();
-  }
-  void onConnect(NimBLEServer *pServer, ble_gap_conn_desc *desc) {
-    (void)pServer;
-    (void)desc;
-    bleConnected = true;
-    imprimir("[BLE] Conectado.");
-  }
-  void onDisconnect(NimBLEServer *pServer, ble_gap_conn_desc *desc) {
-    (void)pServer;
-    (void)desc;
-    bleConnected = false;
-    imprimir("[BLE] Desconectado. A anunciar de novo...");
-    if (adv)
-      adv->start();
-  }
-  void onConnect(NimBLEServer *pServer, NimBLEConnInfo &connInfo) {
-    (void)pServer;
-    (void)connInfo;
-    bleConnected = true;
-    imprimir("[BLE] Conectado.");
-  }
-  void onDisconnect(NimBLEServer *pServer, NimBLEConnInfo &connInfo,
-                    int reason) {
-    (void)pServer;
-    (void)connInfo;
-    (void)reason;
-    bleConnected = false;
-    imprimir("[BLE] Desconectado. A anunciar de novo...");
-    if (adv)
-      adv->start();
+    imprimir("Comando desconhecido. Use C, P, S, X, TH=, FS=, OS=, FLT=, "
+             "RTB=, RTA=, RAW=, EVT=, CAP[=], LOG=, ACK=, DL, REC, DSP, LAT, "
+             "STATS[=0/1], TLM=, JAN[=], MDL[=], PF[=], HORA=, BLE, SUB[=], "
+             "SEQ=, SYNC[=], BENCH[=] ou TPUT.");
+    return CMD_DESCONHECIDO;
   }
-};
-class RxCB : public NimBLECharacteristicCallbacks {
-public:
-  void onWrite(NimBLECharacteristic *c) { handleWrite(c); }
-  void onWrite(NimBLECharacteristic *c, NimBLEConnInfo & /*connInfo*/) {
-    handleWrite(c);
+  return ok ? CMD_OK : CMD_INVALIDO;
+}
+// =================== FILA DE COMANDOS (cmd_fila.h) ===================
+static void executarComando(const CmdMsg &m) {
+  char texto[CMD_MSG_MAX];
+  uint8_t op = 0;
+  CmdEstado estado;
+  cmdAtualRxUs = m.rxUs;
+  cmdAtualOrigem = m.origem;
+  cmdAtualLigacao = m.ligacao;
+  if (m.binario) {
+    op = m.data[5];
+    estado = cmdBinarioParaTexto(m.data, m.len, texto, sizeof(texto))
+                 ? handleCommand(texto)
+                 : CMD_DESCONHECIDO;
+  } else {
+    estado = handleCommand((const char *)m.data);
   }
-
-private:
-  void handleWrite(NimBLECharacteristic *c) {
-    std::string v = c->getValue();
-    if (v.empty())
-      return;
-    // Apanha X sem bloquear, mas deixa o resto para o parser
-    for (char ch : v) {
-      if (ch == 'x' || ch == 'X') {
-        abortRequested = true;
-      }
-    }
-    bool hadNewline = false;
-    for (char ch : v) {
-      if (ch == '\n') {
-        hadNewline = true;
-        handleCommand(bleCmdBuf);
-        bleCmdBuf = "";
-      } else if (ch != '\r') {
-        bleCmdBuf += ch;
-      }
-    }
-    if (!hadNewline) {
-      handleCommand(bleCmdBuf);
-      bleCmdBuf = "";
+  if (estado == CMD_VAZIO)
+    return;
+  uint32_t latUs = halMicros() - m.rxUs;
+  cmdExecutados++;
+  cmdSomaLatUs += latUs;
+  if (latUs > cmdMaxLatUs)
+    cmdMaxLatUs = latUs;
+  if (m.origem == CMD_CONSOLA) {
+    LOGD(">> ACK #%u estado %u, %lu us", (unsigned)m.seq, (unsigned)estado,
+         (unsigned long)latUs);
+  } else if (m.binario || acksTexto) {
+    uint8_t ack[CMD_ACK_LEN];
+    if (bleTxPushPara(m.ligacao, BLE_TX_FRAME, ack,
+                      cmdMontarAck(ack, m.seq, op, estado, latUs)))
+      halBleTxKick();
+  }
+}
+// =================== BLE RX ===================
+// só enfileira: o comando é executado pelo loop()
+void bleRxBytes(uint8_t ligacao, const uint8_t *data, size_t len) {
+  if (ligacao >= HAL_BLE_LIGACOES_MAX)
+    return;
+  if (len >= CMD_BIN_CABECALHO_LEN && data[0] == RT_FRAME_MAGIC &&
+      data[2] == RT_FRAME_TYPE_CMD) {
+    if (data[5] == CMD_OP_X)
+      abortRequested = true;
+    cmdPush(CMD_BLE, ligacao, data, len, true);
+    return;
+  }
+  char *buf = bleCmdBuf[ligacao];
+  size_t &n = bleCmdLen[ligacao];
+  // Apanha X sem bloquear, mas deixa o resto para o parser
+  for (size_t i = 0; i < len; i++) {
+    if (data[i] == 'x' || data[i] == 'X')
+      abortRequested = true;
+  }
+  bool hadNewline = false;
+  for (size_t i = 0; i < len; i++) {
+    char ch = (char)data[i];
+    if (ch == '\n') {
+      hadNewline = true;
+      cmdPush(CMD_BLE, ligacao, (const uint8_t *)buf, n, false);
+      n = 0;
+    } else if (ch != '\r' && n < CMD_MSG_MAX - 1) {
+      buf[n++] = ch;
     }
   }
-};
-void setupBLE() {
-#if !ENABLE_SPP
-  esp_bt_controller_mem_release(ESP_BT_MODE_CLASSIC_BT);
-#endif
-  NimBLEDevice::init("EOG-Calibracao");
-  NimBLEDevice::setMTU(128);
-  NimBLEDevice::setPower(ESP_PWR_LVL_P9);
-  NimBLEServer *server = NimBLEDevice::createServer();
-  server->setCallbacks(new ServerCB());
-  NimBLEService *svc = server->createService(SERVICE_UUID);
-  txChar = svc->createCharacteristic(TX_UUID, NIMBLE_PROPERTY::NOTIFY);
-  NimBLECharacteristic *rxChar = svc->createCharacteristic(
-      RX_UUID, NIMBLE_PROPERTY::WRITE | NIMBLE_PROPERTY::WRITE_NR);
-  rxChar->setCallbacks(new RxCB());
-  svc->start();
-  adv = NimBLEDevice::getAdvertising();
-  adv->reset();
-  NimBLEAdvertisementData advData;
-  advData.setFlags(0x06);
-  advData.setCompleteServices(NimBLEUUID(SERVICE_UUID));
-  adv->setAdvertisementData(advData);
-  NimBLEAdvertisementData scanData;
-  scanData.setName("EOG-Calibracao");
-  adv->setScanResponseData(scanData);
-  adv->start();
-  imprimir("[BLE] A anunciar (Nome + UART UUID)...");
+  if (!hadNewline) {
+    cmdPush(CMD_BLE, ligacao, (const uint8_t *)buf, n, false);
+    n = 0;
+  }
 }
 void setup() {
-  Serial.begin(115200);
-  delay(200);
-#if ENABLE_SPP
-  SerialBT.begin("EOG-Calibracao");
-#endif
+  halConsoleBegin(115200);
+  halDelayMs(200);
+  perfBegin(); // antes do timer da aquisição
   // ADICIONADO: ADC por pino (NÃO global — EOG e acelerómetro precisam de
   // atenuações diferentes)
-  analogReadResolution(12);
-  analogSetPinAttenuation(sensorPin, ADC_11db); // EOG pin 36: lê até 3.3V
-  analogSetPinAttenuation(PIN_X, ADC_0db);      // Acelerómetro: lê até ~1.1V
-  analogSetPinAttenuation(PIN_Y, ADC_0db);
-  analogSetPinAttenuation(PIN_Z, ADC_0db);
-  setupBLE();
+  halAdcBegin();
+  halAdcConfigPin(sensorPin, HAL_ADC_RANGE_3V3); // EOG pin 36: lê até 3.3V
+  halAdcConfigPin(sensorPinH, HAL_ADC_RANGE_3V3);
+  halAdcConfigPin(PIN_X, HAL_ADC_RANGE_1V1); // Acelerómetro: lê até ~1.1V
+  halAdcConfigPin(PIN_Y, HAL_ADC_RANGE_1V1);
+  halAdcConfigPin(PIN_Z, HAL_ADC_RANGE_1V1);
+  acqSetAccelPins(PIN_X, PIN_Y, PIN_Z);
+  acqSetCanais(eogPins, nCanais);
+  acqSetDsp(dspOs, dspModo);
+  if (!acqBegin(EOG_SAMPLE_RATE_HZ))
+    LOGE("[ACQ] Falha a arrancar o timer de aquisição!");
+  if (!recBegin())
+    LOGE("[REC] Sem partição de flash: sessões não são gravadas.");
+  if (!perfisBegin())
+    LOGE("[NVS] Sem NVS: a calibração não fica guardada.");
+  halBleBegin("EOG-Calibracao");
   imprimir("Comandos (Serial / SPP / BLE):");
   imprimir("  C        -> calibrar");
   imprimir("  P        -> baseline piscadelas 30s (BPM)");
   imprimir("  S        -> sessão INFINITA (Bluetooth envia array por minuto)");
   imprimir("  X        -> sair do ciclo atual e voltar ao idle");
-  imprimir("  TH=valor -> threshold manual");
+  imprimir("  TH=valor -> threshold manual (THc=valor: só o canal c)");
+  LOGI("  RTB=hz   -> RT em tramas binárias (0 = JSON, %d-%d Hz)",
+       RT_BIN_MIN_HZ, RT_BIN_MAX_HZ);
+  imprimir("  RAW=1    -> todas as amostras EOG, comprimidas (BLE, binário)");
+  imprimir("  EVT=1    -> uma trama por piscadela em S (BLE, binário)");
+  LOGI("  CAP=1    -> captura binária na USB a %d baud (CAP=baud, CAP=0 "
+       "sai)",
+       CAP_BAUD_OMISSAO);
+  LOGI("  FS=valor -> taxa de amostragem EOG em Hz (%d-%d)", ACQ_MIN_RATE_HZ,
+       ACQ_MAX_RATE_HZ);
+  LOGI("  OS=n     -> leituras do ADC por amostra (1-%d, filtradas e "
+       "decimadas)",
+       DSP_OS_MAX);
+  imprimir("  FLT=n    -> filtro: 0 média, 1 FIR, 2 FIR+IIR, 3 +linha de base");
+  imprimir("  DSP      -> configuração e custo da aquisição");
+  imprimir("  LOG=n    -> nível de log na USB (0 erros, 1 info, 2 debug, "
+           "3 verbose)");
+  imprimir("  DL[=id]  -> descarrega a sessão gravada na flash (BLE, binário)");
+  imprimir("  REC      -> estado do gravador de sessões");
+  imprimir("  LAT      -> latência do loop em cada modo e dos comandos");
+  imprimir("  ACK=1    -> tramas ACK também para comandos de texto (BLE)");
+  imprimir("  STATS    -> perfil por etapa, fs real, heap (STATS=0/1 desliga "
+           "/ liga e zera)");
+  LOGI("  TLM=s    -> trama de telemetria STATS a cada s segundos (0-%d)",
+       TLM_MAX_S);
+  imprimir("  BLE      -> MTU, PHY e intervalo negociados, contadores de "
+           "envio");
+  LOGI("  SUB=m    -> fluxos desta central (BLE, até %d): 1 texto, 2 RT, "
+       "4 minuto, 8 EVT, 16 RAW, 32 dados",
+       HAL_BLE_LIGACOES_MAX);
+  imprimir("  SEQ=1    -> seq e µs do dispositivo em todas as notificações "
+           "(BLE)");
+  imprimir("  SYNC=id  -> acerto de relógio: t1/t2 do dispositivo (BLE, "
+           "binário)");
+  imprimir("  MDL[=n]  -> modelo de piscadelas e sonolência (0 = limiares)");
+  LOGI("  PF[=n]   -> perfis de calibração na NVS; PF=n muda de utilizador "
+       "(1-%d)",
+       PERFIS_MAX);
+  imprimir("  HORA=s   -> hora UTC (s desde 1970) para a data dos perfis");
+  LOGI("  JAN[=s,..] -> piscadelas nas janelas deslizantes (até %d "
+       "horizontes, s)",
+       JANELAS_MAX);
+  LOGI("  BENCH[=s] -> custo e precisão de S sobre s segundos de EOG "
+       "sintético (%d)",
+       BENCH_SEG_OMISSAO);
+  LOGI("  TPUT[=s] -> teste de débito BLE durante s segundos (1-%d, %d)",
+       TPUT_SEG_MAX, TPUT_SEG_OMISSAO);
+  orientacao.begin(accCalib, acqAccelPeriodUs());
+  agendadorBegin(modos, NUM_MODOS);
+  agendadorObservar(observarAmostra);
+  janelas.configurar(JANELAS_OMISSAO,
+                     sizeof(JANELAS_OMISSAO) / sizeof(JANELAS_OMISSAO[0]));
+  minutoJanela.configurar(&MINUTO_S, 1);
+  statsZerar();
+  // arranque a quente: o perfil do utilizador ativo, se passar a verificação
+  lerPerfil();
+  if (temPerfil)
+    agendadorPedir(MODO_V);
+  else
+    imprimir("Sem perfil de calibração: C e P para calibrar.");
 }
 // =================== MAIN LOOP ===================
-void loop() {
+// Uma volta do agendador por chamada: o modo atual (idle, C, P, S ou DL)
+// avança com as amostras que chegaram e os comandos, o RT e o log são
+// servidos em todos os modos.
+static uint8_t modoAnterior = MODO_IDLE;
+// o trabalho de uma volta (tudo menos o delay); devolve o modo atual
+static uint8_t voltaLoop() {
+  PERF_MEDIR(PERF_VOLTA);
   pollAbortImmediate();
+  char cmd[CMD_MSG_MAX];
+  if (lerLinhaComando(cmd, sizeof(cmd))) {
+    if (linhaEhX(cmd))
+      abortRequested = true;
+    cmdPush(CMD_CONSOLA, 0, (const uint8_t *)cmd, strlen(cmd), false);
+  }
+  //!!! MÁGICA: "S", "C" ou "P" correm AQUI, aos bocados, e não no Bluetooth
+  {
+    PERF_MEDIR(PERF_COMANDOS);
+    CmdMsg msg;
+    while (cmdPop(msg))
+      executarComando(msg);
+  }
   if (abortRequested) {
     abortRequested = false;
-    imprimir(">> Idle: X recebido (não estava nenhum ciclo a correr).");
-  }
-  //!!! MÁGICA: Se houver um comando "S", "C" ou "P", corre AQUI e não no
-  //!Bluetooth
-  if (commandToRun != "") {
-    String op = commandToRun;
-    commandToRun = ""; // limpa
-    if (op == "C")
-      calibrar();
-    else if (op == "P")
-      medirBaselinePiscadelas_30s();
-    else if (op == "S")
-      correrSessao();
-  }
-  String cmd;
-  if (lerLinhaComando(cmd))
-    handleCommand(cmd);
-  delay(20);
+    if (agendadorModo() == MODO_IDLE)
+      imprimir(">> Idle: X recebido (não estava nenhum ciclo a correr).");
+    else
+      agendadorInterromper();
+  }
+  // FS= / OS= / FLT= reiniciam o anel: só em idle
+  if (agendadorModo() == MODO_IDLE) {
+    if (taxaPendente) {
+      uint16_t fs = taxaPendente;
+      taxaPendente = 0;
+      servirRaw(true); // os blocos levam a taxa no cabeçalho
+      if (acqBegin(fs))
+        LOGI(">> Taxa de amostragem EOG: %u Hz", (unsigned)fs);
+      else
+        LOGE(">> Falha a mudar a taxa de amostragem.");
+      orientacao.begin(accCalib, acqAccelPeriodUs()); // alpha segue FS=
+      rawCod.mudarFs(acqRateHz());
+      if (capAtiva())
+        capMudarFs(acqRateHz());
+      statsZerar();
+    }
+    if (dspPendente) {
+      dspPendente = false;
+      acqSetDsp(dspOs, dspModo);
+      if (acqBegin(acqRateHz()))
+        mostrarDsp();
+      else
+        LOGE(">> Falha a reconfigurar a aquisição.");
+      statsZerar();
+    }
+    if (canaisPendente) {
+      uint8_t n = canaisPendente;
+      canaisPendente = 0;
+      servirRaw(true); // os blocos e as tramas RT levam os canais
+      enviarRTBinarioPendente();
+      acqSetCanais(eogPins, n);
+      nCanais = n;
+      if (acqBegin(acqRateHz()))
+        LOGI(">> Canais EOG: %u", (unsigned)nCanais);
+      else
+        LOGE(">> Falha a reconfigurar a aquisição.");
+      if (rawLigado)
+        rawCod.reset(acqRateHz(), nCanais);
+      // o perfil gravado é para um número de canais
+      lerPerfil();
+      if (temPerfil)
+        aplicarPerfil();
+      else
+        LOGI(">> Sem perfil %u com %u canais: C para calibrar.",
+             (unsigned)perfilAtivo(), (unsigned)nCanais);
+      statsZerar();
+    }
+  }
+  AcqSample ultima;
+  if (agendadorVolta(ultima))
+    memcpy(leituraRT, ultima.eog, sizeof(leituraRT));
+  // ADICIONADO: acelerómetro já amostrado pela aquisição (~25 Hz)
+  {
+    PERF_MEDIR(PERF_ACEL);
+    AccSample acc;
+    while (acqReadAccel(acc)) {
+      orientacao.update(acc);
+      capAcel(acc);
+    }
+  }
+  servirRT();
+  servirRaw(false);
+  servirTelemetria();
+  servirLigacaoBle();
+  uint8_t modo = agendadorModo();
+  if (modo != modoAnterior) {
+    if (modoAnterior != MODO_IDLE)
+      mostrarLatencia(modoAnterior);
+    modoAnterior = modo;
+  }
+  {
+    PERF_MEDIR(PERF_LOG);
+    logDrain();
+    capDrain();
+    servirCaptura();
+  }
+  agendadorFimVolta();
+  return modo;
+}
+void loop() {
+  uint8_t modo = voltaLoop();
+  // idle: 20 ms como antes; nos modos, só cede o CPU (~1 tick do FreeRTOS)
+  halDelayMs(modo == MODO_IDLE ? 20 : 1);
 }
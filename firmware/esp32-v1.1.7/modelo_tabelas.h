@@ -0,0 +1,163 @@
+#pragma once
+// GERADO por gerar_modelo (firmware/host): não editar à mão.
+//   gerar_modelo -B 12 -a 5 -p 4
+//   origem: sint11.csv sint12.csv sint13.csv sint14.csv
+//   2696 piscadelas do canal 0 (outras 873, normais 1469, lentas 354)
+//   floresta: 5 árvores, profundidade <= 4, 135 nós, acerto no treino 98.6%
+//   3181 janelas (245 com sono, rótulos dos limiares com baseline 12.00 bpm)
+//   logística: acerto no treino 93.6%
+#include "classificador.h"
+
+#define MODELO_NOME "floresta+logistica"
+#define MODELO_ARVORES 5
+
+// amplitude e velocidades em ‰ do AMPLITUDE_MIN (normalizarPiscadela)
+static constexpr ModeloNo modeloNos[] = {
+    {FP_VEL_MAX_FECHO, 1, 1, 14, 48818},
+    {FP_AMPLITUDE, 0, 2, 9, 792},
+    {FP_VEL_MAX_REAB, 0, 3, 6, 8250},
+    {FP_VEL_REAB, 0, 4, 5, 6613},
+    {-1, 0, 0, 0, 0},
+    {-1, 0, 0, 0, 0},
+    {FP_REAB_MS, 0, 7, 8, 164},
+    {-1, 0, 0, 0, 0},
+    {-1, 2, 0, 0, 0},
+    {FP_VEL_REAB, 2, 10, 13, 15772},
+    {FP_FECHO_MS, 2, 11, 12, 110},
+    {-1, 0, 0, 0, 0},
+    {-1, 2, 0, 0, 0},
+    {-1, 1, 0, 0, 0},
+    {FP_VEL_FECHO, 1, 15, 20, 16505},
+    {FP_FECHO_MS, 2, 16, 17, 128},
+    {-1, 0, 0, 0, 0},
+    {FP_AMPLITUDE, 2, 18, 19, 882},
+    {-1, 0, 0, 0, 0},
+    {-1, 2, 0, 0, 0},
+    {FP_VEL_REAB, 1, 21, 24, 14606},
+    {FP_VEL_MAX_FECHO, 1, 22, 23, 74467},
+    {-1, 0, 0, 0, 0},
+    {-1, 1, 0, 0, 0},
+    {FP_FECHO_MS, 1, 25, 26, 42},
+    {-1, 1, 0, 0, 0},
+    {-1, 1, 0, 0, 0},
+    {FP_AMPLITUDE, 1, 28, 37, 643},
+    {FP_VEL_REAB, 0, 29, 30, 2749},
+    {-1, 0, 0, 0, 0},
+    {FP_VEL_REAB, 0, 31, 34, 11000},
+    {FP_VEL_MAX_REAB, 0, 32, 33, 7278},
+    {-1, 0, 0, 0, 0},
+    {-1, 0, 0, 0, 0},
+    {FP_VEL_REAB, 0, 35, 36, 26455},
+    {-1, 0, 0, 0, 0},
+    {-1, 0, 0, 0, 0},
+    {FP_VEL_REAB, 1, 38, 43, 14515},
+    {FP_REAB_MS, 2, 39, 40, 110},
+    {-1, 0, 0, 0, 0},
+    {FP_FECHO_MS, 2, 41, 42, 134},
+    {-1, 2, 0, 0, 0},
+    {-1, 2, 0, 0, 0},
+    {FP_FECHO_MS, 1, 44, 47, 42},
+    {FP_FECHO_MS, 1, 45, 46, 26},
+    {-1, 1, 0, 0, 0},
+    {-1, 1, 0, 0, 0},
+    {FP_VEL_REAB, 1, 48, 49, 24126},
+    {-1, 1, 0, 0, 0},
+    {-1, 1, 0, 0, 0},
+    {FP_REAB_MS, 1, 51, 64, 24},
+    {FP_VEL_MAX_REAB, 0, 52, 57, 8250},
+    {FP_VEL_REAB, 0, 53, 54, 7278},
+    {-1, 0, 0, 0, 0},
+    {FP_FECHO_MS, 2, 55, 56, 2},
+    {-1, 2, 0, 0, 0},
+    {-1, 0, 0, 0, 0},
+    {FP_VEL_MAX_REAB, 0, 58, 61, 38353},
+    {FP_VEL_REAB, 0, 59, 60, 32404},
+    {-1, 0, 0, 0, 0},
+    {-1, 0, 0, 0, 0},
+    {FP_VEL_FECHO, 0, 62, 63, 9308},
+    {-1, 0, 0, 0, 0},
+    {-1, 0, 0, 0, 0},
+    {FP_FECHO_MS, 1, 65, 72, 78},
+    {FP_VEL_MAX_REAB, 1, 66, 69, 74165},
+    {FP_VEL_MAX_FECHO, 1, 67, 68, 55886},
+    {-1, 1, 0, 0, 0},
+    {-1, 1, 0, 0, 0},
+    {FP_VEL_MAX_FECHO, 1, 70, 71, 86435},
+    {-1, 1, 0, 0, 0},
+    {-1, 1, 0, 0, 0},
+    {FP_AMPLITUDE, 2, 73, 76, 808},
+    {FP_FECHO_MS, 0, 74, 75, 144},
+    {-1, 0, 0, 0, 0},
+    {-1, 2, 0, 0, 0},
+    {FP_FECHO_MS, 2, 77, 78, 110},
+    {-1, 0, 0, 0, 0},
+    {-1, 2, 0, 0, 0},
+    {FP_VEL_MAX_FECHO, 1, 80, 95, 48818},
+    {FP_FECHO_MS, 0, 81, 88, 126},
+    {FP_VEL_FECHO, 0, 82, 85, 29098},
+    {FP_VEL_MAX_REAB, 0, 83, 84, 8250},
+    {-1, 0, 0, 0, 0},
+    {-1, 0, 0, 0, 0},
+    {FP_REAB_MS, 1, 86, 87, 26},
+    {-1, 0, 0, 0, 0},
+    {-1, 1, 0, 0, 0},
+    {FP_FECHO_MS, 2, 89, 92, 134},
+    {FP_VEL_MAX_FECHO, 2, 90, 91, 40981},
+    {-1, 2, 0, 0, 0},
+    {-1, 0, 0, 0, 0},
+    {FP_AMPLITUDE, 2, 93, 94, 877},
+    {-1, 2, 0, 0, 0},
+    {-1, 2, 0, 0, 0},
+    {FP_REAB_MS, 1, 96, 103, 100},
+    {FP_FECHO_MS, 1, 97, 100, 42},
+    {FP_VEL_MAX_FECHO, 1, 98, 99, 104418},
+    {-1, 1, 0, 0, 0},
+    {-1, 1, 0, 0, 0},
+    {FP_VEL_MAX_FECHO, 1, 101, 102, 82341},
+    {-1, 1, 0, 0, 0},
+    {-1, 0, 0, 0, 0},
+    {FP_AMPLITUDE, 2, 104, 105, 659},
+    {-1, 0, 0, 0, 0},
+    {FP_FECHO_MS, 2, 106, 107, 140},
+    {-1, 2, 0, 0, 0},
+    {-1, 2, 0, 0, 0},
+    {FP_VEL_MAX_FECHO, 1, 109, 124, 48818},
+    {FP_VEL_MAX_FECHO, 0, 110, 117, 21231},
+    {FP_VEL_MAX_REAB, 0, 111, 114, 8250},
+    {FP_VEL_REAB, 0, 112, 113, 7278},
+    {-1, 0, 0, 0, 0},
+    {-1, 2, 0, 0, 0},
+    {FP_VEL_FECHO, 0, 115, 116, 10253},
+    {-1, 0, 0, 0, 0},
+    {-1, 0, 0, 0, 0},
+    {FP_AMPLITUDE, 2, 118, 121, 877},
+    {FP_VEL_FECHO, 0, 119, 120, 4994},
+    {-1, 2, 0, 0, 0},
+    {-1, 0, 0, 0, 0},
+    {FP_VEL_REAB, 2, 122, 123, 14278},
+    {-1, 2, 0, 0, 0},
+    {-1, 1, 0, 0, 0},
+    {FP_FECHO_MS, 1, 125, 130, 78},
+    {FP_REAB_MS, 1, 126, 129, 74},
+    {FP_FECHO_MS, 1, 127, 128, 42},
+    {-1, 1, 0, 0, 0},
+    {-1, 1, 0, 0, 0},
+    {-1, 1, 0, 0, 0},
+    {FP_VEL_MAX_FECHO, 2, 131, 134, 74467},
+    {FP_AMPLITUDE, 2, 132, 133, 675},
+    {-1, 0, 0, 0, 0},
+    {-1, 2, 0, 0, 0},
+    {-1, 0, 0, 0, 0},
+};
+static constexpr uint16_t modeloRaizes[MODELO_ARVORES] = {0, 27, 50, 79, 108};
+// Q20, por unidade de cada feature da janela
+static constexpr int32_t modeloPesos[FJ_N] = {
+    5687, // normais_min_x10
+    12872, // lentas_min_x10
+    6307, // rel_baseline_x100
+    38086, // lentas
+    15009, // dur_normais_ms
+    14926, // dur_lentas_ms
+    -648, // ibi_ms
+};
+static constexpr int32_t modeloVies = -5976310;
@@ -0,0 +1,86 @@
+#include "orientacao.h"
+
+uint32_t isqrt32(uint32_t v) {
+  uint32_t r = 0;
+  uint32_t bit = 1UL << 30;
+  while (bit > v)
+    bit >>= 2;
+  while (bit) {
+    if (v >= r + bit) {
+      v -= r + bit;
+      r = (r >> 1) + bit;
+    } else {
+      r >>= 1;
+    }
+    bit >>= 2;
+  }
+  return r;
+}
+
+int16_t atan2Dg(int32_t y, int32_t x) {
+  uint32_t ax = (uint32_t)(x < 0 ? -x : x);
+  uint32_t ay = (uint32_t)(y < 0 ? -y : y);
+  if (ax == 0 && ay == 0)
+    return 0;
+  // reduz ao 1º octante: t = min/max em Q15 (0..1)
+  bool troca = ay > ax;
+  uint32_t num = troca ? ax : ay;
+  uint32_t den = troca ? ay : ax;
+  int32_t t = (int32_t)((num << 15) / den);
+  // atan(t), polinómio ímpar de grau 9 em Q15 (erro < 1e-5 rad)
+  int32_t s = (t * t) >> 15;
+  int32_t p = 683;
+  p = -2790 + ((p * s) >> 15);
+  p = 5903 + ((p * s) >> 15);
+  p = -10823 + ((p * s) >> 15);
+  p = 32764 + ((p * s) >> 15);
+  int32_t rad = (t * p) >> 15;
+  // rad (Q15) -> décimas de grau x32 -> décimas de grau
+  int32_t a = (((rad * 18335) >> 15) + 16) >> 5;
+  if (troca)
+    a = 900 - a;
+  if (x < 0)
+    a = 1800 - a;
+  return (int16_t)(y < 0 ? -a : a);
+}
+
+// gravidade no eixo i em Q14, limitada a +-1 g
+static int32_t gravidadeQ14(const AccCalib &cal, const uint16_t q4[3], int i) {
+  int32_t d = (int32_t)q4[i] - cal.offsetQ4[i];
+  if (d >= cal.escalaQ4[i])
+    return 16384;
+  if (d <= -cal.escalaQ4[i])
+    return -16384;
+  return d * 16384 / cal.escalaQ4[i];
+}
+
+void orientacaoCalc(const AccCalib &cal, const uint16_t q4[3], int16_t &rollDg,
+                    int16_t &pitchDg) {
+  int32_t gx = gravidadeQ14(cal, q4, 0);
+  int32_t gy = gravidadeQ14(cal, q4, 1);
+  int32_t gz = -gravidadeQ14(cal, q4, 2);
+  pitchDg = atan2Dg(gx, (int32_t)isqrt32((uint32_t)(gz * gz + gy * gy)));
+  rollDg = atan2Dg(gz, (int32_t)isqrt32((uint32_t)(gx * gx + gy * gy)));
+}
+
+void OrientacaoFiltro::begin(const AccCalib &cal, uint32_t periodoUs) {
+  cal_ = cal;
+  // alpha = dt / (tau + dt), em Q8
+  uint32_t dtMs = periodoUs / 1000;
+  alphaQ8_ = (int32_t)((256 * dtMs + (ORIENT_TAU_MS + dtMs) / 2) /
+                       (ORIENT_TAU_MS + dtMs));
+  if (alphaQ8_ < 1)
+    alphaQ8_ = 1;
+}
+
+int32_t OrientacaoFiltro::filtrar(int32_t estadoQ8, int16_t atualDg,
+                                  int32_t alpha) {
+  return estadoQ8 + (((int32_t)atualDg * 256 - estadoQ8) * alpha) / 256;
+}
+
+void OrientacaoFiltro::update(const AccSample &a) {
+  int16_t roll, pitch;
+  orientacaoCalc(cal_, a.q4, roll, pitch);
+  rollQ8_ = filtrar(rollQ8_, roll, alphaQ8_);
+  pitchQ8_ = filtrar(pitchQ8_, pitch, alphaQ8_);
+}
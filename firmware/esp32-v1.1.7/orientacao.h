@@ -0,0 +1,52 @@
+#pragma once
+#include <stdint.h>
+
+#include "eog_acq.h"
+
+// =================== ORIENTAÇÃO DA CABEÇA (ADXL335) ===================
+// Roll/pitch em décimas de grau a partir das médias que a aquisição produz
+// (AccSample), só com inteiros: gravidade em Q14 (16384 = 1 g), raiz inteira
+// e atan2 por polinómio em Q15. Erro contra o caminho antigo em float
+// (atan2f/sqrtf) medido no host com orient_check.
+
+// constante de tempo do EWMA: 567 ms = alpha 0.15 a 10 Hz (o filtro antigo)
+#define ORIENT_TAU_MS 567
+// abaixo disto (décimas de grau) o ângulo filtrado conta como 0
+#define ORIENT_ZONA_MORTA_DG 20
+
+struct AccCalib {
+  int32_t offsetQ4[3]; // leitura a 0 g (LSB x16)
+  int32_t escalaQ4[3]; // LSB por g (x16)
+};
+
+// raiz quadrada inteira (arredondada para baixo)
+uint32_t isqrt32(uint32_t v);
+// atan2(y, x) em décimas de grau, -1800..1800; |x|, |y| < 131072
+int16_t atan2Dg(int32_t y, int32_t x);
+// roll/pitch instantâneos (sem filtro) de uma média do acelerómetro
+void orientacaoCalc(const AccCalib &cal, const uint16_t q4[3], int16_t &rollDg,
+                    int16_t &pitchDg);
+
+class OrientacaoFiltro {
+public:
+  // periodoUs: intervalo entre AccSample (acqAccelPeriodUs)
+  void begin(const AccCalib &cal, uint32_t periodoUs);
+  void update(const AccSample &a);
+  int16_t rollDg() const { return saida(rollQ8_); }
+  int16_t pitchDg() const { return saida(pitchQ8_); }
+
+private:
+  // a zona morta aplica-se à saída, não ao estado do filtro
+  static int16_t saida(int32_t q8) {
+    int32_t dg = (q8 >= 0 ? q8 + 128 : q8 - 128) / 256;
+    if (dg > -ORIENT_ZONA_MORTA_DG && dg < ORIENT_ZONA_MORTA_DG)
+      return 0;
+    return (int16_t)dg;
+  }
+  static int32_t filtrar(int32_t estadoQ8, int16_t atualDg, int32_t alpha);
+
+  AccCalib cal_ = {};
+  int32_t alphaQ8_ = 38; // 0.15
+  int32_t rollQ8_ = 0;   // décimas de grau x256
+  int32_t pitchQ8_ = 0;
+};
@@ -0,0 +1,105 @@
+#include "perfil.h"
+
+#include <string.h>
+
+#include "rt_frame.h"
+
+volatile bool perfLigado = true;
+
+static PerfEstat etapas[PERF_N];
+// perfZerar só muda a geração; cada escritor zera a sua etapa na medida
+// seguinte, assim o leitor nunca escreve em estado de outra task
+static volatile uint32_t geracaoAtual = 1;
+static uint32_t limites[PERF_HIST_N - 1]; // em ciclos: 1, 4, ..., 4096 µs
+static uint32_t ciclosPorUs = 1;
+static uint16_t seqTrama = 0;
+static uint8_t proximaEtapa = 0; // roda das etapas na trama
+
+static const char *const nomes[PERF_N] = {
+    "tick", "adc", "detecao", "gravador", "acel",
+    "rt",   "cmd", "log",     "ble_tx",   "volta", "raw", "classif", "sono",
+};
+
+void perfBegin() {
+  ciclosPorUs = halCiclosPorUs();
+  if (ciclosPorUs == 0)
+    ciclosPorUs = 1;
+  uint32_t us = 1;
+  for (int i = 0; i < PERF_HIST_N - 1; i++, us *= 4)
+    limites[i] = us * ciclosPorUs;
+  perfZerar();
+}
+
+void perfRegistar(PerfEtapa e, uint32_t ciclos) {
+  PerfEstat &s = etapas[e];
+  uint32_t g = geracaoAtual;
+  if (s.geracao != g) {
+    memset(&s, 0, sizeof(s));
+    s.minCiclos = UINT32_MAX;
+    s.geracao = g;
+  }
+  s.n++;
+  s.somaCiclos += ciclos;
+  if (ciclos < s.minCiclos)
+    s.minCiclos = ciclos;
+  if (ciclos > s.maxCiclos)
+    s.maxCiclos = ciclos;
+  int b = 0;
+  while (b < PERF_HIST_N - 1 && ciclos >= limites[b])
+    b++;
+  s.hist[b]++;
+}
+
+void perfLer(PerfEtapa e, PerfEstat &out) {
+  out = etapas[e];
+  if (out.geracao != geracaoAtual || out.n == 0) {
+    memset(&out, 0, sizeof(out));
+    out.geracao = geracaoAtual;
+  }
+}
+
+void perfZerar() { geracaoAtual = geracaoAtual + 1; }
+
+const char *perfNome(PerfEtapa e) { return e < PERF_N ? nomes[e] : "?"; }
+
+uint32_t perfCiclosParaDecUs(uint64_t ciclos) {
+  return (uint32_t)(ciclos * 10 / ciclosPorUs);
+}
+
+static void escreverU16(uint8_t *p, uint32_t v) {
+  if (v > 0xFFFF)
+    v = 0xFFFF;
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+}
+
+size_t perfMontarTrama(uint8_t *out, size_t maxLen, const PerfResumo &r) {
+  if (maxLen < PERF_TRAMA_CABECALHO_LEN + PERF_TRAMA_ETAPA_LEN)
+    return 0;
+  out[0] = RT_FRAME_MAGIC;
+  out[1] = RT_FRAME_VERSION;
+  out[2] = RT_FRAME_TYPE_STATS;
+  escreverU16(out + 3, seqTrama++);
+  escreverU16(out + 5, r.fsX10);
+  escreverU16(out + 7, r.atrasos);
+  escreverU16(out + 9, r.perdidas);
+  escreverU16(out + 11, r.heapLivre / 1024);
+  escreverU16(out + 13, r.heapMaiorBloco / 1024);
+
+  size_t cabem = (maxLen - PERF_TRAMA_CABECALHO_LEN) / PERF_TRAMA_ETAPA_LEN;
+  if (cabem > PERF_N)
+    cabem = PERF_N;
+  uint8_t *p = out + PERF_TRAMA_CABECALHO_LEN;
+  for (size_t i = 0; i < cabem; i++) {
+    PerfEtapa e = (PerfEtapa)proximaEtapa;
+    proximaEtapa = (uint8_t)((proximaEtapa + 1) % PERF_N);
+    PerfEstat s;
+    perfLer(e, s);
+    p[0] = e;
+    escreverU16(p + 1, s.n ? perfCiclosParaDecUs(s.somaCiclos / s.n) : 0);
+    escreverU16(p + 3, s.maxCiclos / ciclosPorUs);
+    p += PERF_TRAMA_ETAPA_LEN;
+  }
+  out[15] = (uint8_t)cabem;
+  return (size_t)(p - out);
+}
@@ -0,0 +1,98 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hal.h"
+
+// =================== PERFIL (contadores de ciclos) ===================
+// PERF_MEDIR(etapa) no início de um bloco mede-o com o contador de ciclos
+// do CPU e soma a medida à etapa: n, mín/méd/máx e um histograma grosseiro
+// (baldes x4: <1, <4, <16, <64, <256 µs, <1, <4, >=4 ms). Cada etapa tem
+// um só escritor (a task que a mede), por isso não há locks; STATS lê-as
+// como estiverem.
+//
+// Custo: duas leituras do CCOUNT e ~10 comparações por medida. Desligado em
+// runtime (STATS=0) fica um teste de um bool; compilado com PERF_ATIVO 0
+// não fica nada.
+
+#ifndef PERF_ATIVO
+#define PERF_ATIVO 1
+#endif
+
+enum PerfEtapa : uint8_t {
+  PERF_TICK_ACQ = 0, // tick do timer inteiro (ADC + DSP + anel)
+  PERF_ADC,          // só a leitura do ADC
+  PERF_DETECAO,      // detetor.update + contagens (S)
+  PERF_GRAVADOR,     // recAmostra (inclui a escrita do bloco na flash)
+  PERF_ACEL,         // orientação (roll/pitch)
+  PERF_RT,           // RT: formatar + meter na fila BLE
+  PERF_COMANDOS,     // executar comandos da fila
+  PERF_LOG,          // logDrain
+  PERF_BLE_TX,       // uma notificação na task de envio
+  PERF_VOLTA,        // volta inteira do loop (sem o delay)
+  PERF_RAW,          // RAW: comprimir os blocos + meter na fila BLE
+  PERF_CLASSIF,      // modelo: classe de uma piscadela (classificador.h)
+  PERF_SONO,         // modelo: sonolência numa janela
+  PERF_N
+};
+#define PERF_HIST_N 8
+
+struct PerfEstat {
+  uint32_t n;
+  uint32_t minCiclos;
+  uint32_t maxCiclos;
+  uint64_t somaCiclos;
+  uint32_t hist[PERF_HIST_N];
+  uint32_t geracao; // != a atual: valores antigos (antes de perfZerar)
+};
+
+extern volatile bool perfLigado;
+
+void perfBegin(); // limites do histograma com halCiclosPorUs()
+void perfRegistar(PerfEtapa e, uint32_t ciclos);
+// cópia (zeros se a etapa não mediu nada desde o último perfZerar)
+void perfLer(PerfEtapa e, PerfEstat &out);
+void perfZerar();
+const char *perfNome(PerfEtapa e);
+uint32_t perfCiclosParaDecUs(uint64_t ciclos); // décimas de µs
+
+class PerfMedida {
+public:
+  explicit PerfMedida(PerfEtapa e)
+      : e_(e), ativo_(perfLigado), t0_(ativo_ ? halCiclos() : 0) {}
+  ~PerfMedida() {
+    if (ativo_)
+      perfRegistar(e_, halCiclos() - t0_);
+  }
+
+private:
+  PerfEtapa e_;
+  bool ativo_;
+  uint32_t t0_;
+};
+
+#if PERF_ATIVO
+#define PERF_JUNTAR2(a, b) a##b
+#define PERF_JUNTAR(a, b) PERF_JUNTAR2(a, b)
+#define PERF_MEDIR(etapa) PerfMedida PERF_JUNTAR(perfMedida, __LINE__)(etapa)
+#else
+#define PERF_MEDIR(etapa) ((void)0)
+#endif
+
+// ---- trama de telemetria (TLM=s) ----
+// 0 magic, 1 versão, 2 RT_FRAME_TYPE_STATS, 3 u16 seq, 5 u16 fs real x10,
+// 7 u16 ticks atrasados, 9 u16 amostras perdidas, 11 u16 heap livre (KiB),
+// 13 u16 maior bloco (KiB), 15 u8 n, 16 n x {u8 etapa, u16 médio (0.1 µs),
+// u16 máximo (µs)}. As etapas que não cabem no MTU vão nas tramas
+// seguintes (roda). Contadores saturam em 0xFFFF.
+#define PERF_TRAMA_CABECALHO_LEN 16
+#define PERF_TRAMA_ETAPA_LEN 5
+
+struct PerfResumo {
+  uint32_t fsX10;
+  uint32_t atrasos;
+  uint32_t perdidas;
+  uint32_t heapLivre;
+  uint32_t heapMaiorBloco;
+};
+size_t perfMontarTrama(uint8_t *out, size_t maxLen, const PerfResumo &r);
@@ -0,0 +1,92 @@
+#include "perfis_cal.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "hal.h"
+
+// critérios da verificação (ver perfis_cal.h)
+#define VERIF_FRAC_ABERTOS 0.7f
+#define VERIF_SIGMA_FATOR 2.0f
+#define VERIF_SIGMA_FOLGA 2.0f // ADC: um perfil com sigma ~0 não é exigível
+
+static uint8_t ativo = 1;
+
+static void chave(uint8_t utilizador, char *out, size_t max) {
+  snprintf(out, max, "cal%u", (unsigned)utilizador);
+}
+
+bool perfisBegin() {
+  if (!halPrefsBegin())
+    return false;
+  uint8_t u = 0;
+  if (halPrefsRead("ativo", &u, 1) == 1 && u >= 1 && u <= PERFIS_MAX)
+    ativo = u;
+  return true;
+}
+
+uint8_t perfilAtivo() { return ativo; }
+
+bool perfilDefinirAtivo(uint8_t utilizador) {
+  if (utilizador < 1 || utilizador > PERFIS_MAX)
+    return false;
+  ativo = utilizador;
+  return halPrefsWrite("ativo", &ativo, 1);
+}
+
+bool perfilLer(uint8_t utilizador, PerfilCal &out, uint8_t nCanais) {
+  char k[8];
+  chave(utilizador, k, sizeof(k));
+  if (halPrefsRead(k, &out, sizeof(out)) != sizeof(out))
+    return false;
+  return out.versao == PERFIL_VERSAO && out.nCanais == nCanais;
+}
+
+bool perfilGravar(uint8_t utilizador, PerfilCal &p) {
+  if (utilizador < 1 || utilizador > PERFIS_MAX)
+    return false;
+  char k[8];
+  chave(utilizador, k, sizeof(k));
+  p.versao = PERFIL_VERSAO;
+  return halPrefsWrite(k, &p, sizeof(p));
+}
+
+void VerificacaoPerfil::begin(const PerfilCal &p) {
+  p_ = p;
+  n_ = 0;
+  memset(abertos_, 0, sizeof(abertos_));
+  for (uint8_t c = 0; c < ACQ_CANAIS_MAX; c++)
+    rob_[c].begin();
+}
+
+void VerificacaoPerfil::amostra(const uint16_t *eog) {
+  n_++;
+  for (uint8_t c = 0; c < p_.nCanais; c++) {
+    if (eog[c] <= p_.canal[c].limiarInferior)
+      continue; // piscadela (ou sinal muito abaixo do calibrado)
+    abertos_[c]++;
+    rob_[c].add(eog[c]);
+  }
+}
+
+bool VerificacaoPerfil::resultado(Canal *porCanal) const {
+  bool tudo = n_ > 0;
+  for (uint8_t c = 0; c < p_.nCanais; c++) {
+    const PerfilCanal &pc = p_.canal[c];
+    Canal r = {};
+    if (n_)
+      r.fracAbertos = abertos_[c] / (float)n_;
+    r.mediana = rob_[c].mediana();
+    r.sigma = rob_[c].sigma();
+    float offset = pc.baseline - pc.limiarInferior;
+    r.confere = r.fracAbertos >= VERIF_FRAC_ABERTOS &&
+                fabsf(r.mediana - pc.baseline) <= offset / 2 &&
+                r.sigma <= pc.sigma * VERIF_SIGMA_FATOR + VERIF_SIGMA_FOLGA;
+    if (c == 0) // os outros canais só ficam no log
+      tudo = tudo && r.confere;
+    if (porCanal)
+      porCanal[c] = r;
+  }
+  return tudo;
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <stdint.h>
+
+#include "eog_acq.h"
+#include "estatistica.h"
+
+// =================== PERFIS DE CALIBRAÇÃO (NVS) ===================
+// O resultado de C (limiares e qualidade do sinal por canal) e de P (BPM de
+// referência) fica na NVS, um perfil por utilizador (PF=n). No arranque, o
+// perfil do utilizador ativo é posto à prova durante PERFIL_VERIF_S
+// segundos com os olhos abertos: se o sinal ainda bate com o da calibração,
+// os limiares e a baseline são aplicados logo (S faz sentido de imediato);
+// senão, é preciso a calibração completa (C e depois P).
+//
+// A verificação só olha para as amostras acima do limiarInferior (as
+// piscadelas ficam abaixo): quase todas têm de lá estar, a mediana delas
+// não pode ter fugido mais de meio offset da baseline e o ruído (1.4826
+// MAD, os estimadores de C) não pode ter mais do que duplicado.
+// Só o canal 0 decide.
+
+#define PERFIL_VERSAO 1
+#define PERFIS_MAX 4 // utilizadores 1..PERFIS_MAX
+#define PERFIL_VERIF_S 3
+
+struct PerfilCanal {
+  float baseline; // mediana em repouso (ADC)
+  float sigma;    // ruído em repouso (1.4826 MAD, calibracao.h)
+  int16_t limiarInferior;
+  int16_t amplitudeMin;
+  int16_t amplitudeMinLenta;
+  int16_t ampMax; // maior piscadela na calibração, sem outliers
+};
+
+struct PerfilCal {
+  uint16_t versao; // PERFIL_VERSAO; outra = perfil ignorado
+  uint8_t nCanais;
+  uint8_t temBpm;       // já houve P depois de C
+  uint16_t fsHz;        // da calibração
+  uint16_t calibracoes; // quantas vezes C gravou este perfil
+  uint32_t epoch;       // halEpoch() ao gravar (0 = sem hora)
+  float baselineBpm;
+  PerfilCanal canal[ACQ_CANAIS_MAX];
+};
+
+// abre a NVS e lê o utilizador ativo (1 se nunca foi escolhido)
+bool perfisBegin();
+uint8_t perfilAtivo();
+bool perfilDefinirAtivo(uint8_t utilizador); // persiste; false fora 1..MAX
+// false se não há perfil ou é de outra versão / com outros canais
+bool perfilLer(uint8_t utilizador, PerfilCal &out, uint8_t nCanais);
+bool perfilGravar(uint8_t utilizador, PerfilCal &p); // preenche versao
+
+// verificação rápida de um perfil contra o sinal atual
+class VerificacaoPerfil {
+public:
+  void begin(const PerfilCal &p);
+  void amostra(const uint16_t *eog);
+  uint32_t n() const { return n_; }
+  struct Canal {
+    float fracAbertos; // amostras acima do limiarInferior
+    float mediana;     // dessas amostras
+    float sigma;       // 1.4826 MAD
+    bool confere;
+  };
+  // false se o canal 0 (piscadelas) não confere
+  bool resultado(Canal *porCanal) const;
+
+private:
+  PerfilCal p_;
+  uint32_t n_ = 0;
+  uint32_t abertos_[ACQ_CANAIS_MAX];
+  MedianaMad rob_[ACQ_CANAIS_MAX];
+};
@@ -0,0 +1,193 @@
+#include "raw_codec.h"
+
+#include <string.h>
+
+#include "rt_frame.h"
+
+#define RAW_MASCARA (RAW_BUF_AMOSTRAS - 1)
+static_assert((RAW_BUF_AMOSTRAS & RAW_MASCARA) == 0,
+              "RAW_BUF_AMOSTRAS tem de ser potencia de 2");
+
+static inline void putU16(uint8_t *p, uint16_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+}
+static inline uint16_t getU16(const uint8_t *p) {
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t zigzag(int32_t d) {
+  return ((uint32_t)d << 1) ^ (uint32_t)(d >> 31);
+}
+static inline int32_t deszigzag(uint32_t z) {
+  return (int32_t)(z >> 1) ^ -(int32_t)(z & 1);
+}
+static inline uint8_t bitsPara(uint32_t v) {
+  return v ? (uint8_t)(32 - __builtin_clz(v)) : 0;
+}
+
+// o buffer vem a zeros; pos em bits
+static void escreverBits(uint8_t *p, size_t &pos, uint32_t v, uint8_t w) {
+  while (w) {
+    uint8_t off = pos & 7;
+    uint8_t k = 8 - off < w ? 8 - off : w;
+    p[pos >> 3] |= (uint8_t)((v & ((1u << k) - 1)) << off);
+    v >>= k;
+    w -= k;
+    pos += k;
+  }
+}
+static bool lerBits(const uint8_t *p, size_t maxBits, size_t &pos, uint8_t w,
+                    uint32_t &v) {
+  if (pos + w > maxBits)
+    return false;
+  v = 0;
+  for (uint8_t feito = 0; feito < w;) {
+    uint8_t off = pos & 7;
+    uint8_t k = 8 - off < w - feito ? 8 - off : w - feito;
+    v |= (uint32_t)((p[pos >> 3] >> off) & ((1u << k) - 1)) << feito;
+    feito += k;
+    pos += k;
+  }
+  return true;
+}
+
+void RawCodificador::reset(uint16_t fsHz, uint8_t canais) {
+  fs_ = fsHz;
+  canais_ = canais == 0               ? 1
+            : canais > ACQ_CANAIS_MAX ? ACQ_CANAIS_MAX
+                                      : canais;
+  inicio_ = fim_ = 0;
+  perdidas_ = 0;
+}
+
+void RawCodificador::add(uint32_t tUs, const uint16_t *eog) {
+  if (pendentes() >= RAW_BUF_AMOSTRAS) {
+    inicio_++;
+    perdidas_++;
+  }
+  uint32_t i = fim_ & RAW_MASCARA;
+  tUs_[i] = tUs;
+  for (uint8_t c = 0; c < canais_; c++)
+    eog_[c][i] = eog[c];
+  fim_++;
+}
+
+uint32_t RawCodificador::primeiroUs() const {
+  return tUs_[inicio_ & RAW_MASCARA];
+}
+
+size_t RawCodificador::larguras(uint32_t i, size_t g, uint8_t *w) const {
+  size_t bits = 0;
+  for (uint8_t c = 0; c < canais_; c++) {
+    const uint16_t *s = eog_[c];
+    uint32_t maior = 0;
+    for (size_t k = 0; k < g; k++) {
+      uint32_t z = zigzag((int32_t)s[(i + k + 1) & RAW_MASCARA] -
+                          (int32_t)s[(i + k) & RAW_MASCARA]);
+      if (z > maior)
+        maior = z;
+    }
+    w[c] = bitsPara(maior);
+    bits += RAW_LARGURA_BITS + g * w[c];
+  }
+  return bits;
+}
+
+size_t RawCodificador::montar(uint8_t *out, size_t maxLen) {
+  if (maxLen > RT_FRAME_MAX_LEN)
+    maxLen = RT_FRAME_MAX_LEN;
+  size_t cab = RAW_CABECALHO_LEN + 2 * (size_t)canais_;
+  if (pendentes() == 0 || maxLen < cab)
+    return 0;
+  uint32_t i = inicio_;
+  for (uint8_t c = 0; c < canais_; c++)
+    putU16(out + RAW_CABECALHO_LEN + 2 * c, eog_[c][i & RAW_MASCARA]);
+
+  uint8_t *bits = out + cab;
+  size_t maxBits = (maxLen - cab) * 8;
+  size_t pos = 0;
+  memset(bits, 0, maxLen - cab);
+  size_t n = 1;
+  while (n < 255) {
+    size_t g = pendentes() - n;
+    if (g > RAW_GRUPO)
+      g = RAW_GRUPO;
+    if (g > 255 - n)
+      g = 255 - n;
+    // o último grupo encolhe até caber no que resta do MTU; o descodificador
+    // só sabe os grupos pelo n, por isso um grupo curto fecha o bloco
+    uint8_t w[ACQ_CANAIS_MAX];
+    size_t inteiro = g;
+    while (g > 0 && pos + larguras(i, g, w) > maxBits)
+      g--;
+    if (g == 0)
+      break;
+    for (uint8_t c = 0; c < canais_; c++) {
+      const uint16_t *s = eog_[c];
+      escreverBits(bits, pos, w[c], RAW_LARGURA_BITS);
+      for (size_t k = 0; k < g; k++)
+        escreverBits(bits, pos,
+                     zigzag((int32_t)s[(i + k + 1) & RAW_MASCARA] -
+                            (int32_t)s[(i + k) & RAW_MASCARA]),
+                     w[c]);
+    }
+    i += (uint32_t)g;
+    n += g;
+    if (g < inteiro)
+      break;
+  }
+
+  out[0] = RT_FRAME_MAGIC;
+  out[1] = RT_FRAME_VERSION;
+  out[2] = RT_FRAME_TYPE_RAW;
+  putU16(out + 3, seq_++);
+  uint32_t t0 = primeiroUs();
+  putU16(out + 5, (uint16_t)t0);
+  putU16(out + 7, (uint16_t)(t0 >> 16));
+  putU16(out + 9, fs_);
+  out[11] = canais_;
+  out[12] = (uint8_t)n;
+  inicio_ += (uint32_t)n;
+  return cab + (pos + 7) / 8;
+}
+
+int rawDescodificar(const uint8_t *d, size_t len, RawBloco &cab, uint16_t *out,
+                    size_t maxValores) {
+  if (len < RAW_CABECALHO_LEN || d[0] != RT_FRAME_MAGIC ||
+      d[2] != RT_FRAME_TYPE_RAW)
+    return -1;
+  cab.seq = getU16(d + 3);
+  cab.t0Us = getU16(d + 5) | ((uint32_t)getU16(d + 7) << 16);
+  cab.fsHz = getU16(d + 9);
+  cab.canais = d[11];
+  cab.n = d[12];
+  size_t canais = cab.canais;
+  size_t ini = RAW_CABECALHO_LEN + 2 * canais;
+  if (canais == 0 || canais > ACQ_CANAIS_MAX || cab.n == 0 || len < ini ||
+      (size_t)cab.n * canais > maxValores)
+    return -1;
+  for (size_t c = 0; c < canais; c++)
+    out[c] = getU16(d + RAW_CABECALHO_LEN + 2 * c);
+
+  const uint8_t *bits = d + ini;
+  size_t maxBits = (len - ini) * 8;
+  size_t pos = 0;
+  for (size_t i = 1; i < cab.n;) {
+    size_t g = cab.n - i < RAW_GRUPO ? cab.n - i : RAW_GRUPO;
+    for (size_t c = 0; c < canais; c++) {
+      uint32_t w, z;
+      if (!lerBits(bits, maxBits, pos, RAW_LARGURA_BITS, w))
+        return -1;
+      int32_t v = out[(i - 1) * canais + c];
+      for (size_t k = 0; k < g; k++) {
+        if (!lerBits(bits, maxBits, pos, (uint8_t)w, z))
+          return -1;
+        v += deszigzag(z);
+        out[(i + k) * canais + c] = (uint16_t)v;
+      }
+    }
+    i += g;
+  }
+  return cab.n;
+}
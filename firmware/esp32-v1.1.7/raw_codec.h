@@ -0,0 +1,71 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include "eog_acq.h"
+
+// =================== EOG EM BRUTO (RAW=1) ===================
+// Todas as amostras de todos os canais, sem perdas, em blocos comprimidos
+// com delta + zigzag + bits justos. Cada bloco é uma notificação e
+// descodifica-se sozinho (little-endian, bits do menos significativo):
+//
+//   0  u8   RT_FRAME_MAGIC
+//   1  u8   RT_FRAME_VERSION
+//   2  u8   RT_FRAME_TYPE_RAW
+//   3  u16  seq (por bloco; um buraco = bloco perdido)
+//   5  u32  t0 (µs da 1ª amostra, relógio da aquisição)
+//   9  u16  fs (Hz)
+//   11 u8   canais
+//   12 u8   n (amostras por canal, incluindo a 1ª)
+//   13 canais x u16 1ª amostra
+//   .. as n - 1 seguintes em grupos de RAW_GRUPO; em cada grupo, por canal,
+//      u4 largura w e depois w bits por amostra com o zigzag da diferença à
+//      anterior (w = 0: repete a anterior)
+//
+// As amostras são de 12 bits (ADC), por isso w <= 13. Um canal parado custa
+// ~2-3 bits por amostra, uma piscadela só alarga os grupos onde está.
+
+#define RAW_CABECALHO_LEN 13
+#define RAW_GRUPO 16
+#define RAW_LARGURA_BITS 4
+// amostras à espera de ir no ar: ~1 s a 250 Hz; potência de 2
+#define RAW_BUF_AMOSTRAS 256
+
+class RawCodificador {
+public:
+  void reset(uint16_t fsHz, uint8_t canais);
+  // FS=: só para os blocos seguintes (quem chama já enviou os pendentes)
+  void mudarFs(uint16_t fsHz) { fs_ = fsHz; }
+  // a amostra mais antiga é descartada (e contada) se o buffer estiver cheio
+  void add(uint32_t tUs, const uint16_t *eog);
+  size_t pendentes() const { return fim_ - inicio_; }
+  uint32_t primeiroUs() const;
+  // um bloco com as amostras pendentes que couberem em maxLen; 0 se não
+  // há pendentes ou maxLen nem leva o cabeçalho
+  size_t montar(uint8_t *out, size_t maxLen);
+  uint32_t perdidas() const { return perdidas_; }
+
+private:
+  uint32_t tUs_[RAW_BUF_AMOSTRAS];
+  uint16_t eog_[ACQ_CANAIS_MAX][RAW_BUF_AMOSTRAS]; // por canal (SoA)
+  uint32_t inicio_ = 0;
+  uint32_t fim_ = 0;
+  uint32_t perdidas_ = 0;
+  uint16_t seq_ = 0;
+  uint16_t fs_ = 0;
+  uint8_t canais_ = 1;
+  // larguras de um grupo de g diferenças a partir da posição i do buffer
+  size_t larguras(uint32_t i, size_t g, uint8_t *w) const;
+};
+
+struct RawBloco {
+  uint16_t seq;
+  uint32_t t0Us;
+  uint16_t fsHz;
+  uint8_t canais;
+  uint8_t n;
+};
+// bloco -> amostras intercaladas (out[i * canais + c]); devolve n, ou -1 se
+// a trama não é um bloco RAW válido ou não cabe em maxValores
+int rawDescodificar(const uint8_t *d, size_t len, RawBloco &cab, uint16_t *out,
+                    size_t maxValores);
@@ -0,0 +1,286 @@
+#include "rec_sessao.h"
+
+#include <string.h>
+
+#include "hal.h"
+#include "rt_frame.h"
+
+static bool recOk = false;
+static uint32_t recNumBlocos = 0;
+static uint32_t recUsados = 0;
+static uint32_t recSetor = 0; // próximo setor a escrever (= o mais antigo)
+static uint32_t recSeq = 1;
+static uint16_t recSessao = 0;
+static uint32_t recFalhas = 0;
+
+// bloco em construção (RAM)
+static bool recAberta = false;
+static uint8_t recBloco[REC_BLOCO_BYTES];
+static size_t recPos = REC_CABECALHO_LEN;
+static int recRunPos = -1; // byte n da corrida de amostras aberta
+static int recAnterior = 0;
+static bool recPrecisaTempo = true;
+static uint32_t recT0 = 0;
+static uint32_t recProxUs = 0;
+static uint32_t recPeriodoUs = 4000;
+
+static inline void putU16(uint8_t *p, uint16_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+}
+static inline void putU32(uint8_t *p, uint32_t v) {
+  putU16(p, (uint16_t)v);
+  putU16(p + 2, (uint16_t)(v >> 16));
+}
+static inline uint16_t getU16(const uint8_t *p) {
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+static inline uint32_t getU32(const uint8_t *p) {
+  return getU16(p) | ((uint32_t)getU16(p + 2) << 16);
+}
+
+uint32_t recCrc32(const uint8_t *data, size_t len) {
+  uint32_t crc = 0xFFFFFFFFUL;
+  for (size_t i = 0; i < len; i++) {
+    crc ^= data[i];
+    for (int b = 0; b < 8; b++)
+      crc = (crc >> 1) ^ (0xEDB88320UL & (0 - (crc & 1)));
+  }
+  return ~crc;
+}
+
+// ---- escrita de registos no bloco em RAM ----
+static inline void put8(uint8_t v) { recBloco[recPos++] = v; }
+static void putV(uint32_t v) {
+  while (v >= 0x80) {
+    put8((uint8_t)(v | 0x80));
+    v >>= 7;
+  }
+  put8((uint8_t)v);
+}
+static void putZ(int32_t v) { putV(((uint32_t)v << 1) ^ (uint32_t)(v >> 31)); }
+static void putU32Reg(uint32_t v) {
+  putU32(recBloco + recPos, v);
+  recPos += 4;
+}
+
+static bool cabecalhoValido(const uint8_t *cab) {
+  return getU32(cab) == REC_MAGIC && getU32(cab + 4) != 0xFFFFFFFFUL &&
+         getU16(cab + 10) <= REC_BLOCO_BYTES - REC_CABECALHO_LEN;
+}
+
+static void abrirBloco() {
+  recPos = REC_CABECALHO_LEN;
+  recRunPos = -1;
+  recAnterior = 0;
+  recPrecisaTempo = true;
+  recT0 = halMicros();
+}
+
+static void gravarBloco() {
+  if (recPos == REC_CABECALHO_LEN)
+    return;
+  size_t len = recPos - REC_CABECALHO_LEN;
+  putU32(recBloco, REC_MAGIC);
+  putU32(recBloco + 4, recSeq);
+  putU16(recBloco + 8, recSessao);
+  putU16(recBloco + 10, (uint16_t)len);
+  putU32(recBloco + 12, recT0);
+  putU32(recBloco + 16, recCrc32(recBloco + REC_CABECALHO_LEN, len));
+  uint32_t base = recSetor * REC_BLOCO_BYTES;
+  uint8_t antigo[REC_CABECALHO_LEN];
+  bool reescreve =
+      halStorageRead(base, antigo, sizeof(antigo)) && cabecalhoValido(antigo);
+  if (!halStorageErase(base, REC_BLOCO_BYTES) ||
+      !halStorageWrite(base, recBloco, recPos)) {
+    recFalhas++;
+    return; // o setor fica como estiver; o bloco perde-se
+  }
+  if (!reescreve && recUsados < recNumBlocos)
+    recUsados++;
+  recSeq++;
+  recSetor = (recSetor + 1) % recNumBlocos;
+}
+
+// fecha o bloco se os próximos n bytes já não cabem
+static void garantirEspaco(size_t n) {
+  if (recPos + n <= REC_BLOCO_BYTES)
+    return;
+  gravarBloco();
+  abrirBloco();
+}
+
+bool recBegin() {
+  recOk = false;
+  if (!halStorageBegin())
+    return false;
+  recNumBlocos = halStorageSize() / REC_BLOCO_BYTES;
+  if (recNumBlocos < 2)
+    return false;
+  // o bloco com o seq mais alto é o último escrito
+  uint32_t maxSeq = 0;
+  recUsados = 0;
+  recSetor = 0;
+  for (uint32_t i = 0; i < recNumBlocos; i++) {
+    uint8_t cab[REC_CABECALHO_LEN];
+    if (!halStorageRead(i * REC_BLOCO_BYTES, cab, sizeof(cab)) ||
+        !cabecalhoValido(cab))
+      continue;
+    recUsados++;
+    uint32_t seq = getU32(cab + 4);
+    if (seq > maxSeq) {
+      maxSeq = seq;
+      recSetor = (i + 1) % recNumBlocos;
+      recSessao = getU16(cab + 8);
+    }
+  }
+  recSeq = maxSeq + 1;
+  recOk = true;
+  return true;
+}
+
+uint16_t recIniciarSessao(uint16_t fsHz, int limiarInferior,
+                          int amplitudeMin) {
+  if (!recOk)
+    return 0;
+  if (recAberta)
+    recTerminarSessao();
+  recSessao = recSessao == 0xFFFF ? 1 : recSessao + 1;
+  recPeriodoUs = 1000000UL / fsHz;
+  recAberta = true;
+  abrirBloco();
+  put8(REC_INICIO);
+  putV(fsHz);
+  putV((uint32_t)limiarInferior);
+  putV((uint32_t)amplitudeMin);
+  return recSessao;
+}
+
+void recAmostra(const AcqSample &s) {
+  if (!recAberta)
+    return;
+  // pior caso: TEMPO (5) + início de corrida (2) + delta de 12 bits (2)
+  garantirEspaco(9);
+  int32_t desvio = (int32_t)(s.tUs - recProxUs);
+  int32_t tolerancia = (int32_t)(recPeriodoUs / 2);
+  if (recPrecisaTempo || desvio > tolerancia || desvio < -tolerancia) {
+    put8(REC_TEMPO);
+    putU32Reg(s.tUs);
+    recRunPos = -1;
+    recPrecisaTempo = false;
+  }
+  if (recRunPos < 0 || recBloco[recRunPos] == 255) {
+    put8(REC_AMOSTRAS);
+    recRunPos = (int)recPos;
+    put8(0);
+  }
+  putZ((int32_t)s.eog[0] - recAnterior);
+  recAnterior = s.eog[0];
+  recBloco[recRunPos]++;
+  recProxUs = s.tUs + recPeriodoUs;
+}
+
+void recPiscadela(const BlinkEvent &ev) {
+  if (!recAberta)
+    return;
+  garantirEspaco(2 + 5 * 4);
+  put8(REC_PISCADELA);
+  put8((uint8_t)ev.cls);
+  putZ((int32_t)(ev.tPicoUs - recT0) / 1000);
+  putV((uint32_t)(ev.duracaoMs + 0.5f));
+  putV((uint32_t)(ev.amplitude + 0.5f));
+  putV((uint32_t)(ev.velMaxDesc * 100 + 0.5f));
+  recRunPos = -1;
+}
+
+void recMinuto(uint32_t minuto, uint16_t normais, uint16_t lentas, bool sono) {
+  if (!recAberta)
+    return;
+  garantirEspaco(2 + 5 * 3);
+  put8(REC_MINUTO);
+  putV(minuto);
+  putV(normais);
+  putV(lentas);
+  put8(sono ? 1 : 0);
+  recRunPos = -1;
+}
+
+void recTerminarSessao() {
+  if (!recAberta)
+    return;
+  garantirEspaco(1);
+  put8(REC_FIM);
+  gravarBloco();
+  recAberta = false;
+}
+
+void recInfo(RecInfo &out) {
+  out.blocos = recOk ? recNumBlocos : 0;
+  out.usados = recUsados;
+  out.sessao = recSessao;
+  out.aGravar = recAberta;
+  out.falhas = recFalhas;
+}
+
+// =================== DESCARGA ===================
+static bool dlAtivo = false;
+static uint16_t dlSessao = 0;
+static uint32_t dlSetor = 0;
+static uint32_t dlRestantes = 0; // setores por ver
+static uint32_t dlBase = 0;
+static uint16_t dlLen = 0;
+static uint16_t dlOffset = 0;
+static uint16_t dlSeqTrama = 0;
+static uint16_t dlBlocos = 0;
+
+bool recDescargaBegin(uint16_t sessao) {
+  if (!recOk || recAberta)
+    return false;
+  dlSessao = sessao ? sessao : recSessao;
+  dlSetor = recSetor; // o mais antigo
+  dlRestantes = recNumBlocos;
+  dlLen = 0;
+  dlOffset = 0;
+  dlSeqTrama = 0;
+  dlBlocos = 0;
+  dlAtivo = true;
+  return true;
+}
+
+size_t recDescargaNext(uint8_t *out, size_t maxLen) {
+  if (!dlAtivo || maxLen <= REC_TRAMA_CABECALHO_LEN)
+    return 0;
+  out[0] = RT_FRAME_MAGIC;
+  out[1] = RT_FRAME_VERSION;
+  putU16(out + 3, dlSeqTrama++);
+  while (dlOffset >= dlLen) {
+    if (dlRestantes == 0) {
+      out[2] = RT_FRAME_TYPE_REC_FIM;
+      putU16(out + 5, dlBlocos);
+      putU16(out + 7, dlSessao);
+      dlAtivo = false;
+      return REC_TRAMA_CABECALHO_LEN;
+    }
+    uint8_t cab[REC_CABECALHO_LEN];
+    uint32_t base = dlSetor * REC_BLOCO_BYTES;
+    dlSetor = (dlSetor + 1) % recNumBlocos;
+    dlRestantes--;
+    if (halStorageRead(base, cab, sizeof(cab)) && cabecalhoValido(cab) &&
+        getU16(cab + 8) == dlSessao) {
+      dlBase = base;
+      dlLen = (uint16_t)(REC_CABECALHO_LEN + getU16(cab + 10));
+      dlOffset = 0;
+      dlBlocos++;
+    }
+  }
+  size_t n = maxLen - REC_TRAMA_CABECALHO_LEN;
+  if (n > (size_t)(dlLen - dlOffset))
+    n = dlLen - dlOffset;
+  out[2] = RT_FRAME_TYPE_REC_BLOCO;
+  putU16(out + 5, dlOffset);
+  putU16(out + 7, dlLen);
+  if (!halStorageRead(dlBase + dlOffset, out + REC_TRAMA_CABECALHO_LEN, n))
+    memset(out + REC_TRAMA_CABECALHO_LEN, 0xFF, n); // o CRC vai falhar
+  dlOffset += (uint16_t)n;
+  return REC_TRAMA_CABECALHO_LEN + n;
+}
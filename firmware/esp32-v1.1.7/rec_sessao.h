@@ -0,0 +1,76 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include "blink_detector.h"
+#include "eog_acq.h"
+
+// =================== GRAVADOR DE SESSÃO (flash) ===================
+// Cada sessão S grava as amostras EOG em bruto, as piscadelas e os resumos
+// de minuto numa partição de flash usada como anel de blocos (um bloco = um
+// setor). Quando a partição enche, os blocos mais antigos são reescritos. O
+// bloco vai para a flash quando enche (~15 s a 250 Hz) e no fim da sessão.
+//
+// Bloco (little-endian):
+//   0  u32 REC_MAGIC
+//   4  u32 seq (cresce em toda a partição; 0xFFFFFFFF = setor apagado)
+//   8  u16 sessão
+//   10 u16 len (bytes de registos)
+//   12 u32 t0 (µs, halMicros quando o bloco abriu)
+//   16 u32 crc32 dos registos
+//   20 registos
+//
+// Registos (tag + campos; V = varint LEB128, Z = varint zigzag):
+//   REC_INICIO    V fs_hz, V limiarInferior, V amplitudeMin
+//   REC_TEMPO     u32 tUs da amostra seguinte (no início de cada bloco e
+//                 depois de um buraco na amostragem)
+//   REC_AMOSTRAS  u8 n, n x Z (eog do canal 0 - eog anterior; o anterior
+//                 começa a 0 em cada bloco)
+//   REC_PISCADELA u8 classe, Z tPico (ms desde t0), V duração ms,
+//                 V amplitude, V velMaxDesc x100
+//   REC_MINUTO    V minuto, V normais, V lentas, u8 sono
+//   REC_FIM       fim da sessão
+// Cada bloco descodifica-se sozinho: um bloco perdido não estraga os outros.
+//
+// Descarga (DL): tramas REC_BLOCO com pedaços dos blocos tal como estão na
+// flash (o cliente confirma o CRC) e uma REC_FIM no fim (ver rt_frame.h).
+
+#define REC_MAGIC 0x52474F45UL // "EOGR"
+#define REC_BLOCO_BYTES 4096
+#define REC_CABECALHO_LEN 20
+
+#define REC_INICIO 0x10
+#define REC_TEMPO 0x11
+#define REC_AMOSTRAS 0x12
+#define REC_PISCADELA 0x13
+#define REC_MINUTO 0x14
+#define REC_FIM 0x15
+
+// trama de descarga: magic, versão, tipo, u16 seq, u16 offset no bloco,
+// u16 tamanho do bloco, dados
+#define REC_TRAMA_CABECALHO_LEN 9
+
+struct RecInfo {
+  uint32_t blocos; // capacidade (0 = sem partição)
+  uint32_t usados; // blocos com dados válidos
+  uint16_t sessao; // última sessão (a gravar, se houver uma aberta)
+  bool aGravar;
+  uint32_t falhas; // blocos perdidos (erro a apagar/escrever a flash)
+};
+
+// monta a partição e encontra o fim do anel; false se não há partição
+bool recBegin();
+uint16_t recIniciarSessao(uint16_t fsHz, int limiarInferior, int amplitudeMin);
+void recAmostra(const AcqSample &s);
+void recPiscadela(const BlinkEvent &ev);
+void recMinuto(uint32_t minuto, uint16_t normais, uint16_t lentas, bool sono);
+// REC_FIM e grava o bloco pendente (a escrita da flash bloqueia ~50 ms)
+void recTerminarSessao();
+void recInfo(RecInfo &out);
+
+// descarga: sessao 0 = a última
+bool recDescargaBegin(uint16_t sessao);
+// próxima trama (até maxLen bytes) em out; 0 quando acabou
+size_t recDescargaNext(uint8_t *out, size_t maxLen);
+
+uint32_t recCrc32(const uint8_t *data, size_t len);
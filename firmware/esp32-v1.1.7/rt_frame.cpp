@@ -0,0 +1,171 @@
+#include "rt_frame.h"
+
+#include <stdio.h>
+
+#include "blink_detector.h"
+
+static inline void putU16(uint8_t *p, uint16_t v) {
+  p[0] = (uint8_t)v;
+  p[1] = (uint8_t)(v >> 8);
+}
+static inline void putU32(uint8_t *p, uint32_t v) {
+  putU16(p, (uint16_t)v);
+  putU16(p + 2, (uint16_t)(v >> 16));
+}
+
+void RtFrameBuilder::reset(uint8_t dtMs, uint8_t canais) {
+  dt_ = dtMs;
+  canais_ = canais ? canais : 1;
+  n_ = 0;
+}
+
+bool RtFrameBuilder::hasRoom(size_t maxLen) const {
+  if (maxLen > RT_FRAME_MAX_LEN)
+    maxLen = RT_FRAME_MAX_LEN;
+  size_t next = cabecalho() + ((size_t)n_ + 1) * amostraLen();
+  return n_ < 255 && next <= maxLen;
+}
+
+bool RtFrameBuilder::add(uint32_t tMs, const uint16_t *eog, int16_t rollDg,
+                         int16_t pitchDg, size_t maxLen) {
+  if (!hasRoom(maxLen))
+    return false;
+  uint8_t *p = buf_ + cabecalho() + (size_t)n_ * amostraLen();
+  if (n_ == 0)
+    t0_ = tMs;
+  for (uint8_t c = 0; c < canais_; c++, p += 2)
+    putU16(p, eog[c]);
+  putU16(p, (uint16_t)rollDg);
+  putU16(p + 2, (uint16_t)pitchDg);
+  n_++;
+  return true;
+}
+
+size_t RtFrameBuilder::finish(const uint8_t *&out) {
+  buf_[0] = RT_FRAME_MAGIC;
+  buf_[1] = RT_FRAME_VERSION;
+  buf_[2] = canais_ > 1 ? RT_FRAME_TYPE_RT_MC : RT_FRAME_TYPE_RT;
+  putU16(buf_ + 3, seq_++);
+  putU32(buf_ + 5, t0_);
+  buf_[9] = dt_;
+  buf_[10] = n_;
+  if (canais_ > 1)
+    buf_[11] = canais_;
+  out = buf_;
+  size_t len = cabecalho() + (size_t)n_ * amostraLen();
+  n_ = 0;
+  return len;
+}
+
+static inline void putU16Sat(uint8_t *p, float v) {
+  putU16(p, v <= 0 ? 0 : v >= 65535.0f ? 0xFFFF : (uint16_t)(v + 0.5f));
+}
+
+size_t rtMontarPiscadela(uint8_t *out, uint16_t seq, uint8_t canal,
+                         const BlinkEvent &ev, uint32_t ibiMs) {
+  float abertura = (float)(ev.valorFim - ev.pico);
+  out[0] = RT_FRAME_MAGIC;
+  out[1] = RT_FRAME_VERSION;
+  out[2] = RT_FRAME_TYPE_PISCADELA;
+  putU16(out + 3, seq);
+  putU32(out + 5, ev.tInicioUs);
+  out[9] = (uint8_t)ev.cls;
+  out[10] = canal;
+  putU16Sat(out + 11, (float)ev.pico);
+  putU16Sat(out + 13, ev.amplitude);
+  putU16Sat(out + 15, ev.duracaoMs);
+  putU16Sat(out + 17, ev.derivada * 1000.0f);
+  putU16Sat(out + 19, ev.velMaxDesc * 1000.0f);
+  putU16Sat(out + 21, ev.duracaoAberturaMs);
+  putU16Sat(out + 23, ev.duracaoAberturaMs > 0
+                          ? abertura * 1000.0f / ev.duracaoAberturaMs
+                          : 0);
+  putU16Sat(out + 25, ev.velMaxSubida * 1000.0f);
+  putU16Sat(out + 27, (float)ibiMs);
+  return RT_FRAME_PISCADELA_LEN;
+}
+
+static void putU64(uint8_t *p, uint64_t v) {
+  putU32(p, (uint32_t)v);
+  putU32(p + 4, (uint32_t)(v >> 32));
+}
+static uint64_t getU64(const uint8_t *p) {
+  uint64_t v = 0;
+  for (int i = 7; i >= 0; i--)
+    v = (v << 8) | p[i];
+  return v;
+}
+
+size_t rtMontarLigacao(uint8_t *out, uint32_t seq, uint64_t tUs,
+                       uint8_t flags, uint8_t fragmento) {
+  out[0] = RT_FRAME_MAGIC;
+  out[1] = RT_FRAME_VERSION;
+  out[2] = RT_FRAME_TYPE_LIGACAO;
+  putU32(out + 3, seq);
+  putU64(out + 7, tUs);
+  out[15] = flags;
+  out[16] = fragmento;
+  return RT_FRAME_LIGACAO_LEN;
+}
+
+size_t rtMontarSync(uint8_t *out, size_t maxLen, uint16_t id, uint64_t t1Us,
+                    uint32_t mensagens, uint32_t descartadas,
+                    uint32_t recusadas) {
+  if (maxLen < RT_FRAME_SYNC_LEN)
+    return 0;
+  out[0] = RT_FRAME_MAGIC;
+  out[1] = RT_FRAME_VERSION;
+  out[2] = RT_FRAME_TYPE_SYNC;
+  putU16(out + 3, id);
+  putU64(out + 5, t1Us);
+  putU32(out + 13, 0);
+  if (maxLen < RT_FRAME_SYNC_CONTADORES_LEN)
+    return RT_FRAME_SYNC_LEN;
+  putU32(out + 17, mensagens);
+  putU32(out + 21, descartadas);
+  putU32(out + 25, recusadas);
+  return RT_FRAME_SYNC_CONTADORES_LEN;
+}
+
+void rtSyncCarimbar(uint8_t *trama, uint64_t t2Us) {
+  putU32(trama + 13, (uint32_t)(t2Us - getU64(trama + 5)));
+}
+
+size_t rtMontarEstado(uint8_t *out, uint16_t seq, uint8_t nivel,
+                      uint16_t periodoMs, uint32_t descartadas,
+                      uint32_t recusadas, uint8_t ocupacao) {
+  out[0] = RT_FRAME_MAGIC;
+  out[1] = RT_FRAME_VERSION;
+  out[2] = RT_FRAME_TYPE_ESTADO;
+  putU16(out + 3, seq);
+  out[5] = nivel;
+  putU16(out + 6, periodoMs);
+  putU32(out + 8, descartadas);
+  putU32(out + 12, recusadas);
+  out[16] = ocupacao;
+  return RT_FRAME_ESTADO_LEN;
+}
+
+size_t rtFormatarJson(char *out, size_t max, uint32_t tMs,
+                      const uint16_t *eog, uint8_t canais, int16_t rollDg,
+                      int16_t pitchDg) {
+  int n = snprintf(out, max, "[\"RT\",%lu,%d,%.1f,%.1f", (unsigned long)tMs,
+                   (int)eog[0], rollDg / 10.0, pitchDg / 10.0);
+  for (uint8_t c = 1; c < canais; c++)
+    n += snprintf(out + n, max - n, ",%u", (unsigned)eog[c]);
+  n += snprintf(out + n, max - n, "]");
+  return (size_t)n < max ? (size_t)n : max - 1;
+}
+
+size_t rtFormatarMinuto(char *out, size_t max, uint32_t minutoN,
+                        const uint16_t *normais, const uint16_t *lentas,
+                        uint8_t canais, bool sono) {
+  int n = snprintf(out, max, "[\"M%lu\",%u,%u,\"%s\"",
+                   (unsigned long)minutoN, (unsigned)normais[0],
+                   (unsigned)lentas[0], sono ? "S-" : "NS-");
+  for (uint8_t c = 1; c < canais; c++)
+    n += snprintf(out + n, max - n, ",%u,%u", (unsigned)normais[c],
+                  (unsigned)lentas[c]);
+  n += snprintf(out + n, max - n, "]");
+  return (size_t)n < max ? (size_t)n : max - 1;
+}
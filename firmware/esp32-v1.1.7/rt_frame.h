@@ -0,0 +1,160 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include "eog_acq.h"
+
+// =================== TRAMA RT BINÁRIA (opt-in com RTB=hz) ===================
+// Alternativa compacta ao ["RT",ts,eog,roll,pitch] em texto. Cada notificação
+// BLE leva uma trama inteira com várias amostras (little-endian):
+//
+//   0  u8   RT_FRAME_MAGIC (0xA5; nunca é o 1º byte de uma linha de texto)
+//   1  u8   RT_FRAME_VERSION
+//   2  u8   RT_FRAME_TYPE_RT
+//   3  u16  seq (incrementa por trama, dá a volta)
+//   5  u32  t0 (ms, millis() da 1ª amostra)
+//   9  u8   dt (ms entre amostras)
+//   10 u8   n (amostras na trama)
+//   11 n x { u16 eog; i16 roll*10; i16 pitch*10 }
+//
+// O JSON continua a ser o formato por omissão (apps antigas).
+//
+// Com mais de um canal EOG a trama é RT_FRAME_TYPE_RT_MC: o mesmo cabeçalho
+// mais 11 u8 canais, e cada amostra é { u16 eog[canais]; i16 roll*10;
+// i16 pitch*10 }. Com um canal sai a RT de sempre.
+
+#define RT_FRAME_MAGIC 0xA5
+#define RT_FRAME_VERSION 1
+#define RT_FRAME_TYPE_RT 0x01
+// descarga do gravador (rec_sessao.h): pedaço de bloco e fim da descarga
+#define RT_FRAME_TYPE_REC_BLOCO 0x02
+#define RT_FRAME_TYPE_REC_FIM 0x03
+// resposta a um comando (cmd_fila.h):
+//   3 u16 seq do comando, 5 u8 opcode (0 = texto), 6 u8 CmdEstado,
+//   7 u32 latência em µs da receção ao fim da execução
+#define RT_FRAME_TYPE_ACK 0x04
+// telemetria de perfil (perfil.h, TLM=s)
+#define RT_FRAME_TYPE_STATS 0x05
+// RT com vários canais EOG (ver acima)
+#define RT_FRAME_TYPE_RT_MC 0x06
+// teste de débito (TPUT): 3 u16 seq, 5 u32 ms, resto enchimento
+#define RT_FRAME_TYPE_TPUT 0x07
+// EOG em bruto comprimido, todas as amostras (raw_codec.h, RAW=1)
+#define RT_FRAME_TYPE_RAW 0x08
+// uma piscadela (evento fechado do detetor) em S, com EVT=1 (ver abaixo)
+#define RT_FRAME_TYPE_PISCADELA 0x09
+// comando binário app -> firmware (escrito na RX, não notificado)
+#define RT_FRAME_TYPE_CMD 0x10
+#define RT_FRAME_HEADER_LEN 11
+#define RT_FRAME_SAMPLE_LEN 6
+#define RT_FRAME_MC_HEADER_LEN 12
+// maior payload de notificação que usamos (MTU 247 - 3)
+#define RT_FRAME_MAX_LEN 244
+
+// ---- trama de evento (EVT=1), RT_FRAME_PISCADELA_LEN bytes ----
+//   3  u16 seq (por evento)
+//   5  u32 início (µs, relógio da aquisição, como o RAW)
+//   9  u8  BlinkClass, 10 u8 canal
+//   11 u16 pico (ADC), 13 u16 amplitude (contagens)
+//   15 u16 fecho (ms, início -> pico), 17 u16 velocidade média de fecho,
+//   19 u16 velocidade máxima de fecho
+//   21 u16 reabertura (ms, pico -> limiar), 23 u16 velocidade média de
+//   reabertura, 25 u16 velocidade máxima de reabertura
+//   27 u16 IBI (ms desde o pico anterior no canal; 0 = o primeiro)
+// Velocidades em contagens/s. Tudo satura em 0xFFFF.
+#define RT_FRAME_PISCADELA_LEN 29
+struct BlinkEvent;
+size_t rtMontarPiscadela(uint8_t *out, uint16_t seq, uint8_t canal,
+                         const BlinkEvent &ev, uint32_t ibiMs);
+
+// ---- envelope de ligação (SEQ=1) ----
+// Cada notificação, de texto ou binária, vai dentro de um envelope que a
+// fila de envio (ble_tx.h) põe ao enviar:
+//   3  u32 seq (por mensagem, contando as descartadas: um buraco = perdida)
+//   7  u64 µs do dispositivo quando a mensagem entrou na fila (halMicros64)
+//   15 u8  RT_LIGACAO_TEXTO, RT_LIGACAO_CONTINUA
+//   16 u8  fragmento (0, 1, ... dentro da mesma linha)
+//   17 a trama inteira, ou um pedaço da linha como sem SEQ (o último acaba
+//      em '\n'); as tramas encolhem RT_FRAME_LIGACAO_LEN bytes para caber
+#define RT_FRAME_TYPE_LIGACAO 0x0A
+#define RT_FRAME_LIGACAO_LEN 17
+#define RT_LIGACAO_TEXTO 0x01
+#define RT_LIGACAO_CONTINUA 0x02 // a linha segue na notificação seguinte
+size_t rtMontarLigacao(uint8_t *out, uint32_t seq, uint64_t tUs,
+                       uint8_t flags, uint8_t fragmento);
+
+// ---- resposta a SYNC=id (acerto de relógio, como o NTP) ----
+//   3  u16 id (o do pedido)
+//   5  u64 t1: µs do dispositivo quando o pedido chegou
+//   13 u32 t2 - t1: µs até a resposta sair para o rádio
+// e, se o MTU deixar, os contadores da fila de envio (ble_tx.h):
+//   17 u32 mensagens postas na fila (o seq seguinte), 21 u32 descartadas
+//   (fila cheia ou sem espaço), 25 u32 notificações recusadas pelo rádio
+// Com t0 e t3 da app (envio e receção): desvio do relógio = ((t1 - t0) +
+// (t2 - t3)) / 2 e ida e volta no ar = (t3 - t0) - (t2 - t1).
+#define RT_FRAME_TYPE_SYNC 0x0B
+#define RT_FRAME_SYNC_LEN 17
+#define RT_FRAME_SYNC_CONTADORES_LEN 29
+size_t rtMontarSync(uint8_t *out, size_t maxLen, uint16_t id, uint64_t t1Us,
+                    uint32_t mensagens, uint32_t descartadas,
+                    uint32_t recusadas);
+// t2: a fila de envio chama-a mesmo antes do notify
+void rtSyncCarimbar(uint8_t *trama, uint64_t t2Us);
+
+// ---- estado do RT adaptativo (ligação congestionada) ----
+//   3  u16 seq (por trama enviada)
+//   5  u8  nível (0 = ritmo pedido; cada nível divide o ritmo por 2 e os
+//          pontos passam a médias das amostras do intervalo)
+//   6  u16 período atual dos pontos RT em ms
+//   8  u32 pontos RT descartados para esta central (anel RT cheio)
+//   12 u32 notificações RT recusadas pelo rádio a esta central
+//   16 u8  ocupação do anel RT desta central
+// Sai a cada mudança de nível e, enquanto o nível não é 0, periodicamente,
+// só no fluxo RT e só para as centrais que já esperam tramas binárias
+// (RTB=, SEQ=1 ou SUB= explícito): as apps de texto colavam-na à linha.
+#define RT_FRAME_TYPE_ESTADO 0x0C
+#define RT_FRAME_ESTADO_LEN 17
+size_t rtMontarEstado(uint8_t *out, uint16_t seq, uint8_t nivel,
+                      uint16_t periodoMs, uint32_t descartadas,
+                      uint32_t recusadas, uint8_t ocupacao);
+
+// ---- texto (JSON, o formato por omissão) ----
+// ["RT",ts,eog0,roll,pitch(,eog1...)]: os canais extra vão no fim
+#define RT_JSON_MAX (64 + 6 * ACQ_CANAIS_MAX)
+size_t rtFormatarJson(char *out, size_t max, uint32_t tMs,
+                      const uint16_t *eog, uint8_t canais, int16_t rollDg,
+                      int16_t pitchDg);
+// ["M#",normais,lentas,"S-/NS-"(,normais1,lentas1...)]
+#define RT_MINUTO_MAX (48 + 12 * ACQ_CANAIS_MAX)
+size_t rtFormatarMinuto(char *out, size_t max, uint32_t minutoN,
+                        const uint16_t *normais, const uint16_t *lentas,
+                        uint8_t canais, bool sono);
+
+class RtFrameBuilder {
+public:
+  void reset(uint8_t dtMs, uint8_t canais = 1);
+  // false se a amostra já não cabe em maxLen (quem chama envia e recomeça)
+  // eog: um valor por canal; roll/pitch em décimas de grau
+  bool add(uint32_t tMs, const uint16_t *eog, int16_t rollDg, int16_t pitchDg,
+           size_t maxLen);
+  // ainda cabe mais uma amostra numa notificação de maxLen bytes?
+  bool hasRoom(size_t maxLen) const;
+  size_t count() const { return n_; }
+  uint8_t dtMs() const { return dt_; }
+  uint8_t canais() const { return canais_; }
+  uint32_t firstMs() const { return t0_; }
+  // fecha a trama (cabeçalho + amostras) e devolve o comprimento
+  size_t finish(const uint8_t *&out);
+
+private:
+  uint8_t buf_[RT_FRAME_MAX_LEN];
+  uint16_t seq_ = 0;
+  uint32_t t0_ = 0;
+  uint8_t dt_ = 0;
+  uint8_t n_ = 0;
+  uint8_t canais_ = 1;
+  size_t cabecalho() const {
+    return canais_ > 1 ? RT_FRAME_MC_HEADER_LEN : RT_FRAME_HEADER_LEN;
+  }
+  size_t amostraLen() const { return RT_FRAME_SAMPLE_LEN + 2 * (canais_ - 1); }
+};
@@ -0,0 +1,110 @@
+#include "sintetico.h"
+
+#include <math.h>
+
+#define PI_F 3.14159265f
+
+void sintOmissao(SintParams &p) {
+  p.fsHz = 250;
+  p.bpm = 15;
+  p.fracLentas = 0.2f;
+  p.normal = {150, 40, 80};
+  p.lenta = {130, 260, 250};
+  p.variacao = 0.2f;
+  p.forma = SINT_FORMA_COS;
+  p.base = 2048;
+  p.ruido = 3;
+  p.deriva = 10;
+  p.derivaPeriodoS = 30;
+  p.semente = 0x2545F491;
+}
+
+// xorshift32 + Box-Muller, como o ruído do ADC do host
+float GeradorEog::uniforme() {
+  estado_ ^= estado_ << 13;
+  estado_ ^= estado_ >> 17;
+  estado_ ^= estado_ << 5;
+  return (estado_ >> 8) * (1.0f / 16777216.0f);
+}
+float GeradorEog::gaussiana() {
+  float u = uniforme();
+  if (u < 1e-7f)
+    u = 1e-7f;
+  return sqrtf(-2 * logf(u)) * cosf(2 * PI_F * uniforme());
+}
+
+void GeradorEog::begin(const SintParams &p) {
+  p_ = p;
+  estado_ = p.semente ? p.semente : 1;
+  k_ = 0;
+  emPiscadela_ = false;
+  nova_ = false;
+  agendar(0);
+}
+
+// a próxima, contada do início desta (o mínimo aplica-se quando acabar)
+void GeradorEog::agendar(uint32_t aPartirUs) {
+  if (p_.bpm <= 0) {
+    proximaUs_ = 0xFFFFFFFFUL;
+    return;
+  }
+  float u = uniforme();
+  if (u < 1e-7f)
+    u = 1e-7f;
+  proximaUs_ = aPartirUs + (uint32_t)(-logf(u) * 60e6f / p_.bpm);
+}
+
+uint16_t GeradorEog::proxima(uint32_t &tUs) {
+  tUs = (uint32_t)((uint64_t)k_ * 1000000ULL / p_.fsHz);
+  k_++;
+  if (!emPiscadela_ && tUs >= proximaUs_) {
+    const SintTipo &tipo = uniforme() < p_.fracLentas ? p_.lenta : p_.normal;
+    BlinkClass cls = &tipo == &p_.lenta ? BLINK_SLOW : BLINK_NORMAL;
+    float v = p_.variacao;
+    float fecho = tipo.fechoMs * (1 + v * (2 * uniforme() - 1));
+    float reab = tipo.reabMs * (1 + v * (2 * uniforme() - 1));
+    atual_.cls = cls;
+    atual_.amplitude = tipo.amplitude * (1 + v * (2 * uniforme() - 1));
+    atual_.tInicioUs = tUs;
+    atual_.tPicoUs = tUs + (uint32_t)(fecho * 1000);
+    atual_.tFimUs = atual_.tPicoUs + (uint32_t)(reab * 1000);
+    emPiscadela_ = true;
+    nova_ = true;
+    agendar(tUs);
+  }
+  float x = p_.base + p_.ruido * gaussiana();
+  if (p_.deriva != 0 && p_.derivaPeriodoS > 0)
+    x += p_.deriva * sinf(2 * PI_F * (tUs / 1e6f) / p_.derivaPeriodoS);
+  if (emPiscadela_) {
+    const SintPiscadela &b = atual_;
+    float fase; // 0 no nível, 1 no pico
+    if (tUs < b.tPicoUs)
+      fase = (float)(tUs - b.tInicioUs) / (float)(b.tPicoUs - b.tInicioUs);
+    else
+      fase = 1 - (float)(tUs - b.tPicoUs) / (float)(b.tFimUs - b.tPicoUs);
+    if (fase < 0)
+      fase = 0;
+    if (p_.forma == SINT_FORMA_COS)
+      fase = (1 - cosf(PI_F * fase)) / 2;
+    x -= b.amplitude * fase;
+    if (tUs >= b.tFimUs) {
+      emPiscadela_ = false;
+      uint32_t minimoUs = b.tFimUs + SINT_IBI_MIN_MS * 1000UL;
+      if (proximaUs_ < minimoUs)
+        proximaUs_ = minimoUs;
+    }
+  }
+  if (x < 0)
+    x = 0;
+  if (x > 4095)
+    x = 4095;
+  return (uint16_t)(x + 0.5f);
+}
+
+bool GeradorEog::novaPiscadela(SintPiscadela &out) {
+  if (!nova_)
+    return false;
+  nova_ = false;
+  out = atual_;
+  return true;
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <stdint.h>
+
+#include "blink_detector.h"
+
+// =================== EOG SINTÉTICO (bench.h) ===================
+// Um canal EOG com piscadelas de forma conhecida, ruído e deriva, gerado
+// amostra a amostra sem buffers (corre também no ESP32, no BENCH). Cada
+// piscadela gerada fica como verdade para medir o detetor.
+//
+// Piscadela: descida de `amplitude` em fechoMs e volta ao nível em reabMs,
+// em meio coseno (SINT_FORMA_COS) ou em rampa (SINT_FORMA_RAMPA). Os
+// intervalos seguem uma exponencial de média 60/bpm s, nunca menos de
+// SINT_IBI_MIN_MS entre o fim de uma e o início da seguinte. A deriva é uma
+// sinusoide lenta somada ao nível.
+
+#define SINT_IBI_MIN_MS 300
+
+enum SintForma : uint8_t { SINT_FORMA_COS = 0, SINT_FORMA_RAMPA = 1 };
+
+struct SintTipo {
+  float amplitude; // LSB do ADC
+  float fechoMs;   // início -> pico
+  float reabMs;    // pico -> nível
+};
+
+struct SintParams {
+  uint16_t fsHz;
+  float bpm;        // 0 = sem piscadelas
+  float fracLentas; // 0..1
+  SintTipo normal;
+  SintTipo lenta;
+  float variacao; // +- esta fração, ao acaso, em amplitude e tempos
+  SintForma forma;
+  float base;   // nível em repouso (ADC)
+  float ruido;  // desvio padrão (LSB)
+  float deriva; // amplitude da sinusoide (LSB)
+  float derivaPeriodoS;
+  uint32_t semente;
+};
+// uma condução típica a 250 Hz: 15 bpm, 20% lentas, ruído 3, deriva 10
+void sintOmissao(SintParams &p);
+
+struct SintPiscadela {
+  uint32_t tInicioUs;
+  uint32_t tPicoUs;
+  uint32_t tFimUs;
+  BlinkClass cls; // NORMAL ou SLOW
+  float amplitude;
+};
+
+class GeradorEog {
+public:
+  void begin(const SintParams &p);
+  // amostra seguinte (ADC 12 bits) e o seu instante
+  uint16_t proxima(uint32_t &tUs);
+  // a piscadela que começou na última amostra (a verdade chega antes de o
+  // detetor a poder ver)
+  bool novaPiscadela(SintPiscadela &out);
+
+private:
+  float uniforme();
+  float gaussiana();
+  void agendar(uint32_t aPartirUs);
+
+  SintParams p_ = {};
+  uint32_t estado_ = 1;
+  uint32_t k_ = 0; // amostras geradas
+  SintPiscadela atual_ = {};
+  bool emPiscadela_ = false;
+  bool nova_ = false;
+  uint32_t proximaUs_ = 0;
+};
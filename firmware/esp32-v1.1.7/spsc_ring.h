@@ -0,0 +1,92 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include <atomic>
+
+// Anel lock-free para exatamente UM produtor e UM consumidor (ex.: task do
+// timer de aquisição -> loop()). N tem de ser potência de 2.
+// push() só pode ser chamado pelo produtor; pop()/clear() só pelo consumidor.
+template <typename T, size_t N> class SpscRing {
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "N tem de ser potencia de 2");
+
+public:
+  bool push(const T &v) {
+    size_t h = head_.load(std::memory_order_relaxed);
+    size_t t = tail_.load(std::memory_order_acquire);
+    if (h - t >= N)
+      return false; // cheio: quem chama conta a perda
+    buf_[h & (N - 1)] = v;
+    head_.store(h + 1, std::memory_order_release);
+    return true;
+  }
+  bool pop(T &out) {
+    size_t t = tail_.load(std::memory_order_relaxed);
+    size_t h = head_.load(std::memory_order_acquire);
+    if (t == h)
+      return false;
+    out = buf_[t & (N - 1)];
+    tail_.store(t + 1, std::memory_order_release);
+    return true;
+  }
+  // descarta tudo o que já foi produzido (lado do consumidor)
+  void clear() {
+    tail_.store(head_.load(std::memory_order_acquire),
+                std::memory_order_release);
+  }
+  size_t size() const {
+    return head_.load(std::memory_order_acquire) -
+           tail_.load(std::memory_order_acquire);
+  }
+  static constexpr size_t capacity() { return N; }
+
+private:
+  T buf_[N];
+  std::atomic<size_t> head_{0};
+  std::atomic<size_t> tail_{0};
+};
+
+// Só os índices de um anel SPSC, para quem guarda os dados em vetores
+// paralelos (structure-of-arrays, um por campo ou por canal). O produtor
+// escreve em todos os vetores na posição de livre() e depois publicar();
+// o consumidor lê na posição de proxima() e depois consumir().
+template <size_t N> class SpscIndices {
+  static_assert(N >= 2 && (N & (N - 1)) == 0, "N tem de ser potencia de 2");
+
+public:
+  bool livre(size_t &pos) const {
+    size_t h = head_.load(std::memory_order_relaxed);
+    if (h - tail_.load(std::memory_order_acquire) >= N)
+      return false; // cheio: quem chama conta a perda
+    pos = h & (N - 1);
+    return true;
+  }
+  void publicar() {
+    head_.store(head_.load(std::memory_order_relaxed) + 1,
+                std::memory_order_release);
+  }
+  bool proxima(size_t &pos) const {
+    size_t t = tail_.load(std::memory_order_relaxed);
+    if (t == head_.load(std::memory_order_acquire))
+      return false;
+    pos = t & (N - 1);
+    return true;
+  }
+  void consumir() {
+    tail_.store(tail_.load(std::memory_order_relaxed) + 1,
+                std::memory_order_release);
+  }
+  void clear() {
+    tail_.store(head_.load(std::memory_order_acquire),
+                std::memory_order_release);
+  }
+  size_t size() const {
+    return head_.load(std::memory_order_acquire) -
+           tail_.load(std::memory_order_acquire);
+  }
+  static constexpr size_t capacity() { return N; }
+
+private:
+  std::atomic<size_t> head_{0};
+  std::atomic<size_t> tail_{0};
+};
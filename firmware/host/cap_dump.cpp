@@ -0,0 +1,222 @@
+// Descodifica a captura binária da USB (CAP=, captura_usb.h) em ficheiros
+// que o numpy/pandas leem diretamente (CSV com cabeçalho, só números):
+//
+//   PREFIXO_eog.csv  t_us,eog0[,eog1...]
+//   PREFIXO_acc.csv  t_us,x_q4,y_q4,z_q4 (média do ADC x16, como AccSample)
+//   PREFIXO_evt.csv  as colunas do eog_host -E (serve ao gerar_modelo)
+//   PREFIXO_log.txt  as linhas do log (também mostradas aqui, sem -q)
+//
+// Os instantes são os µs da aquisição desenrolados (não dão a volta aos
+// ~71 min). O texto antes da captura e os registos com o CRC errado são
+// saltados; os buracos no seq contam registos perdidos (USB cheia).
+//
+//   stty -F /dev/ttyUSB0 921600 raw && cap_dump -o sessao /dev/ttyUSB0
+//   eog_host -U usb.bin -c 500:usb:CAP=1 ... traço.csv && cap_dump usb.bin
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <string>
+#include <vector>
+
+#include "captura_usb.h"
+#include "rt_frame.h"
+
+static uint16_t lerU16(const uint8_t *p) {
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+static uint32_t lerU32(const uint8_t *p) {
+  return (uint32_t)lerU16(p) | ((uint32_t)lerU16(p + 2) << 16);
+}
+
+// relógio de 32 bits da aquisição -> 64 bits
+struct Desenrolar {
+  bool tem = false;
+  uint32_t ultimo = 0;
+  uint64_t base = 0;
+  uint64_t operator()(uint32_t t) {
+    // só conta como volta um salto grande para trás
+    if (tem && t < ultimo && ultimo - t > 0x80000000UL)
+      base += 0x100000000ULL;
+    tem = true;
+    ultimo = t;
+    return base + t;
+  }
+};
+
+static FILE *fEog, *fAcc, *fEvt, *fLog;
+static std::string prefixo = "captura";
+static bool mostrarLog = true;
+static uint8_t canaisEog = 0; // 0 = cabeçalho por escrever
+static Desenrolar tEog, tAcc, tEvt;
+
+struct Contagem {
+  unsigned long porTipo[8];
+  unsigned long crcMaus, cobsMaus, perdidos, desconhecidos, inicios;
+  unsigned long long lixo; // bytes de texto antes da captura, etc.
+  bool temSeq;
+  uint16_t seq;
+} cont;
+
+static FILE *abrir(const char *sufixo, const char *cabecalho) {
+  std::string nome = prefixo + sufixo;
+  FILE *f = fopen(nome.c_str(), "w");
+  if (!f) {
+    fprintf(stderr, "não consegui criar %s\n", nome.c_str());
+    exit(1);
+  }
+  if (cabecalho)
+    fputs(cabecalho, f);
+  return f;
+}
+
+static void registo(const uint8_t *r, size_t len) {
+  if (len < CAP_CABECALHO_LEN + CAP_CRC_LEN) {
+    cont.cobsMaus++;
+    return;
+  }
+  size_t n = len - CAP_CRC_LEN;
+  if (crc16Ccitt(r, n) != lerU16(r + n)) {
+    cont.crcMaus++;
+    return;
+  }
+  uint16_t seq = lerU16(r + 1);
+  if (cont.temSeq && !(r[0] == CAP_INICIO && seq == 0)) // CAP= de novo
+    cont.perdidos += (uint16_t)(seq - cont.seq - 1);
+  cont.temSeq = true;
+  cont.seq = seq;
+  const uint8_t *d = r + CAP_CABECALHO_LEN;
+  n -= CAP_CABECALHO_LEN;
+  if (r[0] < 8)
+    cont.porTipo[r[0]]++;
+  switch (r[0]) {
+  case CAP_INICIO:
+    if (n < 12)
+      break;
+    cont.inicios++;
+    fprintf(stderr, "início: versão %u, %u Hz, %u canais, %lu baud\n", d[0],
+            lerU16(d + 1), d[3], (unsigned long)lerU32(d + 4));
+    break;
+  case CAP_AMOSTRA: {
+    if (n < 6)
+      break;
+    uint8_t canais = (uint8_t)((n - 4) / 2);
+    if (canaisEog == 0) {
+      canaisEog = canais;
+      fprintf(fEog, "t_us");
+      for (uint8_t c = 0; c < canais; c++)
+        fprintf(fEog, ",eog%u", c);
+      fprintf(fEog, "\n");
+    }
+    fprintf(fEog, "%llu", (unsigned long long)tEog(lerU32(d)));
+    for (uint8_t c = 0; c < canaisEog; c++)
+      fprintf(fEog, ",%u", c < canais ? lerU16(d + 4 + 2 * c) : 0);
+    fprintf(fEog, "\n");
+    break;
+  }
+  case CAP_ACEL:
+    if (n < 10)
+      break;
+    fprintf(fAcc, "%llu,%u,%u,%u\n", (unsigned long long)tAcc(lerU32(d)),
+            lerU16(d + 4), lerU16(d + 6), lerU16(d + 8));
+    break;
+  case CAP_EVENTO:
+    if (n < RT_FRAME_PISCADELA_LEN || d[2] != RT_FRAME_TYPE_PISCADELA)
+      break;
+    fprintf(fEvt, "%llu,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u\n",
+            (unsigned long long)tEvt(lerU32(d + 5)), d[10], d[9],
+            lerU16(d + 11), lerU16(d + 13), lerU16(d + 15), lerU16(d + 17),
+            lerU16(d + 19), lerU16(d + 21), lerU16(d + 23), lerU16(d + 25),
+            lerU16(d + 27));
+    break;
+  case CAP_TEXTO:
+    fwrite(d, 1, n, fLog);
+    fputc('\n', fLog);
+    if (mostrarLog)
+      printf("%.*s\n", (int)n, (const char *)d);
+    break;
+  default:
+    cont.desconhecidos++;
+  }
+}
+
+int main(int argc, char **argv) {
+  int opt;
+  while ((opt = getopt(argc, argv, "o:qh")) != -1) {
+    switch (opt) {
+    case 'o':
+      prefixo = optarg;
+      break;
+    case 'q':
+      mostrarLog = false;
+      break;
+    default:
+      fprintf(stderr, "uso: %s [-o prefixo] [-q] captura.bin|/dev/tty...|-\n",
+              argv[0]);
+      return 2;
+    }
+  }
+  if (optind != argc - 1) {
+    fprintf(stderr, "uso: %s [-o prefixo] [-q] captura.bin|/dev/tty...|-\n",
+            argv[0]);
+    return 2;
+  }
+  FILE *in = strcmp(argv[optind], "-") == 0 ? stdin
+                                            : fopen(argv[optind], "rb");
+  if (!in) {
+    fprintf(stderr, "não consegui abrir %s\n", argv[optind]);
+    return 1;
+  }
+  fEog = abrir("_eog.csv", nullptr); // o cabeçalho depende dos canais
+  fAcc = abrir("_acc.csv", "t_us,x_q4,y_q4,z_q4\n");
+  fEvt = abrir("_evt.csv",
+               "t_us,canal,classe,pico,amplitude,fecho_ms,vel_fecho,"
+               "vel_max_fecho,reab_ms,vel_reab,vel_max_reab,ibi_ms\n");
+  fLog = abrir("_log.txt", nullptr);
+
+  // um registo codificado nunca passa disto; mais comprido é texto/lixo
+  const size_t maximo = CAP_COBS_MAX(CAP_REGISTO_MAX);
+  std::vector<uint8_t> cobs, reg(maximo);
+  uint8_t buf[4096];
+  ssize_t n; // read: numa porta série devolve o que já chegou
+  while ((n = read(fileno(in), buf, sizeof(buf))) > 0) {
+    for (ssize_t i = 0; i < n; i++) {
+      if (buf[i] != 0) {
+        if (cobs.size() < maximo)
+          cobs.push_back(buf[i]);
+        else
+          cont.lixo++;
+        continue;
+      }
+      size_t len = cobs.size() < maximo
+                       ? cobsDescodificar(cobs.data(), cobs.size(), reg.data())
+                       : 0;
+      if (len)
+        registo(reg.data(), len);
+      else if (cont.inicios == 0)
+        cont.lixo += cobs.size(); // o texto antes do CAP=
+      else
+        cont.cobsMaus++;
+      cobs.clear();
+    }
+    if (in == stdin || strncmp(argv[optind], "/dev/", 5) == 0) {
+      fflush(fEog);
+      fflush(fLog);
+    }
+  }
+  if (in != stdin)
+    fclose(in);
+  fclose(fEog);
+  fclose(fAcc);
+  fclose(fEvt);
+  fclose(fLog);
+  fprintf(stderr,
+          "%lu amostras, %lu acelerómetro, %lu eventos, %lu linhas de log; "
+          "%lu perdidos (seq), %lu com CRC errado, %lu maus, %llu bytes "
+          "fora da captura\n",
+          cont.porTipo[CAP_AMOSTRA], cont.porTipo[CAP_ACEL],
+          cont.porTipo[CAP_EVENTO], cont.porTipo[CAP_TEXTO], cont.perdidos,
+          cont.crcMaus, cont.cobsMaus + cont.desconhecidos, cont.lixo);
+  return 0;
+}
@@ -0,0 +1,132 @@
+// Custo e efeito do EogDsp (eog_dsp.h) para cada OS= e FLT=: ns por leitura
+// do ADC neste CPU, desvio padrão do ruído à saída e profundidade de uma
+// piscadela sintética (para ver quanto o filtro a come).
+//
+//   dsp_bench [-f fs] [-N sigma] [-s segundos]
+//
+// O ESP32 a 240 MHz é ~10-20x mais lento do que um PC por MAC; a coluna
+// "ciclos" dá a ordem de grandeza pela frequência de -c (MHz).
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <vector>
+
+#include "eog_dsp.h"
+
+static uint32_t estado = 0x2545F491;
+static float uniforme() {
+  estado ^= estado << 13;
+  estado ^= estado >> 17;
+  estado ^= estado << 5;
+  return (estado >> 8) * (1.0f / 16777216.0f);
+}
+static float gaussiana() {
+  float u = uniforme();
+  if (u < 1e-7f)
+    u = 1e-7f;
+  return sqrtf(-2 * logf(u)) * cosf(6.2831853f * uniforme());
+}
+
+// sinal limpo: 2048 com deriva lenta e uma piscadela (-400, 200 ms) por s
+static float limpo(double t) {
+  float deriva = 60 * sinf(6.2831853f * 0.05f * (float)t);
+  double fase = t - floor(t);
+  float blink = 0;
+  if (fase > 0.4 && fase < 0.6)
+    blink = -400 * sinf(3.14159265f * (float)((fase - 0.4) / 0.2));
+  return 2048 + deriva + blink;
+}
+
+int main(int argc, char **argv) {
+  int fs = 250;
+  float sigma = 20;
+  int segundos = 60;
+  float mhz = 3000;
+  int opt;
+  while ((opt = getopt(argc, argv, "f:N:s:c:")) != -1) {
+    switch (opt) {
+    case 'f':
+      fs = atoi(optarg);
+      break;
+    case 'N':
+      sigma = (float)atof(optarg);
+      break;
+    case 's':
+      segundos = atoi(optarg);
+      break;
+    case 'c':
+      mhz = (float)atof(optarg);
+      break;
+    default:
+      fprintf(stderr, "uso: %s [-f fs] [-N sigma] [-s seg] [-c MHz]\n",
+              argv[0]);
+      return 2;
+    }
+  }
+
+  printf("fs=%d Hz, ruído sigma=%.1f LSB, %d s\n", fs, sigma, segundos);
+  printf("%3s %4s %5s %9s %8s %8s %12s\n", "OS", "FLT", "taps", "ns/leit",
+         "ciclos", "sigma", "piscadela");
+  static const uint8_t oss[] = {1, 2, 4, 8, 16};
+  for (uint8_t os : oss) {
+    if ((uint32_t)fs * os > DSP_MAX_RAW_HZ)
+      continue;
+    // leituras pré-geradas: o tempo medido é só o do DSP
+    long nRaw = (long)segundos * fs * os;
+    std::vector<uint16_t> raw(nRaw), ref(nRaw);
+    estado = 0x2545F491;
+    for (long i = 0; i < nRaw; i++) {
+      double t = (double)i / ((double)fs * os);
+      float v = limpo(t);
+      ref[i] = (uint16_t)lroundf(v);
+      float r = v + sigma * gaussiana();
+      raw[i] = (uint16_t)(r < 0 ? 0 : (r > 4095 ? 4095 : lroundf(r)));
+    }
+    for (int m = DSP_BRUTO; m <= DSP_MODO_MAX; m++) {
+      EogDsp dsp;
+      dsp.configurar(os, (DspModo)m, (uint16_t)fs);
+      std::vector<uint16_t> saida;
+      saida.reserve(nRaw / os);
+      auto t0 = std::chrono::steady_clock::now();
+      for (long i = 0; i < nRaw; i++) {
+        uint16_t o;
+        if (dsp.push(raw[i], o))
+          saida.push_back(o);
+      }
+      auto t1 = std::chrono::steady_clock::now();
+      double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() /
+                  nRaw;
+
+      // mesmo filtro sobre o sinal sem ruído: a diferença é o ruído que
+      // sobra (o atraso do filtro é igual nos dois)
+      EogDsp dspRef;
+      dspRef.configurar(os, (DspModo)m, (uint16_t)fs);
+      double soma2 = 0;
+      long n = 0;
+      int minimo = 4095, nivel = 0;
+      for (long i = 0, k = 0; i < nRaw; i++) {
+        uint16_t o;
+        if (!dspRef.push(ref[i], o))
+          continue;
+        if (k >= fs) { // salta o primeiro segundo
+          double d = (double)saida[k] - o;
+          soma2 += d * d;
+          n++;
+          if (o < minimo)
+            minimo = o;
+          nivel += o;
+        }
+        k++;
+      }
+      double sig = n ? sqrt(soma2 / n) : 0;
+      // profundidade: mediana grosseira (média) menos o mínimo
+      int prof = n ? (int)(nivel / n) - minimo : 0;
+      printf("%3u %4d %5u %9.1f %8.0f %8.2f %12d\n", os, m, dsp.taps(), ns,
+             ns * mhz / 1000, sig, prof);
+    }
+  }
+  return 0;
+}
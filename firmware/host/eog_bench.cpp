@@ -0,0 +1,210 @@
+// Microbenchmark e precisão dos caminhos quentes de S (bench.h) sobre um EOG
+// sintético (sintetico.h): ns por amostra/evento de cada etapa, bytes por
+// trama e precisão/recall da deteção e de cada modelo contra as piscadelas
+// geradas. No ESP32 o mesmo código corre com o comando BENCH.
+//
+//   eog_bench [opções]
+//     -f HZ       taxa de amostragem (250)
+//     -s SEG      duração (120)
+//     -b BPM      piscadelas por minuto (15)
+//     -l FRAC     fração de lentas, 0..1 (0.2)
+//     -N SIGMA    ruído gaussiano (LSB) (3)
+//     -d LSB      amplitude da deriva (10), -P SEG o seu período (30)
+//     -v FRAC     variação ao acaso de amplitude e tempos (0.2)
+//     -A GANHO    multiplica a amplitude das piscadelas (outro elétrodo)
+//     -F FORMA    cos | rampa (cos)
+//     -S SEMENTE  semente do gerador
+//     -o FICH     escreve também o sinal (t_ms,eog) para o eog_host
+//     -g FICH     e as piscadelas geradas (verdade) em CSV
+//     -E FICH     os eventos do detetor com a classe verdadeira, nas colunas
+//                 do eog_host -E e o AMPLITUDE_MIN calibrado (amp_min):
+//                 dados de treino para o gerar_modelo
+//     -m MIN      sai com 1 se a precisão ou o recall da deteção ou de
+//                 algum modelo (por classe) ficar abaixo de MIN (ctest)
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "classificador.h"
+
+// os de parametrosDetecao() (main.cpp) fora dos limiares calibrados
+static const BlinkParams formaOmissao = {0, 1.40f, 5, 70, 0, 1.0f, 145, 350, 0};
+// accCalib de main.cpp
+static const AccCalib accOmissao = {{11269, 11213, 11840}, {3323, 3251, 3306}};
+
+static void linha(const char *l) { printf("%s\n", l); }
+
+// P e R de uma contagem contra o mínimo (sem casos não conta)
+static bool chega(const char *nome, const BenchContagem &c, float min) {
+  bool ok = true;
+  if (c.vp + c.fp && (float)c.vp / (c.vp + c.fp) < min)
+    ok = false;
+  if (c.vp + c.fn && (float)c.vp / (c.vp + c.fn) < min)
+    ok = false;
+  if (!ok)
+    fprintf(stderr, "%s abaixo de %.2f (vp %lu, fp %lu, fn %lu)\n", nome, min,
+            (unsigned long)c.vp, (unsigned long)c.fp, (unsigned long)c.fn);
+  return ok;
+}
+
+static FILE *rotulosFich = nullptr;
+static BenchResultado resultado;
+static void rotulo(const BlinkEvent &ev, BlinkClass verdade) {
+  int32_t f[FP_N];
+  featuresPiscadela(ev, f);
+  fprintf(rotulosFich, "%lu,0,%u,%d", (unsigned long)ev.tInicioUs,
+          (unsigned)verdade, resultado.params.amplitudeMin);
+  for (int i = 0; i < FP_N; i++)
+    fprintf(rotulosFich, ",%ld", (long)f[i]);
+  fprintf(rotulosFich, "\n");
+}
+
+// o mesmo sinal que benchCorrer vê, para gravar
+static bool escrever(const SintParams &p, uint32_t segundos, const char *sinal,
+                     const char *verdade) {
+  FILE *fs = sinal ? fopen(sinal, "w") : nullptr;
+  FILE *fv = verdade ? fopen(verdade, "w") : nullptr;
+  if ((sinal && !fs) || (verdade && !fv)) {
+    if (fs)
+      fclose(fs);
+    if (fv)
+      fclose(fv);
+    return false;
+  }
+  if (fs)
+    fprintf(fs, "t_ms,eog\n");
+  if (fv)
+    fprintf(fv, "t_inicio_ms,t_pico_ms,t_fim_ms,classe,amplitude\n");
+  GeradorEog g;
+  g.begin(p);
+  uint32_t n = segundos * p.fsHz;
+  for (uint32_t i = 0; i < n; i++) {
+    uint32_t t;
+    uint16_t v = g.proxima(t);
+    if (fs)
+      fprintf(fs, "%.1f,%u\n", t / 1000.0, (unsigned)v);
+    SintPiscadela b;
+    if (fv && g.novaPiscadela(b))
+      fprintf(fv, "%.1f,%.1f,%.1f,%s,%.0f\n", b.tInicioUs / 1000.0,
+              b.tPicoUs / 1000.0, b.tFimUs / 1000.0,
+              b.cls == BLINK_SLOW ? "lenta" : "normal", b.amplitude);
+  }
+  if (fs)
+    fclose(fs);
+  if (fv)
+    fclose(fv);
+  return true;
+}
+
+int main(int argc, char **argv) {
+  SintParams p;
+  sintOmissao(p);
+  uint32_t segundos = 120;
+  const char *sinal = nullptr, *verdade = nullptr, *eventos = nullptr;
+  float minimo = -1;
+  int opt;
+  while ((opt = getopt(argc, argv, "f:s:b:l:N:d:P:v:A:F:S:o:g:E:m:h")) != -1) {
+    switch (opt) {
+    case 'f':
+      p.fsHz = (uint16_t)atoi(optarg);
+      break;
+    case 's':
+      segundos = (uint32_t)atoi(optarg);
+      break;
+    case 'b':
+      p.bpm = (float)atof(optarg);
+      break;
+    case 'l':
+      p.fracLentas = (float)atof(optarg);
+      break;
+    case 'N':
+      p.ruido = (float)atof(optarg);
+      break;
+    case 'd':
+      p.deriva = (float)atof(optarg);
+      break;
+    case 'P':
+      p.derivaPeriodoS = (float)atof(optarg);
+      break;
+    case 'v':
+      p.variacao = (float)atof(optarg);
+      break;
+    case 'A':
+      p.normal.amplitude *= (float)atof(optarg);
+      p.lenta.amplitude *= (float)atof(optarg);
+      break;
+    case 'F':
+      if (strcmp(optarg, "rampa") == 0)
+        p.forma = SINT_FORMA_RAMPA;
+      else if (strcmp(optarg, "cos") == 0)
+        p.forma = SINT_FORMA_COS;
+      else {
+        fprintf(stderr, "forma desconhecida: %s (cos | rampa)\n", optarg);
+        return 2;
+      }
+      break;
+    case 'S':
+      p.semente = (uint32_t)strtoul(optarg, nullptr, 0);
+      break;
+    case 'o':
+      sinal = optarg;
+      break;
+    case 'g':
+      verdade = optarg;
+      break;
+    case 'E':
+      eventos = optarg;
+      break;
+    case 'm':
+      minimo = (float)atof(optarg);
+      break;
+    default:
+      fprintf(stderr,
+              "uso: %s [-f fs] [-s seg] [-b bpm] [-l lentas] [-N sigma] "
+              "[-d deriva] [-P seg] [-v var] [-A ganho] [-F cos|rampa] "
+              "[-S semente] [-o sinal.csv] [-g verdade.csv] [-E eventos.csv] "
+              "[-m min]\n",
+              argv[0]);
+      return 2;
+    }
+  }
+  if (p.fsHz < 50 || p.fsHz > 1000 || segundos == 0) {
+    fprintf(stderr, "fs fora de 50..1000 Hz ou duração 0\n");
+    return 2;
+  }
+
+  if ((sinal || verdade) && !escrever(p, segundos, sinal, verdade)) {
+    fprintf(stderr, "não consegui escrever %s\n", sinal ? sinal : verdade);
+    return 1;
+  }
+  if (eventos) {
+    rotulosFich = fopen(eventos, "w");
+    if (!rotulosFich) {
+      fprintf(stderr, "não consegui criar %s\n", eventos);
+      return 1;
+    }
+    fprintf(rotulosFich, "t_us,canal,classe,amp_min");
+    for (int i = 0; i < FP_N; i++)
+      fprintf(rotulosFich, ",%s", featPiscadelaNomes[i]);
+    fprintf(rotulosFich, "\n");
+    benchRotulos(rotulo);
+  }
+  BenchResultado &r = resultado;
+  benchCorrer(p, segundos, formaOmissao, accOmissao, r);
+  benchRelatorio(r, linha);
+  if (rotulosFich)
+    fclose(rotulosFich);
+  if (minimo < 0)
+    return 0;
+  static const char *const classes[3] = {"outro", "normais", "lentas"};
+  bool ok = chega("deteção", r.eventos, minimo);
+  for (uint8_t m = 0; m < r.modelos; m++)
+    for (int c = BLINK_NORMAL; c <= BLINK_SLOW; c++) {
+      char nome[32];
+      snprintf(nome, sizeof(nome), "modelo %u %s", (unsigned)m, classes[c]);
+      ok = chega(nome, r.classe[m][c], minimo) && ok;
+    }
+  return ok ? 0 : 1;
+}
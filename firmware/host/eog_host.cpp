@@ -0,0 +1,367 @@
+// Simulador de host: corre o firmware (main.cpp) sobre um traço gravado.
+//
+//   eog_host [opções] traço.csv
+//     -r HZ       taxa do traço quando só tem a coluna eog (250)
+//     -c T:CMD    injeta CMD aos T ms pelo RX BLE (repetível; "usb:CMD" vai
+//                 pela consola, "bin:CMD" vai como trama CMD binária com o
+//                 opcode equivalente, "@N:CMD" vem da central N). Sem -c:
+//                 "S" aos 500 ms.
+//     -m MTU      liga o BLE em loopback com este MTU (23); repetido, liga
+//                 mais centrais (a 1ª é a que conta nos resumos)
+//     -t MS       pára aos MS ms de tempo virtual
+//     -f FICH     imagem da flash do gravador (lida no início, escrita no fim)
+//     -p FICH     preferências (NVS) com os perfis de calibração
+//     -D FICH     guarda os blocos recebidos por DL (ver rec_dump)
+//     -N SIGMA    soma ruído gaussiano (LSB) a cada leitura do ADC
+//     -E FICH     guarda as tramas de evento (EVT=1) em CSV (ver gerar_modelo)
+//     -U FICH     guarda tudo o que sai pela USB (a captura CAP=, ver cap_dump)
+//     -q          não mostra a consola USB
+//     -n          não mostra as notificações BLE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <vector>
+
+#include "captura_usb.h"
+#include "cmd_fila.h"
+#include "eog_log.h"
+#include "firmware.h"
+#include "hal_host.h"
+#include "perfil.h"
+#include "raw_codec.h"
+#include "rec_sessao.h"
+#include "rt_frame.h"
+
+// contadores da sessão S (main.cpp)
+extern int contagemBlinksNormais;
+extern int contagemBlinksLentos;
+
+// pinos do firmware -> colunas do traço; sem colunas de acelerómetro fica
+// a leitura dos offsets (roll = pitch = 0) e sem eog_h um canal horizontal
+// parado a meio da escala
+static void mapearPinos() {
+  hostMapPin(36, 1, 2048); // EOG vertical
+  hostMapPin(34, 5, 2048); // EOG horizontal
+  hostMapPin(32, 2, 704);  // ADXL335 x
+  hostMapPin(33, 3, 701);  // ADXL335 y
+  hostMapPin(39, 4, 740);  // ADXL335 z
+}
+
+// ---- DL: junta os pedaços REC_BLOCO em blocos e guarda os que passam CRC
+static FILE *dlFich = nullptr;
+static std::vector<uint8_t> dlBloco;
+static size_t dlRecebido = 0;
+static unsigned dlOk = 0, dlMaus = 0;
+
+static uint16_t lerU16(const uint8_t *p) {
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+// ---- RAW: descodifica cada bloco (tem de dar certo) e conta os buracos
+static unsigned rawBlocos = 0, rawMaus = 0, rawBuracos = 0;
+static unsigned long rawAmostras = 0, rawBytes = 0;
+static uint8_t rawCanais = 0;
+static uint16_t rawSeqProx = 0;
+
+static void blocoRaw(const uint8_t *d, size_t len) {
+  uint16_t v[255 * ACQ_CANAIS_MAX];
+  RawBloco cab;
+  int n = rawDescodificar(d, len, cab, v, sizeof(v) / sizeof(v[0]));
+  if (n < 0) {
+    rawMaus++;
+    return;
+  }
+  if (rawBlocos && cab.seq != rawSeqProx)
+    rawBuracos += (uint16_t)(cab.seq - rawSeqProx);
+  rawSeqProx = (uint16_t)(cab.seq + 1);
+  rawBlocos++;
+  rawAmostras += (unsigned long)n;
+  rawBytes += len;
+  rawCanais = cab.canais;
+}
+
+// ---- EVT: uma linha CSV por trama de evento
+static FILE *evtFich = nullptr;
+
+static void tramaRecebida(const uint8_t *d, size_t len) {
+  if (len >= RAW_CABECALHO_LEN && d[0] == RT_FRAME_MAGIC &&
+      d[2] == RT_FRAME_TYPE_RAW) {
+    blocoRaw(d, len);
+    return;
+  }
+  if (len == CMD_ACK_LEN && d[0] == RT_FRAME_MAGIC &&
+      d[2] == RT_FRAME_TYPE_ACK) {
+    uint32_t lat = lerU16(d + 7) | ((uint32_t)lerU16(d + 9) << 16);
+    printf("ACK #%u opcode 0x%02x estado %u: %lu us\n", lerU16(d + 3), d[5],
+           d[6], (unsigned long)lat);
+    return;
+  }
+  if (len == RT_FRAME_PISCADELA_LEN && d[0] == RT_FRAME_MAGIC &&
+      d[2] == RT_FRAME_TYPE_PISCADELA) {
+    static const char *const classes[] = {"outro", "normal", "lenta"};
+    uint32_t t0 = lerU16(d + 5) | ((uint32_t)lerU16(d + 7) << 16);
+    printf("EVT #%u canal %u %s t=%lu ms: pico %u amp %u | fecho %u ms "
+           "%u/%u c/s | reabertura %u ms %u/%u c/s | IBI %u ms\n",
+           lerU16(d + 3), d[10], d[9] < 3 ? classes[d[9]] : "?",
+           (unsigned long)(t0 / 1000), lerU16(d + 11), lerU16(d + 13),
+           lerU16(d + 15), lerU16(d + 17), lerU16(d + 19), lerU16(d + 21),
+           lerU16(d + 23), lerU16(d + 25), lerU16(d + 27));
+    if (evtFich)
+      fprintf(evtFich, "%lu,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u\n",
+              (unsigned long)t0, d[10], d[9], lerU16(d + 11), lerU16(d + 13),
+              lerU16(d + 15), lerU16(d + 17), lerU16(d + 19), lerU16(d + 21),
+              lerU16(d + 23), lerU16(d + 25), lerU16(d + 27));
+    return;
+  }
+  if (len >= RT_FRAME_SYNC_LEN && d[0] == RT_FRAME_MAGIC &&
+      d[2] == RT_FRAME_TYPE_SYNC) {
+    uint64_t t1 = 0;
+    for (int i = 7; i >= 0; i--)
+      t1 = (t1 << 8) | d[5 + i];
+    uint32_t t21 = lerU16(d + 13) | ((uint32_t)lerU16(d + 15) << 16);
+    printf("SYNC #%u: t1 %llu us, t2-t1 %lu us", lerU16(d + 3),
+           (unsigned long long)t1, (unsigned long)t21);
+    if (len >= RT_FRAME_SYNC_CONTADORES_LEN)
+      printf(" | %lu mensagens, %lu descartadas, %lu recusadas",
+             (unsigned long)(lerU16(d + 17) | (uint32_t)lerU16(d + 19) << 16),
+             (unsigned long)(lerU16(d + 21) | (uint32_t)lerU16(d + 23) << 16),
+             (unsigned long)(lerU16(d + 25) | (uint32_t)lerU16(d + 27) << 16));
+    printf("\n");
+    return;
+  }
+  if (len == RT_FRAME_ESTADO_LEN && d[0] == RT_FRAME_MAGIC &&
+      d[2] == RT_FRAME_TYPE_ESTADO) {
+    printf("ESTADO #%u: RT nível %u, um ponto a cada %u ms | %lu "
+           "descartadas, %lu recusadas, anel RT %u\n",
+           lerU16(d + 3), d[5], lerU16(d + 6),
+           (unsigned long)(lerU16(d + 8) | (uint32_t)lerU16(d + 10) << 16),
+           (unsigned long)(lerU16(d + 12) | (uint32_t)lerU16(d + 14) << 16),
+           d[16]);
+    return;
+  }
+  if (len >= PERF_TRAMA_CABECALHO_LEN && d[0] == RT_FRAME_MAGIC &&
+      d[2] == RT_FRAME_TYPE_STATS) {
+    printf("STATS #%u: fs %u.%u Hz, %u atrasados, %u perdidas |", lerU16(d + 3),
+           lerU16(d + 5) / 10, lerU16(d + 5) % 10, lerU16(d + 7),
+           lerU16(d + 9));
+    const uint8_t *e = d + PERF_TRAMA_CABECALHO_LEN;
+    for (unsigned i = 0; i < d[15] && e + PERF_TRAMA_ETAPA_LEN <= d + len;
+         i++, e += PERF_TRAMA_ETAPA_LEN)
+      printf(" %s %u.%u/%u", perfNome((PerfEtapa)e[0]), lerU16(e + 1) / 10,
+             lerU16(e + 1) % 10, lerU16(e + 3));
+    printf("\n");
+    return;
+  }
+  if (len < REC_TRAMA_CABECALHO_LEN || d[0] != RT_FRAME_MAGIC)
+    return;
+  if (d[2] == RT_FRAME_TYPE_REC_FIM) {
+    printf("DL: sessão %u, %u blocos anunciados, %u com CRC certo, %u "
+           "maus\n",
+           lerU16(d + 7), lerU16(d + 5), dlOk, dlMaus);
+    return;
+  }
+  if (d[2] != RT_FRAME_TYPE_REC_BLOCO)
+    return;
+  uint16_t offset = lerU16(d + 5);
+  uint16_t total = lerU16(d + 7);
+  size_t n = len - REC_TRAMA_CABECALHO_LEN;
+  if (offset == 0) {
+    dlBloco.assign(total, 0);
+    dlRecebido = 0;
+  }
+  if (dlBloco.size() != total || offset != dlRecebido || offset + n > total)
+    return; // pedaço perdido: o bloco fica incompleto
+  memcpy(dlBloco.data() + offset, d + REC_TRAMA_CABECALHO_LEN, n);
+  dlRecebido += n;
+  if (dlRecebido < total || total < REC_CABECALHO_LEN)
+    return;
+  const uint8_t *crc = dlBloco.data() + 16;
+  uint32_t esperado = lerU16(crc) | ((uint32_t)lerU16(crc + 2) << 16);
+  if (recCrc32(dlBloco.data() + REC_CABECALHO_LEN,
+               total - REC_CABECALHO_LEN) != esperado) {
+    dlMaus++;
+    return;
+  }
+  dlOk++;
+  if (dlFich)
+    fwrite(dlBloco.data(), 1, total, dlFich);
+}
+
+static void uso(const char *prog) {
+  fprintf(stderr,
+          "uso: %s [-r hz] [-c t_ms:CMD]... [-m mtu] [-t max_ms] [-f flash] "
+          "[-p nvs] [-D blocos] [-N sigma] [-E eventos.csv] [-U usb.bin] "
+          "[-L pct[:ate_ms]] [-q] [-n] traço.csv\n",
+          prog);
+}
+
+int main(int argc, char **argv) {
+  uint32_t hz = 250;
+  std::vector<uint16_t> mtus;
+  bool echoUsb = true;
+  bool echoBle = true;
+  int nCmds = 0;
+  int opt;
+  while ((opt = getopt(argc, argv, "r:c:m:t:f:p:D:N:E:U:L:qnh")) != -1) {
+    switch (opt) {
+    case 'r':
+      hz = (uint32_t)atoi(optarg);
+      break;
+    case 'c': {
+      char *sep = strchr(optarg, ':');
+      if (!sep) {
+        uso(argv[0]);
+        return 2;
+      }
+      *sep = 0;
+      const char *cmd = sep + 1;
+      uint8_t ligacao = 0;
+      if (cmd[0] == '@' && cmd[1] >= '0' && cmd[1] <= '9' && cmd[2] == ':') {
+        ligacao = (uint8_t)(cmd[1] - '0');
+        cmd += 3;
+      }
+      bool viaUsb = strncmp(cmd, "usb:", 4) == 0;
+      if (strncmp(cmd, "bin:", 4) == 0) {
+        uint8_t trama[CMD_MSG_MAX];
+        size_t n = cmdTextoParaBinario(cmd + 4, (uint16_t)(1000 + nCmds),
+                                       trama, sizeof(trama));
+        if (n == 0) {
+          fprintf(stderr, "sem opcode para %s\n", cmd + 4);
+          return 2;
+        }
+        hostScheduleBytes((uint32_t)atol(optarg), ligacao, trama, n);
+      } else {
+        hostSchedule((uint32_t)atol(optarg), viaUsb ? cmd + 4 : cmd, viaUsb,
+                     ligacao);
+      }
+      nCmds++;
+      break;
+    }
+    case 'm':
+      mtus.push_back((uint16_t)atoi(optarg));
+      break;
+    case 't':
+      hostSetMaxMs((uint32_t)atol(optarg));
+      break;
+    case 'f':
+      hostSetStorage(1024 * 1024, optarg);
+      break;
+    case 'p':
+      hostSetPrefs(optarg);
+      break;
+    case 'D':
+      dlFich = fopen(optarg, "wb");
+      if (!dlFich) {
+        fprintf(stderr, "não consegui criar %s\n", optarg);
+        return 1;
+      }
+      break;
+    case 'N':
+      hostSetAdcNoise((float)atof(optarg));
+      break;
+    case 'E':
+      evtFich = fopen(optarg, "w");
+      if (!evtFich) {
+        fprintf(stderr, "não consegui criar %s\n", optarg);
+        return 1;
+      }
+      fprintf(evtFich, "t_us,canal,classe,pico,amplitude,fecho_ms,vel_fecho,"
+                       "vel_max_fecho,reab_ms,vel_reab,vel_max_reab,ibi_ms\n");
+      break;
+    case 'U':
+      if (!hostSetUsbFile(optarg)) {
+        fprintf(stderr, "não consegui criar %s\n", optarg);
+        return 1;
+      }
+      break;
+    case 'L': {
+      const char *ate = strchr(optarg, ':');
+      hostSetCongestao((uint32_t)atoi(optarg),
+                       ate ? (uint32_t)atol(ate + 1) : 0);
+      break;
+    }
+    case 'q':
+      echoUsb = false;
+      break;
+    case 'n':
+      echoBle = false;
+      break;
+    default:
+      uso(argv[0]);
+      return 2;
+    }
+  }
+  if (optind != argc - 1) {
+    uso(argv[0]);
+    return 2;
+  }
+  if (!hostLoadTrace(argv[optind], hz)) {
+    fprintf(stderr, "não consegui ler o traço %s\n", argv[optind]);
+    return 1;
+  }
+  if (nCmds == 0)
+    hostSchedule(500, "S", false, 0);
+  mapearPinos();
+  hostSetEcho(echoUsb, echoBle);
+  if (mtus.empty())
+    mtus.push_back(23);
+  for (uint16_t mtu : mtus)
+    hostBleConnect(mtu);
+  hostSetFrameHook(&tramaRecebida);
+
+  auto t0 = std::chrono::steady_clock::now();
+  setup();
+  while (!hostFinished())
+    loop();
+  logDrain();
+  capDrain();
+  hostCloseUsbFile();
+  if (!hostStorageSave())
+    fprintf(stderr, "não consegui guardar a imagem da flash\n");
+  if (dlFich)
+    fclose(dlFich);
+  if (evtFich)
+    fclose(evtFich);
+  double realS = std::chrono::duration<double>(
+                     std::chrono::steady_clock::now() - t0)
+                     .count();
+
+  const HostStats &st = hostStats();
+  double virtS = hostNowUs() / 1e6;
+  printf("== resumo ==\n");
+  printf("traço: %llu linhas, %.1f s\n", (unsigned long long)st.traceRows,
+         st.traceEndUs / 1e6);
+  printf("tempo virtual %.1f s em %.3f s reais (%.0fx)\n", virtS, realS,
+         realS > 0 ? virtS / realS : 0.0);
+  printf("ticks de aquisição: %llu, leituras ADC: %llu\n",
+         (unsigned long long)st.timerTicks, (unsigned long long)st.adcReads);
+  printf("BLE: %llu notificações, %llu bytes (%llu linhas, %llu tramas)\n",
+         (unsigned long long)st.notifies, (unsigned long long)st.notifyBytes,
+         (unsigned long long)st.bleLines, (unsigned long long)st.bleFrames);
+  printf("USB: %llu linhas, %llu bytes\n", (unsigned long long)st.usbLines,
+         (unsigned long long)st.usbBytes);
+  for (unsigned i = 1; i < mtus.size() && i < HAL_BLE_LIGACOES_MAX; i++)
+    printf("BLE%u: %llu notificações, %llu bytes\n", i,
+           (unsigned long long)st.notifiesPor[i],
+           (unsigned long long)st.notifyBytesPor[i]);
+  if (st.notifiesRecusados)
+    printf("BLE: %llu notificações recusadas (-L)\n",
+           (unsigned long long)st.notifiesRecusados);
+  if (st.bleEnvelopes)
+    printf("SEQ: %llu mensagens com envelope, %llu em falta\n",
+           (unsigned long long)st.bleEnvelopes,
+           (unsigned long long)st.bleSeqPerdidas);
+  if (rawBlocos || rawMaus) {
+    unsigned long valores = rawAmostras * rawCanais;
+    printf("RAW: %u blocos (%u maus, %u em falta), %lu amostras x %u "
+           "canais, %lu bytes, %.2f bits/amostra\n",
+           rawBlocos, rawMaus, rawBuracos, rawAmostras, (unsigned)rawCanais,
+           rawBytes, valores ? 8.0 * rawBytes / valores : 0.0);
+  }
+  printf("piscadelas (S): normais %d, lentas %d\n", contagemBlinksNormais,
+         contagemBlinksLentos);
+  return 0;
+}
@@ -0,0 +1,459 @@
+// Treina o modelo de tabelas do classificador (classificador.h) e escreve
+// modelo_tabelas.h:
+//   - floresta de árvores pequenas (CART, gini) sobre as features de cada
+//     piscadela do canal 0, com a classe do CSV como rótulo;
+//   - regressão logística sobre as features das janelas (janelas.h) que o
+//     mesmo CSV dá ao repetir as piscadelas pelo JanelasSono, rotulada com a
+//     coluna "sono" (0/1) se existir ou, sem ela, com a regra dos limiares
+//     e a baseline de -B.
+// O acerto no treino é medido com a inferência inteira do firmware.
+//
+//   gerar_modelo [-B baseline_bpm] [-R amplitude_min] [-a árvores]
+//                [-p profundidade] [-o modelo_tabelas.h] eventos.csv...
+//
+// eventos.csv: o de eog_host -E (EVT=1), com a coluna classe revista à mão
+// onde o detetor errou e, se houver, uma coluna sono; ou o de eog_bench -E,
+// já rotulado com as piscadelas geradas. A floresta treina com a amplitude
+// e as velocidades relativas ao AMPLITUDE_MIN da calibração, como o
+// firmware as vê: a coluna amp_min (eog_bench) ou, sem ela, -R.
+//
+// O modelo_tabelas.h do repositório sai só de sinal sintético,
+// reproduzível com (build-host como no CMakeLists.txt):
+//
+//   ./build-host/eog_bench -s 1800 -b 20 -l 0.3 -S 11 -E sint11.csv
+//   ./build-host/eog_bench -s 1800 -l 0.2 -v 0.3 -N 5 -S 12 -E sint12.csv
+//   ./build-host/eog_bench -s 1800 -l 0.2 -F rampa -S 13 -E sint13.csv
+//   ./build-host/eog_bench -s 1800 -b 12 -l 0 -S 14 -E sint14.csv
+//   ./build-host/gerar_modelo -B 12 -o firmware/esp32-v1.1.7/modelo_tabelas.h
+//       sint11.csv sint12.csv sint13.csv sint14.csv   (na mesma linha)
+//
+// e tem de acertar nas lentas pelo menos tanto como o modelo 0 no
+// eog_bench por omissão (semente diferente das de treino).
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "classificador.h"
+#include "janelas.h"
+
+struct Piscadela {
+  uint32_t tUs;
+  int32_t f[FP_N];
+  uint8_t classe;
+  int sono;       // -1 = sem coluna
+  int32_t ampMin; // AMPLITUDE_MIN da calibração; 0 = sem coluna
+};
+struct Janela {
+  int32_t f[FJ_N];
+  uint8_t sono;
+};
+
+static uint32_t estado = 0x2545F491;
+static uint32_t aleatorio() {
+  estado ^= estado << 13;
+  estado ^= estado >> 17;
+  estado ^= estado << 5;
+  return estado;
+}
+
+// ---- CSV ----
+static std::vector<std::string> partir(const char *linha) {
+  std::vector<std::string> v;
+  std::string campo;
+  for (const char *p = linha; *p && *p != '\n' && *p != '\r'; p++) {
+    if (*p == ',') {
+      v.push_back(campo);
+      campo.clear();
+    } else {
+      campo += *p;
+    }
+  }
+  v.push_back(campo);
+  return v;
+}
+
+static bool lerEventos(const char *caminho, std::vector<Piscadela> &out) {
+  FILE *f = fopen(caminho, "r");
+  if (!f)
+    return false;
+  char linha[512];
+  if (!fgets(linha, sizeof(linha), f)) {
+    fclose(f);
+    return false;
+  }
+  std::vector<std::string> cab = partir(linha);
+  auto coluna = [&](const char *nome) {
+    for (size_t i = 0; i < cab.size(); i++)
+      if (cab[i] == nome)
+        return (int)i;
+    return -1;
+  };
+  int colT = coluna("t_us"), colCanal = coluna("canal");
+  int colClasse = coluna("classe"), colSono = coluna("sono");
+  int colAmpMin = coluna("amp_min");
+  int colF[FP_N];
+  bool ok = colT >= 0 && colClasse >= 0;
+  for (int i = 0; i < FP_N; i++)
+    ok = ok && (colF[i] = coluna(featPiscadelaNomes[i])) >= 0;
+  if (!ok) {
+    fprintf(stderr, "%s: faltam colunas (t_us, classe ou features)\n",
+            caminho);
+    fclose(f);
+    return false;
+  }
+  while (fgets(linha, sizeof(linha), f)) {
+    std::vector<std::string> v = partir(linha);
+    if (v.size() < cab.size())
+      continue;
+    if (colCanal >= 0 && atoi(v[colCanal].c_str()) != 0)
+      continue;
+    Piscadela p;
+    p.tUs = (uint32_t)strtoul(v[colT].c_str(), nullptr, 10);
+    p.classe = (uint8_t)atoi(v[colClasse].c_str());
+    p.sono = colSono >= 0 ? atoi(v[colSono].c_str()) != 0 : -1;
+    p.ampMin = colAmpMin >= 0 ? atoi(v[colAmpMin].c_str()) : 0;
+    for (int i = 0; i < FP_N; i++)
+      p.f[i] = atoi(v[colF[i]].c_str());
+    if (p.classe < 3)
+      out.push_back(p);
+  }
+  fclose(f);
+  return true;
+}
+
+// ---- janelas: repete as piscadelas de um ficheiro pelo JanelasSono ----
+static void gerarJanelas(const std::vector<Piscadela> &ps, float baseline,
+                         std::vector<Janela> &out) {
+  if (ps.empty())
+    return;
+  static const uint16_t HORIZONTES[] = {10, 60, 300};
+  JanelasSono js;
+  js.configurar(HORIZONTES, 3);
+  uint32_t t0 = ps[0].tUs / 1000;
+  js.begin(t0);
+  SonoParams sp = {baseline, 1.30f, 2};
+  int sonoAtual = 0;
+  auto fecharAte = [&](uint32_t ms) {
+    uint8_t fechou = js.avancar(ms);
+    for (uint8_t h = 0; h < js.n(); h++) {
+      if (!(fechou & (1u << h)))
+        continue;
+      JanelaResumo r;
+      js.resumo(h, r);
+      if (!r.cheia)
+        continue;
+      Janela j;
+      featuresJanela(r, baseline, j.f);
+      j.sono = (uint8_t)(ps[0].sono >= 0 ? sonoAtual : avaliarSono(r, sp));
+      out.push_back(j);
+    }
+  };
+  for (const Piscadela &p : ps) {
+    // o pico é o que as janelas usam (IBI); tUs é o início
+    uint32_t tPicoUs = p.tUs + (uint32_t)p.f[FP_FECHO_MS] * 1000;
+    fecharAte(tPicoUs / 1000);
+    BlinkEvent ev = {};
+    ev.cls = (BlinkClass)p.classe;
+    ev.tInicioUs = p.tUs;
+    ev.tPicoUs = tPicoUs;
+    ev.duracaoMs = (float)p.f[FP_FECHO_MS];
+    ev.amplitude = (float)p.f[FP_AMPLITUDE];
+    js.piscadela(ev);
+    if (p.sono >= 0)
+      sonoAtual = p.sono;
+  }
+}
+
+// ---- floresta ----
+static std::vector<ModeloNo> nos;
+
+static double gini(const int *n, int total) {
+  if (total == 0)
+    return 0;
+  double g = 1;
+  for (int c = 0; c < 3; c++)
+    g -= (double)n[c] * n[c] / ((double)total * total);
+  return g;
+}
+
+static uint16_t folha(uint8_t classe) {
+  ModeloNo n = {-1, classe, 0, 0, 0};
+  nos.push_back(n);
+  return (uint16_t)(nos.size() - 1);
+}
+
+static uint16_t construir(const std::vector<Piscadela> &ps,
+                          std::vector<int> idx, int prof, int profMax) {
+  int n[3] = {0, 0, 0};
+  for (int i : idx)
+    n[ps[i].classe]++;
+  uint8_t maioria = 0;
+  for (uint8_t c = 1; c < 3; c++)
+    if (n[c] > n[maioria])
+      maioria = c;
+  int total = (int)idx.size();
+  if (prof >= profMax || n[maioria] == total || total < 4)
+    return folha(maioria);
+
+  // features sorteadas (~metade) e todos os cortes entre valores distintos
+  double melhorG = gini(n, total);
+  int melhorF = -1;
+  int32_t melhorLim = 0;
+  for (int f = 0; f < FP_N; f++) {
+    if (aleatorio() % 2)
+      continue;
+    std::sort(idx.begin(), idx.end(),
+              [&](int a, int b) { return ps[a].f[f] < ps[b].f[f]; });
+    int esq[3] = {0, 0, 0};
+    for (int k = 0; k < total - 1; k++) {
+      esq[ps[idx[k]].classe]++;
+      int32_t v = ps[idx[k]].f[f], seg = ps[idx[k + 1]].f[f];
+      if (v == seg)
+        continue;
+      int dir[3] = {n[0] - esq[0], n[1] - esq[1], n[2] - esq[2]};
+      int ne = k + 1, nd = total - ne;
+      double g = (ne * gini(esq, ne) + nd * gini(dir, nd)) / total;
+      if (g < melhorG - 1e-9) {
+        melhorG = g;
+        melhorF = f;
+        melhorLim = v + (seg - v) / 2;
+      }
+    }
+  }
+  if (melhorF < 0)
+    return folha(maioria);
+  std::vector<int> e, d;
+  for (int i : idx)
+    (ps[i].f[melhorF] <= melhorLim ? e : d).push_back(i);
+  ModeloNo no = {(int8_t)melhorF, maioria, 0, 0, melhorLim};
+  nos.push_back(no);
+  uint16_t eu = (uint16_t)(nos.size() - 1);
+  uint16_t ie = construir(ps, e, prof + 1, profMax);
+  uint16_t id = construir(ps, d, prof + 1, profMax);
+  nos[eu].esq = ie;
+  nos[eu].dir = id;
+  return eu;
+}
+
+// ---- regressão logística (em double, depois para Q20) ----
+static void treinarLogistica(const std::vector<Janela> &js, int32_t *pesos,
+                             int32_t &vies) {
+  double media[FJ_N] = {}, desvio[FJ_N] = {};
+  for (const Janela &j : js)
+    for (int i = 0; i < FJ_N; i++)
+      media[i] += j.f[i];
+  for (int i = 0; i < FJ_N; i++)
+    media[i] /= js.size();
+  for (const Janela &j : js)
+    for (int i = 0; i < FJ_N; i++)
+      desvio[i] += (j.f[i] - media[i]) * (j.f[i] - media[i]);
+  for (int i = 0; i < FJ_N; i++) {
+    desvio[i] = sqrt(desvio[i] / js.size());
+    if (desvio[i] < 1e-9)
+      desvio[i] = 1;
+  }
+  double w[FJ_N] = {}, b = 0;
+  const double passo = 0.5, l2 = 1e-3;
+  for (int it = 0; it < 3000; it++) {
+    double gw[FJ_N] = {}, gb = 0;
+    for (const Janela &j : js) {
+      double z = b;
+      for (int i = 0; i < FJ_N; i++)
+        z += w[i] * (j.f[i] - media[i]) / desvio[i];
+      double erro = 1 / (1 + exp(-z)) - j.sono;
+      for (int i = 0; i < FJ_N; i++)
+        gw[i] += erro * (j.f[i] - media[i]) / desvio[i];
+      gb += erro;
+    }
+    for (int i = 0; i < FJ_N; i++)
+      w[i] -= passo * (gw[i] / js.size() + l2 * w[i]);
+    b -= passo * gb / js.size();
+  }
+  // z = b + sum w_i (x_i - m_i) / s_i = (b - sum w_i m_i / s_i) + sum
+  // (w_i / s_i) x_i
+  const double q = (double)(1L << MODELO_PESO_Q);
+  double b0 = b;
+  for (int i = 0; i < FJ_N; i++) {
+    pesos[i] = (int32_t)std::max(-2e9, std::min(2e9, w[i] / desvio[i] * q));
+    b0 -= w[i] * media[i] / desvio[i];
+  }
+  vies = (int32_t)std::max(-2e9, std::min(2e9, b0 * q));
+}
+
+static std::string maiusculas(const char *s) {
+  std::string r;
+  for (; *s; s++)
+    r += (char)(*s >= 'a' && *s <= 'z' ? *s - 'a' + 'A' : *s);
+  return r;
+}
+
+int main(int argc, char **argv) {
+  float baseline = 0;
+  int arvores = 5;
+  int profMax = 4;
+  int ampMin = 0;
+  const char *saida = nullptr;
+  int opt;
+  while ((opt = getopt(argc, argv, "B:R:a:p:o:")) != -1) {
+    switch (opt) {
+    case 'B':
+      baseline = (float)atof(optarg);
+      break;
+    case 'R':
+      ampMin = atoi(optarg);
+      break;
+    case 'a':
+      arvores = atoi(optarg);
+      break;
+    case 'p':
+      profMax = atoi(optarg);
+      break;
+    case 'o':
+      saida = optarg;
+      break;
+    default:
+      optind = argc + 1;
+    }
+  }
+  if (optind >= argc || arvores < 1 || arvores > 32 || profMax < 1 ||
+      profMax > 8) {
+    fprintf(stderr,
+            "uso: %s [-B baseline_bpm] [-R amplitude_min] [-a árvores 1-32] "
+            "[-p profundidade 1-8] [-o modelo_tabelas.h] eventos.csv...\n",
+            argv[0]);
+    return 2;
+  }
+
+  std::vector<Piscadela> ps;
+  std::vector<Janela> js;
+  bool comSono = false;
+  // as opções (com as de omissão), para o modelo se poder refazer
+  char opcoes[64];
+  int k = snprintf(opcoes, sizeof(opcoes), "gerar_modelo -B %g", baseline);
+  if (ampMin > 0)
+    k += snprintf(opcoes + k, sizeof(opcoes) - k, " -R %d", ampMin);
+  snprintf(opcoes + k, sizeof(opcoes) - k, " -a %d -p %d", arvores, profMax);
+  std::string origem;
+  for (int a = optind; a < argc; a++) {
+    std::vector<Piscadela> deste;
+    if (!lerEventos(argv[a], deste)) {
+      fprintf(stderr, "não consegui ler %s\n", argv[a]);
+      return 1;
+    }
+    comSono = comSono || (!deste.empty() && deste[0].sono >= 0);
+    gerarJanelas(deste, baseline, js);
+    // a floresta treina nas unidades que o firmware lhe dá (classificador.h)
+    for (Piscadela &p : deste) {
+      int ref = p.ampMin > 0 ? p.ampMin : ampMin;
+      if (ref <= 0) {
+        fprintf(stderr, "%s: sem coluna amp_min; indique o AMPLITUDE_MIN "
+                        "da calibração com -R\n",
+                argv[a]);
+        return 1;
+      }
+      normalizarPiscadela(p.f, ref);
+    }
+    ps.insert(ps.end(), deste.begin(), deste.end());
+    const char *base = strrchr(argv[a], '/');
+    origem += origem.empty() ? "" : " ";
+    origem += base ? base + 1 : argv[a];
+  }
+  if (ps.empty()) {
+    fprintf(stderr, "sem piscadelas do canal 0\n");
+    return 1;
+  }
+
+  // floresta: cada árvore sobre uma amostra com reposição
+  std::vector<uint16_t> raizes;
+  for (int a = 0; a < arvores; a++) {
+    std::vector<int> idx;
+    for (size_t i = 0; i < ps.size(); i++)
+      idx.push_back((int)(aleatorio() % ps.size()));
+    raizes.push_back(construir(ps, idx, 0, profMax));
+  }
+  int certasP = 0;
+  int porClasse[3] = {0, 0, 0};
+  for (const Piscadela &p : ps) {
+    porClasse[p.classe]++;
+    certasP += florestaClasse(nos.data(), raizes.data(), (uint8_t)arvores,
+                              p.f) == p.classe;
+  }
+
+  int32_t pesos[FJ_N] = {};
+  int32_t vies = -(1 << MODELO_PESO_Q); // sem as duas classes: nunca há sono
+  int positivas = 0, certasJ = 0;
+  for (const Janela &j : js)
+    positivas += j.sono;
+  if (positivas > 0 && positivas < (int)js.size())
+    treinarLogistica(js, pesos, vies);
+  else
+    fprintf(stderr, "aviso: janelas só de uma classe (%d de %zu com sono); "
+                    "a logística nunca dá sono\n",
+            positivas, js.size());
+  for (const Janela &j : js)
+    certasJ += (logisticaLogito(pesos, vies, j.f) >= 0) == (j.sono != 0);
+
+  FILE *o = saida ? fopen(saida, "w") : stdout;
+  if (!o) {
+    fprintf(stderr, "não consegui criar %s\n", saida);
+    return 1;
+  }
+  fprintf(o, "#pragma once\n");
+  fprintf(o, "// GERADO por gerar_modelo (firmware/host): não editar à mão.\n");
+  fprintf(o, "//   %s\n", opcoes);
+  fprintf(o, "//   origem: %s\n", origem.c_str());
+  fprintf(o, "//   %zu piscadelas do canal 0 (outras %d, normais %d, lentas "
+             "%d)\n",
+          ps.size(), porClasse[0], porClasse[1], porClasse[2]);
+  fprintf(o, "//   floresta: %d árvores, profundidade <= %d, %zu nós, acerto "
+             "no treino %.1f%%\n",
+          arvores, profMax, nos.size(), 100.0 * certasP / ps.size());
+  if (comSono)
+    fprintf(o, "//   %zu janelas (%d com sono, rótulos da coluna sono)\n",
+            js.size(), positivas);
+  else
+    fprintf(o, "//   %zu janelas (%d com sono, rótulos dos limiares com "
+               "baseline %.2f bpm)\n",
+            js.size(), positivas, baseline);
+  fprintf(o, "//   logística: acerto no treino %.1f%%\n",
+          js.empty() ? 0.0 : 100.0 * certasJ / js.size());
+  fprintf(o, "#include \"classificador.h\"\n\n");
+  fprintf(o, "#define MODELO_NOME \"floresta+logistica\"\n");
+  fprintf(o, "#define MODELO_ARVORES %d\n\n", arvores);
+  fprintf(o, "// amplitude e velocidades em ‰ do AMPLITUDE_MIN "
+             "(normalizarPiscadela)\n");
+  fprintf(o, "static constexpr ModeloNo modeloNos[] = {\n");
+  for (const ModeloNo &n : nos) {
+    if (n.feat < 0)
+      fprintf(o, "    {-1, %u, 0, 0, 0},\n", n.classe);
+    else
+      fprintf(o, "    {FP_%s, %u, %u, %u, %ld},\n",
+              maiusculas(featPiscadelaNomes[n.feat]).c_str(), n.classe,
+              n.esq, n.dir, (long)n.limiar);
+  }
+  fprintf(o, "};\n");
+  fprintf(o, "static constexpr uint16_t modeloRaizes[MODELO_ARVORES] = {");
+  for (int a = 0; a < arvores; a++)
+    fprintf(o, "%s%u", a ? ", " : "", raizes[a]);
+  fprintf(o, "};\n");
+  fprintf(o, "// Q%d, por unidade de cada feature da janela\n",
+          MODELO_PESO_Q);
+  fprintf(o, "static constexpr int32_t modeloPesos[FJ_N] = {\n");
+  for (int i = 0; i < FJ_N; i++)
+    fprintf(o, "    %ld, // %s\n", (long)pesos[i], featJanelaNomes[i]);
+  fprintf(o, "};\n");
+  fprintf(o, "static constexpr int32_t modeloVies = %ld;\n", (long)vies);
+  if (saida)
+    fclose(o);
+  fprintf(stderr, "%zu piscadelas (acerto %.1f%%), %zu janelas (acerto "
+                  "%.1f%%)\n",
+          ps.size(), 100.0 * certasP / ps.size(), js.size(),
+          js.empty() ? 0.0 : 100.0 * certasJ / js.size());
+  return 0;
+}
@@ -0,0 +1,642 @@
+// Implementação Linux da HAL (ver hal_host.h).
+#include "hal_host.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "ble_tx.h"
+#include "firmware.h"
+#include "hal.h"
+#include "rt_frame.h"
+
+namespace {
+
+struct TraceRow {
+  uint64_t tUs;
+  // 0 = t (não usado), 1 = eog, 2..4 = ax, ay, az, 5 = eog horizontal
+  int col[HOST_TRACE_COLS];
+};
+
+struct PinMap {
+  int pin;
+  int coluna;
+  int valorPorOmissao;
+};
+
+struct Scheduled {
+  uint64_t tUs;
+  std::string cmd;
+  bool viaUsb;
+  bool binario; // cmd são bytes, escritos tal e qual
+  uint8_t ligacao;
+};
+
+// uma central em loopback (lugar da HAL)
+struct CentralHost {
+  bool ligada = false;
+  uint16_t mtu = 23;
+  std::string linha;   // reconstrução das linhas fragmentadas
+  bool temSeq = false; // envelope de ligação (SEQ=1): seq esperado
+  uint32_t seqProx = 0;
+};
+
+uint64_t vNowUs = 0;
+uint64_t maxUs = 0;
+
+void (*timerCb)() = nullptr;
+uint64_t timerPeriodUs = 0;
+uint64_t timerNextUs = 0;
+bool inTimer = false;
+
+std::vector<TraceRow> trace;
+int traceCols = 0;
+size_t traceIdx = 0;
+std::vector<PinMap> pins;
+float ruidoSigma = 0;
+uint32_t ruidoEstado = 0x2545F491;
+// ligação congestionada: recusa pct% dos notify até congestaoAteUs
+uint32_t congestaoPct = 0;
+uint64_t congestaoAteUs = 0;
+uint32_t congestaoN = 0;
+// a task de envio voltaria BLE_TX_REPETIR_MS depois de um notify recusado
+bool bleRepetir = false;
+uint64_t bleRepetirUs = 0;
+
+std::vector<Scheduled> agenda;
+size_t agendaIdx = 0;
+bool xEnviado = false;
+
+std::string usbIn;
+std::string usbLinha;
+bool echoUsb = true;
+// linha série: o buffer de TX do ESP32 (1024 B) esvazia a baud/10 B/s
+uint32_t usbBaud = 115200;
+uint64_t usbCreditoUs = 0; // instante até onde o crédito já foi contado
+size_t usbCredito = 1024;
+FILE *usbFich = nullptr;
+bool echoBle = true;
+
+CentralHost centrais[HAL_BLE_LIGACOES_MAX];
+
+std::vector<uint8_t> flash;
+uint32_t flashBytes = 1024 * 1024;
+std::string flashPath;
+std::map<std::string, std::vector<uint8_t>> prefs;
+std::string prefsPath;
+// relógio de parede: desconhecido até halSetEpoch (HORA=)
+bool epochAcertado = false;
+uint64_t epochBaseUs = 0; // epoch em µs quando vNowUs era 0
+void (*frameHook)(const uint8_t *, size_t) = nullptr;
+
+HostStats stats = {};
+
+// xorshift32 + Box-Muller: reprodutível entre corridas
+float uniforme() {
+  ruidoEstado ^= ruidoEstado << 13;
+  ruidoEstado ^= ruidoEstado >> 17;
+  ruidoEstado ^= ruidoEstado << 5;
+  return (ruidoEstado >> 8) * (1.0f / 16777216.0f);
+}
+float gaussiana() {
+  float u = uniforme();
+  if (u < 1e-7f)
+    u = 1e-7f;
+  return sqrtf(-2 * logf(u)) * cosf(6.2831853f * uniforme());
+}
+
+void injetar(const Scheduled &s) {
+  if (s.viaUsb) {
+    usbIn += s.cmd;
+    usbIn += '\n';
+  } else if (s.binario) {
+    bleRxBytes(s.ligacao, (const uint8_t *)s.cmd.data(), s.cmd.size());
+  } else {
+    std::string linha = s.cmd + "\n";
+    bleRxBytes(s.ligacao, (const uint8_t *)linha.data(), linha.size());
+  }
+}
+
+bool traceAcabou() {
+  if (maxUs && vNowUs >= maxUs)
+    return true;
+  return !trace.empty() && vNowUs > stats.traceEndUs;
+}
+
+// comandos agendados e X automático no fim do traço
+void servirAgenda() {
+  while (agendaIdx < agenda.size() && agenda[agendaIdx].tUs <= vNowUs)
+    injetar(agenda[agendaIdx++]);
+  if (!xEnviado && traceAcabou()) {
+    xEnviado = true;
+    injetar({vNowUs, "X", false, false, 0});
+  }
+}
+
+void avancarPara(uint64_t alvo) {
+  while (timerCb && !inTimer && timerNextUs <= alvo) {
+    vNowUs = timerNextUs;
+    timerNextUs += timerPeriodUs;
+    inTimer = true;
+    timerCb();
+    inTimer = false;
+    stats.timerTicks++;
+    servirAgenda();
+  }
+  if (alvo > vNowUs)
+    vNowUs = alvo;
+  servirAgenda();
+  if (bleRepetir && vNowUs >= bleRepetirUs)
+    halBleTxKick();
+}
+
+bool parseLinha(const char *l, double *v, int &n) {
+  n = 0;
+  const char *p = l;
+  while (*p == ' ' || *p == '\t')
+    p++;
+  if (!(*p == '-' || *p == '.' || (*p >= '0' && *p <= '9')))
+    return false; // cabeçalho ou comentário
+  while (*p && n < HOST_TRACE_COLS) {
+    char *fim;
+    double d = strtod(p, &fim);
+    if (fim == p)
+      break;
+    v[n++] = d;
+    p = fim;
+    while (*p == ',' || *p == ';' || *p == ' ' || *p == '\t')
+      p++;
+  }
+  return n > 0;
+}
+
+} // namespace
+
+// =================== API do simulador ===================
+void hostSetAdcNoise(float sigma) { ruidoSigma = sigma; }
+void hostSetCongestao(uint32_t pct, uint32_t ateMs) {
+  congestaoPct = pct > 100 ? 100 : pct;
+  congestaoAteUs = ateMs ? (uint64_t)ateMs * 1000ULL : UINT64_MAX;
+}
+
+bool hostLoadTrace(const char *path, uint32_t hz) {
+  FILE *f = fopen(path, "r");
+  if (!f)
+    return false;
+  char linha[256];
+  trace.clear();
+  traceCols = 0;
+  while (fgets(linha, sizeof(linha), f)) {
+    double v[HOST_TRACE_COLS];
+    int n;
+    if (!parseLinha(linha, v, n))
+      continue;
+    TraceRow r = {};
+    if (n == 1) {
+      // só eog: t implícito
+      r.tUs = (uint64_t)trace.size() * 1000000ULL / (hz ? hz : 250);
+      r.col[1] = (int)v[0];
+    } else {
+      r.tUs = v[0] > 0 ? (uint64_t)(v[0] * 1000.0) : 0;
+      for (int i = 1; i < n; i++)
+        r.col[i] = (int)v[i];
+    }
+    if (!trace.empty() && r.tUs < trace.back().tUs)
+      r.tUs = trace.back().tUs;
+    traceCols = std::max(traceCols, n == 1 ? 2 : n);
+    trace.push_back(r);
+  }
+  fclose(f);
+  if (trace.empty())
+    return false;
+  uint64_t t0 = trace.front().tUs;
+  for (TraceRow &r : trace)
+    r.tUs -= t0;
+  stats.traceRows = trace.size();
+  stats.traceEndUs = trace.back().tUs;
+  traceIdx = 0;
+  return true;
+}
+
+void hostMapPin(int pin, int coluna, int valorPorOmissao) {
+  pins.push_back({pin, coluna, valorPorOmissao});
+}
+
+static void agendar(const Scheduled &s) {
+  auto it = std::upper_bound(
+      agenda.begin() + agendaIdx, agenda.end(), s,
+      [](const Scheduled &a, const Scheduled &b) { return a.tUs < b.tUs; });
+  agenda.insert(it, s);
+}
+
+void hostSchedule(uint32_t tMs, const char *cmd, bool viaUsb,
+                  uint8_t ligacao) {
+  agendar({(uint64_t)tMs * 1000ULL, cmd, viaUsb, false, ligacao});
+}
+
+void hostScheduleBytes(uint32_t tMs, uint8_t ligacao, const uint8_t *data,
+                       size_t len) {
+  agendar({(uint64_t)tMs * 1000ULL,
+           std::string((const char *)data, len), false, true, ligacao});
+}
+
+void hostBleConnect(uint16_t mtu) {
+  for (uint8_t i = 0; i < HAL_BLE_LIGACOES_MAX; i++) {
+    if (centrais[i].ligada)
+      continue;
+    bleTxLigacaoNova(i);
+    centrais[i].ligada = true;
+    centrais[i].mtu = mtu;
+    return;
+  }
+}
+
+void hostSetEcho(bool usb, bool ble) {
+  echoUsb = usb;
+  echoBle = ble;
+}
+
+bool hostSetUsbFile(const char *path) {
+  usbFich = fopen(path, "wb");
+  return usbFich != nullptr;
+}
+void hostCloseUsbFile() {
+  if (usbFich)
+    fclose(usbFich);
+  usbFich = nullptr;
+}
+
+void hostSetMaxMs(uint32_t ms) { maxUs = (uint64_t)ms * 1000ULL; }
+
+void hostSetStorage(uint32_t bytes, const char *path) {
+  flashBytes = bytes - bytes % HAL_STORAGE_SETOR;
+  flashPath = path ? path : "";
+}
+
+bool hostStorageSave() {
+  if (flashPath.empty() || flash.empty())
+    return true;
+  FILE *f = fopen(flashPath.c_str(), "wb");
+  if (!f)
+    return false;
+  bool ok = fwrite(flash.data(), 1, flash.size(), f) == flash.size();
+  return fclose(f) == 0 && ok;
+}
+
+void hostSetPrefs(const char *path) { prefsPath = path ? path : ""; }
+
+void hostSetFrameHook(void (*hook)(const uint8_t *, size_t)) {
+  frameHook = hook;
+}
+
+bool hostFinished() {
+  return xEnviado && agendaIdx >= agenda.size();
+}
+
+uint64_t hostNowUs() { return vNowUs; }
+
+const HostStats &hostStats() { return stats; }
+
+// =================== TEMPO ===================
+uint32_t halMillis() { return (uint32_t)(vNowUs / 1000ULL); }
+uint32_t halMicros() { return (uint32_t)vNowUs; }
+uint64_t halMicros64() { return vNowUs; }
+void halDelayMs(uint32_t ms) { avancarPara(vNowUs + (uint64_t)ms * 1000ULL); }
+void halDelayUs(uint32_t us) { avancarPara(vNowUs + us); }
+// ciclos = ns reais do PC: o perfil mede o custo de verdade, não o relógio
+// virtual (que não anda dentro de uma volta)
+uint32_t halCiclos() {
+  return (uint32_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+uint32_t halCiclosPorUs() { return 1000; }
+uint32_t halEpoch() {
+  return epochAcertado ? (uint32_t)((epochBaseUs + vNowUs) / 1000000ULL) : 0;
+}
+void halSetEpoch(uint32_t s) {
+  epochBaseUs = (uint64_t)s * 1000000ULL - vNowUs;
+  epochAcertado = true;
+}
+
+// =================== MEMÓRIA ===================
+uint32_t halHeapLivre() { return 0; }
+uint32_t halHeapMaiorBloco() { return 0; }
+
+// uma só thread
+void halCriticalEnter() {}
+void halCriticalExit() {}
+
+// =================== ADC ===================
+void halAdcBegin() {}
+void halAdcConfigPin(int pin, HalAdcRange range) {
+  (void)pin;
+  (void)range;
+}
+int halAdcRead(int pin) {
+  stats.adcReads++;
+  const PinMap *m = nullptr;
+  for (const PinMap &p : pins)
+    if (p.pin == pin)
+      m = &p;
+  if (!m)
+    return 0;
+  if (trace.empty() || m->coluna >= traceCols)
+    return m->valorPorOmissao;
+  // retenção de ordem zero: última linha com t <= agora
+  while (traceIdx + 1 < trace.size() && trace[traceIdx + 1].tUs <= vNowUs)
+    traceIdx++;
+  int v = trace[traceIdx].col[m->coluna];
+  if (ruidoSigma > 0) {
+    v += (int)lroundf(ruidoSigma * gaussiana());
+    v = v < 0 ? 0 : (v > 4095 ? 4095 : v);
+  }
+  return v;
+}
+
+// =================== TIMER ===================
+bool halTimerStart(void (*cb)(), uint32_t periodUs) {
+  timerCb = cb;
+  timerPeriodUs = periodUs ? periodUs : 1;
+  timerNextUs = vNowUs + timerPeriodUs;
+  return true;
+}
+void halTimerStop() { timerCb = nullptr; }
+
+// =================== CONSOLA ===================
+void halConsoleBegin(uint32_t baud) { usbBaud = baud; }
+bool halConsoleSetBaud(uint32_t baud) {
+  usbBaud = baud;
+  if (echoUsb)
+    printf("[%10.3f] USB a %lu baud\n", vNowUs / 1e6, (unsigned long)baud);
+  return true;
+}
+size_t halConsoleWritable() {
+  uint64_t bytes = (vNowUs - usbCreditoUs) * usbBaud / 10000000ULL;
+  if (bytes) {
+    usbCreditoUs += bytes * 10000000ULL / usbBaud;
+    usbCredito = (size_t)std::min<uint64_t>(1024, usbCredito + bytes);
+  }
+  return usbCredito;
+}
+size_t halConsoleWrite(const uint8_t *data, size_t len) {
+  len = std::min(len, halConsoleWritable());
+  usbCredito -= len;
+  stats.usbBytes += len;
+  if (usbFich)
+    fwrite(data, 1, len, usbFich);
+  for (size_t i = 0; i < len; i++) {
+    char c = (char)data[i];
+    if (c == '\r')
+      continue;
+    if (c == 0) { // fim de um registo da captura (CAP=): não é texto
+      usbLinha.clear();
+      continue;
+    }
+    if (c != '\n') {
+      usbLinha += c;
+      continue;
+    }
+    // o que sobra de um registo binário partido por um '\n' não se mostra
+    bool texto = true;
+    for (char x : usbLinha)
+      texto = texto && ((uint8_t)x >= 0x20 || x == '\t');
+    stats.usbLines++;
+    if (echoUsb && texto)
+      printf("[%10.3f] USB| %s\n", vNowUs / 1e6, usbLinha.c_str());
+    usbLinha.clear();
+  }
+  return len;
+}
+int halConsoleAvailable() { return (int)usbIn.size(); }
+int halConsolePeek() { return usbIn.empty() ? -1 : (uint8_t)usbIn[0]; }
+int halConsoleRead() {
+  if (usbIn.empty())
+    return -1;
+  int c = (uint8_t)usbIn[0];
+  usbIn.erase(0, 1);
+  return c;
+}
+void halSppWriteLine(const char *s) { (void)s; }
+
+// =================== ARMAZENAMENTO ===================
+// flash NOR: apagar põe 0xFF, escrever só limpa bits
+bool halStorageBegin() {
+  flash.assign(flashBytes, 0xFF);
+  if (!flashPath.empty()) {
+    FILE *f = fopen(flashPath.c_str(), "rb");
+    if (f) {
+      size_t n = fread(flash.data(), 1, flash.size(), f);
+      (void)n;
+      fclose(f);
+    }
+  }
+  return flashBytes > 0;
+}
+uint32_t halStorageSize() { return (uint32_t)flash.size(); }
+bool halStorageErase(uint32_t offset, uint32_t len) {
+  if (offset % HAL_STORAGE_SETOR || len % HAL_STORAGE_SETOR ||
+      (uint64_t)offset + len > flash.size())
+    return false;
+  memset(flash.data() + offset, 0xFF, len);
+  return true;
+}
+bool halStorageWrite(uint32_t offset, const void *data, size_t len) {
+  if ((uint64_t)offset + len > flash.size())
+    return false;
+  const uint8_t *p = (const uint8_t *)data;
+  for (size_t i = 0; i < len; i++)
+    flash[offset + i] &= p[i];
+  return true;
+}
+bool halStorageRead(uint32_t offset, void *data, size_t len) {
+  if ((uint64_t)offset + len > flash.size())
+    return false;
+  memcpy(data, flash.data() + offset, len);
+  return true;
+}
+
+// =================== PREFERÊNCIAS ===================
+// ficheiro: por chave, u8 tamanho da chave, chave, u16 tamanho, dados
+bool halPrefsBegin() {
+  prefs.clear();
+  if (prefsPath.empty())
+    return true;
+  FILE *f = fopen(prefsPath.c_str(), "rb");
+  if (!f)
+    return true;
+  int nc;
+  while ((nc = fgetc(f)) != EOF) {
+    std::string chave(nc, '\0');
+    uint8_t t[2];
+    if (fread(&chave[0], 1, nc, f) != (size_t)nc || fread(t, 1, 2, f) != 2)
+      break;
+    std::vector<uint8_t> v(t[0] | (t[1] << 8));
+    if (fread(v.data(), 1, v.size(), f) != v.size())
+      break;
+    prefs[chave] = v;
+  }
+  fclose(f);
+  return true;
+}
+size_t halPrefsRead(const char *chave, void *data, size_t max) {
+  auto it = prefs.find(chave);
+  if (it == prefs.end())
+    return 0;
+  if (it->second.size() <= max)
+    memcpy(data, it->second.data(), it->second.size());
+  return it->second.size();
+}
+bool halPrefsWrite(const char *chave, const void *data, size_t len) {
+  if (strlen(chave) > 15 || len > 0xFFFF)
+    return false;
+  const uint8_t *p = (const uint8_t *)data;
+  prefs[chave].assign(p, p + len);
+  if (prefsPath.empty())
+    return true;
+  FILE *f = fopen(prefsPath.c_str(), "wb");
+  if (!f)
+    return false;
+  for (const auto &kv : prefs) {
+    uint8_t t[2] = {(uint8_t)kv.second.size(),
+                    (uint8_t)(kv.second.size() >> 8)};
+    fputc((int)kv.first.size(), f);
+    fwrite(kv.first.data(), 1, kv.first.size(), f);
+    fwrite(t, 1, 2, f);
+    fwrite(kv.second.data(), 1, kv.second.size(), f);
+  }
+  return fclose(f) == 0;
+}
+
+// =================== BLE (loopback) ===================
+void halBleBegin(const char *name) {
+  if (!echoUsb)
+    return;
+  for (uint8_t i = 0; i < HAL_BLE_LIGACOES_MAX; i++)
+    if (i == 0 || centrais[i].ligada)
+      printf("[%10.3f] BLE loopback \"%s\" (central %u: MTU %u, %s)\n",
+             vNowUs / 1e6, name, (unsigned)i, (unsigned)centrais[i].mtu,
+             centrais[i].ligada ? "ligado" : "desligado");
+}
+bool halBleConnected() {
+  for (const CentralHost &c : centrais)
+    if (c.ligada)
+      return true;
+  return false;
+}
+bool halBleLigada(uint8_t ligacao) {
+  return ligacao < HAL_BLE_LIGACOES_MAX && centrais[ligacao].ligada;
+}
+uint16_t halBleMtu() {
+  uint16_t min = 0;
+  for (const CentralHost &c : centrais)
+    if (c.ligada && (min == 0 || c.mtu < min))
+      min = c.mtu;
+  return min ? min : 23;
+}
+uint16_t halBleMtuLigacao(uint8_t ligacao) {
+  return halBleLigada(ligacao) ? centrais[ligacao].mtu : 23;
+}
+// loopback: não há link layer, só o MTU dado a hostBleConnect
+bool halBleLigacao(uint8_t ligacao, HalBleLigacao &out) {
+  out = HalBleLigacao();
+  if (!halBleLigada(ligacao))
+    return false;
+  out.mtu = centrais[ligacao].mtu;
+  return true;
+}
+namespace {
+// "BLE<" na central 0 (a saída de sempre), "BLE1<", ... nas outras
+void prefixo(uint8_t i) {
+  if (i == 0)
+    printf("[%10.3f] BLE<", vNowUs / 1e6);
+  else
+    printf("[%10.3f] BLE%u<", vNowUs / 1e6, (unsigned)i);
+}
+// trama binária: uma por notificação
+void receberTrama(uint8_t i, const uint8_t *data, size_t len) {
+  stats.bleFrames++;
+  if (frameHook && i == 0)
+    frameHook(data, len);
+  if (echoBle) {
+    prefixo(i);
+    printf(" bin %zu B:", len);
+    for (size_t k = 0; k < len; k++)
+      printf(" %02x", data[k]);
+    printf("\n");
+  }
+}
+void receberTexto(uint8_t i, const uint8_t *data, size_t len) {
+  std::string &linha = centrais[i].linha;
+  for (size_t k = 0; k < len; k++) {
+    if (data[k] != '\n') {
+      linha += (char)data[k];
+      continue;
+    }
+    stats.bleLines++;
+    if (echoBle) {
+      prefixo(i);
+      printf(" %s\n", linha.c_str());
+    }
+    linha.clear();
+  }
+}
+// SEQ=1: tira o envelope e conta os seq que não chegaram (uma app sabe que
+// o pediu; aqui pergunta-se à fila)
+bool receberEnvelope(uint8_t i, const uint8_t *data, size_t len) {
+  if (len < RT_FRAME_LIGACAO_LEN || data[0] != RT_FRAME_MAGIC ||
+      data[2] != RT_FRAME_TYPE_LIGACAO)
+    return false;
+  CentralHost &c = centrais[i];
+  uint32_t seq = (uint32_t)data[3] | ((uint32_t)data[4] << 8) |
+                 ((uint32_t)data[5] << 16) | ((uint32_t)data[6] << 24);
+  if (data[16] == 0) { // 1º fragmento: uma mensagem nova
+    if (c.temSeq && seq != c.seqProx)
+      stats.bleSeqPerdidas += seq - c.seqProx;
+    c.temSeq = true;
+    c.seqProx = seq + 1;
+    stats.bleEnvelopes++;
+  }
+  const uint8_t *p = data + RT_FRAME_LIGACAO_LEN;
+  size_t n = len - RT_FRAME_LIGACAO_LEN;
+  if (data[15] & RT_LIGACAO_TEXTO)
+    receberTexto(i, p, n);
+  else
+    receberTrama(i, p, n);
+  return true;
+}
+} // namespace
+
+bool halBleNotify(uint8_t ligacao, const uint8_t *data, size_t len) {
+  if (!halBleLigada(ligacao))
+    return false;
+  // sempre o mesmo padrão: pct recusas espalhadas em cada 100 notify
+  if (congestaoPct && vNowUs < congestaoAteUs &&
+      congestaoN++ * congestaoPct % 100 < congestaoPct) {
+    stats.notifiesRecusados++;
+    return false;
+  }
+  stats.notifies++;
+  stats.notifyBytes += len;
+  stats.notifiesPor[ligacao]++;
+  stats.notifyBytesPor[ligacao] += len;
+  if (bleTxEnvelopeAtivo(ligacao) && receberEnvelope(ligacao, data, len))
+    return true;
+  if (centrais[ligacao].linha.empty() && len > 0 && data[0] >= 0x80)
+    receberTrama(ligacao, data, len);
+  else
+    receberTexto(ligacao, data, len);
+  return true;
+}
+// produtor e consumidor na mesma thread: esvazia logo
+void halBleTxKick() {
+  bleRepetir = bleTxDrain();
+  bleRepetirUs = vNowUs + BLE_TX_REPETIR_MS * 1000ULL;
+}
@@ -0,0 +1,75 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include "hal.h"
+
+// =================== HAL DE HOST (Linux) ===================
+// Relógio virtual: o tempo só anda em halDelayMs/halDelayUs, e o timer de
+// aquisição dispara dentro desses delays. O ADC devolve o valor do traço CSV
+// no instante virtual; o BLE é um loopback (TX vai para stdout, RX recebe os
+// comandos agendados). Tudo corre numa só thread, muito mais rápido do que o
+// tempo real.
+
+// Traço CSV: "t_ms,eog[,ax,ay,az[,eog_h]]" por linha (cabeçalho/comentários
+// são ignorados). Com uma só coluna (eog), as linhas ficam espaçadas a hz.
+#define HOST_TRACE_COLS 6
+bool hostLoadTrace(const char *path, uint32_t hz);
+// pino do ADC -> coluna do traço (1 = eog); valor se a coluna não existir
+void hostMapPin(int pin, int coluna, int valorPorOmissao);
+// ruído gaussiano (desvio padrão em LSB) somado a cada leitura do traço,
+// como o do ADC do ESP32; sempre a mesma sequência (semente fixa)
+void hostSetAdcNoise(float sigma);
+// ligação congestionada: halBleNotify recusa pct% das notificações (como
+// o NimBLE sem buffers) até ateMs de tempo virtual (0 = sempre)
+void hostSetCongestao(uint32_t pct, uint32_t ateMs);
+// comando injetado aos tMs pelo RX BLE da central `ligacao` (ou pela
+// consola USB se viaUsb)
+void hostSchedule(uint32_t tMs, const char *cmd, bool viaUsb,
+                  uint8_t ligacao);
+// escrita binária na RX BLE (ex.: trama CMD de cmd_fila.h), sem '\n'
+void hostScheduleBytes(uint32_t tMs, uint8_t ligacao, const uint8_t *data,
+                       size_t len);
+// liga mais uma central (lugares 0, 1, ... até HAL_BLE_LIGACOES_MAX); só a
+// 0 passa as tramas ao hook, as outras só aparecem no eco e nos contadores
+void hostBleConnect(uint16_t mtu);
+void hostSetEcho(bool usb, bool ble);
+// tudo o que sai pela USB, byte a byte, como um `cat` da porta série (ex.:
+// a captura CAP= para o cap_dump). A USB esvazia ao ritmo do baud.
+bool hostSetUsbFile(const char *path);
+void hostCloseUsbFile();
+// limite de tempo virtual (0 = até ao fim do traço)
+void hostSetMaxMs(uint32_t ms);
+// flash do gravador em RAM com `bytes` (0 = sem partição). Com path, a
+// imagem é lida daí no início (se existir) e escrita por hostStorageSave(),
+// o que deixa descarregar (DL) numa corrida o que outra gravou.
+void hostSetStorage(uint32_t bytes, const char *path);
+bool hostStorageSave();
+// preferências (NVS) em RAM. Com path, são lidas daí no início (se existir)
+// e o ficheiro é reescrito a cada halPrefsWrite, como a NVS: o perfil de
+// calibração de uma corrida serve de arranque a quente na seguinte.
+void hostSetPrefs(const char *path);
+// chamada para cada notificação binária (ex.: juntar os blocos de um DL)
+void hostSetFrameHook(void (*hook)(const uint8_t *data, size_t len));
+// fim do traço (já foi enviado X) e nenhum comando por injetar
+bool hostFinished();
+uint64_t hostNowUs();
+
+struct HostStats {
+  uint64_t adcReads;
+  uint64_t timerTicks;
+  uint64_t notifies;
+  uint64_t notifyBytes;
+  uint64_t bleLines;
+  uint64_t bleFrames;
+  uint64_t notifiesPor[HAL_BLE_LIGACOES_MAX]; // por central
+  uint64_t notifyBytesPor[HAL_BLE_LIGACOES_MAX];
+  uint64_t bleEnvelopes;   // mensagens com envelope de ligação (SEQ=1)
+  uint64_t bleSeqPerdidas; // buracos no seq do envelope
+  uint64_t notifiesRecusados; // hostSetCongestao
+  uint64_t usbLines;
+  uint64_t usbBytes;
+  uint64_t traceRows;
+  uint64_t traceEndUs;
+};
+const HostStats &hostStats();
@@ -0,0 +1,118 @@
+// Compara o roll/pitch inteiro (orientacao.cpp) com o caminho antigo em float
+// (atan2f/sqrtf sobre as mesmas médias) em toda a gama útil do ADXL335, e
+// mede o custo de cada um por chamada. O erro conta à parte os pontos com
+// |g| entre 0.7 e 1.3 (cabeça parada ou a acenar): perto de 0 g o ângulo é
+// dominado pela quantização e não tem significado físico.
+//
+//   orient_check [passo_lsb] [erro_max]
+//
+// passo da grelha em LSB do ADC (omissão 4); com erro_max (graus), sai com 1
+// se o erro máximo com |g| entre 0.7 e 1.3 passar dele (ctest).
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <chrono>
+
+#include "orientacao.h"
+
+// calibração do firmware (main.cpp)
+static const float OFFSET[3] = {704.3f, 700.8f, 740.0f};
+static const float ESCALA[3] = {207.7f, 203.2f, 206.6f};
+static const AccCalib CAL = {{11269, 11213, 11840}, {3323, 3251, 3306}};
+
+// updateAccelerometer() antigo, sem o EWMA; devolve |g| antes do limite
+static float orientacaoFloat(const float raw[3], float &roll, float &pitch) {
+  float gx = (raw[0] - OFFSET[0]) / ESCALA[0];
+  float gy = (raw[1] - OFFSET[1]) / ESCALA[1];
+  float gz = -(raw[2] - OFFSET[2]) / ESCALA[2];
+  float g = sqrtf(gx * gx + gy * gy + gz * gz);
+  gx = fminf(fmaxf(gx, -1.0f), 1.0f);
+  gy = fminf(fmaxf(gy, -1.0f), 1.0f);
+  gz = fminf(fmaxf(gz, -1.0f), 1.0f);
+  pitch = atan2f(gx, sqrtf(gz * gz + gy * gy)) * 57.2957795f;
+  roll = atan2f(gz, sqrtf(gx * gx + gy * gy)) * 57.2957795f;
+  return g;
+}
+
+struct Erro {
+  double max = 0;
+  double soma = 0;
+  long n = 0;
+  void add(double e) {
+    e = fabs(e);
+    if (e > max)
+      max = e;
+    soma += e;
+    n++;
+  }
+};
+
+int main(int argc, char **argv) {
+  int passo = argc > 1 ? atoi(argv[1]) : 4;
+  if (passo < 1)
+    passo = 1;
+  double erroMax = argc > 2 ? atof(argv[2]) : -1;
+  // +-1.3 g à volta do offset de cada eixo
+  int lo[3], hi[3];
+  for (int i = 0; i < 3; i++) {
+    lo[i] = (int)(OFFSET[i] - 1.3f * ESCALA[i]);
+    hi[i] = (int)(OFFSET[i] + 1.3f * ESCALA[i]);
+  }
+  Erro eRoll, ePitch, eRoll1g, ePitch1g;
+  double tFloat = 0, tInt = 0;
+  volatile float sinkF = 0;
+  volatile int sinkI = 0;
+  using relogio = std::chrono::steady_clock;
+  for (int x = lo[0]; x <= hi[0]; x += passo) {
+    for (int y = lo[1]; y <= hi[1]; y += passo) {
+      // uma linha de z de cada vez: o cronómetro fica fora do ciclo interior
+      float rollF[1024], pitchF[1024], g[1024];
+      int16_t rollI[1024], pitchI[1024];
+      int n = 0;
+      auto t0 = relogio::now();
+      for (int z = lo[2]; z <= hi[2] && n < 1024; z += passo, n++) {
+        float raw[3] = {(float)x, (float)y, (float)z};
+        g[n] = orientacaoFloat(raw, rollF[n], pitchF[n]);
+      }
+      auto t1 = relogio::now();
+      n = 0;
+      for (int z = lo[2]; z <= hi[2] && n < 1024; z += passo, n++) {
+        uint16_t q4[3] = {(uint16_t)(x * 16), (uint16_t)(y * 16),
+                          (uint16_t)(z * 16)};
+        orientacaoCalc(CAL, q4, rollI[n], pitchI[n]);
+      }
+      auto t2 = relogio::now();
+      tFloat += std::chrono::duration<double, std::nano>(t1 - t0).count();
+      tInt += std::chrono::duration<double, std::nano>(t2 - t1).count();
+      for (int k = 0; k < n; k++) {
+        eRoll.add(rollI[k] / 10.0 - rollF[k]);
+        ePitch.add(pitchI[k] / 10.0 - pitchF[k]);
+        if (g[k] >= 0.7f && g[k] <= 1.3f) {
+          eRoll1g.add(rollI[k] / 10.0 - rollF[k]);
+          ePitch1g.add(pitchI[k] / 10.0 - pitchF[k]);
+        }
+        sinkF = sinkF + rollF[k];
+        sinkI = sinkI + rollI[k];
+      }
+    }
+  }
+  printf("pontos: %ld (passo %d LSB)\n", eRoll.n, passo);
+  printf("|g| 0.7..1.3 (%ld pontos):\n", eRoll1g.n);
+  printf("  roll : erro máx %.3f°, médio %.3f°\n", eRoll1g.max,
+         eRoll1g.soma / eRoll1g.n);
+  printf("  pitch: erro máx %.3f°, médio %.3f°\n", ePitch1g.max,
+         ePitch1g.soma / ePitch1g.n);
+  printf("toda a grelha:\n");
+  printf("  roll : erro máx %.3f°, médio %.3f°\n", eRoll.max,
+         eRoll.soma / eRoll.n);
+  printf("  pitch: erro máx %.3f°, médio %.3f°\n", ePitch.max,
+         ePitch.soma / ePitch.n);
+  printf("custo por chamada (PC): float %.1f ns, inteiro %.1f ns\n",
+         tFloat / eRoll.n, tInt / eRoll.n);
+  if (erroMax >= 0 && (eRoll1g.max > erroMax || ePitch1g.max > erroMax)) {
+    fprintf(stderr, "erro acima de %.3f°\n", erroMax);
+    return 1;
+  }
+  return 0;
+}
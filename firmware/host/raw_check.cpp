@@ -0,0 +1,169 @@
+// Ida e volta do codec RAW (raw_codec.h): gera EOG sintético pelo mesmo
+// EogDsp da aquisição (OS=8, FLT=2), comprime-o em blocos como o firmware
+// (um envio a cada 250 ms, tantas tramas quantas forem precisas), descomprime
+// e compara amostra a amostra. Mostra, para cada MTU, bytes/s, notificações/s
+// e bits por amostra, ao lado do RT em JSON a 10 Hz. -w troca o sinal por
+// ruído branco de 12 bits (o pior caso do codec).
+//
+//   raw_check [-f fs] [-k canais] [-N sigma] [-s segundos] [-w]
+//
+// Sai com 1 se alguma amostra não voltar igual.
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <vector>
+
+#include "eog_dsp.h"
+#include "raw_codec.h"
+#include "rt_frame.h"
+
+static uint32_t estado = 0x2545F491;
+static float uniforme() {
+  estado ^= estado << 13;
+  estado ^= estado >> 17;
+  estado ^= estado << 5;
+  return (estado >> 8) * (1.0f / 16777216.0f);
+}
+static float gaussiana() {
+  float u = uniforme();
+  if (u < 1e-7f)
+    u = 1e-7f;
+  return sqrtf(-2 * logf(u)) * cosf(6.2831853f * uniforme());
+}
+
+// canal 0 (vertical): deriva lenta e uma piscadela (-400, 200 ms) a cada 3 s;
+// os outros (horizontais): sacadas de +-150 a cada 2 s
+static float limpo(int canal, double t) {
+  if (canal > 0) {
+    long passo = (long)floor(t / 2 + canal * 0.3);
+    return 2048 + ((passo & 1) ? 150.0f : -150.0f);
+  }
+  float deriva = 60 * sinf(6.2831853f * 0.05f * (float)t);
+  double fase = fmod(t, 3.0);
+  float blink = 0;
+  if (fase > 1.4 && fase < 1.6)
+    blink = -400 * sinf(3.14159265f * (float)((fase - 1.4) / 0.2));
+  return 2048 + deriva + blink;
+}
+
+int main(int argc, char **argv) {
+  int fs = 250;
+  int canais = 2;
+  float sigma = 20;
+  int segundos = 60;
+  bool ruido = false;
+  int opt;
+  while ((opt = getopt(argc, argv, "f:k:N:s:w")) != -1) {
+    switch (opt) {
+    case 'f':
+      fs = atoi(optarg);
+      break;
+    case 'k':
+      canais = atoi(optarg);
+      break;
+    case 'N':
+      sigma = (float)atof(optarg);
+      break;
+    case 's':
+      segundos = atoi(optarg);
+      break;
+    case 'w':
+      ruido = true;
+      break;
+    default:
+      fprintf(stderr, "uso: %s [-f fs] [-k canais] [-N sigma] [-s seg] [-w]\n",
+              argv[0]);
+      return 2;
+    }
+  }
+  if (fs < 1 || fs > 1000 || canais < 1 || canais > ACQ_CANAIS_MAX ||
+      segundos < 1) {
+    fprintf(stderr, "fs 1..1000, canais 1..%d, segundos >= 1\n",
+            ACQ_CANAIS_MAX);
+    return 2;
+  }
+
+  // amostras intercaladas [i * canais + c], já à saída do DSP
+  long n = (long)segundos * fs;
+  std::vector<uint16_t> sinal(n * canais);
+  const uint8_t os = 8;
+  for (int c = 0; c < canais; c++) {
+    EogDsp dsp;
+    dsp.configurar(os, DSP_FIR_IIR, (uint16_t)fs);
+    long i = 0;
+    for (long k = 0; i < n; k++) {
+      if (ruido) {
+        sinal[i++ * canais + c] = (uint16_t)(uniforme() * 4096) & 0x0FFF;
+        continue;
+      }
+      float v = limpo(c, (double)k / ((double)fs * os)) + sigma * gaussiana();
+      uint16_t out;
+      if (dsp.push((uint16_t)(v < 0 ? 0 : (v > 4095 ? 4095 : v)), out))
+        sinal[i++ * canais + c] = out;
+    }
+  }
+
+  printf("fs=%d Hz, %d canais, %s, %d s\n", fs, canais,
+         ruido ? "ruído branco de 12 bits" : "EOG sintético", segundos);
+  // ["RT",ts,eog,roll,pitch(,eog_c...)] a 10 Hz, como o firmware
+  char linha[96];
+  int lenJson = snprintf(linha, sizeof(linha), "[\"RT\",123456,%d,-12.3,4.5",
+                         (int)sinal[0]);
+  for (int c = 1; c < canais; c++)
+    lenJson += snprintf(linha + lenJson, sizeof(linha) - lenJson, ",%u",
+                        (unsigned)sinal[c]);
+  lenJson += 2; // "]\n"
+  printf("%5s %7s %9s %9s %10s %6s\n", "MTU", "blocos", "bytes/s", "notif/s",
+         "bits/amos", "ok");
+  bool tudoOk = true;
+  static const uint16_t mtus[] = {23, 64, 128, 185, 247};
+  for (uint16_t mtu : mtus) {
+    size_t maxLen = (size_t)(mtu - 3);
+    if (maxLen <= RAW_CABECALHO_LEN + 2 * (size_t)canais) {
+      printf("%5u  (o cabeçalho de %d canais não cabe)\n", (unsigned)mtu,
+             canais);
+      continue;
+    }
+    RawCodificador cod;
+    cod.reset((uint16_t)fs, (uint8_t)canais);
+    long blocos = 0, bytes = 0, lidas = 0;
+    bool ok = true;
+    long porEnvio = fs / 4 > 0 ? fs / 4 : 1;
+    uint8_t trama[RT_FRAME_MAX_LEN];
+    std::vector<uint16_t> v(255 * canais);
+    for (long i = 0; i < n && ok; i++) {
+      cod.add((uint32_t)(i * 1000000LL / fs), &sinal[i * canais]);
+      if ((i + 1) % porEnvio != 0 && i + 1 != n)
+        continue;
+      while (cod.pendentes() && ok) {
+        size_t len = cod.montar(trama, maxLen);
+        RawBloco cab;
+        int m = len ? rawDescodificar(trama, len, cab, v.data(), v.size())
+                    : -1;
+        if (m < 0 || cab.seq != (uint16_t)blocos ||
+            cab.t0Us != (uint32_t)(lidas * 1000000LL / fs) ||
+            lidas + m > n ||
+            memcmp(v.data(), &sinal[lidas * canais],
+                   (size_t)m * canais * sizeof(uint16_t)) != 0) {
+          ok = false;
+          break;
+        }
+        lidas += m;
+        blocos++;
+        bytes += (long)len;
+      }
+    }
+    ok = ok && lidas == n && cod.perdidas() == 0;
+    tudoOk = tudoOk && ok;
+    printf("%5u %7ld %9.1f %9.1f %10.2f %6s\n", (unsigned)mtu, blocos,
+           (double)bytes / segundos, (double)blocos / segundos,
+           8.0 * bytes / ((double)n * canais), ok ? "sim" : "NÃO");
+  }
+  printf("RT JSON a 10 Hz: %d bytes/s (%d bytes por linha), %d notif/s com "
+         "MTU 23, 10 com MTU >= %d\n",
+         10 * lenJson, lenJson, 10 * ((lenJson + 19) / 20), lenJson + 3);
+  return tudoOk ? 0 : 1;
+}
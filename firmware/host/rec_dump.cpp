@@ -0,0 +1,213 @@
+// Descodifica blocos do gravador de sessão (rec_sessao.h): o ficheiro do -D
+// do eog_host, ou uma imagem inteira da flash (-f). Escreve as amostras como
+// traço CSV "t_ms,eog" (o eog_host consegue repeti-lo) e piscadelas, minutos
+// e buracos como linhas de comentário.
+//
+//   rec_dump blocos.bin > sessao.csv
+//   rec_dump -s 3 flash.bin > sessao3.csv   (só a sessão 3)
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "rec_sessao.h"
+
+static uint32_t lerU32(const uint8_t *p) {
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) |
+         ((uint32_t)p[3] << 24);
+}
+
+struct Leitor {
+  const uint8_t *p;
+  const uint8_t *fim;
+  bool ok = true;
+  uint8_t u8() {
+    if (p >= fim) {
+      ok = false;
+      return 0;
+    }
+    return *p++;
+  }
+  uint32_t v() {
+    uint32_t r = 0;
+    for (int s = 0; s < 35; s += 7) {
+      uint8_t b = u8();
+      r |= (uint32_t)(b & 0x7F) << s;
+      if (!(b & 0x80))
+        break;
+    }
+    return r;
+  }
+  int32_t z() {
+    uint32_t u = v();
+    return (int32_t)(u >> 1) ^ -(int32_t)(u & 1);
+  }
+  uint32_t u32() {
+    uint32_t r = 0;
+    for (int i = 0; i < 4; i++)
+      r |= (uint32_t)u8() << (8 * i);
+    return r;
+  }
+};
+
+struct Bloco {
+  uint32_t seq;
+  uint16_t sessao;
+  uint32_t t0;
+  std::vector<uint8_t> regs;
+};
+
+// µs de 32 bits do firmware -> tempo contínuo desde a 1ª amostra
+static uint64_t tBase = 0;
+static uint32_t tUltimo = 0;
+static bool tIniciado = false;
+static uint64_t desdobrar(uint32_t t) {
+  if (!tIniciado) {
+    tIniciado = true;
+    tUltimo = t;
+    tBase = 0;
+    return 0;
+  }
+  tBase += (uint32_t)(t - tUltimo);
+  tUltimo = t;
+  return tBase;
+}
+
+static unsigned long totalAmostras = 0;
+// seguem de um bloco para o outro (cada bloco começa com REC_TEMPO)
+static uint32_t periodoUs = 4000;
+static uint32_t proxUs = 0;
+
+static bool descodificar(const Bloco &b) {
+  Leitor r{b.regs.data(), b.regs.data() + b.regs.size()};
+  int anterior = 0;
+  while (r.ok && r.p < r.fim) {
+    uint8_t tag = r.u8();
+    switch (tag) {
+    case REC_INICIO: {
+      uint32_t fs = r.v();
+      uint32_t limiar = r.v();
+      uint32_t ampMin = r.v();
+      if (fs)
+        periodoUs = 1000000UL / fs;
+      printf("# sessão %u: fs=%u Hz limiarInferior=%u amplitudeMin=%u\n",
+             b.sessao, fs, limiar, ampMin);
+      break;
+    }
+    case REC_TEMPO: {
+      uint32_t t = r.u32();
+      if (tIniciado && (int32_t)(t - proxUs) != 0)
+        printf("# buraco: %+.1f ms\n", (int32_t)(t - proxUs) / 1000.0);
+      proxUs = t;
+      break;
+    }
+    case REC_AMOSTRAS: {
+      uint8_t n = r.u8();
+      for (int i = 0; i < n && r.ok; i++) {
+        anterior += r.z();
+        printf("%.3f,%d\n", desdobrar(proxUs) / 1000.0, anterior);
+        proxUs += periodoUs;
+        totalAmostras++;
+      }
+      break;
+    }
+    case REC_PISCADELA: {
+      uint8_t cls = r.u8();
+      int32_t tPicoMs = r.z();
+      uint32_t dur = r.v();
+      uint32_t amp = r.v();
+      uint32_t vel = r.v();
+      static const char *nomes[] = {"outra", "normal", "lenta"};
+      printf("# piscadela %s: pico t0%+dms duração=%ums amplitude=%u "
+             "velMaxDesc=%.2f\n",
+             cls < 3 ? nomes[cls] : "?", tPicoMs, dur, amp, vel / 100.0);
+      break;
+    }
+    case REC_MINUTO: {
+      uint32_t m = r.v();
+      uint32_t normais = r.v();
+      uint32_t lentas = r.v();
+      uint8_t sono = r.u8();
+      printf("# minuto %u: normais=%u lentas=%u %s\n", m, normais, lentas,
+             sono ? "S-" : "NS-");
+      break;
+    }
+    case REC_FIM:
+      printf("# fim da sessão %u\n", b.sessao);
+      break;
+    default:
+      r.ok = false;
+    }
+  }
+  return r.ok;
+}
+
+int main(int argc, char **argv) {
+  int sessao = -1;
+  int opt;
+  while ((opt = getopt(argc, argv, "s:")) != -1) {
+    if (opt != 's') {
+      fprintf(stderr, "uso: %s [-s sessão] blocos.bin\n", argv[0]);
+      return 2;
+    }
+    sessao = atoi(optarg);
+  }
+  if (optind != argc - 1) {
+    fprintf(stderr, "uso: %s [-s sessão] blocos.bin\n", argv[0]);
+    return 2;
+  }
+  FILE *f = fopen(argv[optind], "rb");
+  if (!f) {
+    fprintf(stderr, "não consegui abrir %s\n", argv[optind]);
+    return 1;
+  }
+  std::vector<uint8_t> dados;
+  uint8_t buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+    dados.insert(dados.end(), buf, buf + n);
+  fclose(f);
+
+  // blocos seguidos (-D) ou um por setor (imagem da flash): procura o magic
+  // em cada múltiplo de 4 bytes e salta o bloco inteiro quando o encontra
+  std::vector<Bloco> blocos;
+  unsigned maus = 0;
+  for (size_t i = 0; i + REC_CABECALHO_LEN <= dados.size();) {
+    const uint8_t *c = dados.data() + i;
+    uint32_t len = c[10] | (c[11] << 8);
+    if (lerU32(c) != REC_MAGIC || lerU32(c + 4) == 0xFFFFFFFFUL ||
+        i + REC_CABECALHO_LEN + len > dados.size()) {
+      i += 4;
+      continue;
+    }
+    const uint8_t *regs = c + REC_CABECALHO_LEN;
+    if (recCrc32(regs, len) != lerU32(c + 16)) {
+      maus++;
+      i += 4;
+      continue;
+    }
+    Bloco b;
+    b.seq = lerU32(c + 4);
+    b.sessao = (uint16_t)(c[8] | (c[9] << 8));
+    b.t0 = lerU32(c + 12);
+    b.regs.assign(regs, regs + len);
+    if (sessao < 0 || b.sessao == sessao)
+      blocos.push_back(b);
+    i += REC_CABECALHO_LEN + len;
+  }
+  std::sort(blocos.begin(), blocos.end(),
+            [](const Bloco &a, const Bloco &b) { return a.seq < b.seq; });
+
+  printf("t_ms,eog\n");
+  unsigned invalidos = 0;
+  for (const Bloco &b : blocos)
+    if (!descodificar(b))
+      invalidos++;
+  fprintf(stderr, "%zu blocos, %lu amostras, %u com CRC errado, %u mal "
+          "formados\n",
+          blocos.size(), totalAmostras, maus, invalidos);
+  return 0;
+}